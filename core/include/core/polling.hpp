@@ -0,0 +1,12 @@
+#pragma once
+
+#include <async/result.hpp>
+#include <frg/string.hpp>
+#include <helix/ipc.hpp>
+
+// Enables adaptive polling (see helix::Dispatcher::setSpinLimit()) if the system
+// has more than one CPU; on a single CPU, polling cannot observe any progress.
+// The kernel command line option "<driver>.spin=<limit>" overrides the default
+// limit; a limit of zero disables polling.
+async::result<void> configurePolling(helix::Dispatcher &dispatcher,
+		frg::string_view driver, unsigned int default_limit);
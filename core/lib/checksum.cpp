@@ -0,0 +1,168 @@
+#include <core/checksum.hpp>
+
+#include <arch/bit.hpp>
+#include <cstring>
+
+#ifdef __x86_64__
+#include <immintrin.h>
+#endif
+
+// The one's complement sum is independent of byte order (RFC 1071, 2.(B)):
+// we sum up native-endian words in a wide accumulator, fold the result
+// down to 16 bits and only convert the folded sum to big endian.
+// Since folding preserves the sum modulo 0xFFFF (and never turns a non-zero sum
+// into zero), the result is identical to folding after every word.
+
+namespace {
+
+uint16_t fold(uint64_t sum) {
+	sum = (sum >> 32) + (sum & 0xFFFF'FFFF);
+	sum = (sum >> 32) + (sum & 0xFFFF'FFFF);
+	sum = (sum >> 16) + (sum & 0xFFFF);
+	sum = (sum >> 16) + (sum & 0xFFFF);
+	sum = (sum >> 16) + (sum & 0xFFFF);
+	return sum;
+}
+
+// Adds a 64-bit word with end-around carry.
+uint64_t addCarry(uint64_t sum, uint64_t word) {
+	uint64_t result;
+	if(__builtin_add_overflow(sum, word, &result))
+		result++;
+	return result;
+}
+
+// Sums up size bytes (size must be even) in native byte order.
+uint64_t sumGeneric(const unsigned char *p, size_t size) {
+	uint64_t sum = 0;
+
+	// Use four independent accumulators to break the dependency chain.
+	uint64_t acc[4] = {};
+	while(size >= 32) {
+		for(int i = 0; i < 4; i++) {
+			uint64_t word;
+			std::memcpy(&word, p + 8 * i, 8);
+			acc[i] = addCarry(acc[i], word);
+		}
+		p += 32;
+		size -= 32;
+	}
+	for(int i = 0; i < 4; i++)
+		sum = addCarry(sum, acc[i]);
+
+	while(size >= 8) {
+		uint64_t word;
+		std::memcpy(&word, p, 8);
+		sum = addCarry(sum, word);
+		p += 8;
+		size -= 8;
+	}
+	while(size >= 2) {
+		uint16_t word;
+		std::memcpy(&word, p, 2);
+		sum = addCarry(sum, word);
+		p += 2;
+		size -= 2;
+	}
+	return sum;
+}
+
+#ifdef __x86_64__
+
+// Each 32-bit lane receives up to 2 * 0xFFFF per step; flush before it can overflow.
+constexpr size_t vectorFlushInterval = 0x8000;
+
+uint64_t sumSse2(const unsigned char *p, size_t size) {
+	uint64_t sum = 0;
+	auto zero = _mm_setzero_si128();
+	while(size >= 16) {
+		auto acc = _mm_setzero_si128();
+		size_t n = 0;
+		for(; size >= 16 && n < vectorFlushInterval; n++) {
+			auto v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p));
+			acc = _mm_add_epi32(acc, _mm_unpacklo_epi16(v, zero));
+			acc = _mm_add_epi32(acc, _mm_unpackhi_epi16(v, zero));
+			p += 16;
+			size -= 16;
+		}
+
+		uint32_t lanes[4];
+		_mm_storeu_si128(reinterpret_cast<__m128i *>(lanes), acc);
+		for(auto lane : lanes)
+			sum = addCarry(sum, lane);
+	}
+	return addCarry(sum, sumGeneric(p, size));
+}
+
+[[gnu::target("avx2")]]
+uint64_t sumAvx2(const unsigned char *p, size_t size) {
+	uint64_t sum = 0;
+	auto zero = _mm256_setzero_si256();
+	while(size >= 32) {
+		auto acc = _mm256_setzero_si256();
+		size_t n = 0;
+		for(; size >= 32 && n < vectorFlushInterval; n++) {
+			auto v = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(p));
+			acc = _mm256_add_epi32(acc, _mm256_unpacklo_epi16(v, zero));
+			acc = _mm256_add_epi32(acc, _mm256_unpackhi_epi16(v, zero));
+			p += 32;
+			size -= 32;
+		}
+
+		uint32_t lanes[8];
+		_mm256_storeu_si256(reinterpret_cast<__m256i *>(lanes), acc);
+		for(auto lane : lanes)
+			sum = addCarry(sum, lane);
+	}
+	return addCarry(sum, sumSse2(p, size));
+}
+
+#endif // __x86_64__
+
+using SumFunction = uint64_t (*)(const unsigned char *, size_t);
+
+SumFunction selectSumFunction() {
+#ifdef __x86_64__
+	__builtin_cpu_init();
+	if(__builtin_cpu_supports("avx2"))
+		return sumAvx2;
+	// SSE2 is part of the x86_64 baseline.
+	return sumSse2;
+#else
+	return sumGeneric;
+#endif
+}
+
+SumFunction sumFunction = selectSumFunction();
+
+} // anonymous namespace
+
+void Checksum::update(uint16_t word)  {
+	state_ += word;
+	while (state_ >> 16 != 0) {
+		state_ = (state_ >> 16) + (state_ & 0xffff);
+	}
+}
+
+void Checksum::update(const void *data, size_t size) {
+	using namespace arch;
+	auto iter = static_cast<const unsigned char*>(data);
+	if (size % 2 != 0) {
+		size--;
+		update(iter[size] << 8);
+	}
+	if (!size)
+		return;
+
+	uint16_t sum = fold(sumFunction(iter, size));
+	update(convert_endian<endian::big, endian::native>(sum));
+}
+
+void Checksum::update(arch::dma_buffer_view view) {
+	update(view.data(), view.size());
+}
+
+uint16_t Checksum::finalize() {
+	auto state_ = this->state_;
+	return ~state_;
+}
@@ -0,0 +1,70 @@
+#include <stdlib.h>
+#include <string>
+
+#include <bragi/helpers-std.hpp>
+#include <core/cmdline.hpp>
+#include <core/polling.hpp>
+#include <frg/cmdline.hpp>
+#include <kerncfg.bragi.hpp>
+#include <protocols/mbus/client.hpp>
+
+namespace {
+
+async::result<uint64_t> getNumCpus() {
+	auto filter = mbus_ng::Conjunction{{
+		mbus_ng::EqualsFilter{"class", "kerncfg"}
+	}};
+
+	auto enumerator = mbus_ng::Instance::global().enumerate(filter);
+	auto [_, events] = (co_await enumerator.nextEvents()).unwrap();
+	assert(events.size() == 1);
+
+	auto entity = co_await mbus_ng::Instance::global().getEntity(events[0].id);
+	auto lane = (co_await entity.getRemoteLane()).unwrap();
+
+	managarm::kerncfg::GetNumCpuRequest req;
+
+	auto [offer, sendReq, recvResp] =
+		co_await helix_ng::exchangeMsgs(
+			lane,
+			helix_ng::offer(
+				helix_ng::sendBragiHeadOnly(req, frg::stl_allocator{}),
+				helix_ng::recvInline()
+			)
+		);
+
+	HEL_CHECK(offer.error());
+	HEL_CHECK(sendReq.error());
+	HEL_CHECK(recvResp.error());
+
+	auto resp = *bragi::parse_head_only<managarm::kerncfg::GetNumCpuResponse>(recvResp);
+	assert(resp.error() == managarm::kerncfg::Error::SUCCESS);
+	co_return resp.num_cpu();
+}
+
+} // anonymous namespace
+
+async::result<void> configurePolling(helix::Dispatcher &dispatcher,
+		frg::string_view driver, unsigned int default_limit) {
+	unsigned int limit = default_limit;
+	if(co_await getNumCpus() < 2)
+		limit = 0;
+
+	Cmdline cmdline;
+	auto cmdline_str = co_await cmdline.get();
+
+	std::string option{driver.data(), driver.size()};
+	option += ".spin";
+	frg::string_view value;
+	frg::array args = {
+		frg::option(frg::string_view{option.data(), option.size()}, frg::as_string_view(value)),
+	};
+	frg::parse_arguments({cmdline_str.data(), cmdline_str.length()}, args);
+
+	if(value.size()) {
+		std::string value_str{value.data(), value.size()};
+		limit = strtoul(value_str.c_str(), nullptr, 10);
+	}
+
+	dispatcher.setSpinLimit(limit);
+}
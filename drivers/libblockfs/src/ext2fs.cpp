@@ -22,6 +22,219 @@ namespace {
 
 	constexpr int pageShift = 12;
 	constexpr size_t pageSize = size_t{1} << pageShift;
+
+	// Directory index hash functions, see Documentation/filesystems/ext4 in Linux.
+
+	uint32_t rotateLeft(uint32_t x, int n) {
+		return (x << n) | (x >> (32 - n));
+	}
+
+	template<typename Char>
+	uint32_t legacyHash(const char *name, size_t length) {
+		uint32_t hash0 = 0x12a3fe2d, hash1 = 0x37abe8f9;
+		auto p = reinterpret_cast<const Char *>(name);
+		for(size_t i = 0; i < length; i++) {
+			uint32_t hash = hash1 + (hash0 ^ (static_cast<int>(p[i]) * 7152373));
+			if(hash & 0x80000000)
+				hash -= 0x7fffffff;
+			hash1 = hash0;
+			hash0 = hash;
+		}
+		return hash0 << 1;
+	}
+
+	// Packs up to 4 * num bytes of the name into words, padded by the length.
+	template<typename Char>
+	void nameToWords(const char *name, size_t length, uint32_t *words, int num) {
+		auto p = reinterpret_cast<const Char *>(name);
+		uint32_t pad = static_cast<uint32_t>(length) | (static_cast<uint32_t>(length) << 8);
+		pad |= pad << 16;
+
+		uint32_t value = pad;
+		length = std::min(length, size_t(num) * 4);
+		for(size_t i = 0; i < length; i++) {
+			value = static_cast<int>(p[i]) + (value << 8);
+			if(i % 4 == 3) {
+				*words++ = value;
+				value = pad;
+				num--;
+			}
+		}
+		if(--num >= 0)
+			*words++ = value;
+		while(--num >= 0)
+			*words++ = pad;
+	}
+
+	void teaTransform(uint32_t buf[4], const uint32_t in[4]) {
+		uint32_t sum = 0;
+		uint32_t b0 = buf[0], b1 = buf[1];
+		for(int n = 0; n < 16; n++) {
+			sum += 0x9E3779B9;
+			b0 += ((b1 << 4) + in[0]) ^ (b1 + sum) ^ ((b1 >> 5) + in[1]);
+			b1 += ((b0 << 4) + in[2]) ^ (b0 + sum) ^ ((b0 >> 5) + in[3]);
+		}
+		buf[0] += b0;
+		buf[1] += b1;
+	}
+
+	void halfMd4Transform(uint32_t buf[4], const uint32_t in[8]) {
+		constexpr uint32_t k2 = 013240474631;
+		constexpr uint32_t k3 = 015666365641;
+		auto f = [] (uint32_t x, uint32_t y, uint32_t z) { return z ^ (x & (y ^ z)); };
+		auto g = [] (uint32_t x, uint32_t y, uint32_t z) { return (x & y) + ((x ^ y) & z); };
+		auto h = [] (uint32_t x, uint32_t y, uint32_t z) { return x ^ y ^ z; };
+		uint32_t a = buf[0], b = buf[1], c = buf[2], d = buf[3];
+
+		auto round = [] (auto fn, uint32_t &a, uint32_t b, uint32_t c, uint32_t d,
+				uint32_t x, int s) {
+			a = rotateLeft(a + fn(b, c, d) + x, s);
+		};
+
+		round(f, a, b, c, d, in[0], 3);
+		round(f, d, a, b, c, in[1], 7);
+		round(f, c, d, a, b, in[2], 11);
+		round(f, b, c, d, a, in[3], 19);
+		round(f, a, b, c, d, in[4], 3);
+		round(f, d, a, b, c, in[5], 7);
+		round(f, c, d, a, b, in[6], 11);
+		round(f, b, c, d, a, in[7], 19);
+
+		round(g, a, b, c, d, in[1] + k2, 3);
+		round(g, d, a, b, c, in[3] + k2, 5);
+		round(g, c, d, a, b, in[5] + k2, 9);
+		round(g, b, c, d, a, in[7] + k2, 13);
+		round(g, a, b, c, d, in[0] + k2, 3);
+		round(g, d, a, b, c, in[2] + k2, 5);
+		round(g, c, d, a, b, in[4] + k2, 9);
+		round(g, b, c, d, a, in[6] + k2, 13);
+
+		round(h, a, b, c, d, in[3] + k3, 3);
+		round(h, d, a, b, c, in[7] + k3, 9);
+		round(h, c, d, a, b, in[2] + k3, 11);
+		round(h, b, c, d, a, in[6] + k3, 15);
+		round(h, a, b, c, d, in[1] + k3, 3);
+		round(h, d, a, b, c, in[5] + k3, 9);
+		round(h, c, d, a, b, in[0] + k3, 11);
+		round(h, b, c, d, a, in[4] + k3, 15);
+
+		buf[0] += a;
+		buf[1] += b;
+		buf[2] += c;
+		buf[3] += d;
+	}
+
+	template<typename Char>
+	uint32_t halfMd4Hash(uint32_t buf[4], const char *name, size_t length) {
+		uint32_t in[8];
+		for(size_t i = 0; i < length; i += 32) {
+			nameToWords<Char>(name + i, length - i, in, 8);
+			halfMd4Transform(buf, in);
+		}
+		return buf[1];
+	}
+
+	template<typename Char>
+	uint32_t teaHash(uint32_t buf[4], const char *name, size_t length) {
+		uint32_t in[4];
+		for(size_t i = 0; i < length; i += 16) {
+			nameToWords<Char>(name + i, length - i, in, 4);
+			teaTransform(buf, in);
+		}
+		return buf[0];
+	}
+
+	// A node of an extent tree. The root node is stored in the inode (block zero).
+	struct ExtentNode {
+		DiskExtentHeader *header() {
+			return reinterpret_cast<DiskExtentHeader *>(buffer.data());
+		}
+
+		DiskExtentIndex *indices() {
+			return reinterpret_cast<DiskExtentIndex *>(buffer.data() + sizeof(DiskExtentHeader));
+		}
+
+		DiskExtent *leaves() {
+			return reinterpret_cast<DiskExtent *>(buffer.data() + sizeof(DiskExtentHeader));
+		}
+
+		// Both DiskExtentIndex and DiskExtent start with the first logical block.
+		uint32_t key(size_t i) {
+			return indices()[i].block;
+		}
+
+		uint64_t block;
+		std::vector<std::byte> buffer;
+		// Index of the entry that we descended into (or the insertion point in leaves).
+		size_t at = 0;
+	};
+
+	uint64_t extentStart(const DiskExtent &extent) {
+		return extent.startLo | (uint64_t(extent.startHi) << 32);
+	}
+
+	uint64_t indexLeaf(const DiskExtentIndex &index) {
+		return index.leafLo | (uint64_t(index.leafHi) << 32);
+	}
+
+	// Directory entries that are moved between blocks when the index is modified.
+	struct MovedEntry {
+		uint32_t hash;
+		std::vector<char> bytes;
+	};
+
+	size_t entrySize(size_t name_length) {
+		return (sizeof(DiskDirEntry) + name_length + 3) & ~size_t(3);
+	}
+
+	// Writes entries into a directory block; the last one spans the rest of the block.
+	template<typename It>
+	void packEntries(char *block, size_t block_size, It begin, It end) {
+		assert(begin != end);
+		size_t offset = 0;
+		DiskDirEntry *last = nullptr;
+		for(auto it = begin; it != end; ++it) {
+			auto size = entrySize(it->bytes.size() - sizeof(DiskDirEntry));
+			assert(offset + size <= block_size);
+			last = reinterpret_cast<DiskDirEntry *>(block + offset);
+			memset(last, 0, size);
+			memcpy(last, it->bytes.data(), it->bytes.size());
+			last->recordLength = size;
+			offset += size;
+		}
+		last->recordLength += block_size - offset;
+	}
+
+	// Finds space for an entry of the given size in [begin, end) and shrinks the entry
+	// that the space is taken from. Returns the offset and length of the new entry.
+	std::optional<std::pair<uintptr_t, size_t>> claimSlot(char *base,
+			uintptr_t begin, uintptr_t end, size_t required) {
+		uintptr_t offset = begin;
+		while(offset < end) {
+			assert(!(offset & 3));
+			assert(offset + sizeof(DiskDirEntry) <= end);
+			auto previous_entry = reinterpret_cast<DiskDirEntry *>(base + offset);
+			assert(previous_entry->recordLength);
+
+			// Calculate available space after we contract previous_entry.
+			// Unused entries (e.g., at the start of a block) can be replaced entirely.
+			size_t contracted = 0;
+			if(previous_entry->inode)
+				contracted = entrySize(previous_entry->nameLength);
+			assert(previous_entry->recordLength >= contracted);
+			auto available = previous_entry->recordLength - contracted;
+
+			// Check whether we can shrink previous_entry and insert a new entry after it.
+			if(available >= required) {
+				previous_entry->recordLength = contracted;
+				return std::pair<uintptr_t, size_t>{offset + contracted, available};
+			}
+
+			offset += previous_entry->recordLength;
+		}
+		assert(offset == end);
+		return std::nullopt;
+	}
 }
 
 // --------------------------------------------------------
@@ -31,9 +244,336 @@ namespace {
 Inode::Inode(FileSystem &fs, uint32_t number)
 : fs(fs), number(number), isReady(false) { }
 
-void Inode::setFileSize(size_t size) {
-	assert(!(size & ~uint64_t(0xFFFFFFFF)));
-	diskInode()->size = size;
+Inode::~Inode() {
+	fs.dropReservation(this);
+}
+
+void Inode::setFileSize(uint64_t size) {
+	auto disk_inode = diskInode();
+	if((disk_inode->mode & EXT2_S_IFMT) == EXT2_S_IFREG) {
+		// Callers enable the large_file feature before they grow files beyond 4 GiB.
+		assert(fs.largeFile || !(size >> 32));
+		disk_inode->dirAcl = size >> 32;
+	}else{
+		assert(!(size & ~uint64_t(0xFFFFFFFF)));
+	}
+	disk_inode->size = size;
+}
+
+std::pair<uint64_t, size_t> Inode::mapExtent(uint64_t index, size_t limit) {
+	auto it = std::upper_bound(extents.begin(), extents.end(), index,
+			[] (uint64_t index, const Extent &extent) {
+		return index < extent.logical;
+	});
+
+	if(it == extents.begin() || index >= std::prev(it)->logical + std::prev(it)->length) {
+		// The block is part of a hole that extends up to the next extent.
+		size_t n = limit;
+		if(it != extents.end())
+			n = std::min<uint64_t>(n, it->logical - index);
+		return {0, n};
+	}
+
+	--it;
+	auto uninitialized = it->uninitialized;
+	uint64_t physical = it->physical + (index - it->logical);
+	size_t n = std::min<uint64_t>(limit, it->logical + it->length - index);
+
+	// Fuse extents that are also contiguous on disk.
+	for(++it; it != extents.end() && n < limit; ++it) {
+		if(it->logical != index + n || it->uninitialized != uninitialized
+				|| it->physical != physical + n)
+			break;
+		n = std::min<uint64_t>(limit, n + it->length);
+	}
+
+	if(uninitialized)
+		return {0, n};
+	return {physical, n};
+}
+
+bool Inode::isIndexed() {
+	return fs.dirIndex && (diskInode()->flags & EXT2_INDEX_FL);
+}
+
+auto Inode::probeIndex(const std::string &name) -> std::optional<DxPath> {
+	auto base = reinterpret_cast<char *>(fileMapping.get());
+	if(fileSize() < 2 * fs.blockSize)
+		return std::nullopt;
+
+	// The root info follows the "." (12 bytes) and ".." (12 bytes) entries.
+	DiskDxRootInfo info;
+	memcpy(&info, base + 24, sizeof(DiskDxRootInfo));
+	if(info.reservedZero || info.infoLength != sizeof(DiskDxRootInfo)
+			|| info.hashVersion > DX_HASH_TEA || info.indirectLevels > 2)
+		return std::nullopt;
+
+	DxPath path;
+	path.hashVersion = info.hashVersion + (fs.unsignedDirHash ? 3 : 0);
+	path.hash = fs.dirHash(path.hashVersion, name.data(), name.size());
+
+	uintptr_t entries = 24 + info.infoLength;
+	for(unsigned int level = 0; ; level++) {
+		auto block_end = (entries & ~uintptr_t(fs.blockSize - 1)) + fs.blockSize;
+		DiskDxCountLimit count_limit;
+		memcpy(&count_limit, base + entries, sizeof(DiskDxCountLimit));
+		if(!count_limit.count || count_limit.count > count_limit.limit
+				|| entries + count_limit.limit * sizeof(DiskDxEntry) > block_end)
+			return std::nullopt;
+
+		// Find the last entry whose hash is not larger than the name's hash.
+		// The first entry covers all hashes below the second one.
+		auto dx = reinterpret_cast<DiskDxEntry *>(base + entries);
+		unsigned int low = 1, high = count_limit.count;
+		while(low < high) {
+			auto mid = low + (high - low) / 2;
+			if(dx[mid].hash > path.hash) {
+				high = mid;
+			}else{
+				low = mid + 1;
+			}
+		}
+		auto at = low - 1;
+
+		auto block = dx[at].block & 0x0FFF'FFFF;
+		if((uint64_t(block) + 1) * fs.blockSize > fileSize())
+			return std::nullopt;
+		path.frames.push_back({entries, at});
+
+		if(level == info.indirectLevels) {
+			path.leaf = block;
+			return path;
+		}
+		entries = uintptr_t(block) * fs.blockSize + sizeof(DiskDirEntry);
+	}
+}
+
+// Advances to the next leaf if it might contain further entries with the same hash.
+bool Inode::nextLeaf(DxPath &path) {
+	auto base = reinterpret_cast<char *>(fileMapping.get());
+	auto count_of = [&] (const DxPath::Frame &frame) {
+		DiskDxCountLimit count_limit;
+		memcpy(&count_limit, base + frame.entries, sizeof(DiskDxCountLimit));
+		return count_limit.count;
+	};
+	auto entry_of = [&] (const DxPath::Frame &frame) {
+		return reinterpret_cast<DiskDxEntry *>(base + frame.entries)[frame.at];
+	};
+
+	int level = path.frames.size() - 1;
+	while(level >= 0 && path.frames[level].at + 1u >= count_of(path.frames[level]))
+		level--;
+	if(level < 0)
+		return false;
+	path.frames[level].at++;
+
+	// Hash collisions that were split over two leaves set the lowest bit of the hash.
+	if((entry_of(path.frames[level]).hash & ~uint32_t(1)) != path.hash)
+		return false;
+
+	for(size_t l = level + 1; l < path.frames.size(); l++) {
+		auto block = entry_of(path.frames[l - 1]).block & 0x0FFF'FFFF;
+		path.frames[l] = {uintptr_t(block) * fs.blockSize + sizeof(DiskDirEntry), 0};
+	}
+	path.leaf = entry_of(path.frames.back()).block & 0x0FFF'FFFF;
+	return (uint64_t(path.leaf) + 1) * fs.blockSize <= fileSize();
+}
+
+auto Inode::scanBlock(uint32_t block, const std::string &name) -> std::optional<EntryPosition> {
+	auto base = reinterpret_cast<char *>(fileMapping.get());
+	std::optional<uintptr_t> previous;
+	uintptr_t offset = uintptr_t(block) * fs.blockSize;
+	auto end = offset + fs.blockSize;
+	while(offset < end) {
+		assert(!(offset & 3));
+		assert(offset + sizeof(DiskDirEntry) <= end);
+		auto disk_entry = reinterpret_cast<DiskDirEntry *>(base + offset);
+		assert(disk_entry->recordLength);
+
+		if(disk_entry->inode
+				&& name.length() == disk_entry->nameLength
+				&& !memcmp(disk_entry->name, name.data(), name.length()))
+			return EntryPosition{offset, previous};
+
+		previous = offset;
+		offset += disk_entry->recordLength;
+	}
+	assert(offset == end);
+	return std::nullopt;
+}
+
+auto Inode::locateEntry(const std::string &name) -> std::optional<EntryPosition> {
+	if(isIndexed()) {
+		if(auto path = probeIndex(name); path) {
+			do {
+				if(auto position = scanBlock(path->leaf, name); position)
+					return position;
+			} while(nextLeaf(*path));
+			return std::nullopt;
+		}
+		std::cout << "ext2fs: Directory index of inode " << number
+				<< " is not supported, falling back to linear search" << std::endl;
+	}
+
+	// Unindexed directory: check all blocks. Index blocks look like empty entries.
+	assert(!(fileSize() % fs.blockSize));
+	for(uint32_t block = 0; block < fileSize() / fs.blockSize; block++) {
+		if(auto position = scanBlock(block, name); position)
+			return position;
+	}
+	return std::nullopt;
+}
+
+async::result<helix::UniqueDescriptor> Inode::appendDirBlock() {
+	auto block = fileSize() >> fs.blockShift;
+	auto new_size = fileSize() + fs.blockSize;
+	auto map_size = (new_size + 0xFFF) & ~size_t(0xFFF);
+	co_await fs.assignDataBlocks(this, block, 1);
+	setFileSize(new_size);
+	HEL_CHECK(helResizeMemory(backingMemory, map_size));
+	fileMapping = helix::Mapping{helix::BorrowedDescriptor{frontalMemory},
+			0, map_size,
+			kHelMapProtRead | kHelMapProtWrite | kHelMapDontRequireBacking};
+
+	helix::LockMemoryView lock_memory;
+	auto &&submit = helix::submitLockMemoryView(helix::BorrowedDescriptor(frontalMemory),
+			&lock_memory,
+			0, map_size, helix::Dispatcher::global());
+	co_await submit.async_wait();
+	HEL_CHECK(lock_memory.error());
+
+	// Initialize the block as a single unused entry.
+	auto disk_entry = reinterpret_cast<DiskDirEntry *>(
+			reinterpret_cast<char *>(fileMapping.get()) + block * fs.blockSize);
+	memset(disk_entry, 0, sizeof(DiskDirEntry));
+	disk_entry->recordLength = fs.blockSize;
+
+	auto syncInode = co_await helix_ng::synchronizeSpace(
+			helix::BorrowedDescriptor{kHelNullHandle},
+			diskMapping.get(), fs.inodeSize);
+	HEL_CHECK(syncInode.error());
+
+	co_return lock_memory.descriptor();
+}
+
+// Finds space for a new entry in the leaf that its hash maps to.
+// Full leaves are split in two; returns std::nullopt if the index cannot be updated.
+async::result<std::optional<std::pair<uintptr_t, size_t>>>
+Inode::claimIndexedSlot(const std::string &name, size_t required) {
+	auto path = probeIndex(name);
+	if(!path)
+		co_return std::nullopt;
+
+	auto leaf_offset = uintptr_t(path->leaf) * fs.blockSize;
+	if(auto slot = claimSlot(reinterpret_cast<char *>(fileMapping.get()),
+			leaf_offset, leaf_offset + fs.blockSize, required); slot)
+		co_return slot;
+
+	// The leaf is full. Splitting it requires a free entry in the parent index block;
+	// unlike Linux, we do not split index blocks.
+	auto frame = path->frames.back();
+	DiskDxCountLimit count_limit;
+	memcpy(&count_limit, reinterpret_cast<char *>(fileMapping.get()) + frame.entries,
+			sizeof(DiskDxCountLimit));
+	if(count_limit.count >= count_limit.limit)
+		co_return std::nullopt;
+
+	auto lock = co_await appendDirBlock();
+	auto base = reinterpret_cast<char *>(fileMapping.get());
+	uint32_t new_block = (fileSize() >> fs.blockShift) - 1;
+
+	// Sort the leaf's entries by hash and move the upper half to the new block.
+	std::vector<MovedEntry> moved;
+	uintptr_t offset = leaf_offset;
+	while(offset < leaf_offset + fs.blockSize) {
+		auto disk_entry = reinterpret_cast<DiskDirEntry *>(base + offset);
+		if(disk_entry->inode) {
+			auto bytes = reinterpret_cast<char *>(disk_entry);
+			moved.push_back({fs.dirHash(path->hashVersion, disk_entry->name, disk_entry->nameLength),
+					std::vector<char>(bytes, bytes + sizeof(DiskDirEntry) + disk_entry->nameLength)});
+		}
+		offset += disk_entry->recordLength;
+	}
+	assert(moved.size() >= 2);
+	std::stable_sort(moved.begin(), moved.end(), [] (const MovedEntry &a, const MovedEntry &b) {
+		return a.hash < b.hash;
+	});
+
+	auto split = moved.size() / 2;
+	auto split_hash = moved[split].hash;
+	// Mark the split hash as continued if entries with this hash remain in the old leaf.
+	bool continued = split_hash == moved[split - 1].hash;
+
+	packEntries(base + leaf_offset, fs.blockSize, moved.begin(), moved.begin() + split);
+	packEntries(base + uintptr_t(new_block) * fs.blockSize, fs.blockSize,
+			moved.begin() + split, moved.end());
+
+	// Insert the new leaf into the parent after the old one.
+	auto dx = reinterpret_cast<DiskDxEntry *>(base + frame.entries);
+	memmove(&dx[frame.at + 2], &dx[frame.at + 1],
+			(count_limit.count - frame.at - 1) * sizeof(DiskDxEntry));
+	dx[frame.at + 1] = {split_hash | continued, new_block};
+	count_limit.count++;
+	memcpy(base + frame.entries, &count_limit, sizeof(DiskDxCountLimit));
+
+	auto target = path->hash >= split_hash ? new_block : path->leaf;
+	auto target_offset = uintptr_t(target) * fs.blockSize;
+	co_return claimSlot(base, target_offset, target_offset + fs.blockSize, required);
+}
+
+// Converts a single-block directory into an indexed one (like Linux' make_indexed_dir()).
+async::result<bool> Inode::makeIndexed() {
+	if(!fs.dirIndex || fileSize() != fs.blockSize)
+		co_return false;
+
+	auto base = reinterpret_cast<char *>(fileMapping.get());
+	auto dot = reinterpret_cast<DiskDirEntry *>(base);
+	auto dot_dot = reinterpret_cast<DiskDirEntry *>(base + 12);
+	if(dot->recordLength != 12 || dot->nameLength != 1
+			|| dot_dot->nameLength != 2 || memcmp(dot_dot->name, "..", 2))
+		co_return false;
+
+	// Collect all entries except "." and "..".
+	std::vector<MovedEntry> moved;
+	uintptr_t offset = 12 + dot_dot->recordLength;
+	while(offset < fs.blockSize) {
+		auto disk_entry = reinterpret_cast<DiskDirEntry *>(base + offset);
+		if(disk_entry->inode) {
+			auto bytes = reinterpret_cast<char *>(disk_entry);
+			moved.push_back({0, std::vector<char>(bytes,
+					bytes + sizeof(DiskDirEntry) + disk_entry->nameLength)});
+		}
+		offset += disk_entry->recordLength;
+	}
+	if(moved.empty())
+		co_return false;
+
+	auto lock = co_await appendDirBlock();
+	base = reinterpret_cast<char *>(fileMapping.get());
+	dot_dot = reinterpret_cast<DiskDirEntry *>(base + 12);
+
+	packEntries(base + fs.blockSize, fs.blockSize, moved.begin(), moved.end());
+
+	// Turn block 0 into the index root that points to block 1.
+	dot_dot->recordLength = fs.blockSize - 12;
+	DiskDxRootInfo info{};
+	info.hashVersion = fs.defHashVersion;
+	info.infoLength = sizeof(DiskDxRootInfo);
+	memcpy(base + 24, &info, sizeof(DiskDxRootInfo));
+
+	auto dx = reinterpret_cast<DiskDxEntry *>(base + 24 + sizeof(DiskDxRootInfo));
+	DiskDxCountLimit count_limit;
+	count_limit.limit = (fs.blockSize - 24 - sizeof(DiskDxRootInfo)) / sizeof(DiskDxEntry);
+	count_limit.count = 1;
+	memcpy(&dx[0], &count_limit, sizeof(DiskDxCountLimit));
+	dx[0].block = 1;
+
+	diskInode()->flags |= EXT2_INDEX_FL;
+	auto syncInode = co_await helix_ng::synchronizeSpace(
+			helix::BorrowedDescriptor{kHelNullHandle},
+			diskMapping.get(), fs.inodeSize);
+	HEL_CHECK(syncInode.error());
+	co_return true;
 }
 
 async::result<frg::expected<protocols::fs::Error, std::optional<DirEntry>>>
@@ -42,7 +582,7 @@ Inode::findEntry(std::string name) {
 
 	if(fileType != kTypeDirectory)
 		co_return protocols::fs::Error::notDirectory;
-	assert(fileMapping.size() == fileSize());
+	assert(fileMapping.size() >= fileSize());
 
 	helix::LockMemoryView lock_memory;
 	auto map_size = (fileSize() + 0xFFF) & ~size_t(0xFFF);
@@ -52,40 +592,27 @@ Inode::findEntry(std::string name) {
 	co_await submit.async_wait();
 	HEL_CHECK(lock_memory.error());
 
-	// Read the directory structure.
-	uintptr_t offset = 0;
-	while(offset < fileSize()) {
-		assert(!(offset & 3));
-		assert(offset + sizeof(DiskDirEntry) <= fileSize());
-		auto disk_entry = reinterpret_cast<DiskDirEntry *>(
-				reinterpret_cast<char *>(fileMapping.get()) + offset);
-		assert(disk_entry->recordLength);
-
-		if(disk_entry->inode
-				&& name.length() == disk_entry->nameLength
-				&& !memcmp(disk_entry->name, name.data(), name.length())) {
-			DirEntry entry;
-			entry.inode = disk_entry->inode;
-
-			switch(disk_entry->fileType) {
-			case EXT2_FT_REG_FILE:
-				entry.fileType = kTypeRegular; break;
-			case EXT2_FT_DIR:
-				entry.fileType = kTypeDirectory; break;
-			case EXT2_FT_SYMLINK:
-				entry.fileType = kTypeSymlink; break;
-			default:
-				entry.fileType = kTypeNone;
-			}
-
-			co_return entry;
-		}
-
-		offset += disk_entry->recordLength;
+	auto position = locateEntry(name);
+	if(!position)
+		co_return std::nullopt;
+
+	auto disk_entry = reinterpret_cast<DiskDirEntry *>(
+			reinterpret_cast<char *>(fileMapping.get()) + position->offset);
+	DirEntry entry;
+	entry.inode = disk_entry->inode;
+
+	switch(disk_entry->fileType) {
+	case EXT2_FT_REG_FILE:
+		entry.fileType = kTypeRegular; break;
+	case EXT2_FT_DIR:
+		entry.fileType = kTypeDirectory; break;
+	case EXT2_FT_SYMLINK:
+		entry.fileType = kTypeSymlink; break;
+	default:
+		entry.fileType = kTypeNone;
 	}
-	assert(offset == fileSize());
 
-	co_return std::nullopt;
+	co_return entry;
 }
 
 async::result<std::optional<DirEntry>>
@@ -96,11 +623,18 @@ Inode::link(std::string name, int64_t ino, blockfs::FileType type) {
 	co_await readyJump.wait();
 
 	assert(fileType == kTypeDirectory);
-	assert(fileMapping.size() == fileSize());
+	assert(fileMapping.size() >= fileSize());
 
-	// Lock the mapping into memory before calling this function.
 	auto appendDirEntry = [&](size_t offset, size_t length)
 			-> async::result<std::optional<DirEntry>> {
+		// The directory might have grown since the caller locked it.
+		helix::LockMemoryView lock_memory;
+		auto &&submit = helix::submitLockMemoryView(helix::BorrowedDescriptor(frontalMemory),
+				&lock_memory,
+				0, (fileSize() + 0xFFF) & ~size_t(0xFFF), helix::Dispatcher::global());
+		co_await submit.async_wait();
+		HEL_CHECK(lock_memory.error());
+
 		auto diskEntry = reinterpret_cast<DiskDirEntry *>(
 				reinterpret_cast<char *>(fileMapping.get()) + offset);
 		memset(diskEntry, 0, sizeof(DiskDirEntry));
@@ -155,55 +689,36 @@ Inode::link(std::string name, int64_t ino, blockfs::FileType type) {
 
 	// Space required for the new directory entry.
 	// We use name.size() + 1 for the entry name length to account for the null terminator
-	auto required = (sizeof(DiskDirEntry) + name.size() + 1 + 3) & ~size_t(3);
-
-	// Walk the directory structure.
-	uintptr_t offset = 0;
-	while(offset < fileSize()) {
-		assert(!(offset & 3));
-		assert(offset + sizeof(DiskDirEntry) <= fileSize());
-		auto previous_entry = reinterpret_cast<DiskDirEntry *>(
-				reinterpret_cast<char *>(fileMapping.get()) + offset);
-		assert(previous_entry->recordLength);
+	auto required = entrySize(name.size() + 1);
 
-		// Calculate available space after we contract previous_entry.
-		auto contracted = (sizeof(DiskDirEntry) + previous_entry->nameLength + 3) & ~size_t(3);
-		assert(previous_entry->recordLength >= contracted);
-		auto available = previous_entry->recordLength - contracted;
+	// Indexed directories store the entry in the leaf that its hash maps to.
+	// If the index cannot be updated, we drop it and fall back to a linear directory
+	// (as required by the ext2 specification for implementations without htree support).
+	if(isIndexed()) {
+		if(auto slot = co_await claimIndexedSlot(name, required); slot)
+			co_return co_await appendDirEntry(slot->first, slot->second);
 
-		// Check whether we can shrink previous_entry and insert a new entry after it.
-		if(available >= required) {
-			// Update the existing dentry.
-			previous_entry->recordLength = contracted;
-
-			co_return co_await appendDirEntry(offset + contracted, available);
-		}
-
-		offset += previous_entry->recordLength;
+		diskInode()->flags &= ~EXT2_INDEX_FL;
+		auto syncInode = co_await helix_ng::synchronizeSpace(
+				helix::BorrowedDescriptor{kHelNullHandle},
+				diskMapping.get(), fs.inodeSize);
+		HEL_CHECK(syncInode.error());
 	}
-	assert(offset == fileSize());
-
-	// If we made it this far, we ran out of space in the directory. Resize it.
-	auto blockOffset = (offset & ~(fs.blockSize - 1)) >> fs.blockShift;
-	auto newSize = (offset + fs.blockSize + 0xFFF) & ~size_t(0xFFF);
-	setFileSize(newSize);
-	co_await fs.assignDataBlocks(this, blockOffset, 1);
-	HEL_CHECK(helResizeMemory(backingMemory, newSize));
-	fileMapping = helix::Mapping{helix::BorrowedDescriptor{frontalMemory},
-			0, newSize,
-			kHelMapProtRead | kHelMapProtWrite | kHelMapDontRequireBacking};
 
-	// Now append the entry that we couldn't add before.
-	{
-		helix::LockMemoryView lock_memory;
-		auto &&submit = helix::submitLockMemoryView(helix::BorrowedDescriptor(frontalMemory),
-				&lock_memory,
-				0, newSize, helix::Dispatcher::global());
-		co_await submit.async_wait();
-		HEL_CHECK(lock_memory.error());
+	if(auto slot = claimSlot(reinterpret_cast<char *>(fileMapping.get()), 0,
+			fileSize(), required); slot)
+		co_return co_await appendDirEntry(slot->first, slot->second);
 
-		co_return co_await appendDirEntry(offset, fileSize() - offset);
+	// We ran out of space in the directory. Index it once it outgrows its first block.
+	if(co_await makeIndexed()) {
+		if(auto slot = co_await claimIndexedSlot(name, required); slot)
+			co_return co_await appendDirEntry(slot->first, slot->second);
 	}
+
+	// Otherwise, resize it.
+	co_await appendDirBlock();
+	auto offset = fileSize() - fs.blockSize;
+	co_return co_await appendDirEntry(offset, fs.blockSize);
 }
 
 async::result<frg::expected<protocols::fs::Error>> Inode::unlink(std::string name) {
@@ -213,7 +728,7 @@ async::result<frg::expected<protocols::fs::Error>> Inode::unlink(std::string nam
 
 	if(fileType != kTypeDirectory)
 		co_return protocols::fs::Error::notDirectory;
-	assert(fileMapping.size() == fileSize());
+	assert(fileMapping.size() >= fileSize());
 
 	helix::LockMemoryView lock_memory;
 	auto map_size = (fileSize() + 0xFFF) & ~size_t(0xFFF);
@@ -223,91 +738,83 @@ async::result<frg::expected<protocols::fs::Error>> Inode::unlink(std::string nam
 	co_await submit.async_wait();
 	HEL_CHECK(lock_memory.error());
 
-	// Read the directory structure.
-	DiskDirEntry *previous_entry = nullptr;
-	uintptr_t offset = 0;
-	while(offset < fileSize()) {
-		assert(!(offset & 3));
-		assert(offset + sizeof(DiskDirEntry) <= fileSize());
-		auto disk_entry = reinterpret_cast<DiskDirEntry *>(
-				reinterpret_cast<char *>(fileMapping.get()) + offset);
-		assert(disk_entry->recordLength);
+	auto position = locateEntry(name);
+	if(!position)
+		co_return protocols::fs::Error::fileNotFound;
 
-		if(disk_entry->inode
-				&& name.length() == disk_entry->nameLength
-				&& !memcmp(disk_entry->name, name.data(), name.length())) {
+	auto disk_entry = reinterpret_cast<DiskDirEntry *>(
+			reinterpret_cast<char *>(fileMapping.get()) + position->offset);
 
-			auto target = fs.accessInode(disk_entry->inode);
-			co_await target->readyJump.wait();
+	auto target = fs.accessInode(disk_entry->inode);
+	co_await target->readyJump.wait();
 
-			if(target->fileType == kTypeDirectory) {
-				if(target->diskInode()->linksCount > 2) {
-					co_return protocols::fs::Error::directoryNotEmpty;
-				}
+	if(target->fileType == kTypeDirectory) {
+		if(target->diskInode()->linksCount > 2) {
+			co_return protocols::fs::Error::directoryNotEmpty;
+		}
 
-				helix::LockMemoryView target_lock_memory;
-				auto target_map_size = (target->fileSize() + 0xFFF) & ~size_t(0xFFF);
-				auto &&target_submit = helix::submitLockMemoryView(helix::BorrowedDescriptor(target->frontalMemory),
-						&target_lock_memory,
-						0, target_map_size, helix::Dispatcher::global());
-				co_await target_submit.async_wait();
-				HEL_CHECK(target_lock_memory.error());
-
-				// Check the directory entries for anything other than "." and "..".
-				uintptr_t target_offset = 0;
-				while(target_offset < target->fileSize()) {
-					assert(!(target_offset & 3));
-					assert(target_offset + sizeof(DiskDirEntry) <= target->fileSize());
-					auto target_disk_entry = reinterpret_cast<DiskDirEntry *>(
-						reinterpret_cast<char*>(target->fileMapping.get()) + target_offset);
-					assert(target_disk_entry);
-					assert(target_disk_entry->recordLength);
-
-					if(target_disk_entry->inode
-						&& target_disk_entry->nameLength == 2
-						&& target_disk_entry->name[0] == '.'
-						&& target_disk_entry->name[1] == '.') {
-						// ".."
-					} else if(target_disk_entry->inode
-						&& target_disk_entry->nameLength == 1
-						&& target_disk_entry->name[0] == '.') {
-						// "."
-					} else {
-						// Directory has stuff in it, do not delete it.
-						co_return protocols::fs::Error::directoryNotEmpty;
-					}
-
-					target_offset += target_disk_entry->recordLength;
-				}
+		helix::LockMemoryView target_lock_memory;
+		auto target_map_size = (target->fileSize() + 0xFFF) & ~size_t(0xFFF);
+		auto &&target_submit = helix::submitLockMemoryView(helix::BorrowedDescriptor(target->frontalMemory),
+				&target_lock_memory,
+				0, target_map_size, helix::Dispatcher::global());
+		co_await target_submit.async_wait();
+		HEL_CHECK(target_lock_memory.error());
+
+		// Check the directory entries for anything other than "." and "..".
+		uintptr_t target_offset = 0;
+		while(target_offset < target->fileSize()) {
+			assert(!(target_offset & 3));
+			assert(target_offset + sizeof(DiskDirEntry) <= target->fileSize());
+			auto target_disk_entry = reinterpret_cast<DiskDirEntry *>(
+				reinterpret_cast<char*>(target->fileMapping.get()) + target_offset);
+			assert(target_disk_entry);
+			assert(target_disk_entry->recordLength);
+
+			if(!target_disk_entry->inode) {
+				// Unused entry (e.g., an emptied block or an index block).
+			} else if(target_disk_entry->nameLength == 2
+				&& target_disk_entry->name[0] == '.'
+				&& target_disk_entry->name[1] == '.') {
+				// ".."
+			} else if(target_disk_entry->nameLength == 1
+				&& target_disk_entry->name[0] == '.') {
+				// "."
+			} else {
+				// Directory has stuff in it, do not delete it.
+				co_return protocols::fs::Error::directoryNotEmpty;
 			}
 
-			// The directory should start with "." and "..". As those entries are never deleted,
-			// we can assume that a previous entry exists.
-			assert(previous_entry);
-			previous_entry->recordLength += disk_entry->recordLength;
-
-			// Flush the data to disk.
-			// TODO: It would be enough to flush only one or two pages here.
-			auto syncDir = co_await helix_ng::synchronizeSpace(
-					helix::BorrowedDescriptor{kHelNullHandle}, fileMapping.get(), fileSize());
-			HEL_CHECK(syncDir.error());
-
-			// Decrement the inode's link count
-			target->diskInode()->linksCount--;
-			auto syncInode = co_await helix_ng::synchronizeSpace(
-					helix::BorrowedDescriptor{kHelNullHandle},
-					target->diskMapping.get(), fs.inodeSize);
-			HEL_CHECK(syncInode.error());
-
-			co_return {};
+			target_offset += target_disk_entry->recordLength;
 		}
+	}
 
-		offset += disk_entry->recordLength;
-		previous_entry = disk_entry;
+	// Merge the entry into the previous entry of the same block.
+	// The first entry of a block has no predecessor and is only marked as unused.
+	if(position->previous) {
+		auto previous_entry = reinterpret_cast<DiskDirEntry *>(
+				reinterpret_cast<char *>(fileMapping.get()) + *position->previous);
+		previous_entry->recordLength += disk_entry->recordLength;
+	}else{
+		disk_entry->inode = 0;
 	}
-	assert(offset == fileSize());
 
-	co_return protocols::fs::Error::fileNotFound;
+	// Flush the data to disk.
+	// TODO: It would be enough to flush only one or two pages here.
+	auto syncDir = co_await helix_ng::synchronizeSpace(
+			helix::BorrowedDescriptor{kHelNullHandle}, fileMapping.get(), fileSize());
+	HEL_CHECK(syncDir.error());
+
+	// Decrement the inode's link count
+	target->diskInode()->linksCount--;
+	if(!target->diskInode()->linksCount)
+		fs.dropReservation(target.get());
+	auto syncInode = co_await helix_ng::synchronizeSpace(
+			helix::BorrowedDescriptor{kHelNullHandle},
+			target->diskMapping.get(), fs.inodeSize);
+	HEL_CHECK(syncInode.error());
+
+	co_return {};
 }
 
 async::result<std::optional<DirEntry>> Inode::mkdir(std::string name) {
@@ -315,7 +822,7 @@ async::result<std::optional<DirEntry>> Inode::mkdir(std::string name) {
 
 	co_await readyJump.wait();
 
-	auto dirNode = co_await fs.createDirectory();
+	auto dirNode = co_await fs.createDirectory(this);
 	co_await dirNode->readyJump.wait();
 
 	co_await fs.assignDataBlocks(dirNode.get(), 0, 1);
@@ -384,7 +891,7 @@ async::result<std::optional<DirEntry>> Inode::symlink(std::string name, std::str
 
 	co_await readyJump.wait();
 
-	auto newNode = co_await fs.createSymlink();
+	auto newNode = co_await fs.createSymlink(this);
 	co_await newNode->readyJump.wait();
 
 	assert(target.size() <= 60); // TODO: implement this case!
@@ -445,6 +952,36 @@ FileSystem::FileSystem(BlockDevice *device)
 : device(device) {
 }
 
+uint32_t FileSystem::dirHash(int version, const char *name, size_t length) {
+	uint32_t buf[4] = {0x67452301, 0xefcdab89, 0x98badcfe, 0x10325476};
+	if(hashSeed[0] || hashSeed[1] || hashSeed[2] || hashSeed[3])
+		memcpy(buf, hashSeed, sizeof(buf));
+
+	uint32_t hash;
+	switch(version) {
+	case DX_HASH_LEGACY:
+		hash = legacyHash<signed char>(name, length); break;
+	case DX_HASH_LEGACY_UNSIGNED:
+		hash = legacyHash<unsigned char>(name, length); break;
+	case DX_HASH_HALF_MD4:
+		hash = halfMd4Hash<signed char>(buf, name, length); break;
+	case DX_HASH_HALF_MD4_UNSIGNED:
+		hash = halfMd4Hash<unsigned char>(buf, name, length); break;
+	case DX_HASH_TEA:
+		hash = teaHash<signed char>(buf, name, length); break;
+	case DX_HASH_TEA_UNSIGNED:
+		hash = teaHash<unsigned char>(buf, name, length); break;
+	default:
+		throw std::runtime_error("ext2fs: Unexpected directory hash version");
+	}
+
+	// The lowest bit is reserved to mark hash collisions; the largest hash marks the end.
+	hash &= ~uint32_t(1);
+	if(hash == (0x7fffffffu << 1))
+		hash = (0x7fffffffu - 1) << 1;
+	return hash;
+}
+
 async::result<void> FileSystem::init() {
 	std::vector<uint8_t> buffer(1024);
 	co_await device->readSectors(2, buffer.data(), 2);
@@ -462,7 +999,16 @@ async::result<void> FileSystem::init() {
 	inodesPerGroup = sb.inodesPerGroup;
 	blocksCount = sb.blocksCount;
 	inodesCount = sb.inodesCount;
-	numBlockGroups = (sb.blocksCount + (sb.blocksPerGroup - 1)) / sb.blocksPerGroup;
+	firstDataBlock = sb.firstDataBlock;
+	numBlockGroups = (sb.blocksCount - sb.firstDataBlock + (sb.blocksPerGroup - 1))
+			/ sb.blocksPerGroup;
+
+	largeFile = sb.featureRoCompat & EXT2_FEATURE_RO_COMPAT_LARGE_FILE;
+	extents = sb.featureIncompat & EXT4_FEATURE_INCOMPAT_EXTENTS;
+	dirIndex = sb.featureCompat & EXT2_FEATURE_COMPAT_DIR_INDEX;
+	unsignedDirHash = sb.flags & EXT2_FLAGS_UNSIGNED_HASH;
+	defHashVersion = sb.defHashVersion;
+	memcpy(hashSeed, sb.hashSeed, sizeof(hashSeed));
 
 	if(logSuperblock) {
 		std::cout << "ext2fs: Revision is: " << sb.revLevel << std::endl;
@@ -642,7 +1188,7 @@ auto FileSystem::accessInode(uint32_t number) -> std::shared_ptr<Inode> {
 }
 
 async::result<std::shared_ptr<Inode>> FileSystem::createRegular(int uid, int gid) {
-	auto ino = co_await allocateInode();
+	auto ino = co_await allocateInode(nullptr, false);
 	assert(ino);
 
 	// Lock and map the inode table.
@@ -665,6 +1211,13 @@ async::result<std::shared_ptr<Inode>> FileSystem::createRegular(int uid, int gid
 	memset(disk_inode, 0, inodeSize);
 	disk_inode->mode = EXT2_S_IFREG;
 	disk_inode->generation = generation + 1;
+	if(extents) {
+		disk_inode->flags |= EXT4_EXTENTS_FL;
+		DiskExtentHeader header{};
+		header.magic = EXT4_EXTENT_MAGIC;
+		header.max = (sizeof(FileData) - sizeof(DiskExtentHeader)) / sizeof(DiskExtent);
+		memcpy(disk_inode->data.embedded, &header, sizeof(DiskExtentHeader));
+	}
 	struct timespec time;
 	// TODO: Move to CLOCK_REALTIME when supported
 	clock_gettime(CLOCK_MONOTONIC, &time);
@@ -677,8 +1230,8 @@ async::result<std::shared_ptr<Inode>> FileSystem::createRegular(int uid, int gid
 	co_return accessInode(ino);
 }
 
-async::result<std::shared_ptr<Inode>> FileSystem::createDirectory() {
-	auto ino = co_await allocateInode();
+async::result<std::shared_ptr<Inode>> FileSystem::createDirectory(Inode *parent) {
+	auto ino = co_await allocateInode(parent, true);
 	assert(ino);
 
 	// Lock and map the inode table.
@@ -701,6 +1254,13 @@ async::result<std::shared_ptr<Inode>> FileSystem::createDirectory() {
 	memset(disk_inode, 0, inodeSize);
 	disk_inode->mode = EXT2_S_IFDIR;
 	disk_inode->generation = generation + 1;
+	if(extents) {
+		disk_inode->flags |= EXT4_EXTENTS_FL;
+		DiskExtentHeader header{};
+		header.magic = EXT4_EXTENT_MAGIC;
+		header.max = (sizeof(FileData) - sizeof(DiskExtentHeader)) / sizeof(DiskExtent);
+		memcpy(disk_inode->data.embedded, &header, sizeof(DiskExtentHeader));
+	}
 	struct timespec time;
 	// TODO: Move to CLOCK_REALTIME when supported
 	clock_gettime(CLOCK_MONOTONIC, &time);
@@ -708,16 +1268,11 @@ async::result<std::shared_ptr<Inode>> FileSystem::createDirectory() {
 	disk_inode->ctime = time.tv_sec;
 	disk_inode->mtime = time.tv_sec;
 
-	// update usedDirsCount in the respective bgdt for this inode
-	auto bg_idx = (ino - 1) / inodesPerGroup;
-	bgdt[bg_idx].usedDirsCount++;
-	co_await writebackBgdt();
-
 	co_return accessInode(ino);
 }
 
-async::result<std::shared_ptr<Inode>> FileSystem::createSymlink() {
-	auto ino = co_await allocateInode();
+async::result<std::shared_ptr<Inode>> FileSystem::createSymlink(Inode *parent) {
+	auto ino = co_await allocateInode(parent, false);
 	assert(ino);
 
 	// Lock and map the inode table.
@@ -761,6 +1316,8 @@ async::result<void> FileSystem::write(Inode *inode, uint64_t offset,
 
 	// Resize the file if necessary.
 	if(offset + length > inode->fileSize()) {
+		if((offset + length) >> 32)
+			co_await enableLargeFile();
 		HEL_CHECK(helResizeMemory(inode->backingMemory,
 				(offset + length + 0xFFF) & ~size_t(0xFFF)));
 		inode->setFileSize(offset + length);
@@ -847,7 +1404,7 @@ async::detached FileSystem::initiateInode(std::shared_ptr<Inode> inode) {
 	HelHandle backingOrder1, backingOrder2;
 	HEL_CHECK(helCreateManagedMemory(3 << blockPagesShift,
 			0, &backingOrder1, &frontalOrder1));
-	HEL_CHECK(helCreateManagedMemory((blockSize / 4) << blockPagesShift,
+	HEL_CHECK(helCreateManagedMemory((2 * (blockSize / 4)) << blockPagesShift,
 			0, &backingOrder2, &frontalOrder2));
 	inode->indirectOrder1 = helix::UniqueDescriptor{frontalOrder1};
 	inode->indirectOrder2 = helix::UniqueDescriptor{frontalOrder2};
@@ -868,39 +1425,77 @@ async::detached FileSystem::manageFileData(std::shared_ptr<Inode> inode) {
 		co_await submit.async_wait();
 		HEL_CHECK(manage.error());
 		assert(manage.offset() + manage.length() <= ((inode->fileSize() + 0xFFF) & ~size_t(0xFFF)));
+		assert(manage.type() == kHelManageInitialize || manage.type() == kHelManageWriteback);
+		assert(!(manage.offset() % inode->fs.blockSize));
+
+		// Do not wait for the I/O here, such that the kernel can hand out
+		// further requests. Requests that arrive while all workers are busy
+		// are merged with adjacent ones once a worker becomes available.
+		inode->pendingManage.push_back({manage.type(), manage.offset(), manage.length()});
+		if(inode->numManageWorkers < maxManageWorkersPerInode) {
+			inode->numManageWorkers++;
+			serveManageRequests(inode);
+		}
+	}
+}
 
-		if(manage.type() == kHelManageInitialize) {
-			helix::Mapping file_map{helix::BorrowedDescriptor{inode->backingMemory},
-					static_cast<ptrdiff_t>(manage.offset()), manage.length(), kHelMapProtWrite};
+async::detached FileSystem::serveManageRequests(std::shared_ptr<Inode> inode) {
+	while(!inode->pendingManage.empty()) {
+		std::vector<ManageRequest> parts{inode->pendingManage.front()};
+		inode->pendingManage.pop_front();
+
+		// Merge pending requests of the same type that extend the range in either direction.
+		auto type = parts.front().type;
+		auto offset = parts.front().offset;
+		auto length = parts.front().length;
+		bool merged = true;
+		while(merged) {
+			merged = false;
+			for(auto it = inode->pendingManage.begin(); it != inode->pendingManage.end(); ++it) {
+				if(it->type != type || length + it->length > maxManageMergeSize)
+					continue;
+				if(it->offset == offset + length) {
+					length += it->length;
+				}else if(it->offset + it->length == offset) {
+					offset = it->offset;
+					length += it->length;
+				}else{
+					continue;
+				}
+				parts.push_back(*it);
+				inode->pendingManage.erase(it);
+				merged = true;
+				break;
+			}
+		}
 
-			assert(!(manage.offset() % inode->fs.blockSize));
-			size_t backed_size = std::min(manage.length(), inode->fileSize() - manage.offset());
-			size_t num_blocks = (backed_size + (inode->fs.blockSize - 1)) / inode->fs.blockSize;
+		while(numManageIos >= maxManageIos)
+			co_await manageIoDone.async_wait();
+		numManageIos++;
 
-			assert(num_blocks * inode->fs.blockSize <= manage.length());
-			co_await inode->fs.readDataBlocks(inode, manage.offset() / inode->fs.blockSize,
-					num_blocks, file_map.get());
+		size_t backed_size = std::min(length, inode->fileSize() - offset);
+		size_t num_blocks = (backed_size + (blockSize - 1)) / blockSize;
+		assert(num_blocks * blockSize <= length);
 
-			HEL_CHECK(helUpdateMemory(inode->backingMemory, kHelManageInitialize,
-					manage.offset(), manage.length()));
+		if(type == kHelManageInitialize) {
+			helix::Mapping file_map{helix::BorrowedDescriptor{inode->backingMemory},
+					static_cast<ptrdiff_t>(offset), length, kHelMapProtWrite};
+			co_await readDataBlocks(inode, offset / blockSize, num_blocks, file_map.get());
 		}else{
-			assert(manage.type() == kHelManageWriteback);
-
 			helix::Mapping file_map{helix::BorrowedDescriptor{inode->backingMemory},
-					static_cast<ptrdiff_t>(manage.offset()), manage.length(), kHelMapProtRead};
-
-			assert(!(manage.offset() % inode->fs.blockSize));
-			size_t backed_size = std::min(manage.length(), inode->fileSize() - manage.offset());
-			size_t num_blocks = (backed_size + (inode->fs.blockSize - 1)) / inode->fs.blockSize;
+					static_cast<ptrdiff_t>(offset), length, kHelMapProtRead};
+			co_await writeDataBlocks(inode, offset / blockSize, num_blocks, file_map.get());
+		}
 
-			assert(num_blocks * inode->fs.blockSize <= manage.length());
-			co_await inode->fs.writeDataBlocks(inode, manage.offset() / inode->fs.blockSize,
-					num_blocks, file_map.get());
+		numManageIos--;
+		manageIoDone.raise();
 
-			HEL_CHECK(helUpdateMemory(inode->backingMemory, kHelManageWriteback,
-					manage.offset(), manage.length()));
-		}
+		for(auto &part : parts)
+			HEL_CHECK(helUpdateMemory(inode->backingMemory, part.type,
+					part.offset, part.length));
 	}
+
+	inode->numManageWorkers--;
 }
 
 async::detached FileSystem::manageIndirect(std::shared_ptr<Inode> inode,
@@ -926,9 +1521,7 @@ async::detached FileSystem::manageIndirect(std::shared_ptr<Inode> inode,
 				assert(!"unexpected offset");
 				abort();
 			}
-		}else{
-			assert(order == 2);
-
+		}else if(order == 2) {
 			auto indirect_frame = element >> (blockShift - 2);
 			auto indirect_index = element & ((1 << (blockShift - 2)) - 1);
 
@@ -944,6 +1537,27 @@ async::detached FileSystem::manageIndirect(std::shared_ptr<Inode> inode,
 					(1 + indirect_frame) << blockPagesShift, size_t{1} << blockPagesShift,
 					kHelMapProtRead | kHelMapDontRequireBacking};
 			block = reinterpret_cast<uint32_t *>(indirect_map.get())[indirect_index];
+		}else{
+			assert(order == 3);
+
+			// Order 2 frames of the triple indirect subtree follow those of the double
+			// indirect block.
+			auto indirect_frame = (blockSize / 4) + (element >> (blockShift - 2));
+			auto indirect_index = element & ((1 << (blockShift - 2)) - 1);
+
+			helix::LockMemoryView lock_indirect;
+			auto &&submit_indirect = helix::submitLockMemoryView(inode->indirectOrder2,
+					&lock_indirect,
+					size_t{indirect_frame} << blockPagesShift, 1 << blockPagesShift,
+					helix::Dispatcher::global());
+			co_await submit_indirect.async_wait();
+			HEL_CHECK(lock_indirect.error());
+
+			helix::Mapping indirect_map{inode->indirectOrder2,
+					static_cast<ptrdiff_t>(size_t{indirect_frame} << blockPagesShift),
+					size_t{1} << blockPagesShift,
+					kHelMapProtRead | kHelMapDontRequireBacking};
+			block = reinterpret_cast<uint32_t *>(indirect_map.get())[indirect_index];
 		}
 
 		assert(!(manage.offset() & ((1 << blockPagesShift) - 1))
@@ -972,51 +1586,270 @@ async::detached FileSystem::manageIndirect(std::shared_ptr<Inode> inode,
 	}
 }
 
-async::result<uint32_t> FileSystem::allocateBlock() {
-	for(uint32_t bg_idx = 0; bg_idx < numBlockGroups; bg_idx++) {
+namespace {
+
+// Returns the first run of at least min_length clear bits in [begin, end) of the
+// bitmap (cut off after max_length bits) or a run of length zero.
+std::pair<uint32_t, size_t> findClearRun(const uint32_t *words, uint32_t begin, uint32_t end,
+		size_t min_length, size_t max_length) {
+	auto bit = begin;
+	while(bit < end) {
+		// Skip over allocated bits.
+		auto clear = ~words[bit / 32] >> (bit % 32);
+		if(!clear) {
+			bit = (bit / 32 + 1) * 32;
+			continue;
+		}
+		bit += __builtin_ctz(clear);
+		if(bit >= end)
+			break;
+
+		auto start = bit;
+		while(bit < end && bit - start < max_length) {
+			auto set = words[bit / 32] >> (bit % 32);
+			if(!set) {
+				bit = (bit / 32 + 1) * 32;
+				continue;
+			}
+			bit += __builtin_ctz(set);
+			break;
+		}
+
+		auto length = std::min<size_t>(std::min(bit, end) - start, max_length);
+		if(length >= min_length)
+			return {start, length};
+	}
+	return {0, 0};
+}
+
+} // anonymous namespace
+
+void FileSystem::markBlocksUsed(uint32_t *words, uint32_t bg, uint32_t bit, size_t count) {
+	for(size_t i = 0; i < count; i++)
+		words[(bit + i) / 32] |= static_cast<uint32_t>(1) << ((bit + i) % 32);
+	assert(bgdt[bg].freeBlocksCount >= count);
+	bgdt[bg].freeBlocksCount -= count;
+
+	dirtyBlockBitmaps.insert(bg);
+	scheduleAllocationWriteback();
+}
+
+void FileSystem::dropReservation(Inode *inode) {
+	if(inode->reservationEnd > inode->reservationStart)
+		reservations.erase(inode->reservationStart);
+	inode->reservationStart = 0;
+	inode->reservationEnd = 0;
+}
+
+async::result<std::pair<uint32_t, size_t>> FileSystem::claimBlocks(uint32_t goal, size_t count,
+		size_t min_length, size_t max_length, bool honor_reservations,
+		Inode *reserve_for) {
+	assert(count && count <= max_length && min_length <= max_length);
+	if(goal < firstDataBlock || goal >= blocksCount)
+		goal = firstDataBlock;
+	auto goal_bg = groupOfBlock(goal);
+
+	// Visit the goal's group (starting at the goal), all other groups and
+	// finally the part of the goal's group that precedes the goal.
+	for(uint32_t i = 0; i <= numBlockGroups; i++) {
+		auto bg = (goal_bg + i) % numBlockGroups;
+		auto group_start = firstBlockOfGroup(bg);
+		auto begin = i ? group_start : goal;
+		auto end = i < numBlockGroups ? group_start + blocksInGroup(bg) : goal;
+		// The BGDT lets us skip full groups without looking at their bitmaps.
+		if(begin >= end || bgdt[bg].freeBlocksCount < min_length)
+			continue;
+
 		helix::LockMemoryView lock_bitmap;
 		auto &&submit_bitmap = helix::submitLockMemoryView(blockBitmap,
 				&lock_bitmap,
-				bg_idx << blockPagesShift, 1 << blockPagesShift,
+				bg << blockPagesShift, 1 << blockPagesShift,
 				helix::Dispatcher::global());
 		co_await submit_bitmap.async_wait();
 		HEL_CHECK(lock_bitmap.error());
 
 		helix::Mapping bitmap_map{blockBitmap,
-				bg_idx << blockPagesShift, size_t{1} << blockPagesShift,
+				bg << blockPagesShift, size_t{1} << blockPagesShift,
 				kHelMapProtRead | kHelMapProtWrite | kHelMapDontRequireBacking};
-
 		auto words = reinterpret_cast<uint32_t *>(bitmap_map.get());
-		for(unsigned int i = 0; i < (blocksPerGroup + 31) / 32; i++) {
-			if(words[i] == 0xFFFFFFFF)
-				continue;
-			for(int j = 0; j < 32; j++) {
-				if(i * 32 + j >= blocksPerGroup)
-					break;
-				if(words[i] & (static_cast<uint32_t>(1) << j))
+
+		// Search the parts of [begin, end) that are not reserved by other inodes.
+		auto block = begin;
+		while(block < end) {
+			auto limit = end;
+			if(honor_reservations) {
+				auto it = reservations.upper_bound(block);
+				if(it != reservations.begin() && block < std::prev(it)->second) {
+					block = std::prev(it)->second;
 					continue;
-				// TODO: Make sure we never return reserved blocks.
-				// TODO: Make sure we never return blocks higher than the max. block in the SB.
-				auto block = bg_idx * blocksPerGroup + i * 32 + j;
-				assert(block);
-				assert(block < blocksCount);
-				words[i] |= static_cast<uint32_t>(1) << j;
+				}
+				if(it != reservations.end())
+					limit = std::min(limit, it->first);
+			}
 
-				bgdt[bg_idx].freeBlocksCount--;
-				co_await writebackBgdt();
+			auto [bit, length] = findClearRun(words, block - group_start,
+					limit - group_start, min_length, max_length);
+			if(!length) {
+				block = limit;
+				continue;
+			}
 
-				co_return block;
+			auto taken = std::min(count, length);
+			markBlocksUsed(words, bg, bit, taken);
+			if(reserve_for && length > taken) {
+				dropReservation(reserve_for);
+				reserve_for->reservationStart = group_start + bit;
+				reserve_for->reservationEnd = group_start + bit + length;
+				reservations.emplace(reserve_for->reservationStart, reserve_for->reservationEnd);
 			}
-			assert(!"Failed to find zero-bit");
+			co_return {group_start + bit, length};
 		}
 	}
 
-	co_return 0;
+	co_return {0, 0};
 }
 
-async::result<uint32_t> FileSystem::allocateInode() {
-	// TODO: Do not start at block group zero.
-	for(uint32_t bg_idx = 0; bg_idx < numBlockGroups; bg_idx++) {
+async::result<std::pair<uint32_t, size_t>> FileSystem::allocateBlocks(Inode *inode, size_t count) {
+	assert(count);
+
+	// Continue in the current reservation window.
+	auto goal = inode->allocGoal;
+	if(goal >= inode->reservationStart && goal < inode->reservationEnd) {
+		auto bg = groupOfBlock(goal);
+		auto group_start = firstBlockOfGroup(bg);
+
+		helix::LockMemoryView lock_bitmap;
+		auto &&submit_bitmap = helix::submitLockMemoryView(blockBitmap,
+				&lock_bitmap,
+				bg << blockPagesShift, 1 << blockPagesShift,
+				helix::Dispatcher::global());
+		co_await submit_bitmap.async_wait();
+		HEL_CHECK(lock_bitmap.error());
+
+		helix::Mapping bitmap_map{blockBitmap,
+				bg << blockPagesShift, size_t{1} << blockPagesShift,
+				kHelMapProtRead | kHelMapProtWrite | kHelMapDontRequireBacking};
+		auto words = reinterpret_cast<uint32_t *>(bitmap_map.get());
+
+		// Another allocation might have moved the window while we waited.
+		// Blocks in the window can also be taken by other inodes if the disk is full.
+		if(goal == inode->allocGoal && goal < inode->reservationEnd) {
+			auto [bit, length] = findClearRun(words, goal - group_start,
+					inode->reservationEnd - group_start, 1, count);
+			if(length && bit == goal - group_start) {
+				markBlocksUsed(words, bg, bit, length);
+				inode->allocGoal = goal + length;
+				co_return {goal, length};
+			}
+		}
+	}
+
+	// Reserve a new window. Windows start small and grow while the inode keeps
+	// allocating, such that large files end up in large contiguous runs.
+	if(!goal)
+		goal = firstBlockOfGroup((inode->number - 1) / inodesPerGroup);
+	if(!inode->reservationSize)
+		inode->reservationSize = minReservation;
+	auto window = std::max(count, inode->reservationSize);
+	inode->reservationSize = std::min(2 * inode->reservationSize, maxReservation);
+	dropReservation(inode);
+
+	// Prefer runs that fit at least a minimal window; on a fragmented or full disk,
+	// fall back to any free block (including those in other inodes' windows).
+	auto run = co_await claimBlocks(goal, count,
+			std::min(window, minReservation), window, true, inode);
+	if(!run.second)
+		run = co_await claimBlocks(goal, count, 1, window, true, inode);
+	if(!run.second)
+		run = co_await claimBlocks(goal, count, 1, count, false, nullptr);
+	if(!run.second)
+		co_return {0, 0};
+
+	auto taken = std::min(count, run.second);
+	inode->allocGoal = run.first + taken;
+	co_return {run.first, taken};
+}
+
+async::result<uint32_t> FileSystem::allocateBlock(Inode *inode) {
+	auto goal = inode->allocGoal;
+	if(!goal)
+		goal = firstBlockOfGroup((inode->number - 1) / inodesPerGroup);
+
+	auto run = co_await claimBlocks(goal, 1, 1, 1, true, nullptr);
+	if(!run.second)
+		run = co_await claimBlocks(goal, 1, 1, 1, false, nullptr);
+	co_return run.first;
+}
+
+async::result<void> FileSystem::releaseBlocks(Inode *inode, uint32_t block, size_t count) {
+	auto bg = groupOfBlock(block);
+	auto bit = block - firstBlockOfGroup(bg);
+
+	helix::LockMemoryView lock_bitmap;
+	auto &&submit_bitmap = helix::submitLockMemoryView(blockBitmap,
+			&lock_bitmap,
+			bg << blockPagesShift, 1 << blockPagesShift,
+			helix::Dispatcher::global());
+	co_await submit_bitmap.async_wait();
+	HEL_CHECK(lock_bitmap.error());
+
+	helix::Mapping bitmap_map{blockBitmap,
+			bg << blockPagesShift, size_t{1} << blockPagesShift,
+			kHelMapProtRead | kHelMapProtWrite | kHelMapDontRequireBacking};
+	auto words = reinterpret_cast<uint32_t *>(bitmap_map.get());
+
+	for(size_t i = 0; i < count; i++)
+		words[(bit + i) / 32] &= ~(static_cast<uint32_t>(1) << ((bit + i) % 32));
+	bgdt[bg].freeBlocksCount += count;
+
+	// The next allocation can reuse the blocks.
+	if(inode->allocGoal == block + count)
+		inode->allocGoal = block;
+
+	dirtyBlockBitmaps.insert(bg);
+	scheduleAllocationWriteback();
+}
+
+async::result<uint32_t> FileSystem::allocateInode(Inode *parent, bool directory) {
+	uint32_t goal_bg = inodeRotor;
+	if(parent)
+		goal_bg = (parent->number - 1) / inodesPerGroup;
+
+	if(directory) {
+		// Spread out directories: among the groups with an above-average number of
+		// free inodes, take the one with the most free blocks.
+		uint64_t free_inodes = 0;
+		for(uint32_t bg = 0; bg < numBlockGroups; bg++)
+			free_inodes += bgdt[bg].freeInodesCount;
+		auto average = free_inodes / numBlockGroups;
+
+		std::optional<uint32_t> best;
+		for(uint32_t i = 0; i < numBlockGroups; i++) {
+			auto bg = (goal_bg + i) % numBlockGroups;
+			if(!bgdt[bg].freeInodesCount || bgdt[bg].freeInodesCount < average)
+				continue;
+			if(!best || bgdt[bg].freeBlocksCount > bgdt[*best].freeBlocksCount)
+				best = bg;
+		}
+		if(best)
+			goal_bg = *best;
+	}
+
+	// Like Linux, try the goal group and groups at growing distances from it
+	// (that also have free blocks) before falling back to a linear search.
+	std::vector<uint32_t> candidates{goal_bg};
+	for(uint32_t j = 1, bg = goal_bg; j < numBlockGroups; j <<= 1) {
+		bg = (bg + j) % numBlockGroups;
+		if(bgdt[bg].freeBlocksCount)
+			candidates.push_back(bg);
+	}
+	for(uint32_t i = 1; i < numBlockGroups; i++)
+		candidates.push_back((goal_bg + i) % numBlockGroups);
+
+	for(auto bg_idx : candidates) {
+		if(!bgdt[bg_idx].freeInodesCount)
+			continue;
+
 		helix::LockMemoryView lock_bitmap;
 		auto &&submit_bitmap = helix::submitLockMemoryView(inodeBitmap,
 				&lock_bitmap,
@@ -1030,35 +1863,98 @@ async::result<uint32_t> FileSystem::allocateInode() {
 				kHelMapProtRead | kHelMapProtWrite | kHelMapDontRequireBacking};
 
 		auto words = reinterpret_cast<uint32_t *>(bitmap_map.get());
-		for(unsigned int i = 0; i < (inodesPerGroup + 31) / 32; i++) {
-			if(words[i] == 0xFFFFFFFF)
-				continue;
-			for(int j = 0; j < 32; j++) {
-				if(i * 32 + j >= inodesPerGroup)
-					break;
-				if(words[i] & (static_cast<uint32_t>(1) << j))
-					continue;
-				// TODO: Make sure we never return reserved inodes.
-				// TODO: Make sure we never return inodes higher than the max. inode in the SB.
-				auto ino = bg_idx * inodesPerGroup + i * 32 + j + 1;
-				assert(ino);
-				assert(ino < inodesCount);
-				words[i] |= static_cast<uint32_t>(1) << j;
+		auto [bit, length] = findClearRun(words, 0, inodesPerGroup, 1, 1);
+		if(!length)
+			continue;
 
-				bgdt[bg_idx].freeInodesCount--;
-				co_await writebackBgdt();
+		// TODO: Make sure we never return reserved inodes.
+		auto ino = bg_idx * inodesPerGroup + bit + 1;
+		assert(ino <= inodesCount);
+		words[bit / 32] |= static_cast<uint32_t>(1) << (bit % 32);
 
-				co_return ino;
-			}
-			assert(!"Failed to find zero-bit");
-		}
+		bgdt[bg_idx].freeInodesCount--;
+		if(directory)
+			bgdt[bg_idx].usedDirsCount++;
+		inodeRotor = bg_idx;
+
+		dirtyInodeBitmaps.insert(bg_idx);
+		scheduleAllocationWriteback();
+
+		co_return ino;
 	}
 
 	co_return 0;
 }
 
+void FileSystem::scheduleAllocationWriteback() {
+	if(allocationWritebackActive)
+		return;
+	allocationWritebackActive = true;
+	writebackAllocationState();
+}
+
+async::detached FileSystem::writebackAllocationState() {
+	auto syncBitmap = [&] (helix::BorrowedDescriptor memory, uint32_t bg)
+			-> async::result<void> {
+		helix::LockMemoryView lock_bitmap;
+		auto &&submit_bitmap = helix::submitLockMemoryView(memory,
+				&lock_bitmap,
+				bg << blockPagesShift, 1 << blockPagesShift,
+				helix::Dispatcher::global());
+		co_await submit_bitmap.async_wait();
+		HEL_CHECK(lock_bitmap.error());
+
+		helix::Mapping bitmap_map{memory,
+				bg << blockPagesShift, size_t{1} << blockPagesShift,
+				kHelMapProtRead | kHelMapDontRequireBacking};
+		auto sync = co_await helix_ng::synchronizeSpace(
+				helix::BorrowedDescriptor{kHelNullHandle},
+				bitmap_map.get(), size_t{1} << blockPagesShift);
+		HEL_CHECK(sync.error());
+	};
+
+	// Every bitmap update also changes the BGDT.
+	while(!dirtyBlockBitmaps.empty() || !dirtyInodeBitmaps.empty()) {
+		auto block_bitmaps = std::exchange(dirtyBlockBitmaps, {});
+		auto inode_bitmaps = std::exchange(dirtyInodeBitmaps, {});
+
+		for(auto bg : block_bitmaps)
+			co_await syncBitmap(blockBitmap, bg);
+		for(auto bg : inode_bitmaps)
+			co_await syncBitmap(inodeBitmap, bg);
+		co_await writebackBgdt();
+	}
+
+	allocationWritebackActive = false;
+}
+
+void FileSystem::ensureIndirectOrder3(Inode *inode) {
+	if(inode->indirectOrder3)
+		return;
+
+	// One frame for each block that the order 2 blocks of the triple indirect block point to.
+	size_t per_indirect = blockSize / 4;
+	HelHandle frontalOrder3, backingOrder3;
+	HEL_CHECK(helCreateManagedMemory((per_indirect * per_indirect) << blockPagesShift,
+			0, &backingOrder3, &frontalOrder3));
+	inode->indirectOrder3 = helix::UniqueDescriptor{frontalOrder3};
+	manageIndirect(inode->shared_from_this(), 3, helix::UniqueDescriptor{backingOrder3});
+}
+
 async::result<void> FileSystem::assignDataBlocks(Inode *inode,
 		uint64_t block_offset, size_t num_blocks) {
+	if(inode->usesExtents()) {
+		co_await inode->extentMutex.async_lock();
+		co_await assignExtentBlocks(inode, block_offset, num_blocks);
+		inode->extentMutex.unlock();
+
+		auto syncInode = co_await helix_ng::synchronizeSpace(
+				helix::BorrowedDescriptor{kHelNullHandle},
+				inode->diskMapping.get(), inodeSize);
+		HEL_CHECK(syncInode.error());
+		co_return;
+	}
+
 	size_t per_indirect = blockSize / 4;
 	size_t per_single = per_indirect;
 	size_t per_double = per_indirect * per_indirect;
@@ -1070,7 +1966,24 @@ async::result<void> FileSystem::assignDataBlocks(Inode *inode,
 
 	auto disk_inode = inode->diskInode();
 
+	// Data and indirection blocks are taken from runs of contiguous blocks.
+	// Blocks that are left over at the end are released again.
+	uint32_t run_block = 0;
+	size_t run_length = 0;
+
 	size_t prg = 0;
+	auto nextBlock = [&] () -> async::result<uint32_t> {
+		if(!run_length) {
+			auto [block, length] = co_await allocateBlocks(inode, num_blocks - prg);
+			run_block = block;
+			run_length = length;
+			if(!length)
+				co_return 0;
+		}
+		run_length--;
+		co_return run_block++;
+	};
+
 	while(prg < num_blocks) {
 		if(block_offset + prg < i_range) {
 			while(prg < num_blocks
@@ -1080,7 +1993,7 @@ async::result<void> FileSystem::assignDataBlocks(Inode *inode,
 					prg++;
 					continue;
 				}
-				auto block = co_await allocateBlock();
+				auto block = co_await nextBlock();
 				assert(block && "Out of disk space"); // TODO: Fix this.
 				disk_inode->blocks += (blockSize / 512);
 				disk_inode->data.blocks.direct[idx] = block;
@@ -1091,7 +2004,7 @@ async::result<void> FileSystem::assignDataBlocks(Inode *inode,
 
 			// Allocate the single-indirect block itself.
 			if(!disk_inode->data.blocks.singleIndirect) {
-				auto block = co_await allocateBlock();
+				auto block = co_await nextBlock();
 				assert(block && "Out of disk space"); // TODO: Fix this.
 				disk_inode->blocks += (blockSize / 512);
 				disk_inode->data.blocks.singleIndirect = block;
@@ -1120,7 +2033,7 @@ async::result<void> FileSystem::assignDataBlocks(Inode *inode,
 					prg++;
 					continue;
 				}
-				auto block = co_await allocateBlock();
+				auto block = co_await nextBlock();
 				assert(block && "Out of disk space"); // TODO: Fix this.
 				disk_inode->blocks += (blockSize / 512);
 				window[idx] = block;
@@ -1129,7 +2042,7 @@ async::result<void> FileSystem::assignDataBlocks(Inode *inode,
 		}else if(block_offset + prg < d_range) {
 			bool doubleNeedsReset = false;
 			if(!disk_inode->data.blocks.doubleIndirect) {
-				auto block = co_await allocateBlock();
+				auto block = co_await nextBlock();
 				assert(block && "Out of disk space"); // TODO: Fix this.
 				disk_inode->blocks += (blockSize / 512);
 				disk_inode->data.blocks.doubleIndirect = block;
@@ -1159,7 +2072,7 @@ async::result<void> FileSystem::assignDataBlocks(Inode *inode,
 				bool needsReset = false;
 				if(!double_window[indirect_frame]) {
 					// Allocate the single indirect block.
-					auto block = co_await allocateBlock();
+					auto block = co_await nextBlock();
 					assert(block && "Out of disk space"); // TODO: Fix this.
 					disk_inode->blocks += (blockSize / 512);
 					double_window[indirect_frame] = block;
@@ -1186,17 +2099,118 @@ async::result<void> FileSystem::assignDataBlocks(Inode *inode,
 					continue;
 				}
 
-				auto block = co_await allocateBlock();
+				auto block = co_await nextBlock();
 				assert(block && "Out of disk space"); // TODO: Fix this.
 				disk_inode->blocks += (blockSize / 512);
 				window[indirect_index] = block;
 				prg++;
 			}
 		}else{
-			assert(!"TODO: Implement allocation in triple indirect blocks");
+			bool tripleNeedsReset = false;
+			if(!disk_inode->data.blocks.tripleIndirect) {
+				auto block = co_await nextBlock();
+				assert(block && "Out of disk space"); // TODO: Fix this.
+				disk_inode->blocks += (blockSize / 512);
+				disk_inode->data.blocks.tripleIndirect = block;
+				tripleNeedsReset = true;
+			}
+
+			helix::LockMemoryView lock_triple_indirect;
+			auto &&submit = helix::submitLockMemoryView(inode->indirectOrder1,
+					&lock_triple_indirect, 2 << blockPagesShift, 1 << blockPagesShift,
+					helix::Dispatcher::global());
+			co_await submit.async_wait();
+			HEL_CHECK(lock_triple_indirect.error());
+
+			helix::Mapping triple_indirect_map{inode->indirectOrder1,
+					2 << blockPagesShift, size_t{1} << blockPagesShift,
+					kHelMapProtRead | kHelMapProtWrite | kHelMapDontRequireBacking};
+			auto triple_window = reinterpret_cast<uint32_t *>(triple_indirect_map.get());
+
+			if(tripleNeedsReset)
+				memset(triple_window, 0, size_t{1} << blockPagesShift);
+
+			ensureIndirectOrder3(inode);
+
+			while(prg < num_blocks) {
+				auto triple_offset = block_offset + prg - d_range;
+				assert(triple_offset < per_double * per_indirect && "File too large");
+				int64_t double_frame = triple_offset >> (2 * (blockShift - 2));
+				int64_t indirect_frame = triple_offset >> (blockShift - 2);
+				int64_t double_index = indirect_frame & ((1 << (blockShift - 2)) - 1);
+				int64_t indirect_index = triple_offset & ((1 << (blockShift - 2)) - 1);
+
+				bool doubleNeedsReset = false;
+				if(!triple_window[double_frame]) {
+					// Allocate the double indirect block.
+					auto block = co_await nextBlock();
+					assert(block && "Out of disk space"); // TODO: Fix this.
+					disk_inode->blocks += (blockSize / 512);
+					triple_window[double_frame] = block;
+					doubleNeedsReset = true;
+				}
+
+				// Order 2 frames of the triple indirect block follow those of the
+				// double indirect block.
+				helix::LockMemoryView lock_double_indirect;
+				auto &&submit_double = helix::submitLockMemoryView(inode->indirectOrder2,
+						&lock_double_indirect, (per_indirect + double_frame) << blockPagesShift,
+						1 << blockPagesShift, helix::Dispatcher::global());
+				co_await submit_double.async_wait();
+				HEL_CHECK(lock_double_indirect.error());
+
+				helix::Mapping double_indirect_map{inode->indirectOrder2,
+						static_cast<ptrdiff_t>((per_indirect + double_frame) << blockPagesShift),
+						size_t{1} << blockPagesShift,
+						kHelMapProtRead | kHelMapProtWrite | kHelMapDontRequireBacking};
+				auto double_window = reinterpret_cast<uint32_t *>(double_indirect_map.get());
+
+				if(doubleNeedsReset)
+					memset(double_window, 0, size_t{1} << blockPagesShift);
+
+				bool needsReset = false;
+				if(!double_window[double_index]) {
+					// Allocate the single indirect block.
+					auto block = co_await nextBlock();
+					assert(block && "Out of disk space"); // TODO: Fix this.
+					disk_inode->blocks += (blockSize / 512);
+					double_window[double_index] = block;
+					needsReset = true;
+				}
+
+				helix::LockMemoryView lock_indirect;
+				auto &&submit_indirect = helix::submitLockMemoryView(inode->indirectOrder3,
+						&lock_indirect, indirect_frame << blockPagesShift, 1 << blockPagesShift,
+						helix::Dispatcher::global());
+				co_await submit_indirect.async_wait();
+				HEL_CHECK(lock_indirect.error());
+
+				helix::Mapping indirect_map{inode->indirectOrder3,
+						static_cast<ptrdiff_t>(indirect_frame << blockPagesShift),
+						size_t{1} << blockPagesShift,
+						kHelMapProtRead | kHelMapProtWrite | kHelMapDontRequireBacking};
+				auto window = reinterpret_cast<uint32_t *>(indirect_map.get());
+
+				if(needsReset)
+					memset(window, 0, size_t{1} << blockPagesShift);
+
+				if(window[indirect_index]) {
+					prg++;
+					continue;
+				}
+
+				auto block = co_await nextBlock();
+				assert(block && "Out of disk space"); // TODO: Fix this.
+				disk_inode->blocks += (blockSize / 512);
+				window[indirect_index] = block;
+				prg++;
+			}
 		}
 	}
 
+	if(run_length)
+		co_await releaseBlocks(inode, run_block, run_length);
+
 	auto syncInode = co_await helix_ng::synchronizeSpace(
 			helix::BorrowedDescriptor{kHelNullHandle},
 			inode->diskMapping.get(), inodeSize);
@@ -1205,6 +2219,32 @@ async::result<void> FileSystem::assignDataBlocks(Inode *inode,
 
 async::result<void> FileSystem::readDataBlocks(std::shared_ptr<Inode> inode,
 		uint64_t offset, size_t num_blocks, void *buffer) {
+	co_await inode->readyJump.wait();
+	// TODO: Assert that we do not read past the EOF.
+
+	if(inode->usesExtents()) {
+		if(!inode->extentsLoaded) {
+			co_await inode->extentMutex.async_lock();
+			co_await loadExtents(inode.get());
+			inode->extentMutex.unlock();
+		}
+
+		// Extents are already contiguous on disk; we only need to split at holes.
+		size_t progress = 0;
+		while(progress < num_blocks) {
+			auto issue = inode->mapExtent(offset + progress, num_blocks - progress);
+			if(issue.first) {
+				co_await device->readSectors(issue.first * sectorsPerBlock,
+						(uint8_t *)buffer + progress * blockSize,
+						issue.second * sectorsPerBlock);
+			}else{
+				memset((uint8_t *)buffer + progress * blockSize, 0, issue.second * blockSize);
+			}
+			progress += issue.second;
+		}
+		co_return;
+	}
+
 	// We perform "block-fusion" here i.e. we try to read/write multiple
 	// consecutive blocks in a single read/writeSectors() operation.
 	auto fuse = [] (size_t remaining, uint32_t *list, size_t limit) {
@@ -1226,13 +2266,40 @@ async::result<void> FileSystem::readDataBlocks(std::shared_ptr<Inode> inode,
 	size_t s_range = i_range + per_single; // Plus the first single indirect block.
 	size_t d_range = s_range + per_double; // Plus the first double indirect block.
 
-	co_await inode->readyJump.wait();
-	// TODO: Assert that we do not read past the EOF.
-
 	constexpr size_t indirectBufferSize = 8;
 
 	std::array<uint32_t, indirectBufferSize> indirectBuffer;
 
+	// Fuses blocks that are listed in the given frame of an indirection cache.
+	auto fuseIndirect = [&] (helix::BorrowedDescriptor memory, uint64_t frame,
+			size_t indirect_index, size_t remaining)
+			-> async::result<std::pair<size_t, size_t>> {
+		remaining = std::min(remaining, per_indirect - indirect_index);
+		if (remaining > indirectBufferSize) {
+			helix::LockMemoryView lock_indirect;
+			auto &&submit = helix::submitLockMemoryView(memory, &lock_indirect,
+					frame << blockPagesShift, 1 << blockPagesShift,
+					helix::Dispatcher::global());
+			co_await submit.async_wait();
+			HEL_CHECK(lock_indirect.error());
+
+			helix::Mapping indirect_map{memory,
+					static_cast<ptrdiff_t>(frame << blockPagesShift), size_t{1} << blockPagesShift,
+					kHelMapProtRead | kHelMapDontRequireBacking};
+
+			co_return fuse(remaining,
+					reinterpret_cast<uint32_t *>(indirect_map.get()) + indirect_index,
+					remaining);
+		} else {
+			auto readMemory = co_await helix_ng::readMemory(memory,
+					(frame << blockPagesShift) + indirect_index * 4,
+					remaining * 4, indirectBuffer.data());
+			HEL_CHECK(readMemory.error());
+
+			co_return fuse(remaining, indirectBuffer.data(), remaining);
+		}
+	};
+
 	size_t progress = 0;
 	while(progress < num_blocks) {
 		// Block number and block count of the readSectors() command that we will issue here.
@@ -1242,65 +2309,28 @@ async::result<void> FileSystem::readDataBlocks(std::shared_ptr<Inode> inode,
 //		std::cout << "Reading " << index << "-th block from inode " << inode->number
 //				<< " (" << progress << "/" << num_blocks << " in request)" << std::endl;
 
-		assert(index < d_range);
-		if(index >= d_range) {
-			assert(!"Fix triple indirect blocks");
-		}else if(index >= s_range) { // Use the double indirect block.
+		if(index >= d_range) { // Use the triple indirect block.
+			ensureIndirectOrder3(inode.get());
 			auto remaining = num_blocks - progress;
-			int64_t indirect_frame = (index - s_range) >> (blockShift - 2);
-			int64_t indirect_index = (index - s_range) & ((1 << (blockShift - 2)) - 1);
-
-			if (remaining > indirectBufferSize) {
-				helix::LockMemoryView lock_indirect;
-				auto &&submit = helix::submitLockMemoryView(inode->indirectOrder2, &lock_indirect,
-						indirect_frame << blockPagesShift, 1 << blockPagesShift,
-						helix::Dispatcher::global());
-				co_await submit.async_wait();
-				HEL_CHECK(lock_indirect.error());
-
-				helix::Mapping indirect_map{inode->indirectOrder2,
-						indirect_frame << blockPagesShift, size_t{1} << blockPagesShift,
-						kHelMapProtRead | kHelMapDontRequireBacking};
+			uint64_t indirect_frame = (index - d_range) >> (blockShift - 2);
+			size_t indirect_index = (index - d_range) & ((1 << (blockShift - 2)) - 1);
+			assert(indirect_frame < per_double && "File too large");
 
-				issue = fuse(remaining,
-						reinterpret_cast<uint32_t *>(indirect_map.get()) + indirect_index,
-						per_indirect - indirect_index);
-			} else {
-				auto readMemory = co_await helix_ng::readMemory(
-						helix::BorrowedDescriptor{inode->indirectOrder2},
-						(indirect_frame << blockPagesShift) + indirect_index * 4,
-						remaining * 4, indirectBuffer.data());
-				HEL_CHECK(readMemory.error());
+			issue = co_await fuseIndirect(inode->indirectOrder3,
+					indirect_frame, indirect_index, remaining);
+		}else if(index >= s_range) { // Use the double indirect block.
+			auto remaining = num_blocks - progress;
+			uint64_t indirect_frame = (index - s_range) >> (blockShift - 2);
+			size_t indirect_index = (index - s_range) & ((1 << (blockShift - 2)) - 1);
 
-				issue = fuse(remaining, indirectBuffer.data(), remaining);
-			}
+			issue = co_await fuseIndirect(inode->indirectOrder2,
+					indirect_frame, indirect_index, remaining);
 		}else if(index >= i_range) { // Use the single indirect block.
 			auto remaining = num_blocks - progress;
 			auto indirect_index = index - i_range;
 
-			if (remaining > indirectBufferSize) {
-				helix::LockMemoryView lock_indirect;
-				auto &&submit = helix::submitLockMemoryView(inode->indirectOrder1,
-						&lock_indirect, 0, 1 << blockPagesShift,
-						helix::Dispatcher::global());
-				co_await submit.async_wait();
-				HEL_CHECK(lock_indirect.error());
-
-				helix::Mapping indirect_map{inode->indirectOrder1,
-						0, size_t{1} << blockPagesShift,
-						kHelMapProtRead | kHelMapDontRequireBacking};
-
-				issue = fuse(remaining,
-						reinterpret_cast<uint32_t *>(indirect_map.get()) + indirect_index,
-						per_indirect - indirect_index);
-			} else {
-				auto readMemory = co_await helix_ng::readMemory(
-						helix::BorrowedDescriptor{inode->indirectOrder1},
-						indirect_index * 4, remaining * 4, indirectBuffer.data());
-				HEL_CHECK(readMemory.error());
-
-				issue = fuse(remaining, indirectBuffer.data(), remaining);
-			}
+			issue = co_await fuseIndirect(inode->indirectOrder1,
+					0, indirect_index, remaining);
 		}else{
 			auto disk_inode = inode->diskInode();
 
@@ -1326,6 +2356,66 @@ async::result<void> FileSystem::readDataBlocks(std::shared_ptr<Inode> inode,
 //       Refactor common code into a another method.
 async::result<void> FileSystem::writeDataBlocks(std::shared_ptr<Inode> inode,
 		uint64_t offset, size_t num_blocks, const void *buffer) {
+	co_await inode->readyJump.wait();
+	// TODO: Assert that we do not write past the EOF.
+
+	if(inode->usesExtents()) {
+		co_await inode->extentMutex.async_lock();
+		co_await loadExtents(inode.get());
+
+		// Pages can be written back to holes and to uninitialized extents if they were
+		// modified through a mapping (e.g., of a sparse or preallocated file).
+		// Allocate or convert these blocks first. They are entirely overwritten below,
+		// hence there is no need to zero them.
+		bool changed = false;
+		uint64_t index = offset;
+		while(index < offset + num_blocks) {
+			auto it = std::upper_bound(inode->extents.begin(), inode->extents.end(), index,
+					[] (uint64_t index, const Inode::Extent &extent) {
+				return index < extent.logical;
+			});
+			if(it == inode->extents.begin()
+					|| index >= std::prev(it)->logical + std::prev(it)->length) {
+				uint64_t end = offset + num_blocks;
+				if(it != inode->extents.end())
+					end = std::min(end, it->logical);
+				co_await assignExtentBlocks(inode.get(), index, end - index);
+				changed = true;
+				index = end;
+				continue;
+			}
+
+			--it;
+			auto end = it->logical + it->length;
+			if(it->uninitialized) {
+				co_await initializeExtent(inode.get(), it->logical,
+						index, offset + num_blocks - index, false);
+				changed = true;
+			}
+			index = end;
+		}
+		inode->extentMutex.unlock();
+
+		// The root of the extent tree and the block count live in the inode.
+		if(changed) {
+			auto syncInode = co_await helix_ng::synchronizeSpace(
+					helix::BorrowedDescriptor{kHelNullHandle},
+					inode->diskMapping.get(), inodeSize);
+			HEL_CHECK(syncInode.error());
+		}
+
+		size_t progress = 0;
+		while(progress < num_blocks) {
+			auto issue = inode->mapExtent(offset + progress, num_blocks - progress);
+			assert(issue.first);
+			co_await device->writeSectors(issue.first * sectorsPerBlock,
+					(const uint8_t *)buffer + progress * blockSize,
+					issue.second * sectorsPerBlock);
+			progress += issue.second;
+		}
+		co_return;
+	}
+
 	// We perform "block-fusion" here i.e. we try to read/write multiple
 	// consecutive blocks in a single read/writeSectors() operation.
 	auto fuse = [] (size_t index, size_t remaining, uint32_t *list, size_t limit) {
@@ -1347,9 +2437,6 @@ async::result<void> FileSystem::writeDataBlocks(std::shared_ptr<Inode> inode,
 	size_t s_range = i_range + per_single; // Plus the first single indirect block.
 	size_t d_range = s_range + per_double; // Plus the first double indirect block.
 
-	co_await inode->readyJump.wait();
-	// TODO: Assert that we do not write past the EOF.
-
 	size_t progress = 0;
 	while(progress < num_blocks) {
 		// Block number and block count of the writeSectors() command that we will issue here.
@@ -1359,11 +2446,27 @@ async::result<void> FileSystem::writeDataBlocks(std::shared_ptr<Inode> inode,
 //		std::cout << "Write " << index << "-th block to inode " << inode->number
 //				<< " (" << progress << "/" << num_blocks << " in request)" << std::endl;
 
-		assert(index < d_range);
-		if(index >= d_range) {
-			assert(!"Fix triple indirect blocks");
+		if(index >= d_range) { // Use the triple indirect block.
+			ensureIndirectOrder3(inode.get());
+			uint64_t indirect_frame = (index - d_range) >> (blockShift - 2);
+			int64_t indirect_index = (index - d_range) & ((1 << (blockShift - 2)) - 1);
+			assert(indirect_frame < per_double && "File too large");
+
+			helix::LockMemoryView lock_indirect;
+			auto &&submit = helix::submitLockMemoryView(inode->indirectOrder3, &lock_indirect,
+					indirect_frame << blockPagesShift, 1 << blockPagesShift,
+					helix::Dispatcher::global());
+			co_await submit.async_wait();
+			HEL_CHECK(lock_indirect.error());
+
+			helix::Mapping indirect_map{inode->indirectOrder3,
+					static_cast<ptrdiff_t>(indirect_frame << blockPagesShift),
+					size_t{1} << blockPagesShift,
+					kHelMapProtRead | kHelMapDontRequireBacking};
+
+			issue = fuse(indirect_index, num_blocks - progress,
+					reinterpret_cast<uint32_t *>(indirect_map.get()), per_indirect);
 		}else if(index >= s_range) { // Use the double indirect block.
-			// TODO: Use shift/and instead of div/mod.
 			int64_t indirect_frame = (index - s_range) >> (blockShift - 2);
 			int64_t indirect_index = (index - s_range) & ((1 << (blockShift - 2)) - 1);
 
@@ -1380,7 +2483,7 @@ async::result<void> FileSystem::writeDataBlocks(std::shared_ptr<Inode> inode,
 
 			issue = fuse(indirect_index, num_blocks - progress,
 					reinterpret_cast<uint32_t *>(indirect_map.get()), per_indirect);
-		}else if(index >= i_range) { // Use the triple indirect block.
+		}else if(index >= i_range) { // Use the single indirect block.
 			helix::LockMemoryView lock_indirect;
 			auto &&submit = helix::submitLockMemoryView(inode->indirectOrder1,
 					&lock_indirect, 0, 1 << blockPagesShift,
@@ -1403,7 +2506,12 @@ async::result<void> FileSystem::writeDataBlocks(std::shared_ptr<Inode> inode,
 //		std::cout << "Issuing write of " << issue.second
 //				<< " blocks, starting at " << issue.first << std::endl;
 
-		assert(issue.first);
+		// Pages can be written back to holes if they were modified through a mapping
+		// of a sparse file. Allocate the missing blocks and look them up again.
+		if(!issue.first) {
+			co_await assignDataBlocks(inode.get(), index, num_blocks - progress);
+			continue;
+		}
 		co_await device->writeSectors(issue.first * sectorsPerBlock,
 				(const uint8_t *)buffer + progress * blockSize,
 				issue.second * sectorsPerBlock);
@@ -1412,7 +2520,396 @@ async::result<void> FileSystem::writeDataBlocks(std::shared_ptr<Inode> inode,
 }
 
 
+namespace {
+
+ExtentNode rootExtentNode(Inode *inode) {
+	ExtentNode node;
+	node.block = 0;
+	node.buffer.resize(sizeof(FileData));
+	memcpy(node.buffer.data(), inode->diskInode()->data.embedded, sizeof(FileData));
+	return node;
+}
+
+// Validates the header of an extent tree node that occupies size bytes.
+void checkExtentNode(ExtentNode &node, size_t size) {
+	auto header = node.header();
+	if(header->magic != EXT4_EXTENT_MAGIC
+			|| header->depth > EXT4_EXTENT_MAX_DEPTH
+			|| header->entries > header->max
+			|| sizeof(DiskExtentHeader) + header->max * sizeof(DiskExtent) > size)
+		throw std::runtime_error("ext2fs: Corrupted extent tree");
+}
+
+async::result<ExtentNode> readExtentNode(FileSystem &fs, uint64_t block, uint16_t depth) {
+	ExtentNode node;
+	node.block = block;
+	node.buffer.resize(fs.blockSize);
+	co_await fs.device->readSectors(block * fs.sectorsPerBlock,
+			node.buffer.data(), fs.sectorsPerBlock);
+	checkExtentNode(node, fs.blockSize);
+	if(node.header()->depth != depth)
+		throw std::runtime_error("ext2fs: Corrupted extent tree");
+	co_return node;
+}
+
+// Writes back a node; the caller synchronizes the inode after modifying the root.
+async::result<void> writeExtentNode(FileSystem &fs, Inode *inode, ExtentNode &node) {
+	if(!node.block) {
+		memcpy(inode->diskInode()->data.embedded, node.buffer.data(), sizeof(FileData));
+		co_return;
+	}
+	co_await fs.device->writeSectors(node.block * fs.sectorsPerBlock,
+			node.buffer.data(), fs.sectorsPerBlock);
+}
+
+// Returns the nodes from the root to the leaf that covers the given logical block.
+async::result<std::vector<ExtentNode>> findExtentLeaf(FileSystem &fs,
+		Inode *inode, uint64_t logical) {
+	std::vector<ExtentNode> path;
+	path.push_back(rootExtentNode(inode));
+	checkExtentNode(path.back(), sizeof(FileData));
+
+	while(path.back().header()->depth) {
+		auto &node = path.back();
+		auto header = node.header();
+		if(!header->entries)
+			throw std::runtime_error("ext2fs: Corrupted extent tree");
+
+		// Take the last index that starts at or before the block (or the first one).
+		auto indices = node.indices();
+		auto it = std::upper_bound(indices + 1, indices + header->entries, logical,
+				[] (uint64_t logical, const DiskExtentIndex &index) {
+			return logical < index.block;
+		});
+		node.at = it - indices - 1;
+
+		auto child = indexLeaf(indices[node.at]);
+		auto depth = header->depth - 1;
+		path.push_back(co_await readExtentNode(fs, child, depth));
+	}
+	co_return path;
+}
+
+} // anonymous namespace
+
+async::result<void> FileSystem::loadExtents(Inode *inode) {
+	if(inode->extentsLoaded)
+		co_return;
+
+	std::vector<Inode::Extent> extents;
+
+	// Depth-first traversal; ExtentNode::at is the next entry to visit.
+	std::vector<ExtentNode> path;
+	path.push_back(rootExtentNode(inode));
+	checkExtentNode(path.back(), sizeof(FileData));
+	while(!path.empty()) {
+		auto &node = path.back();
+		auto header = node.header();
+
+		if(!header->depth) {
+			for(size_t i = 0; i < header->entries; i++) {
+				auto &leaf = node.leaves()[i];
+				bool uninitialized = leaf.length > EXT4_EXTENT_MAX_INIT_LENGTH;
+				extents.push_back({leaf.block, extentStart(leaf),
+						uninitialized ? leaf.length - EXT4_EXTENT_MAX_INIT_LENGTH : leaf.length,
+						uninitialized});
+			}
+			path.pop_back();
+			continue;
+		}
+
+		if(node.at == header->entries) {
+			path.pop_back();
+			continue;
+		}
+
+		auto child = indexLeaf(node.indices()[node.at++]);
+		auto depth = header->depth - 1;
+		path.push_back(co_await readExtentNode(*this, child, depth));
+	}
+
+	for(size_t i = 1; i < extents.size(); i++) {
+		if(extents[i].logical < extents[i - 1].logical + extents[i - 1].length)
+			throw std::runtime_error("ext2fs: Corrupted extent tree");
+	}
+
+	inode->extents = std::move(extents);
+	inode->extentsLoaded = true;
+}
+
+async::result<void> FileSystem::assignExtentBlocks(Inode *inode,
+		uint64_t block_offset, size_t num_blocks) {
+	co_await loadExtents(inode);
+
+	auto disk_inode = inode->diskInode();
+
+	size_t prg = 0;
+	while(prg < num_blocks) {
+		auto index = block_offset + prg;
+		auto [physical, n] = inode->mapExtent(index, num_blocks - prg);
+		if(physical) {
+			prg += n;
+			continue;
+		}
+
+		auto it = std::upper_bound(inode->extents.begin(), inode->extents.end(), index,
+				[] (uint64_t index, const Inode::Extent &extent) {
+			return index < extent.logical;
+		});
+		if(it != inode->extents.begin() && std::prev(it)->uninitialized
+				&& index < std::prev(it)->logical + std::prev(it)->length) {
+			co_await initializeExtent(inode, std::prev(it)->logical,
+					index, num_blocks - prg, true);
+			continue;
+		}
+
+		// Fill the hole with runs of contiguous blocks.
+		size_t filled = 0;
+		while(filled < n) {
+			auto [block, length] = co_await allocateBlocks(inode, std::min(n - filled,
+					size_t{EXT4_EXTENT_MAX_INIT_LENGTH}));
+			assert(length && "Out of disk space"); // TODO: Fix this.
+			disk_inode->blocks += length * (blockSize / 512);
+
+			co_await insertExtent(inode, {index + filled, block,
+					static_cast<uint32_t>(length), false});
+			filled += length;
+		}
+		prg += n;
+	}
+}
+
+async::result<void> FileSystem::insertExtent(Inode *inode, Inode::Extent extent) {
+	assert(extent.logical + extent.length <= (uint64_t{1} << 32) && "File too large");
+	assert(extent.length && extent.length <= EXT4_EXTENT_MAX_INIT_LENGTH);
+	assert(!extent.uninitialized || extent.length < EXT4_EXTENT_MAX_INIT_LENGTH);
+
+	auto disk_inode = inode->diskInode();
+	auto path = co_await findExtentLeaf(*this, inode, extent.logical);
+
+	// Update the cached extents.
+	auto it = std::upper_bound(inode->extents.begin(), inode->extents.end(), extent.logical,
+			[] (uint64_t logical, const Inode::Extent &extent) {
+		return logical < extent.logical;
+	});
+	if(it != inode->extents.begin()
+			&& !extent.uninitialized && !std::prev(it)->uninitialized
+			&& std::prev(it)->logical + std::prev(it)->length == extent.logical
+			&& std::prev(it)->physical + std::prev(it)->length == extent.physical) {
+		std::prev(it)->length += extent.length;
+	}else{
+		inode->extents.insert(it, extent);
+	}
+
+	// Extend the preceding extent if the new one continues it on disk.
+	auto &leaf = path.back();
+	auto leaves = leaf.leaves();
+	leaf.at = std::upper_bound(leaves, leaves + leaf.header()->entries, extent.logical,
+			[] (uint64_t logical, const DiskExtent &extent) {
+		return logical < extent.block;
+	}) - leaves;
+	if(leaf.at && !extent.uninitialized) {
+		auto &previous = leaves[leaf.at - 1];
+		if(previous.block + previous.length == extent.logical
+				&& extentStart(previous) + previous.length == extent.physical
+				&& previous.length + extent.length <= EXT4_EXTENT_MAX_INIT_LENGTH) {
+			previous.length += extent.length;
+			co_await writeExtentNode(*this, inode, leaf);
+			co_return;
+		}
+	}
+
+	// Insert the entry into the leaf. Full nodes are split and the new node is inserted
+	// into the parent. If the root is full, its entries move to a new block (which
+	// increases the depth of the tree).
+	std::array<std::byte, sizeof(DiskExtent)> entry;
+	DiskExtent disk_extent;
+	disk_extent.block = extent.logical;
+	disk_extent.length = extent.length;
+	if(extent.uninitialized)
+		disk_extent.length += EXT4_EXTENT_MAX_INIT_LENGTH;
+	disk_extent.startHi = extent.physical >> 32;
+	disk_extent.startLo = extent.physical;
+	memcpy(entry.data(), &disk_extent, sizeof(DiskExtent));
+
+	auto makeNode = [&] () -> async::result<ExtentNode> {
+		auto block = co_await allocateBlock(inode);
+		assert(block && "Out of disk space"); // TODO: Fix this.
+		disk_inode->blocks += (blockSize / 512);
+
+		ExtentNode node;
+		node.block = block;
+		node.buffer.resize(blockSize);
+		node.header()->magic = EXT4_EXTENT_MAGIC;
+		node.header()->max = (blockSize - sizeof(DiskExtentHeader)) / sizeof(DiskExtent);
+		co_return node;
+	};
+
+	// Updates the first keys of the ancestors after inserting at the start of a node.
+	auto updateKeys = [&] (size_t level) -> async::result<void> {
+		while(level && !path[level].at) {
+			auto &parent = path[level - 1];
+			parent.indices()[parent.at].block = path[level].key(0);
+			co_await writeExtentNode(*this, inode, parent);
+			level--;
+		}
+	};
+
+	auto insertEntry = [] (ExtentNode &node, const std::array<std::byte, sizeof(DiskExtent)> &entry) {
+		auto header = node.header();
+		auto entries = node.buffer.data() + sizeof(DiskExtentHeader);
+		memmove(entries + (node.at + 1) * sizeof(DiskExtent), entries + node.at * sizeof(DiskExtent),
+				(header->entries - node.at) * sizeof(DiskExtent));
+		memcpy(entries + node.at * sizeof(DiskExtent), entry.data(), sizeof(DiskExtent));
+		header->entries++;
+	};
+
+	size_t level = path.size() - 1;
+	while(true) {
+		auto &node = path[level];
+		auto header = node.header();
+
+		if(header->entries < header->max) {
+			insertEntry(node, entry);
+			co_await writeExtentNode(*this, inode, node);
+			co_await updateKeys(level);
+			break;
+		}
+
+		if(!level) {
+			auto child = co_await makeNode();
+			memcpy(child.buffer.data() + sizeof(DiskExtentHeader),
+					node.buffer.data() + sizeof(DiskExtentHeader),
+					header->entries * sizeof(DiskExtent));
+			child.header()->entries = header->entries;
+			child.header()->depth = header->depth;
+			child.at = node.at;
+			co_await writeExtentNode(*this, inode, child);
+
+			header->depth++;
+			header->entries = 1;
+			auto &index = node.indices()[0];
+			index.block = child.key(0);
+			index.leafLo = child.block;
+			index.leafHi = child.block >> 32;
+			index.unused = 0;
+			node.at = 0;
+			co_await writeExtentNode(*this, inode, node);
+
+			path.insert(path.begin() + 1, std::move(child));
+			level = 1;
+			continue;
+		}
+
+		// Split the node at the insertion point. When appending, the new node only
+		// contains the new entry such that sequentially written files fill their nodes.
+		auto sibling = co_await makeNode();
+		sibling.header()->depth = header->depth;
+		auto moved = header->entries - node.at;
+		memcpy(sibling.buffer.data() + sizeof(DiskExtentHeader),
+				node.buffer.data() + sizeof(DiskExtentHeader) + node.at * sizeof(DiskExtent),
+				moved * sizeof(DiskExtent));
+		sibling.header()->entries = moved;
+		header->entries = node.at;
+
+		if(moved) {
+			insertEntry(node, entry);
+		}else{
+			sibling.at = 0;
+			insertEntry(sibling, entry);
+		}
+		co_await writeExtentNode(*this, inode, sibling);
+		co_await writeExtentNode(*this, inode, node);
+		if(moved)
+			co_await updateKeys(level);
+
+		// Insert the sibling into the parent, after the current node.
+		DiskExtentIndex index;
+		index.block = sibling.key(0);
+		index.leafLo = sibling.block;
+		index.leafHi = sibling.block >> 32;
+		index.unused = 0;
+		memcpy(entry.data(), &index, sizeof(DiskExtentIndex));
+		path[level - 1].at++;
+		level--;
+	}
+}
+
+// Marks the blocks [first, first + count) of the uninitialized extent that starts at
+// logical as initialized. Like Linux, we split the extent around these blocks, such that
+// the rest of it stays uninitialized. If zero_edges is set, the first and the last block
+// are zeroed on disk since the caller might only partially overwrite them.
+async::result<void> FileSystem::initializeExtent(Inode *inode, uint64_t logical,
+		uint64_t first, size_t count, bool zero_edges) {
+	auto path = co_await findExtentLeaf(*this, inode, logical);
+	auto &leaf = path.back();
+	auto leaves = leaf.leaves();
+	auto disk_extent = std::find_if(leaves, leaves + leaf.header()->entries,
+			[&] (const DiskExtent &extent) {
+		return extent.block == logical;
+	});
+	assert(disk_extent != leaves + leaf.header()->entries);
+	assert(disk_extent->length > EXT4_EXTENT_MAX_INIT_LENGTH);
+
+	uint64_t length = disk_extent->length - EXT4_EXTENT_MAX_INIT_LENGTH;
+	uint64_t physical = extentStart(*disk_extent);
+	auto begin = std::max(first, logical);
+	auto end = std::min(first + count, logical + length);
+	assert(begin < end);
+
+	if(zero_edges) {
+		std::vector<std::byte> zeros(blockSize);
+		co_await device->writeSectors((physical + (begin - logical)) * sectorsPerBlock,
+				zeros.data(), sectorsPerBlock);
+		if(end - 1 != begin)
+			co_await device->writeSectors((physical + (end - 1 - logical)) * sectorsPerBlock,
+					zeros.data(), sectorsPerBlock);
+	}
+
+	auto it = std::find_if(inode->extents.begin(), inode->extents.end(),
+			[&] (const Inode::Extent &extent) {
+		return extent.logical == logical;
+	});
+	assert(it != inode->extents.end());
+
+	// The existing entry keeps the head of the extent: either the uninitialized blocks
+	// before the range or the range itself. The remaining parts are inserted.
+	if(begin > logical) {
+		disk_extent->length = (begin - logical) + EXT4_EXTENT_MAX_INIT_LENGTH;
+		it->length = begin - logical;
+	}else{
+		disk_extent->length = end - logical;
+		it->length = end - logical;
+		it->uninitialized = false;
+	}
+	co_await writeExtentNode(*this, inode, leaf);
+
+	if(begin > logical)
+		co_await insertExtent(inode, {begin, physical + (begin - logical),
+				static_cast<uint32_t>(end - begin), false});
+	if(end < logical + length)
+		co_await insertExtent(inode, {end, physical + (end - logical),
+				static_cast<uint32_t>(logical + length - end), true});
+}
+
+async::result<void> FileSystem::enableLargeFile() {
+	if(largeFile)
+		co_return;
+	largeFile = true;
+
+	std::vector<uint8_t> buffer(1024);
+	co_await device->readSectors(2, buffer.data(), 2);
+	auto sb = reinterpret_cast<DiskSuperblock *>(buffer.data());
+	sb->featureRoCompat |= EXT2_FEATURE_RO_COMPAT_LARGE_FILE;
+	co_await device->writeSectors(2, buffer.data(), 2);
+}
+
 async::result<void> FileSystem::truncate(Inode *inode, size_t size) {
+	if(size >> 32)
+		co_await enableLargeFile();
+	// Allocations after the truncation start with a fresh (small) window.
+	dropReservation(inode);
+	inode->reservationSize = 0;
 	HEL_CHECK(helResizeMemory(inode->backingMemory,
 			(size + 0xFFF) & ~size_t(0xFFF)));
 	inode->setFileSize(size);
@@ -1436,6 +2933,82 @@ async::result<void> FileSystem::writebackBgdt() {
 OpenFile::OpenFile(std::shared_ptr<Inode> inode)
 : inode(inode), offset(0) { }
 
+namespace {
+
+// Asks the kernel to populate the page cache without waiting for the result.
+void loadahead(Inode *inode, uint64_t offset, uint64_t end) {
+	auto cache_size = (inode->fileSize() + 0xFFF) & ~uint64_t(0xFFF);
+	offset &= ~uint64_t(0xFFF);
+	end = std::min((end + 0xFFF) & ~uint64_t(0xFFF), cache_size);
+	if(offset >= end)
+		return;
+	HEL_CHECK(helLoadahead(inode->frontalMemory, offset, end - offset));
+}
+
+} // anonymous namespace
+
+void OpenFile::noteRead(uint64_t read_offset, size_t length) {
+	auto end = read_offset + length;
+	bool sequential = read_offset == nextReadOffset;
+	nextReadOffset = end;
+
+	if(advice == POSIX_FADV_RANDOM)
+		return;
+
+	if(!sequential) {
+		readaheadWindow = 0;
+		readaheadEnd = 0;
+		return;
+	}
+
+	auto max_window = maxReadahead;
+	if(advice == POSIX_FADV_SEQUENTIAL)
+		max_window *= 2;
+
+	if(!readaheadWindow) {
+		readaheadWindow = std::clamp(4 * length, minReadahead, max_window);
+		readaheadEnd = end;
+	}
+
+	// Issue the next window once the reader consumed half of the current one,
+	// such that it does not stall on the window boundary.
+	if(readaheadEnd > end + readaheadWindow / 2)
+		return;
+
+	auto start = std::max(readaheadEnd, end);
+	loadahead(inode.get(), start, start + readaheadWindow);
+	readaheadEnd = start + readaheadWindow;
+	readaheadWindow = std::min(2 * readaheadWindow, max_window);
+}
+
+frg::expected<protocols::fs::Error> OpenFile::advise(int64_t advise_offset, int64_t length,
+		int new_advice) {
+	if(advise_offset < 0 || length < 0)
+		return protocols::fs::Error::illegalArguments;
+
+	switch(new_advice) {
+	case POSIX_FADV_NORMAL:
+	case POSIX_FADV_SEQUENTIAL:
+	case POSIX_FADV_RANDOM:
+		advice = new_advice;
+		readaheadWindow = 0;
+		readaheadEnd = 0;
+		break;
+	case POSIX_FADV_WILLNEED: {
+		uint64_t end = length ? advise_offset + length : inode->fileSize();
+		loadahead(inode.get(), advise_offset, end);
+		break;
+	}
+	case POSIX_FADV_DONTNEED:
+	case POSIX_FADV_NOREUSE:
+		// We cannot drop pages from the page cache; these are only hints anyway.
+		break;
+	default:
+		return protocols::fs::Error::illegalArguments;
+	}
+	return {};
+}
+
 async::result<std::optional<std::string>>
 OpenFile::readEntries() {
 	co_await inode->readyJump.wait();
@@ -1,15 +1,21 @@
 
+#include <fcntl.h>
 #include <string.h>
 #include <time.h>
+#include <algorithm>
+#include <deque>
+#include <map>
 #include <optional>
 #include <memory>
 #include <optional>
+#include <set>
 #include <unordered_map>
 #include <unordered_set>
 #include <vector>
 #include <protocols/fs/file-locks.hpp>
 
 #include <async/oneshot-event.hpp>
+#include <async/mutex.hpp>
 #include <async/recurring-event.hpp>
 #include <hel.h>
 
@@ -93,7 +99,16 @@ struct DiskSuperblock {
 	//-- Other options --
 	uint32_t defaultMountOptions;
 	uint32_t firstMetaBg;
-	uint8_t unused[760];
+	uint32_t mkfsTime;
+	uint32_t journalBlocks[17];
+	//-- 64bit Support --
+	uint32_t blocksCountHi;
+	uint32_t rBlocksCountHi;
+	uint32_t freeBlocksCountHi;
+	uint16_t minExtraIsize;
+	uint16_t wantExtraIsize;
+	uint32_t flags;
+	uint8_t unused[668];
 };
 static_assert(sizeof(DiskSuperblock) == 1024, "Bad DiskSuperblock struct size");
 
@@ -125,7 +140,7 @@ struct DiskInode {
 	FileData data;
 	uint32_t generation;
 	uint32_t fileAcl;
-	uint32_t dirAcl;
+	uint32_t dirAcl; // Upper 32 bits of the size for regular files (large_file feature).
 	uint32_t faddr;
 	uint8_t osd2[12];
 };
@@ -135,6 +150,30 @@ enum {
 	EXT2_ROOT_INO = 2
 };
 
+enum {
+	EXT2_FEATURE_COMPAT_DIR_INDEX = 0x20
+};
+
+enum {
+	EXT2_FEATURE_RO_COMPAT_LARGE_FILE = 0x2
+};
+
+enum {
+	EXT4_FEATURE_INCOMPAT_EXTENTS = 0x40
+};
+
+// Superblock flags.
+enum {
+	EXT2_FLAGS_SIGNED_HASH = 0x1,
+	EXT2_FLAGS_UNSIGNED_HASH = 0x2
+};
+
+// Inode flags.
+enum {
+	EXT2_INDEX_FL = 0x1000,
+	EXT4_EXTENTS_FL = 0x80000
+};
+
 enum {
 	EXT2_S_IFMT = 0xF000,
 	EXT2_S_IFLNK = 0xA000,
@@ -156,6 +195,76 @@ enum {
 	EXT2_FT_SYMLINK = 7
 };
 
+// Hashed directory index (htree). Block 0 of an indexed directory holds the
+// "." and ".." entries, followed by DiskDxRootInfo and the root DiskDxEntry array.
+// Interior index blocks start with an empty DiskDirEntry that spans the whole block.
+// The first DiskDxEntry of each array stores DiskDxCountLimit instead of a hash.
+
+struct DiskDxRootInfo {
+	uint32_t reservedZero;
+	uint8_t hashVersion;
+	uint8_t infoLength;
+	uint8_t indirectLevels;
+	uint8_t unusedFlags;
+};
+static_assert(sizeof(DiskDxRootInfo) == 8, "Bad DiskDxRootInfo struct size");
+
+struct DiskDxCountLimit {
+	uint16_t limit;
+	uint16_t count;
+};
+
+struct DiskDxEntry {
+	uint32_t hash;
+	uint32_t block;
+};
+
+enum {
+	DX_HASH_LEGACY = 0,
+	DX_HASH_HALF_MD4 = 1,
+	DX_HASH_TEA = 2,
+	DX_HASH_LEGACY_UNSIGNED = 3,
+	DX_HASH_HALF_MD4_UNSIGNED = 4,
+	DX_HASH_TEA_UNSIGNED = 5
+};
+
+// Extent tree (ext4 extents feature). Inodes with EXT4_EXTENTS_FL store the root node
+// of the tree in FileData. Each node starts with a DiskExtentHeader; nodes of depth zero
+// contain DiskExtents, all other nodes contain DiskExtentIndex entries.
+
+struct DiskExtentHeader {
+	uint16_t magic;
+	uint16_t entries;
+	uint16_t max;
+	uint16_t depth;
+	uint32_t generation;
+};
+static_assert(sizeof(DiskExtentHeader) == 12, "Bad DiskExtentHeader struct size");
+
+struct DiskExtentIndex {
+	uint32_t block;
+	uint32_t leafLo;
+	uint16_t leafHi;
+	uint16_t unused;
+};
+static_assert(sizeof(DiskExtentIndex) == 12, "Bad DiskExtentIndex struct size");
+
+struct DiskExtent {
+	uint32_t block;
+	uint16_t length;
+	uint16_t startHi;
+	uint32_t startLo;
+};
+static_assert(sizeof(DiskExtent) == 12, "Bad DiskExtent struct size");
+
+enum {
+	EXT4_EXTENT_MAGIC = 0xF30A,
+	// Extents longer than this are uninitialized (i.e., preallocated but unwritten).
+	EXT4_EXTENT_MAX_INIT_LENGTH = 32768,
+	// Linux refuses deeper trees.
+	EXT4_EXTENT_MAX_DEPTH = 5
+};
+
 // --------------------------------------------------------
 // DirEntry
 // --------------------------------------------------------
@@ -171,8 +280,16 @@ struct DirEntry {
 
 struct FileSystem;
 
+// A kHelManageInitialize or kHelManageWriteback request on a file's page cache.
+struct ManageRequest {
+	int type;
+	uintptr_t offset;
+	size_t length;
+};
+
 struct Inode : std::enable_shared_from_this<Inode> {
 	Inode(FileSystem &fs, uint32_t number);
+	~Inode();
 
 	DiskInode *diskInode() {
 		return reinterpret_cast<DiskInode *>(diskMapping.get());
@@ -180,7 +297,11 @@ struct Inode : std::enable_shared_from_this<Inode> {
 
 	// Returns the size of the file in bytes.
 	uint64_t fileSize() {
-		return diskInode()->size;
+		auto disk_inode = diskInode();
+		uint64_t size = disk_inode->size;
+		if((disk_inode->mode & EXT2_S_IFMT) == EXT2_S_IFREG)
+			size |= uint64_t(disk_inode->dirAcl) << 32;
+		return size;
 	}
 
 	void setFileSize(uint64_t size);
@@ -195,6 +316,40 @@ struct Inode : std::enable_shared_from_this<Inode> {
 	async::result<protocols::fs::Error> chmod(int mode);
 	async::result<protocols::fs::Error> utimensat(uint64_t atime_sec, uint64_t atime_nsec, uint64_t mtime_sec, uint64_t mtime_nsec);
 
+	// Directory helpers; the directory's page cache must be locked.
+
+	// Location of a directory entry and of the entry preceding it in the same block.
+	struct EntryPosition {
+		uintptr_t offset;
+		std::optional<uintptr_t> previous;
+	};
+
+	// Path from the index root to a leaf block.
+	struct DxPath {
+		struct Frame {
+			// Offset of the DiskDxEntry array and the index of the entry that was taken.
+			uintptr_t entries;
+			unsigned int at;
+		};
+
+		uint32_t hash;
+		int hashVersion;
+		std::vector<Frame> frames;
+		uint32_t leaf;
+	};
+
+	bool isIndexed();
+	std::optional<DxPath> probeIndex(const std::string &name);
+	bool nextLeaf(DxPath &path);
+	std::optional<EntryPosition> scanBlock(uint32_t block, const std::string &name);
+	std::optional<EntryPosition> locateEntry(const std::string &name);
+
+	// Appends a block to the directory and returns a lock on the whole page cache.
+	async::result<helix::UniqueDescriptor> appendDirBlock();
+	async::result<std::optional<std::pair<uintptr_t, size_t>>>
+	claimIndexedSlot(const std::string &name, size_t required);
+	async::result<bool> makeIndexed();
+
 	FileSystem &fs;
 
 	// ext2fs on-disk inode number
@@ -214,6 +369,11 @@ struct Inode : std::enable_shared_from_this<Inode> {
 	HelHandle frontalMemory;
 	helix::Mapping fileMapping;
 
+	// manage requests that were not picked up by a worker yet
+	std::deque<ManageRequest> pendingManage;
+	// number of running serveManageRequests() coroutines
+	unsigned int numManageWorkers = 0;
+
 	// Caches indirection blocks reachable from the inode.
 	// - Indirection level 1/1 for single indirect blocks.
 	// - Indirection level 1/2 for double indirect blocks.
@@ -225,8 +385,42 @@ struct Inode : std::enable_shared_from_this<Inode> {
 	helix::UniqueDescriptor indirectOrder2;
 	// Caches indirection blocks reachable from order 2 blocks.
 	// - Indirection level 3/3 for triple indirect blocks.
+	// Only created once the triple indirect block is used.
 	helix::UniqueDescriptor indirectOrder3;
 
+	// Mapping of logical to physical blocks for inodes with EXT4_EXTENTS_FL.
+	struct Extent {
+		uint64_t logical;
+		uint64_t physical;
+		uint32_t length;
+		// Uninitialized extents read as zeros.
+		bool uninitialized;
+	};
+
+	bool usesExtents() {
+		return diskInode()->flags & EXT4_EXTENTS_FL;
+	}
+
+	// Returns the physical block of the given logical block (or zero for holes) and
+	// the number of blocks (up to limit) that are contiguous on disk starting at it.
+	std::pair<uint64_t, size_t> mapExtent(uint64_t index, size_t limit);
+
+	// Leaf entries of the extent tree, sorted by logical block.
+	// Loaded on first access; updated together with the on-disk tree.
+	std::vector<Extent> extents;
+	bool extentsLoaded = false;
+	// Protects the extent tree against concurrent modification.
+	async::mutex extentMutex;
+
+	// Block allocation state, see FileSystem::allocateBlocks().
+	// Block following the most recently allocated data block (or zero).
+	uint32_t allocGoal = 0;
+	// Blocks [reservationStart, reservationEnd) are reserved for this inode.
+	uint32_t reservationStart = 0;
+	uint32_t reservationEnd = 0;
+	// Size of the next reservation window; grows while the file is extended.
+	size_t reservationSize = 0;
+
 	// NOTE: The following fields are only meaningful if the isReady is true
 
 	FileType fileType;
@@ -253,32 +447,85 @@ struct FileSystem {
 	std::shared_ptr<Inode> accessRoot();
 	std::shared_ptr<Inode> accessInode(uint32_t number);
 	async::result<std::shared_ptr<Inode>> createRegular(int uid, int gid);
-	async::result<std::shared_ptr<Inode>> createDirectory();
-	async::result<std::shared_ptr<Inode>> createSymlink();
+	async::result<std::shared_ptr<Inode>> createDirectory(Inode *parent);
+	async::result<std::shared_ptr<Inode>> createSymlink(Inode *parent);
 
 	async::result<void> write(Inode *inode, uint64_t offset,
 			const void *buffer, size_t length);
 
 	async::detached initiateInode(std::shared_ptr<Inode> inode);
 	async::detached manageFileData(std::shared_ptr<Inode> inode);
+	async::detached serveManageRequests(std::shared_ptr<Inode> inode);
 	async::detached manageIndirect(std::shared_ptr<Inode> inode, int order,
 			helix::UniqueDescriptor memory);
 
-	async::result<uint32_t> allocateBlock();
-	async::result<uint32_t> allocateInode();
+	uint32_t firstBlockOfGroup(uint32_t bg) {
+		return firstDataBlock + bg * blocksPerGroup;
+	}
+	uint32_t groupOfBlock(uint32_t block) {
+		return (block - firstDataBlock) / blocksPerGroup;
+	}
+	uint32_t blocksInGroup(uint32_t bg) {
+		return std::min(blocksPerGroup, blocksCount - firstBlockOfGroup(bg));
+	}
+
+	// Allocates up to count contiguous data blocks for the inode. Returns the first
+	// block and the number of blocks (zero if the disk is full). Allocations continue
+	// in the inode's reservation window; if that is exhausted, a new window is
+	// reserved close to the previous one.
+	async::result<std::pair<uint32_t, size_t>> allocateBlocks(Inode *inode, size_t count);
+	// Allocates a single metadata block close to the inode's data.
+	async::result<uint32_t> allocateBlock(Inode *inode);
+	// Frees blocks that were allocated by allocateBlocks() but not used.
+	async::result<void> releaseBlocks(Inode *inode, uint32_t block, size_t count);
+	// Allocates an inode in (or, for directories, spread out from) the parent's group.
+	async::result<uint32_t> allocateInode(Inode *parent, bool directory);
+
+	// Finds the first run of at least min_length free blocks at or after goal and
+	// allocates its first count blocks. Returns the start and the length of the run
+	// (up to max_length). The rest of the run is reserved for reserve_for (if given).
+	async::result<std::pair<uint32_t, size_t>> claimBlocks(uint32_t goal, size_t count,
+			size_t min_length, size_t max_length, bool honor_reservations,
+			Inode *reserve_for);
+	void markBlocksUsed(uint32_t *words, uint32_t bg, uint32_t bit, size_t count);
+	// Returns the unused part of the inode's reservation window to other inodes.
+	void dropReservation(Inode *inode);
+
+	// Bitmaps and the BGDT are written back asynchronously. Allocations that happen
+	// while a writeback is in progress are batched into the next one.
+	void scheduleAllocationWriteback();
+	async::detached writebackAllocationState();
 
 	async::result<void> assignDataBlocks(Inode *inode,
 			uint64_t block_offset, size_t num_blocks);
 
+	// Creates the order 3 indirection cache on first use.
+	void ensureIndirectOrder3(Inode *inode);
+
+	// Extent tree support; the caller must hold the inode's extentMutex.
+	async::result<void> loadExtents(Inode *inode);
+	async::result<void> assignExtentBlocks(Inode *inode,
+			uint64_t block_offset, size_t num_blocks);
+	async::result<void> insertExtent(Inode *inode, Inode::Extent extent);
+	async::result<void> initializeExtent(Inode *inode, uint64_t logical,
+			uint64_t first, size_t count, bool zero_edges);
+
 	async::result<void> readDataBlocks(std::shared_ptr<Inode> inode, uint64_t block_offset,
 			size_t num_blocks, void *buffer);
+	// Allocates blocks that are missing (or uninitialized) before writing them.
 	async::result<void> writeDataBlocks(std::shared_ptr<Inode> inode, uint64_t block_offset,
 			size_t num_blocks, const void *buffer);
 
+	// Sets the large_file feature in the superblock (if it is not set yet).
+	async::result<void> enableLargeFile();
+
 	async::result<void> truncate(Inode *inode, size_t size);
 
 	async::result<void> writebackBgdt();
 
+	// Hash of a directory entry name for the directory index.
+	uint32_t dirHash(int version, const char *name, size_t length);
+
 	BlockDevice *device;
 	uint16_t inodeSize;
 	uint32_t blockShift;
@@ -290,14 +537,48 @@ struct FileSystem {
 	uint32_t inodesPerGroup;
 	uint32_t blocksCount;
 	uint32_t inodesCount;
+	uint32_t firstDataBlock;
 	std::vector<std::byte> blockGroupDescriptorBuffer;
 	DiskGroupDesc *bgdt;
 
+	// Reservation windows of inodes, mapping the first block to the end of the window.
+	// Other inodes only allocate blocks from a window if the disk is (nearly) full.
+	std::map<uint32_t, uint32_t> reservations;
+	static constexpr size_t minReservation = 8;
+	static constexpr size_t maxReservation = 1024;
+
+	// Group in which inodes without a parent are allocated.
+	uint32_t inodeRotor = 0;
+
+	// Block groups whose bitmaps need to be written back.
+	std::set<uint32_t> dirtyBlockBitmaps;
+	std::set<uint32_t> dirtyInodeBitmaps;
+	bool allocationWritebackActive = false;
+
+	bool largeFile;
+	bool extents;
+
+	// Directory index (dir_index feature) parameters from the superblock.
+	bool dirIndex;
+	bool unsignedDirHash;
+	uint8_t defHashVersion;
+	uint32_t hashSeed[4];
+
 	helix::UniqueDescriptor blockBitmap;
 	helix::UniqueDescriptor inodeBitmap;
 	helix::UniqueDescriptor inodeTable;
 
 	std::unordered_map<uint32_t, std::weak_ptr<Inode>> activeInodes;
+
+	// Limits on concurrently served page cache requests (per inode) and on
+	// the block I/Os that they issue (per file system, i.e., per device).
+	static constexpr unsigned int maxManageWorkersPerInode = 4;
+	static constexpr unsigned int maxManageIos = 32;
+	// Adjacent manage requests are merged up to this size.
+	static constexpr size_t maxManageMergeSize = size_t{1} << 20;
+
+	unsigned int numManageIos = 0;
+	async::recurring_event manageIoDone;
 };
 
 // --------------------------------------------------------
@@ -309,10 +590,27 @@ struct OpenFile {
 
 	async::result<std::optional<std::string>> readEntries();
 
+	// Called before reading [offset, offset + length) from the page cache.
+	// Sequential reads start (and grow) an asynchronous readahead window,
+	// other reads collapse it.
+	void noteRead(uint64_t offset, size_t length);
+
+	// Implements posix_fadvise() (and readahead(), which maps to POSIX_FADV_WILLNEED).
+	frg::expected<protocols::fs::Error> advise(int64_t offset, int64_t length, int advice);
+
+	static constexpr size_t minReadahead = 32 * 1024;
+	static constexpr size_t maxReadahead = 512 * 1024;
+
 	std::shared_ptr<Inode> inode;
 	uint64_t offset;
 	Flock flock;
 	bool append;
+
+	// Readahead state, see noteRead().
+	int advice = POSIX_FADV_NORMAL;
+	uint64_t nextReadOffset = 0;
+	uint64_t readaheadEnd = 0;
+	size_t readaheadWindow = 0;
 };
 
 } } // namespace blockfs::ext2fs
@@ -87,6 +87,7 @@ async::result<protocols::fs::ReadResult> read(void *object, const char *,
 
 	auto chunk_offset = self->offset;
 	self->offset += chunkSize;
+	self->noteRead(chunk_offset, chunkSize);
 
 	// TODO: If we *know* that the pages are already available,
 	//       we can also fall back to the following "old" mapping code.
@@ -141,6 +142,7 @@ async::result<protocols::fs::ReadResult> pread(void *object, int64_t offset, con
 		co_return size_t{0}; // TODO: Return an explicit end-of-file error?
 
 	auto chunk_offset = offset;
+	self->noteRead(chunk_offset, chunk_size);
 	auto map_offset = chunk_offset & ~size_t(0xFFF);
 	auto map_size = (((chunk_offset & size_t(0xFFF)) + chunk_size + 0xFFF) & ~size_t(0xFFF));
 
@@ -212,6 +214,13 @@ truncate(void *object, size_t size) {
 	co_return {};
 }
 
+async::result<frg::expected<protocols::fs::Error>>
+fadvise(void *object, int64_t offset, int64_t length, int advice) {
+	auto self = static_cast<ext2fs::OpenFile *>(object);
+	co_await self->inode->readyJump.wait();
+	co_return self->advise(offset, length, advice);
+}
+
 async::result<int> getFileFlags(void *) {
 	std::cout << "libblockfs: getFileFlags is stubbed" << std::endl;
     co_return 0;
@@ -236,6 +245,7 @@ constexpr protocols::fs::FileOperations fileOperations {
 	.flock        = &flock,
 	.getFileFlags = &getFileFlags,
 	.setFileFlags = &setFileFlags,
+	.fadvise      = &fadvise,
 };
 
 async::result<frg::expected<protocols::fs::Error, protocols::fs::GetLinkResult>>
@@ -1,6 +1,12 @@
 #include <nic/virtio/virtio.hpp>
 
+#include <algorithm>
+#include <cassert>
+#include <deque>
+#include <vector>
+
 #include <arch/dma_pool.hpp>
+#include <async/recurring-event.hpp>
 #include <core/virtio/core.hpp>
 
 namespace {
@@ -10,13 +16,40 @@ namespace {
 namespace {
 // Device feature bits.
 constexpr size_t legacyHeaderSize = 10;
+// Upper bound on the number of pre-posted receive buffers.
+constexpr size_t maxReceiveQueueDepth = 128;
+// Upper bound on the number of receive/transmit queue pairs that we use.
+constexpr unsigned int maxQueuePairs = 4;
 enum {
-	VIRTIO_NET_F_MAC = 5
+	VIRTIO_NET_F_CSUM = 0,
+	VIRTIO_NET_F_GUEST_CSUM = 1,
+	VIRTIO_NET_F_MAC = 5,
+	VIRTIO_NET_F_HOST_TSO4 = 11,
+	VIRTIO_NET_F_CTRL_VQ = 17,
+	VIRTIO_NET_F_MQ = 22
+};
+
+// Offsets into the device configuration space.
+constexpr size_t maxVirtqueuePairsOffset = 8;
+
+// Control virtqueue commands.
+enum {
+	VIRTIO_NET_CTRL_MQ = 4,
+	VIRTIO_NET_CTRL_MQ_VQ_PAIRS_SET = 0,
+	VIRTIO_NET_OK = 0
+};
+
+struct ControlCommand {
+	uint8_t cls;
+	uint8_t command;
+	uint16_t virtqueuePairs;
+	uint8_t ack;
 };
 
 // Bits for VirtHeader::flags.
 enum {
-	VIRTIO_NET_HDR_F_NEEDS_CSUM = 1
+	VIRTIO_NET_HDR_F_NEEDS_CSUM = 1,
+	VIRTIO_NET_HDR_F_DATA_VALID = 2
 };
 
 // Values for VirtHeader::gsoType.
@@ -43,13 +76,45 @@ struct VirtioNic : nic::Link {
 
 	async::result<size_t> receive(arch::dma_buffer_view) override;
 	async::result<void> send(const arch::dma_buffer_view) override;
+	async::result<void> sendOffloaded(const arch::dma_buffer_view,
+		nic::TransmitOffload offload) override;
+
+	size_t numReceiveQueues() override;
+	size_t receiveQueueDepth() override;
+	async::result<void> postReceives(std::vector<arch::dma_buffer> buffers, size_t queue) override;
+	async::result<std::vector<ReceivedFrame>> harvestReceived(size_t queue) override;
 
 	~VirtioNic() override = default;
 private:
+	async::result<void> transmit_(const arch::dma_buffer_view payload,
+		const nic::TransmitOffload &offload);
+
+	async::detached enableQueuePairs_(unsigned int numPairs);
+
+	struct ReceiveQueue;
+
+	struct ReceiveSlot : virtio_core::Request {
+		ReceiveSlot(ReceiveQueue *queue, arch::dma_pool *pool, arch::dma_buffer buffer)
+		: queue{queue}, header{pool}, buffer{std::move(buffer)} { }
+
+		ReceiveQueue *queue;
+		arch::dma_object<VirtHeader> header;
+		arch::dma_buffer buffer;
+		bool done = false;
+	};
+
+	struct ReceiveQueue {
+		virtio_core::Queue *vq;
+		// Receive buffers that are currently owned by the device, in posting order.
+		std::deque<std::unique_ptr<ReceiveSlot>> slots;
+		async::recurring_event event;
+	};
+
 	std::unique_ptr<virtio_core::Transport> transport_;
 	arch::contiguous_pool dmaPool_;
-	virtio_core::Queue *receiveVq_;
-	virtio_core::Queue *transmitVq_;
+	std::vector<std::unique_ptr<ReceiveQueue>> receiveQueues_;
+	std::vector<virtio_core::Queue *> transmitVqs_;
+	virtio_core::Queue *controlVq_ = nullptr;
 };
 
 VirtioNic::VirtioNic(std::unique_ptr<virtio_core::Transport> transport)
@@ -68,10 +133,48 @@ VirtioNic::VirtioNic(std::unique_ptr<virtio_core::Transport> transport)
 		transport_->acknowledgeDriverFeature(VIRTIO_NET_F_MAC);
 	}
 
+	if(transport_->checkDeviceFeature(VIRTIO_NET_F_CSUM)) {
+		transport_->acknowledgeDriverFeature(VIRTIO_NET_F_CSUM);
+		offloads_.txChecksum = true;
+
+		// TSO requires checksum offload.
+		if(transport_->checkDeviceFeature(VIRTIO_NET_F_HOST_TSO4)) {
+			transport_->acknowledgeDriverFeature(VIRTIO_NET_F_HOST_TSO4);
+			offloads_.tso4 = true;
+			offloads_.maxTsoSize = 0xFFFF;
+		}
+	}
+	if(transport_->checkDeviceFeature(VIRTIO_NET_F_GUEST_CSUM)) {
+		transport_->acknowledgeDriverFeature(VIRTIO_NET_F_GUEST_CSUM);
+		offloads_.rxChecksum = true;
+	}
+
+	// With VIRTIO_NET_F_MQ, the device steers received frames of a flow to the queue pair
+	// that the flow was last transmitted on (automatic receive steering).
+	unsigned int devicePairs = 1;
+	if(transport_->checkDeviceFeature(VIRTIO_NET_F_CTRL_VQ)
+			&& transport_->checkDeviceFeature(VIRTIO_NET_F_MQ)) {
+		transport_->acknowledgeDriverFeature(VIRTIO_NET_F_CTRL_VQ);
+		transport_->acknowledgeDriverFeature(VIRTIO_NET_F_MQ);
+		devicePairs = std::max(transport_->loadConfig16(maxVirtqueuePairsOffset), uint16_t{1});
+	}
+	unsigned int numPairs = std::min(devicePairs, maxQueuePairs);
+
 	transport_->finalizeFeatures();
-	transport_->claimQueues(2);
-	receiveVq_ = transport_->setupQueue(0);
-	transmitVq_ = transport_->setupQueue(1);
+
+	// Queue 2k receives and queue 2k + 1 transmits; the control queue comes after all pairs.
+	if(devicePairs > 1) {
+		transport_->claimQueues(2 * devicePairs + 1);
+		controlVq_ = transport_->setupQueue(2 * devicePairs);
+	}else{
+		transport_->claimQueues(2);
+	}
+	for(unsigned int i = 0; i < numPairs; i++) {
+		auto queue = std::make_unique<ReceiveQueue>();
+		queue->vq = transport_->setupQueue(2 * i);
+		receiveQueues_.push_back(std::move(queue));
+		transmitVqs_.push_back(transport_->setupQueue(2 * i + 1));
+	}
 
 	promiscuous_ = true;
 	all_multicast_ = true;
@@ -80,40 +183,159 @@ VirtioNic::VirtioNic(std::unique_ptr<virtio_core::Transport> transport)
 	l1_up_ = true;
 
 	transport_->runDevice();
+
+	if(numPairs > 1)
+		enableQueuePairs_(numPairs);
+}
+
+async::detached VirtioNic::enableQueuePairs_(unsigned int numPairs) {
+	arch::dma_object<ControlCommand> command { &dmaPool_ };
+	command.data()->cls = VIRTIO_NET_CTRL_MQ;
+	command.data()->command = VIRTIO_NET_CTRL_MQ_VQ_PAIRS_SET;
+	command.data()->virtqueuePairs = numPairs;
+	command.data()->ack = 0xFF;
+
+	auto view = command.view_buffer();
+	virtio_core::Chain chain;
+	chain.append(co_await controlVq_->obtainDescriptor());
+	chain.setupBuffer(virtio_core::hostToDevice, view.subview(0, 2));
+	chain.append(co_await controlVq_->obtainDescriptor());
+	chain.setupBuffer(virtio_core::hostToDevice, view.subview(2, 2));
+	chain.append(co_await controlVq_->obtainDescriptor());
+	chain.setupBuffer(virtio_core::deviceToHost, view.subview(4, 1));
+	co_await controlVq_->submitDescriptor(chain.front());
+
+	if(command.data()->ack != VIRTIO_NET_OK) {
+		// The device keeps using the first pair only; frames are still received there.
+		std::cout << "virtio-driver: Failed to enable " << numPairs
+				<< " queue pairs" << std::endl;
+		co_return;
+	}
+	std::cout << "virtio-driver: Using " << numPairs << " queue pairs" << std::endl;
 }
 
 async::result<size_t> VirtioNic::receive(arch::dma_buffer_view frame) {
 	arch::dma_object<VirtHeader> header { &dmaPool_ };
 
 	virtio_core::Chain chain;
-	chain.append(co_await receiveVq_->obtainDescriptor());
+	auto receiveVq = receiveQueues_.front()->vq;
+	chain.append(co_await receiveVq->obtainDescriptor());
 	chain.setupBuffer(virtio_core::deviceToHost,
 			header.view_buffer().subview(0, legacyHeaderSize));
-	chain.append(co_await receiveVq_->obtainDescriptor());
+	chain.append(co_await receiveVq->obtainDescriptor());
 	chain.setupBuffer(virtio_core::deviceToHost, frame);
 
-	co_return (co_await receiveVq_->submitDescriptor(chain.front()) - legacyHeaderSize);
+	co_return (co_await receiveVq->submitDescriptor(chain.front()) - legacyHeaderSize);
+}
+
+size_t VirtioNic::numReceiveQueues() {
+	return receiveQueues_.size();
+}
+
+size_t VirtioNic::receiveQueueDepth() {
+	// Each frame takes two descriptors (header + frame).
+	return std::min(receiveQueues_.front()->vq->numDescriptors() / 2, maxReceiveQueueDepth);
+}
+
+async::result<void> VirtioNic::postReceives(std::vector<arch::dma_buffer> buffers, size_t queue) {
+	auto rq = receiveQueues_[queue].get();
+	for(auto &buffer : buffers) {
+		auto slot = std::make_unique<ReceiveSlot>(rq, &dmaPool_, std::move(buffer));
+
+		virtio_core::Chain chain;
+		chain.append(co_await rq->vq->obtainDescriptor());
+		chain.setupBuffer(virtio_core::deviceToHost,
+				slot->header.view_buffer().subview(0, legacyHeaderSize));
+		chain.append(co_await rq->vq->obtainDescriptor());
+		chain.setupBuffer(virtio_core::deviceToHost, slot->buffer);
+
+		rq->vq->postDescriptor(chain.front(), slot.get(),
+				[] (virtio_core::Request *base_request) {
+			auto slot = static_cast<ReceiveSlot *>(base_request);
+			slot->done = true;
+			slot->queue->event.raise();
+		});
+		rq->slots.push_back(std::move(slot));
+	}
+
+	// Notify the device only once per batch.
+	if(!buffers.empty())
+		rq->vq->notify();
+}
+
+async::result<std::vector<nic::Link::ReceivedFrame>> VirtioNic::harvestReceived(size_t queue) {
+	auto rq = receiveQueues_[queue].get();
+	while(rq->slots.empty() || !rq->slots.front()->done)
+		co_await rq->event.async_wait();
+
+	std::vector<ReceivedFrame> frames;
+	while(!rq->slots.empty() && rq->slots.front()->done) {
+		auto &slot = rq->slots.front();
+		// With VIRTIO_NET_F_GUEST_CSUM, the device either validated the checksum
+		// or the frame originates from the host and does not carry one yet.
+		auto flags = slot->header.data()->flags;
+		bool checksumValid = offloads_.rxChecksum
+				&& (flags & (VIRTIO_NET_HDR_F_DATA_VALID | VIRTIO_NET_HDR_F_NEEDS_CSUM));
+		frames.push_back({std::move(slot->buffer), slot->len - legacyHeaderSize, checksumValid});
+		rq->slots.pop_front();
+	}
+
+	if(logFrames) {
+		std::cout << "virtio-driver: harvested " << frames.size()
+				<< " frames on queue " << queue << std::endl;
+	}
+	co_return frames;
 }
 
 async::result<void> VirtioNic::send(const arch::dma_buffer_view payload) {
-	if (payload.size() > 1514) {
+	co_await transmit_(payload, {});
+}
+
+async::result<void> VirtioNic::sendOffloaded(const arch::dma_buffer_view payload,
+		nic::TransmitOffload offload) {
+	co_await transmit_(payload, offload);
+}
+
+async::result<void> VirtioNic::transmit_(const arch::dma_buffer_view payload,
+		const nic::TransmitOffload &offload) {
+	if (offload.tcpSegmentation) {
+		assert(offloads_.tso4);
+		if (payload.size() > 14 + offloads_.maxTsoSize) {
+			throw std::runtime_error("data exceeds maximal TSO size");
+		}
+	} else if (payload.size() > 1514) {
 		throw std::runtime_error("data exceeds mtu");
 	}
 
 	arch::dma_object<VirtHeader> header { &dmaPool_ };
 	memset(header.data(), 0, sizeof(VirtHeader));
+	if (offload.checksum) {
+		assert(offloads_.txChecksum);
+		header.data()->flags = VIRTIO_NET_HDR_F_NEEDS_CSUM;
+		header.data()->csumStart = offload.checksumStart;
+		header.data()->csumOffset = offload.checksumOffset;
+	}
+	if (offload.tcpSegmentation) {
+		header.data()->gsoType = VIRTIO_NET_HDR_GSO_TCPV4;
+		header.data()->hdrLen = offload.headerLength;
+		header.data()->gsoSize = offload.segmentSize;
+	}
+
+	// Transmit all frames of a flow on the same queue (which also steers the flow's
+	// received frames to the corresponding receive queue).
+	auto transmitVq = transmitVqs_[offload.flowHash % transmitVqs_.size()];
 
 	virtio_core::Chain chain;
-	chain.append(co_await transmitVq_->obtainDescriptor());
+	chain.append(co_await transmitVq->obtainDescriptor());
 	chain.setupBuffer(virtio_core::hostToDevice,
 			header.view_buffer().subview(0, legacyHeaderSize));
-	chain.append(co_await transmitVq_->obtainDescriptor());
+	chain.append(co_await transmitVq->obtainDescriptor());
 	chain.setupBuffer(virtio_core::hostToDevice, payload);
 
 	if(logFrames) {
 		std::cout << "virtio-driver: sending frame" << std::endl;
 	}
-	co_await transmitVq_->submitDescriptor(chain.front());
+	co_await transmitVq->submitDescriptor(chain.front());
 	if(logFrames) {
 		std::cout << "virtio-driver: sent frame" << std::endl;
 	}
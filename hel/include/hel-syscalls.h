@@ -379,6 +379,16 @@ extern inline __attribute__ (( always_inline )) HelError helSubmitAsync(HelHandl
 			(HelWord)queue, (HelWord)context, (HelWord)flags);
 };
 
+extern inline __attribute__ (( always_inline )) HelError helSubmitAsyncBatch(
+		const struct HelChain *chains, size_t count, HelHandle queue, uint32_t flags,
+		size_t *numSubmitted) {
+	HelWord numSubmittedWord;
+	HelError error = helSyscall4_1(kHelCallSubmitAsyncBatch, (HelWord)chains, (HelWord)count,
+			(HelWord)queue, (HelWord)flags, &numSubmittedWord);
+	*numSubmitted = (size_t)numSubmittedWord;
+	return error;
+};
+
 extern inline __attribute__ (( always_inline )) HelError helShutdownLane(HelHandle handle) {
 	return helSyscall1(kHelCallShutdownLane, (HelWord)handle);
 };
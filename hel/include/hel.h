@@ -18,7 +18,7 @@
 
 enum {
 	// largest system call number plus 1
-	kHelNumCalls = 105,
+	kHelNumCalls = 106,
 
 	kHelCallLog = 1,
 	kHelCallPanic = 10,
@@ -83,6 +83,7 @@ enum {
 
 	kHelCallCreateStream = 68,
 	kHelCallSubmitAsync = 79,
+	kHelCallSubmitAsyncBatch = 105,
 	kHelCallShutdownLane = 91,
 
 	kHelCallFutexWait = 73,
@@ -225,6 +226,14 @@ struct HelAction {
 	HelHandle handle;
 };
 
+//! A chain of actions that is submitted to a lane (see ::helSubmitAsyncBatch).
+struct HelChain {
+	HelHandle lane;
+	const struct HelAction *actions;
+	size_t count;
+	uintptr_t context;
+};
+
 struct HelDescriptorInfo {
 	int type;
 };
@@ -232,6 +241,7 @@ struct HelDescriptorInfo {
 enum HelAllocFlags {
 	kHelAllocContinuous = 4,
 	kHelAllocOnDemand = 1,
+	kHelAllocHugePages = 8,
 };
 
 struct HelAllocRestrictions {
@@ -684,6 +694,10 @@ HEL_C_LINKAGE HelError helCancelAsync(HelHandle queueHandle, uint64_t asyncId);
 //! @param[in] size
 //!    	Size of the memory object in bytes.
 //!    	Must be aligned to the system's page size.
+//! @param[in] flags
+//!    	Allocation flags. If ::kHelAllocHugePages is given and @p size
+//!    	is a multiple of the huge page size (2 MiB), the memory is backed
+//!    	by huge pages and suitably aligned mappings use huge page table entries.
 //! @param[in] restrictions
 //!    	Specifies restrictions for the kernel's memory allocator.
 //!    	May be @p NULL if there are no restrictions.
@@ -1068,6 +1082,24 @@ HEL_C_LINKAGE HelError helCreateStream(HelHandle *lane1, HelHandle *lane2, uint3
 HEL_C_LINKAGE HelError helSubmitAsync(HelHandle handle, const struct HelAction *actions,
 		size_t count, HelHandle queue, uintptr_t context, uint32_t flags);
 
+//! Pass messages on multiple lanes using a single system call.
+//!
+//! Behaves as if ::helSubmitAsync was called on each element of @p chains (in order).
+//! @param[in] chains
+//!     Pointer to array of action chains.
+//! @param[in] count
+//!     Number of elements in @p chains.
+//! @param[in] queue
+//!     Queue that receives the results of all chains.
+//! @param[in] flags
+//!     Must be zero.
+//! @param[out] numSubmitted
+//!     Number of chains that were submitted successfully.
+//!     If this is less than @p count, the error refers to the first chain
+//!     that was not submitted; the remaining chains are not submitted either.
+HEL_C_LINKAGE HelError helSubmitAsyncBatch(const struct HelChain *chains, size_t count,
+		HelHandle queue, uint32_t flags, size_t *numSubmitted);
+
 HEL_C_LINKAGE HelError helShutdownLane(HelHandle handle);
 
 //! Create a token object.
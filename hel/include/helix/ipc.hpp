@@ -2,6 +2,7 @@
 
 #include <assert.h>
 #include <tuple>
+#include <algorithm>
 #include <array>
 
 #include <async/oneshot-event.hpp>
@@ -170,11 +171,17 @@ private:
 public:
 	static constexpr int sizeShift = 9;
 
+	// Maximal number of chains that are buffered by submitChain().
+	static constexpr size_t maxPendingChains = 32;
+
 	static Dispatcher &global();
 
 	Dispatcher()
 	: _handle{kHelNullHandle}, _queue{nullptr},
-			_activeChunks{0}, _retrieveIndex{0}, _nextIndex{0}, _lastProgress{0} { }
+			_activeChunks{0}, _retrieveIndex{0}, _nextIndex{0}, _lastProgress{0},
+			_numPendingChains{0}, _numSubmissions{0},
+			_spinLimit{0}, _spinBudget{0}, _numSkippedPolls{0},
+			_numAvoidedSleeps{0}, _numSleeps{0} { }
 
 	Dispatcher(const Dispatcher &) = delete;
 
@@ -208,7 +215,69 @@ public:
 		return _handle;
 	}
 
+	// Defers the submission of an action chain until flushChains() is called.
+	// This allows multiple chains to be submitted using a single system call.
+	// The actions must stay valid until the chain is flushed.
+	void submitChain(HelHandle lane, const HelAction *actions, size_t count, Context *context) {
+		if(_numPendingChains == maxPendingChains)
+			flushChains();
+		_pendingChains[_numPendingChains++] = HelChain{
+			.lane = lane,
+			.actions = actions,
+			.count = count,
+			.context = reinterpret_cast<uintptr_t>(context)
+		};
+	}
+
+	// Submits all chains that were deferred by submitChain().
+	// This is called automatically before the dispatcher blocks in wait().
+	void flushChains() {
+		if(!_numPendingChains)
+			return;
+
+		size_t numSubmitted;
+		HEL_CHECK(helSubmitAsyncBatch(_pendingChains, _numPendingChains, acquire(), 0,
+				&numSubmitted));
+		assert(numSubmitted == _numPendingChains);
+		_numPendingChains = 0;
+		_numSubmissions++;
+	}
+
+	// Called for each system call that submits chains without going through submitChain().
+	void noteSubmission() {
+		_numSubmissions++;
+	}
+
+	// Number of system calls issued to submit exchangeMsgs() chains, coalesced or not.
+	uint64_t numSubmissions() {
+		return _numSubmissions;
+	}
+
+	// If non-zero, wait() polls the queue for up to this many iterations
+	// before it blocks on the futex. This trades CPU time for latency.
+	// The number of iterations adapts: it doubles (up to the limit) whenever polling
+	// avoids a sleep and it halves whenever it does not. Once it reaches zero,
+	// polling is only retried occasionally, such that idle (or uniprocessor)
+	// systems do not waste CPU time.
+	void setSpinLimit(unsigned int spinLimit) {
+		_spinLimit = spinLimit;
+		_spinBudget = spinLimit;
+		_numSkippedPolls = 0;
+	}
+
+	// Number of times that polling found a new element such that we did not have to block.
+	uint64_t numAvoidedSleeps() {
+		return _numAvoidedSleeps;
+	}
+
+	// Number of times that we blocked on the futex.
+	uint64_t numSleeps() {
+		return _numSleeps;
+	}
+
 	void wait() {
+		flushChains();
+
 		while(true) {
 			// TODO: Initialize all chunks when setting up the queue.
 			if(_retrieveIndex == _nextIndex) {
@@ -300,7 +369,44 @@ private:
 		}
 	}
 
+	bool _pollProgressFutex(bool *done) {
+		for(unsigned int i = 0; i < _spinBudget; ++i) {
+			auto futex = __atomic_load_n(&_retrieveChunk()->progressFutex, __ATOMIC_ACQUIRE);
+			if(_lastProgress != (futex & kHelProgressMask)) {
+				*done = false;
+				return true;
+			}else if(futex & kHelProgressDone) {
+				*done = true;
+				return true;
+			}
+#if defined(__x86_64__)
+			asm volatile ("pause");
+#elif defined(__aarch64__)
+			asm volatile ("yield");
+#endif
+		}
+		return false;
+	}
+
 	void _waitProgressFutex(bool *done) {
+		if(_spinLimit && !_spinBudget && ++_numSkippedPolls == reprobeInterval) {
+			_spinBudget = std::max(_spinLimit / 16, 1u);
+			_numSkippedPolls = 0;
+		}
+
+		if(_spinBudget) {
+			auto futex = __atomic_load_n(&_retrieveChunk()->progressFutex, __ATOMIC_ACQUIRE);
+			// Only count polls that actually had to wait.
+			if(_lastProgress == (futex & kHelProgressMask) && !(futex & kHelProgressDone)) {
+				if(_pollProgressFutex(done)) {
+					_spinBudget = std::min(2 * _spinBudget, _spinLimit);
+					_numAvoidedSleeps++;
+					return;
+				}
+				_spinBudget /= 2;
+			}
+		}
+
 		while(true) {
 			auto futex = __atomic_load_n(&_retrieveChunk()->progressFutex, __ATOMIC_ACQUIRE);
 			assert(!(futex & ~(kHelProgressMask | kHelProgressWaiters | kHelProgressDone)));
@@ -319,6 +425,7 @@ private:
 						_lastProgress | kHelProgressWaiters,
 						false, __ATOMIC_ACQUIRE, __ATOMIC_ACQUIRE));
 
+			_numSleeps++;
 			HEL_CHECK(helFutexWait(&_retrieveChunk()->progressFutex,
 					_lastProgress | kHelProgressWaiters, -1));
 		}
@@ -341,6 +448,19 @@ private:
 
 	// Per-chunk reference counts.
 	int _refCounts[16];
+
+	HelChain _pendingChains[maxPendingChains];
+	size_t _numPendingChains;
+	uint64_t _numSubmissions;
+
+	// Number of sleeps after which polling is retried once the budget dropped to zero.
+	static constexpr unsigned int reprobeInterval = 64;
+
+	unsigned int _spinLimit;
+	unsigned int _spinBudget;
+	unsigned int _numSkippedPolls;
+	uint64_t _numAvoidedSleeps;
+	uint64_t _numSleeps;
 };
 
 inline void CurrentDispatcherToken::wait() {
@@ -908,16 +1028,26 @@ using namespace helix;
 
 template <typename Results, typename Actions, typename Receiver>
 struct ExchangeMsgsOperation : private Context {
-	ExchangeMsgsOperation(BorrowedDescriptor lane, Actions actions, Receiver receiver)
-	: lane_{std::move(lane)}, actions_{std::move(actions)}, receiver_{std::move(receiver)} { }
+	ExchangeMsgsOperation(BorrowedDescriptor lane, Actions actions, bool coalesce,
+			Receiver receiver)
+	: lane_{std::move(lane)}, actions_{std::move(actions)}, coalesce_{coalesce},
+			receiver_{std::move(receiver)} { }
 
 	void start() {
-		auto helActions = frg::apply(chainActionArrays, actions_);
-
 		auto context = static_cast<Context *>(this);
-		HEL_CHECK(helSubmitAsync(lane_.getHandle(),
-				helActions.data(), helActions.size(), Dispatcher::global().acquire(),
-				reinterpret_cast<uintptr_t>(context), 0));
+		if(coalesce_) {
+			// The actions need to outlive this function.
+			helActions_ = frg::apply(chainActionArrays, actions_);
+			Dispatcher::global().submitChain(lane_.getHandle(),
+					helActions_.data(), helActions_.size(), context);
+		}else{
+			auto helActions = frg::apply(chainActionArrays, actions_);
+
+			HEL_CHECK(helSubmitAsync(lane_.getHandle(),
+					helActions.data(), helActions.size(), Dispatcher::global().acquire(),
+					reinterpret_cast<uintptr_t>(context), 0));
+			Dispatcher::global().noteSubmission();
+		}
 	}
 
 private:
@@ -934,6 +1064,8 @@ private:
 
 	BorrowedDescriptor lane_;
 	Actions actions_;
+	bool coalesce_;
+	decltype(frg::apply(chainActionArrays, std::declval<Actions &>())) helActions_;
 	Receiver receiver_;
 };
 
@@ -941,17 +1073,18 @@ template <typename Results, typename Actions>
 struct [[nodiscard]] ExchangeMsgsSender {
 	using value_type = Results;
 
-	ExchangeMsgsSender(BorrowedDescriptor lane, Results, Actions actions)
-	: lane_{std::move(lane)}, actions_{std::move(actions)} { }
+	ExchangeMsgsSender(BorrowedDescriptor lane, Results, Actions actions, bool coalesce = false)
+	: lane_{std::move(lane)}, actions_{std::move(actions)}, coalesce_{coalesce} { }
 
 	template<typename Receiver>
 	ExchangeMsgsOperation<Results, Actions, Receiver> connect(Receiver receiver) {
-		return {std::move(lane_), std::move(actions_), std::move(receiver)};
+		return {std::move(lane_), std::move(actions_), coalesce_, std::move(receiver)};
 	}
 
 private:
 	BorrowedDescriptor lane_;
 	Actions actions_;
+	bool coalesce_;
 };
 
 template <typename Results, typename Actions>
@@ -969,6 +1102,20 @@ auto exchangeMsgs(BorrowedDescriptor descriptor, Args &&...args) {
 	};
 }
 
+// Like exchangeMsgs() but the submission is deferred until the dispatcher flushes
+// its pending chains (at the latest, when it waits for completions).
+// This allows servers that reply to many clients to submit all replies at once.
+// Callers must not block outside of the dispatcher while waiting for the result.
+template <typename ...Args>
+auto exchangeMsgsCoalesced(BorrowedDescriptor descriptor, Args &&...args) {
+	return ExchangeMsgsSender{
+		std::move(descriptor),
+		createResultsTuple(args...),
+		frg::tuple{std::forward<Args>(args)...},
+		true
+	};
+}
+
 // --------------------------------------------------------------------
 // Operations other than exchangeMsgs().
 // --------------------------------------------------------------------
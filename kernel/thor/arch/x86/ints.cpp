@@ -483,6 +483,9 @@ extern "C" void onPlatformPing(IrqImageAccessor image) {
 
 	acknowledgeIpi();
 
+	// Pings are also used to forward deadlines of the CPU-local timer engine.
+	LocalApicContext::handleRemoteAlarm();
+
 	handlePreemption(image);
 }
 
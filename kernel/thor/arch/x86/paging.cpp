@@ -166,7 +166,8 @@ ClientPageSpace::~ClientPageSpace() {
 		PageAccessor accessor{ps};
 		auto tbl = reinterpret_cast<uint64_t *>(accessor.get());
 		for(int i = 0; i < 512; i++) {
-			if(tbl[i] & ptePresent)
+			// Large pages are owned by their memory views, not by the page tables.
+			if((tbl[i] & ptePresent) && !(tbl[i] & pteLargePage))
 				physicalAllocator->free(tbl[i] & pteAddress, kPageSize);
 		}
 	};
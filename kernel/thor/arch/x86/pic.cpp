@@ -128,8 +128,20 @@ void GlobalApicContext::GlobalAlarmSlot::arm(uint64_t nanos) {
 	LocalApicContext::_updateLocalTimer();
 }
 
+void LocalApicContext::LocalAlarmSlot::arm(uint64_t nanos) {
+	_context->_localDeadline.store(nanos, std::memory_order_relaxed);
+
+	// Only the owning CPU can program its timer.
+	if(_context == localApicContext()) {
+		LocalApicContext::_updateLocalTimer();
+	}else{
+		assert(_context->_cpuData);
+		sendPingIpi(_context->_cpuData);
+	}
+}
+
 LocalApicContext::LocalApicContext()
-: _preemptionDeadline{0}, _globalDeadline{0} { }
+: _preemptionDeadline{0}, _globalDeadline{0}, _localAlarmInstance{this}, _localDeadline{0} { }
 
 void LocalApicContext::setPreemption(uint64_t nanos) {
 	assert(localApicContext()->timersAreCalibrated);
@@ -166,9 +178,23 @@ void LocalApicContext::handleTimerIrq() {
 		}
 	}
 
+	auto localDeadline = self->_localDeadline.load(std::memory_order_relaxed);
+	if(localDeadline && now > localDeadline) {
+		// Only reset the deadline if it was not concurrently re-armed.
+		self->_localDeadline.compare_exchange_strong(localDeadline, 0,
+				std::memory_order_relaxed);
+		self->_localAlarmInstance.fireAlarm();
+	}
+
 	localApicContext()->_updateLocalTimer();
 }
 
+void LocalApicContext::handleRemoteAlarm() {
+	if(!localApicContext()->timersAreCalibrated)
+		return;
+	_updateLocalTimer();
+}
+
 void LocalApicContext::_updateLocalTimer() {
 	uint64_t deadline = 0;
 	auto consider = [&] (uint64_t dc) {
@@ -187,6 +213,7 @@ void LocalApicContext::_updateLocalTimer() {
 
 	consider(localApicContext()->_preemptionDeadline);
 	consider(localApicContext()->_globalDeadline);
+	consider(localApicContext()->_localDeadline.load(std::memory_order_relaxed));
 
 	if(localApicContext()->useTscMode) {
 		if(!deadline) {
@@ -324,6 +351,10 @@ void initLocalApicPerCpu() {
 	picBase.store(lApicLvtPerfCount, apicLvtMode(4));
 
 	calibrateApicTimer();
+
+	// On the boot CPU, this happens once the system clock source is known.
+	if(systemClockSource())
+		initLocalTimerEngine();
 }
 
 uint32_t getLocalApicId() {
@@ -402,9 +433,23 @@ static initgraph::Task assessTimersTask{&globalInitEngine, "x86.assess-timers",
 		globalTimerEngine = frg::construct<PrecisionTimerEngine>(*kernelAlloc,
 				globalClockSource, globalApicContext()->globalAlarm());
 	//			globalClockSource, hpetAlarmTracker);
+
+		// The boot CPU has already initialized its local APIC at this point.
+		initLocalTimerEngine();
 	}
 };
 
+void initLocalTimerEngine() {
+	assert(globalClockSource);
+	assert(localApicContext()->timersAreCalibrated);
+	auto cpuData = getCpuData();
+	assert(!cpuData->localTimerEngine);
+
+	localApicContext()->_cpuData = cpuData;
+	cpuData->localTimerEngine = frg::construct<PrecisionTimerEngine>(*kernelAlloc,
+			globalClockSource, &localApicContext()->_localAlarmInstance);
+}
+
 void acknowledgeIpi() {
 	picBase.store(lApicEoi, 0);
 }
@@ -20,9 +20,13 @@ constexpr uint64_t ptePwt = 0x8;
 constexpr uint64_t ptePcd = 0x10;
 constexpr uint64_t pteDirty = 0x40;
 constexpr uint64_t ptePat = 0x80;
+// In the PDPT and PD, bit 7 selects a large page and the PAT bit moves to bit 12.
+constexpr uint64_t pteLargePage = 0x80;
+constexpr uint64_t pteLargePat = 0x1000;
 constexpr uint64_t pteGlobal = 0x100;
 constexpr uint64_t pteXd = 0x8000000000000000;
 constexpr uint64_t pteAddress = 0x000FFFFFFFFFF00;
+constexpr uint64_t pteLargeAddress = 0x000FFFFFFFE00000;
 
 inline int getLowerHalfBits() {
 	return 47;
@@ -59,6 +63,36 @@ struct X86CursorPolicy {
 
 	static constexpr uint64_t pteBuild(PhysicalAddr physical, PageFlags flags, CachingMode cachingMode) {
 		auto pte = physical | ptePresent;
+		pte |= pteFlags_(flags, cachingMode, ptePat);
+		return pte;
+	}
+
+	static constexpr bool pteLargePresent(uint64_t pte) {
+		return (pte & ptePresent) && (pte & pteLargePage);
+	}
+
+	static constexpr PhysicalAddr pteLargeAddress(uint64_t pte) {
+		return pte & thor::pteLargeAddress;
+	}
+
+	static constexpr uint64_t pteBuildLarge(PhysicalAddr physical, PageFlags flags,
+			CachingMode cachingMode) {
+		assert(!(physical & ~thor::pteLargeAddress));
+		auto pte = physical | ptePresent | pteLargePage;
+		pte |= pteFlags_(flags, cachingMode, pteLargePat);
+		return pte;
+	}
+
+	static constexpr uint64_t pteSplitLarge(uint64_t pte, size_t index) {
+		auto small = (pte & ~(thor::pteLargeAddress | pteLargePage | pteLargePat))
+				| (pteLargeAddress(pte) + (index << 12));
+		if(pte & pteLargePat)
+			small |= ptePat;
+		return small;
+	}
+
+	static constexpr uint64_t pteFlags_(PageFlags flags, CachingMode cachingMode, uint64_t patBit) {
+		uint64_t pte = 0;
 
 		if constexpr (Kernel)
 			pte |= pteGlobal;
@@ -71,7 +105,7 @@ struct X86CursorPolicy {
 		if(cachingMode == CachingMode::writeThrough) {
 			pte |= ptePwt;
 		}else if(cachingMode == CachingMode::writeCombine) {
-			pte |= ptePat | ptePwt;
+			pte |= patBit | ptePwt;
 		}else if(cachingMode == CachingMode::uncached || cachingMode == CachingMode::mmio
 				|| cachingMode == CachingMode::mmioNonPosted) {
 			pte |= ptePcd;
@@ -84,7 +118,7 @@ struct X86CursorPolicy {
 
 
 	static constexpr bool pteTablePresent(uint64_t pte) {
-		return pte & ptePresent;
+		return (pte & ptePresent) && !(pte & pteLargePage);
 	}
 
 	static constexpr PhysicalAddr pteTableAddress(uint64_t pte) {
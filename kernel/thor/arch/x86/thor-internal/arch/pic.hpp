@@ -9,6 +9,8 @@
 
 namespace thor {
 
+struct CpuData;
+
 // --------------------------------------------------------
 // Local APIC management
 // --------------------------------------------------------
@@ -78,6 +80,21 @@ private:
 
 struct LocalApicContext {
 	friend struct GlobalApicContext;
+	friend void initLocalTimerEngine();
+
+	// Alarm that drives the CPU-local timer engine.
+	// arm() can be called from any CPU; remote calls are forwarded via a ping IPI.
+	struct LocalAlarmSlot final : AlarmTracker {
+		using AlarmTracker::fireAlarm;
+
+		LocalAlarmSlot(LocalApicContext *context)
+		: _context{context} { }
+
+		void arm(uint64_t nanos) override;
+
+	private:
+		LocalApicContext *_context;
+	};
 
 	LocalApicContext();
 
@@ -86,6 +103,9 @@ struct LocalApicContext {
 
 	static void handleTimerIrq();
 
+	// Reprograms the local timer after a remote CPU changed the local alarm.
+	static void handleRemoteAlarm();
+
 	bool useTscMode = false;
 	bool timersAreCalibrated = false;
 	uint32_t localTicksPerMilli = 0;
@@ -97,6 +117,10 @@ private:
 private:
 	uint64_t _preemptionDeadline;
 	uint64_t _globalDeadline;
+
+	LocalAlarmSlot _localAlarmInstance;
+	std::atomic<uint64_t> _localDeadline;
+	CpuData *_cpuData = nullptr;
 };
 
 GlobalApicContext *globalApicContext();
@@ -105,6 +129,8 @@ initgraph::Stage *getApicDiscoveryStage();
 
 void initLocalApicPerCpu();
 
+void initLocalTimerEngine();
+
 uint32_t getLocalApicId();
 
 uint64_t localTicks();
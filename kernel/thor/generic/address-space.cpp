@@ -107,6 +107,11 @@ frg::expected<Error> VirtualOperations::faultPage(VirtualAddr va, MemoryView *vi
 	return {};
 }
 
+frg::expected<Error> VirtualOperations::faultLargePage(VirtualAddr, MemoryView *,
+		uintptr_t, PageFlags) {
+	return Error::noHardwareSupport;
+}
+
 frg::expected<Error> VirtualOperations::cleanPages(VirtualAddr va, MemoryView *view,
 		uintptr_t offset, size_t size) {
 	assert(!(va & (kPageSize - 1)));
@@ -445,7 +450,19 @@ VirtualSpace::map(smarter::borrowed_ptr<MemorySlice> slice,
 					actualAddress = FRG_CO_TRY(_allocate(length, flags));
 				}
 			}else {
-				actualAddress = FRG_CO_TRY(_allocate(length, flags));
+				// Align mappings of large, contiguous views such that they can use large pages.
+				// If no aligned hole is available, we fall back to an unaligned one.
+				auto viewOffset = slice->offset() + offset;
+				if(length >= kHugePageSize && !(viewOffset & (kHugePageSize - 1))
+						&& slice->getView()->peekContiguity(viewOffset) >= kHugePageSize) {
+					if(auto res = _allocate(length, flags, kHugePageSize)) {
+						actualAddress = res.unwrap();
+					}else{
+						actualAddress = FRG_CO_TRY(_allocate(length, flags));
+					}
+				}else{
+					actualAddress = FRG_CO_TRY(_allocate(length, flags));
+				}
 			}
 		}
 
@@ -671,6 +688,20 @@ VirtualSpace::handleFault(VirtualAddr address, uint32_t faultFlags,
 		co_await mapping->evictionMutex.async_lock();
 		frg::unique_lock evictionLock{frg::adopt_lock, mapping->evictionMutex};
 
+		// Map the entire surrounding large page if the mapping covers it.
+		// Otherwise (or if the view is not suitably backed), fall back to small pages.
+		auto largeAddress = address & ~(kHugePageSize - 1);
+		if(largeAddress >= mapping->address
+				&& largeAddress + kHugePageSize <= mapping->address + mapping->length) {
+			auto largeOffset = mapping->viewOffset + (largeAddress - mapping->address);
+			if(!(largeOffset & (kHugePageSize - 1))) {
+				auto largeOutcome = _ops->faultLargePage(largeAddress,
+						mapping->view.get(), largeOffset, mapping->compilePageFlags());
+				if(largeOutcome)
+					co_return {};
+			}
+		}
+
 		auto remapOutcome = _ops->faultPage(address & ~(kPageSize - 1),
 				mapping->view.get(), mapping->viewOffset + offset,
 				mapping->compilePageFlags());
@@ -764,13 +795,17 @@ bool VirtualSpace::_areMappingsInRange(VirtualAddr address, size_t length) {
 	return false;
 }
 
-frg::expected<Error, VirtualAddr> VirtualSpace::_allocate(size_t length, MapFlags flags) {
+frg::expected<Error, VirtualAddr> VirtualSpace::_allocate(size_t length, MapFlags flags,
+		size_t align) {
 	assert(length > 0);
 	assert((length % kPageSize) == 0);
+	assert(align >= kPageSize && !(align & (align - 1)));
 //	infoLogger() << "Allocate virtual memory area"
 //			<< ", size: 0x" << frg::hex_fmt(length) << frg::endlog;
 
-	if(_holes.get_root()->largestHole < length)
+	// Holes of this size can always fit an aligned area.
+	auto needed = length + align - kPageSize;
+	if(_holes.get_root()->largestHole < needed)
 		return Error::noMemory;
 
 	auto current = _holes.get_root();
@@ -778,41 +813,41 @@ frg::expected<Error, VirtualAddr> VirtualSpace::_allocate(size_t length, MapFlag
 		if(flags & kMapPreferBottom) {
 			// Try to allocate memory at the bottom of the range.
 			if(HoleTree::get_left(current)
-					&& HoleTree::get_left(current)->largestHole >= length) {
+					&& HoleTree::get_left(current)->largestHole >= needed) {
 				current = HoleTree::get_left(current);
 				continue;
 			}
 
-			if(current->length() >= length) {
+			if(current->length() >= needed) {
 				// Note that _splitHole can deallocate the hole!
-				auto address = current->address();
-				_splitHole(current, 0, length);
+				auto address = (current->address() + align - 1) & ~(align - 1);
+				_splitHole(current, address - current->address(), length);
 				return address;
 			}
 
 			assert(HoleTree::get_right(current));
-			assert(HoleTree::get_right(current)->largestHole >= length);
+			assert(HoleTree::get_right(current)->largestHole >= needed);
 			current = HoleTree::get_right(current);
 		}else{
 			// Try to allocate memory at the top of the range.
 			assert(flags & kMapPreferTop);
 
 			if(HoleTree::get_right(current)
-					&& HoleTree::get_right(current)->largestHole >= length) {
+					&& HoleTree::get_right(current)->largestHole >= needed) {
 				current = HoleTree::get_right(current);
 				continue;
 			}
 
-			if(current->length() >= length) {
+			if(current->length() >= needed) {
 				// Note that _splitHole can deallocate the hole!
-				auto offset = current->length() - length;
-				auto address = current->address() + offset;
+				auto address = (current->address() + current->length() - length) & ~(align - 1);
+				auto offset = address - current->address();
 				_splitHole(current, offset, length);
 				return address;
 			}
 
 			assert(HoleTree::get_left(current));
-			assert(HoleTree::get_left(current)->largestHole >= length);
+			assert(HoleTree::get_left(current)->largestHole >= needed);
 			current = HoleTree::get_left(current);
 		}
 	}
@@ -1237,6 +1272,42 @@ coroutine<size_t> VirtualSpace::writePartialSpace(uintptr_t address,
 	co_return progress;
 }
 
+coroutine<frg::expected<Error, PinnedPage>> VirtualSpace::pinPage(uintptr_t address,
+		smarter::shared_ptr<WorkQueue> wq) {
+	assert(!(address & (kPageSize - 1)));
+	// We do not take _consistencyMutex here since we are only interested in a snapshot.
+
+	smarter::shared_ptr<Mapping> mapping;
+	{
+		auto irqLock = frg::guard(&irqMutex());
+		auto spaceGuard = frg::guard(&_snapshotMutex);
+
+		mapping = _findMapping(address);
+	}
+	if(!mapping || !(mapping->flags & MappingFlags::protRead))
+		co_return Error::fault;
+
+	auto offsetInMapping = address - mapping->address;
+	FRG_CO_TRY(co_await mapping->lockVirtualRange(offsetInMapping, kPageSize, wq));
+
+	FetchFlags fetchFlags = 0;
+	if(mapping->flags & MappingFlags::dontRequireBacking)
+		fetchFlags |= fetchDisallowBacking;
+
+	auto touchOutcome = co_await mapping->view->fetchRange(
+			mapping->viewOffset + offsetInMapping, fetchFlags, wq);
+	if(!touchOutcome) {
+		mapping->unlockVirtualRange(offsetInMapping, kPageSize);
+		co_return touchOutcome.error();
+	}
+
+	auto [physical, cacheMode] = mapping->resolveRange(offsetInMapping);
+	// Since we have locked the MemoryView, the physical address remains valid.
+	assert(physical != PhysicalAddr(-1));
+
+	co_return PinnedPage{std::move(mapping), offsetInMapping, physical, cacheMode};
+}
+
 // --------------------------------------------------------
 // AddressSpace
 // --------------------------------------------------------
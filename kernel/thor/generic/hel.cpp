@@ -30,6 +30,9 @@
 using namespace thor;
 
 namespace {
+	// Minimal size of (page-aligned) flow transfers that bypass intermediate kernel buffers.
+	constexpr size_t zeroCopyThreshold = 4 * kPageSize;
+
 	// TODO: Replace this by a function that returns the type of special descriptor.
 	bool isSpecialMemoryView(HelHandle handle) {
 		return handle == kHelZeroMemory;
@@ -436,7 +439,10 @@ HelError helAllocateMemory(size_t size, uint32_t flags,
 			return kHelErrFault;
 
 	smarter::shared_ptr<AllocatedMemory> memory;
-	if(flags & kHelAllocContinuous) {
+	if((flags & kHelAllocHugePages) && !(size & (kHugePageSize - 1))) {
+		memory = smarter::allocate_shared<AllocatedMemory>(*kernelAlloc, size, effective.addressBits,
+				kHugePageSize, kHugePageSize);
+	}else if(flags & kHelAllocContinuous) {
 		memory = smarter::allocate_shared<AllocatedMemory>(*kernelAlloc, size, effective.addressBits,
 				size, kPageSize);
 	}else if(flags & kHelAllocOnDemand) {
@@ -2323,10 +2329,9 @@ HelError helCreateStream(HelHandle *lane1_handle, HelHandle *lane2_handle, uint3
 	return kHelErrNone;
 }
 
-HelError helSubmitAsync(HelHandle handle, const HelAction *actions, size_t count,
-		HelHandle queueHandle, uintptr_t context, uint32_t flags) {
-	if(flags)
-		return kHelErrIllegalArgs;
+// Shared between helSubmitAsync() and helSubmitAsyncBatch().
+static HelError submitAsyncChain(HelHandle handle, const HelAction *actions, size_t count,
+		smarter::shared_ptr<IpcQueue> queue, uintptr_t context) {
 	if(!count)
 		return kHelErrIllegalArgs;
 
@@ -2334,7 +2339,6 @@ HelError helSubmitAsync(HelHandle handle, const HelAction *actions, size_t count
 	auto thisUniverse = thisThread->getUniverse();
 
 	LaneHandle lane;
-	smarter::shared_ptr<IpcQueue> queue;
 	{
 		auto irq_lock = frg::guard(&irqMutex());
 		Universe::Guard universe_guard(thisUniverse->lock);
@@ -2347,13 +2351,6 @@ HelError helSubmitAsync(HelHandle handle, const HelAction *actions, size_t count
 		}else{
 			return kHelErrBadDescriptor;
 		}
-
-		auto queueWrapper = thisUniverse->getDescriptor(universe_guard, queueHandle);
-		if(!queueWrapper)
-			return kHelErrNoDescriptor;
-		if(!queueWrapper->is<QueueDescriptor>())
-			return kHelErrBadDescriptor;
-		queue = queueWrapper->get<QueueDescriptor>().queue;
 	}
 
 	struct Item {
@@ -2701,8 +2698,10 @@ HelError helSubmitAsync(HelHandle handle, const HelAction *actions, size_t count
 		// Below, we need to ensure that we always complete our own nodes
 		// before completing peer nodes.
 
-		// The size of this array must be a power of two.
-		frg::array<frg::unique_memory<KernelAlloc>, 2> xferBuffers;
+		// The size of these arrays must be a power of two.
+		// Buffers are only allocated on demand.
+		frg::array<frg::unique_memory<KernelAlloc>, 8> xferBuffers;
+		frg::array<PinnedPage, 8> xferPins;
 
 		size_t i = 0;
 		size_t seenFlows = 0; // Iterates through flows.
@@ -2752,6 +2751,22 @@ HelError helSubmitAsync(HelHandle handle, const HelAction *actions, size_t count
 				// Empty packets are handled by the generic stream code.
 				assert(recipe->length);
 
+				// Large page-aligned buffers are not copied into kernel buffers.
+				// Instead, we pin the sender's pages and let the receiver copy
+				// directly out of them.
+				bool zeroCopy = recipe->length >= zeroCopyThreshold
+						&& !(reinterpret_cast<uintptr_t>(recipe->buffer) & (kPageSize - 1));
+				size_t window = zeroCopy ? xferPins.size() : 2;
+				smarter::shared_ptr<AddressSpace, BindableHandle> space;
+				if(zeroCopy)
+					space = thread->getAddressSpace().lock();
+
+				// Called for each ack. Acks arrive in the same order as transfer packets.
+				auto retireAck = [&] (size_t index) {
+					if(zeroCopy)
+						xferPins[index & (window - 1)].unpin();
+				};
+
 				size_t progress = 0;
 				size_t numSent = 0;
 				size_t numAcked = 0;
@@ -2762,13 +2777,13 @@ HelError helSubmitAsync(HelHandle handle, const HelAction *actions, size_t count
 					while(numSent != numAcked) {
 						// If there is anything more to send, we only need to wait until
 						// at least one buffer is not in-flight (otherwise, we wait for all).
-						if(!lastTransferSent && numSent - numAcked < xferBuffers.size())
+						if(!lastTransferSent && numSent - numAcked < window)
 							break;
 						auto ackPacket = co_await node->flowQueue.async_get();
 						assert(ackPacket);
 						if(ackPacket->fault)
 							anyRemoteFault = true;
-						++numAcked;
+						retireAck(numAcked++);
 					}
 
 					if(lastTransferSent) {
@@ -2791,7 +2806,7 @@ HelError helSubmitAsync(HelHandle handle, const HelAction *actions, size_t count
 						while(numSent != numAcked) {
 							auto ackPacket = co_await node->flowQueue.async_get();
 							assert(ackPacket);
-							++numAcked;
+							retireAck(numAcked++);
 						}
 
 						node->_error = Error::remoteFault;
@@ -2799,17 +2814,45 @@ HelError helSubmitAsync(HelHandle handle, const HelAction *actions, size_t count
 					}
 
 					// Prepare a buffer an send it.
-					assert(numSent - numAcked < xferBuffers.size());
-					auto &xb = xferBuffers[numSent & (xferBuffers.size() - 1)];
-					if(!xb.size())
-						xb = frg::unique_memory<KernelAlloc>{*kernelAlloc, 4096};
+					assert(numSent - numAcked < window);
+					auto slot = numSent & (window - 1);
+					void *chunkData = nullptr;
+					size_t chunkSize = 0;
+					bool outcome = true;
+					if(zeroCopy) {
+						auto &pin = xferPins[slot];
+						assert(!pin);
+
+						chunkSize = frg::min(recipe->length - progress, kPageSize);
+						auto pinOutcome = co_await space->pinPage(
+								reinterpret_cast<uintptr_t>(recipe->buffer) + progress,
+								thread->mainWorkQueue()->take());
+						if(!pinOutcome) {
+							outcome = false;
+						}else if(auto mode = pinOutcome.value().cachingMode();
+								mode == CachingMode::null || mode == CachingMode::writeBack) {
+							// The page stays pinned until the receiver acks the packet.
+							pin = std::move(pinOutcome.value());
+							chunkData = PageAccessor{pin.physical()}.get();
+						}
+						// Otherwise, the page cannot be accessed through the direct physical
+						// mapping and we fall back to copying below.
+					}
+					if(outcome && !chunkData) {
+						auto &xb = xferBuffers[slot];
+						if(!xb.size())
+							xb = frg::unique_memory<KernelAlloc>{*kernelAlloc, 4096};
 
-					auto chunkSize = frg::min(recipe->length - progress, xb.size());
+						chunkData = xb.data();
+						chunkSize = frg::min(recipe->length - progress, xb.size());
+
+						co_await thread->mainWorkQueue()->enter();
+						outcome = readUserMemory(xb.data(),
+								reinterpret_cast<std::byte *>(recipe->buffer) + progress,
+								chunkSize);
+					}
 					assert(chunkSize);
 
-					co_await thread->mainWorkQueue()->enter();
-					auto outcome = readUserMemory(xb.data(),
-							reinterpret_cast<std::byte *>(recipe->buffer) + progress, chunkSize);
 					if(!outcome) {
 						// Send the packet (may deallocate the peer!).
 						peer->flowQueue.put({ .terminate = true, .fault = true });
@@ -2820,7 +2863,7 @@ HelError helSubmitAsync(HelHandle handle, const HelAction *actions, size_t count
 						while(numSent != numAcked) {
 							auto ackPacket = co_await node->flowQueue.async_get();
 							assert(ackPacket);
-							++numAcked;
+							retireAck(numAcked++);
 						}
 
 						node->_error = Error::fault;
@@ -2830,7 +2873,7 @@ HelError helSubmitAsync(HelHandle handle, const HelAction *actions, size_t count
 					lastTransferSent = (progress + chunkSize == recipe->length);
 					// Send the packet (may deallocate the peer!).
 					peer->flowQueue.put({
-						.data = xb.data(),
+						.data = chunkData,
 						.size = chunkSize,
 						.terminate = lastTransferSent
 					});
@@ -2928,6 +2971,62 @@ HelError helSubmitAsync(HelHandle handle, const HelAction *actions, size_t count
 	return kHelErrNone;
 }
 
+static HelError lookupQueue(HelHandle queueHandle, smarter::shared_ptr<IpcQueue> &queue) {
+	auto thisThread = getCurrentThread();
+	auto thisUniverse = thisThread->getUniverse();
+
+	auto irq_lock = frg::guard(&irqMutex());
+	Universe::Guard universe_guard(thisUniverse->lock);
+
+	auto queueWrapper = thisUniverse->getDescriptor(universe_guard, queueHandle);
+	if(!queueWrapper)
+		return kHelErrNoDescriptor;
+	if(!queueWrapper->is<QueueDescriptor>())
+		return kHelErrBadDescriptor;
+	queue = queueWrapper->get<QueueDescriptor>().queue;
+	return kHelErrNone;
+}
+
+HelError helSubmitAsync(HelHandle handle, const HelAction *actions, size_t count,
+		HelHandle queueHandle, uintptr_t context, uint32_t flags) {
+	if(flags)
+		return kHelErrIllegalArgs;
+	if(!count)
+		return kHelErrIllegalArgs;
+
+	smarter::shared_ptr<IpcQueue> queue;
+	if(auto error = lookupQueue(queueHandle, queue); error != kHelErrNone)
+		return error;
+
+	return submitAsyncChain(handle, actions, count, std::move(queue), context);
+}
+
+HelError helSubmitAsyncBatch(const HelChain *chains, size_t count,
+		HelHandle queueHandle, uint32_t flags, size_t *numSubmitted) {
+	*numSubmitted = 0;
+	if(flags)
+		return kHelErrIllegalArgs;
+
+	// The queue is only looked up once for all chains.
+	smarter::shared_ptr<IpcQueue> queue;
+	if(auto error = lookupQueue(queueHandle, queue); error != kHelErrNone)
+		return error;
+
+	for(size_t i = 0; i < count; i++) {
+		HelChain chain;
+		if(!readUserObject(chains + i, chain))
+			return kHelErrFault;
+
+		auto error = submitAsyncChain(chain.lane, chain.actions, chain.count,
+				queue, chain.context);
+		if(error != kHelErrNone)
+			return error;
+		++*numSubmitted;
+	}
+
+	return kHelErrNone;
+}
+
 HelError helShutdownLane(HelHandle handle) {
 	auto this_thread = getCurrentThread();
 	auto this_universe = this_thread->getUniverse();
@@ -2,6 +2,7 @@
 
 #include <thor-internal/universe.hpp>
 #include <thor-internal/coroutine.hpp>
+#include <thor-internal/cpu-data.hpp>
 #include <thor-internal/fiber.hpp>
 #include <thor-internal/kerncfg.hpp>
 #include <thor-internal/ostrace.hpp>
@@ -84,6 +85,8 @@ private:
 			resp.set_total_usable_memory(physicalAllocator->numTotalPages());
 			resp.set_available_memory(physicalAllocator->numFreePages());
 			resp.set_memory_unit(kPageSize);
+			resp.set_page_cache_hits(physicalAllocator->numCacheHits());
+			resp.set_page_cache_misses(physicalAllocator->numCacheMisses());
 
 			frg::unique_memory<KernelAlloc> respBuffer{*kernelAlloc, resp.size_of_head()};
 			bragi::write_head_only(resp, respBuffer);
@@ -107,6 +110,28 @@ private:
 			if(respError != Error::success) {
 				co_return respError;
 			}
+		}else if(preamble.id() == bragi::message_id<managarm::kerncfg::GetSchedulerStatsRequest>) {
+			auto req = bragi::parse_head_only<managarm::kerncfg::GetSchedulerStatsRequest>(reqBuffer, *kernelAlloc);
+
+			if (!req)
+				co_return Error::protocolViolation;
+
+			managarm::kerncfg::GetSchedulerStatsResponse<KernelAlloc> resp(*kernelAlloc);
+			if(req->cpu() < getCpuCount()) {
+				auto scheduler = &getCpuData(req->cpu())->scheduler;
+				resp.set_error(managarm::kerncfg::Error::SUCCESS);
+				resp.set_load_level(scheduler->loadLevel());
+				resp.set_num_migrated_in(scheduler->numMigratedIn());
+				resp.set_num_migrated_out(scheduler->numMigratedOut());
+			}else{
+				resp.set_error(managarm::kerncfg::Error::ILLEGAL_ARGUMENTS);
+			}
+
+			frg::unique_memory<KernelAlloc> respBuffer{*kernelAlloc, resp.size_of_head()};
+			bragi::write_head_only(resp, respBuffer);
+			auto respError = co_await SendBufferSender{lane, std::move(respBuffer)};
+			if(respError != Error::success)
+				co_return respError;
 		}else{
 			managarm::kerncfg::SvrResponse<KernelAlloc> resp(*kernelAlloc);
 			resp.set_error(managarm::kerncfg::Error::ILLEGAL_REQUEST);
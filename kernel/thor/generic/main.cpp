@@ -201,6 +201,9 @@ extern "C" void thorMain() {
 		// Run all other initgraph tasks.
 		globalInitEngine.run();
 
+		// All CPUs are online at this point.
+		Scheduler::enableLoadBalancing();
+
 		transitionBootFb();
 
 		pci::runAllBridges();
@@ -767,6 +770,12 @@ void handleSyscall(SyscallImageAccessor image) {
 		*image.error() = helSubmitAsync((HelHandle)arg0, (HelAction *)arg1,
 				(size_t)arg2, (HelHandle)arg3, (uintptr_t)arg4, (uint32_t)arg5);
 	} break;
+	case kHelCallSubmitAsyncBatch: {
+		size_t numSubmitted;
+		*image.error() = helSubmitAsyncBatch((HelChain *)arg0, (size_t)arg1,
+				(HelHandle)arg2, (uint32_t)arg3, &numSubmitted);
+		*image.out0() = numSubmitted;
+	} break;
 	case kHelCallShutdownLane: {
 		*image.error() = helShutdownLane((HelHandle)arg0);
 	} break;
@@ -341,6 +341,10 @@ MemoryView::touchRange(uintptr_t offset, size_t size,
 	co_return {};
 }
 
+size_t MemoryView::peekContiguity(uintptr_t) {
+	return kPageSize;
+}
+
 Error MemoryView::updateRange(ManageRequest, size_t, size_t) {
 	return Error::illegalObject;
 }
@@ -674,6 +678,11 @@ frg::tuple<PhysicalAddr, CachingMode> AllocatedMemory::peekRange(uintptr_t offse
 			CachingMode::null};
 }
 
+size_t AllocatedMemory::peekContiguity(uintptr_t) {
+	// Chunks are allocated from the buddy allocator and thus naturally aligned.
+	return _chunkSize;
+}
+
 coroutine<frg::expected<Error, PhysicalRange>>
 AllocatedMemory::fetchRange(uintptr_t offset, FetchFlags, smarter::shared_ptr<WorkQueue>) {
 	auto irq_lock = frg::guard(&irqMutex());
@@ -1,4 +1,5 @@
 #include <assert.h>
+#include <string.h>
 #include <thor-internal/arch-generic/paging.hpp>
 #include <thor-internal/cpu-data.hpp>
 #include <thor-internal/debug.hpp>
@@ -50,60 +51,162 @@ void PhysicalChunkAllocator::bootstrapRegion(PhysicalAddr address,
 	_freePages.store(currentFree + (numRoots << order), std::memory_order_relaxed);
 }
 
-PhysicalAddr PhysicalChunkAllocator::allocate(size_t size, int addressBits) {
-	auto irq_lock = frg::guard(&irqMutex());
-	auto lock = frg::guard(&_mutex);
-
-	auto currentFree = _freePages.load(std::memory_order_relaxed);
-	auto currentUsed = _usedPages.load(std::memory_order_relaxed);
-	assert(currentFree > size / kPageSize);
-	_freePages.store(currentFree - size / kPageSize, std::memory_order_relaxed);
-	_usedPages.store(currentUsed + size / kPageSize, std::memory_order_relaxed);
+namespace {
+	// Returns the buddy order (relative to kPageSize) of a chunk size.
+	int chunkOrder(size_t size) {
+		int order = 0;
+		while(size > (size_t(kPageSize) << order))
+			order++;
+		return order;
+	}
+}
 
+PhysicalAddr PhysicalChunkAllocator::allocate(size_t size, int addressBits) {
 	// TODO: This could be solved better.
-	int target = 0;
-	while(size > (size_t(kPageSize) << target))
-		target++;
+	int target = chunkOrder(size);
 	assert(size == (size_t(kPageSize) << target));
 
 	if(logPhysicalAllocs)
 		infoLogger() << "thor: Allocating physical memory of order "
 					<< (target + kPageShift) << frg::endlog;
+
+	auto irq_lock = frg::guard(&irqMutex());
+
+	auto physical = BuddyAccessor::illegalAddress;
+	if(target < PhysicalChunkCache::numOrders && addressBits >= 64) {
+		auto cache = &getCpuData()->physicalCache;
+		auto cache_lock = frg::guard(&cache->mutex);
+		auto magazine = &cache->magazines[target];
+
+		if(magazine->count) {
+			cache->numHits.store(cache->numHits.load(std::memory_order_relaxed) + 1,
+					std::memory_order_relaxed);
+		}else{
+			cache->numMisses.store(cache->numMisses.load(std::memory_order_relaxed) + 1,
+					std::memory_order_relaxed);
+
+			// Refill the magazine with a batch of chunks.
+			auto lock = frg::guard(&_mutex);
+			while(magazine->count < PhysicalChunkCache::batchSize) {
+				auto chunk = _allocateFromBuddy(target, addressBits);
+				if(chunk == BuddyAccessor::illegalAddress)
+					break;
+				magazine->chunks[magazine->count++] = chunk;
+			}
+		}
+
+		if(magazine->count)
+			physical = magazine->chunks[--magazine->count];
+	}else{
+		auto lock = frg::guard(&_mutex);
+		physical = _allocateFromBuddy(target, addressBits);
+	}
+
+	if(physical == BuddyAccessor::illegalAddress) {
+		// The memory might be stuck in the caches of (other) CPUs.
+		// This also allows the buddy allocator to coalesce large chunks.
+		_drainCaches();
+
+		auto lock = frg::guard(&_mutex);
+		physical = _allocateFromBuddy(target, addressBits);
+		if(physical == BuddyAccessor::illegalAddress)
+			return static_cast<PhysicalAddr>(-1);
+	}
+	assert(!(physical % (size_t(kPageSize) << target)));
+
+	// Chunks in the per-CPU caches count as free memory.
+	auto previousFree = _freePages.fetch_sub(size / kPageSize, std::memory_order_relaxed);
+	assert(previousFree >= size / kPageSize);
+	(void)previousFree;
+	_usedPages.fetch_add(size / kPageSize, std::memory_order_relaxed);
+	return physical;
+}
+
+void PhysicalChunkAllocator::free(PhysicalAddr address, size_t size) {
+	int target = chunkOrder(size);
+
+	auto irq_lock = frg::guard(&irqMutex());
+
+	auto previousUsed = _usedPages.fetch_sub(size / kPageSize, std::memory_order_relaxed);
+	assert(previousUsed >= size / kPageSize);
+	(void)previousUsed;
+	_freePages.fetch_add(size / kPageSize, std::memory_order_relaxed);
+
+	if(target < PhysicalChunkCache::numOrders) {
+		auto cache = &getCpuData()->physicalCache;
+		auto cache_lock = frg::guard(&cache->mutex);
+		auto magazine = &cache->magazines[target];
+
+		if(magazine->count == PhysicalChunkCache::magazineSize) {
+			// Drain the oldest chunks back to the buddy allocator.
+			auto lock = frg::guard(&_mutex);
+			for(size_t i = 0; i < PhysicalChunkCache::batchSize; i++)
+				_freeToBuddy(magazine->chunks[i], target);
+			memmove(magazine->chunks, magazine->chunks + PhysicalChunkCache::batchSize,
+					(magazine->count - PhysicalChunkCache::batchSize) * sizeof(PhysicalAddr));
+			magazine->count -= PhysicalChunkCache::batchSize;
+		}
+
+		magazine->chunks[magazine->count++] = address;
+		return;
+	}
+
+	auto lock = frg::guard(&_mutex);
+	_freeToBuddy(address, target);
+}
+
+uint64_t PhysicalChunkAllocator::numCacheHits() {
+	uint64_t n = 0;
+	for(size_t i = 0; i < getCpuCount(); i++)
+		n += getCpuData(i)->physicalCache.numHits.load(std::memory_order_relaxed);
+	return n;
+}
+
+uint64_t PhysicalChunkAllocator::numCacheMisses() {
+	uint64_t n = 0;
+	for(size_t i = 0; i < getCpuCount(); i++)
+		n += getCpuData(i)->physicalCache.numMisses.load(std::memory_order_relaxed);
+	return n;
+}
+
+void PhysicalChunkAllocator::_drainCaches() {
+	for(size_t i = 0; i < getCpuCount(); i++) {
+		auto cache = &getCpuData(i)->physicalCache;
+		auto cache_lock = frg::guard(&cache->mutex);
+		auto lock = frg::guard(&_mutex);
+		for(int order = 0; order < PhysicalChunkCache::numOrders; order++) {
+			auto magazine = &cache->magazines[order];
+			for(size_t j = 0; j < magazine->count; j++)
+				_freeToBuddy(magazine->chunks[j], order);
+			magazine->count = 0;
+		}
+	}
+}
+
+PhysicalAddr PhysicalChunkAllocator::_allocateFromBuddy(int order, int addressBits) {
 	for(int i = 0; i < _numRegions; i++) {
-		if(target > _allRegions[i].buddyAccessor.tableOrder())
+		if(order > _allRegions[i].buddyAccessor.tableOrder())
 			continue;
 
-		auto physical = _allRegions[i].buddyAccessor.allocate(target, addressBits);
+		auto physical = _allRegions[i].buddyAccessor.allocate(order, addressBits);
 		if(physical == BuddyAccessor::illegalAddress)
 			continue;
 	//	infoLogger() << "Allocate " << (void *)physical << frg::endlog;
-		assert(!(physical % (size_t(kPageSize) << target)));
 		return physical;
 	}
 
-	return static_cast<PhysicalAddr>(-1);
+	return BuddyAccessor::illegalAddress;
 }
 
-void PhysicalChunkAllocator::free(PhysicalAddr address, size_t size) {
-	auto irq_lock = frg::guard(&irqMutex());
-	auto lock = frg::guard(&_mutex);
-	
-	int target = 0;
-	while(size > (size_t(kPageSize) << target))
-		target++;
-
+void PhysicalChunkAllocator::_freeToBuddy(PhysicalAddr address, int order) {
+	auto size = size_t(kPageSize) << order;
 	for(int i = 0; i < _numRegions; i++) {
 		if(address < _allRegions[i].physicalBase)
 			continue;
 		if(address + size - _allRegions[i].physicalBase > _allRegions[i].regionSize)
 			continue;
 
-		_allRegions[i].buddyAccessor.free(address, target);
-		auto currentFree = _freePages.load(std::memory_order_relaxed);
-		auto currentUsed = _usedPages.load(std::memory_order_relaxed);
-		assert(currentUsed > size / kPageSize);
-		_freePages.store(currentFree + size / kPageSize, std::memory_order_relaxed);
-		_usedPages.store(currentUsed - size / kPageSize, std::memory_order_relaxed);
+		_allRegions[i].buddyAccessor.free(address, order);
 		return;
 	}
 
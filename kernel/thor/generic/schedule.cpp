@@ -14,12 +14,23 @@ namespace {
 	constexpr bool logNextBest = false;
 	constexpr bool logUpdates = false;
 	constexpr bool logIdle = false;
+	constexpr bool logBalancing = false;
 
 	constexpr bool disablePreemption = false;
+	constexpr bool disableBalancing = false;
 
 	// Minimum length of a preemption time slice in ns.
 	constexpr int64_t sliceGranularity = 10'000'000;
 
+	// Interval between two periodic balancing attempts of a busy CPU in ns.
+	constexpr uint64_t balanceInterval = 50'000'000;
+	// Minimal interval between two steal requests of an idle CPU in ns.
+	constexpr uint64_t stealInterval = 1'000'000;
+	// Maximal number of waiting entities that we inspect per donation.
+	constexpr size_t maxDonationScan = 8;
+
+	std::atomic<bool> loadBalancingEnabled{false};
+
 	struct IdleTask final : ScheduleEntity {
 		IdleTask()
 		: ScheduleEntity{ScheduleType::idle} { }
@@ -71,6 +82,10 @@ ScheduleEntity::~ScheduleEntity() {
 	assert(state == ScheduleState::null);
 }
 
+bool ScheduleEntity::mayMigrateTo(int) {
+	return false;
+}
+
 void Scheduler::associate(ScheduleEntity *entity, Scheduler *scheduler) {
 	assert(entity->type() == ScheduleType::regular);
 
@@ -154,6 +169,12 @@ void Scheduler::suspendCurrent() {
 	self->_current = nullptr;
 }
 
+void Scheduler::enableLoadBalancing() {
+	if(disableBalancing)
+		return;
+	loadBalancingEnabled.store(true, std::memory_order_relaxed);
+}
+
 Scheduler::Scheduler(CpuData *cpuContext)
 : _cpuContext{cpuContext}, _current{&globalIdleTask.get()} { }
 
@@ -203,15 +224,8 @@ void Scheduler::update() {
 
 	_updateCurrentEntity();
 
-	// Finally, process all pending entities.
-	frg::intrusive_list<
-		ScheduleEntity,
-		frg::locate_member<
-			ScheduleEntity,
-			frg::default_list_hook<ScheduleEntity>,
-			&ScheduleEntity::listHook
-		>
-	> pendingSnapshot;
+	// Process all pending entities.
+	EntityList pendingSnapshot;
 	{
 		auto irqLock = frg::guard(&irqMutex());
 		auto lock = frg::guard(&_mutex);
@@ -230,6 +244,14 @@ void Scheduler::update() {
 		_waitQueue.push(entity);
 		_numWaiting++;
 	}
+	_updateLoad();
+
+	// Finally, move entities to other CPUs if necessary.
+	if(!loadBalancingEnabled.load(std::memory_order_relaxed))
+		return;
+	if(auto thief = _workRequest.exchange(nullptr, std::memory_order_relaxed); thief)
+		_donateTo(thief);
+	_balance();
 }
 
 bool Scheduler::maybeReschedule() {
@@ -323,6 +345,8 @@ void Scheduler::_schedule() {
 		if(logScheduling)
 			infoLogger() << "No entities to schedule" << frg::endlog;
 		_scheduled = &globalIdleTask.get();
+		_updateLoad();
+		_requestWork();
 		return;
 	}
 
@@ -417,6 +441,143 @@ void Scheduler::_updateEntityStats(ScheduleEntity *entity) {
 	entity->_refClock = _refClock;
 }
 
+void Scheduler::_updateLoad() {
+	auto n = _numWaiting;
+	if(_current && _current->type() == ScheduleType::regular)
+		n++;
+	_loadLevel.store(n, std::memory_order_relaxed);
+}
+
+void Scheduler::_requestWork() {
+	if(!loadBalancingEnabled.load(std::memory_order_relaxed))
+		return;
+
+	// Avoid flooding busy CPUs with IPIs while we stay idle.
+	if(_stealClock && _refClock - _stealClock < stealInterval)
+		return;
+	_stealClock = _refClock;
+
+	// Find the peer with the most waiting entities.
+	Scheduler *victim = nullptr;
+	size_t victimLoad = 1;
+	for(size_t i = 0; i < getCpuCount(); i++) {
+		auto other = &getCpuData(i)->scheduler;
+		if(other == this)
+			continue;
+		auto load = other->loadLevel();
+		if(load > victimLoad) {
+			victim = other;
+			victimLoad = load;
+		}
+	}
+	if(!victim)
+		return;
+
+	// Only one thief can be served at a time; others retry later.
+	Scheduler *expected = nullptr;
+	if(!victim->_workRequest.compare_exchange_strong(expected, this,
+			std::memory_order_relaxed))
+		return;
+
+	if(logBalancing)
+		infoLogger() << "thor: CPU #" << _cpuContext->cpuIndex
+				<< " requests work from CPU #" << victim->_cpuContext->cpuIndex
+				<< " (load " << victimLoad << ")" << frg::endlog;
+	sendPingIpi(victim->_cpuContext);
+}
+
+void Scheduler::_balance() {
+	if(_refClock - _balanceClock < balanceInterval)
+		return;
+	_balanceClock = _refClock;
+
+	if(!_numWaiting)
+		return;
+
+	// Find the peer with the least load. We only push entities if this
+	// actually reduces the imbalance, i.e., if the loads differ by at least two.
+	auto ownLoad = loadLevel();
+	Scheduler *target = nullptr;
+	size_t targetLoad = ownLoad - 1;
+	for(size_t i = 0; i < getCpuCount(); i++) {
+		auto other = &getCpuData(i)->scheduler;
+		if(other == this)
+			continue;
+		auto load = other->loadLevel();
+		if(load < targetLoad) {
+			target = other;
+			targetLoad = load;
+		}
+	}
+	if(!target)
+		return;
+
+	_donateTo(target);
+}
+
+void Scheduler::_donateTo(Scheduler *target) {
+	assert(!intsAreEnabled());
+	assert(target != this);
+
+	auto targetIndex = target->_cpuContext->cpuIndex;
+	auto targetLoad = target->loadLevel();
+
+	EntityList donated;
+	size_t numDonated = 0;
+	ScheduleEntity *retained[maxDonationScan];
+	size_t numRetained = 0;
+	while(!_waitQueue.empty() && numDonated + numRetained < maxDonationScan) {
+		// Stop as soon as the donation would not reduce the imbalance anymore.
+		if(loadLevel() - numDonated < targetLoad + numDonated + 2)
+			break;
+
+		auto entity = _waitQueue.top();
+		_waitQueue.pop();
+		assert(entity->state == ScheduleState::active);
+
+		if(!entity->mayMigrateTo(targetIndex)) {
+			retained[numRetained++] = entity;
+			continue;
+		}
+
+		// Bring the entity's unfairness up to date. The target scheduler
+		// re-bases refProgress when it takes the entity off its pending list.
+		_updateWaitingEntity(entity);
+		_updateEntityStats(entity);
+
+		entity->_scheduler = target;
+		entity->state = ScheduleState::pending;
+		donated.push_back(entity);
+		_numWaiting--;
+		numDonated++;
+	}
+
+	for(size_t i = 0; i < numRetained; i++)
+		_waitQueue.push(retained[i]);
+	_updateLoad();
+
+	if(!numDonated)
+		return;
+
+	if(logBalancing)
+		infoLogger() << "thor: CPU #" << _cpuContext->cpuIndex
+				<< " moves " << numDonated << " entities to CPU #" << targetIndex
+				<< frg::endlog;
+
+	bool wasEmpty;
+	{
+		auto lock = frg::guard(&target->_mutex);
+
+		wasEmpty = target->_pendingList.empty();
+		target->_pendingList.splice(target->_pendingList.end(), donated);
+	}
+	_numMigratedOut.fetch_add(numDonated, std::memory_order_relaxed);
+	target->_numMigratedIn.fetch_add(numDonated, std::memory_order_relaxed);
+
+	if(wasEmpty)
+		sendPingIpi(target->_cpuContext);
+}
+
 Scheduler *localScheduler() {
 	return &getCpuData()->scheduler;
 }
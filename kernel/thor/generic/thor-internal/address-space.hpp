@@ -13,6 +13,12 @@ namespace thor {
 
 struct VirtualSpace;
 
+// Returns true if a large page at the given view offset can be mapped to physical.
+inline bool canMapLargePage(MemoryView *view, uintptr_t offset, PhysicalAddr physical) {
+	return !(physical & (kHugePageSize - 1))
+			&& view->peekContiguity(offset) >= kHugePageSize;
+}
+
 template<typename Cursor, typename PageSpace>
 frg::expected<Error> mapPresentPagesByCursor(PageSpace *ps, VirtualAddr va,
 		MemoryView *view, uintptr_t offset, size_t size, PageFlags flags) {
@@ -30,6 +36,18 @@ frg::expected<Error> mapPresentPagesByCursor(PageSpace *ps, VirtualAddr va,
 		}
 		assert(!(physicalRange.template get<0>() & (kPageSize - 1)));
 
+		if constexpr (Cursor::supportsLargePages) {
+			static_assert(Cursor::largePageSize == kHugePageSize);
+			if(!(c.virtualAddress() & (kHugePageSize - 1))
+					&& progress + kHugePageSize <= size
+					&& canMapLargePage(view, offset + progress, physicalRange.template get<0>())
+					&& c.mapLarge(physicalRange.template get<0>(), flags,
+							physicalRange.template get<1>())) {
+				c.advanceLarge();
+				continue;
+			}
+		}
+
 		c.map4k(physicalRange.template get<0>(), flags, physicalRange.template get<1>());
 		c.advance4k();
 	}
@@ -91,6 +109,41 @@ frg::expected<Error> faultPageByCursor(PageSpace *ps, VirtualAddr va,
 	return {};
 }
 
+// Maps a large page at va. Returns Error::noHardwareSupport if this is not possible;
+// callers are expected to fall back to faultPageByCursor() in this case.
+template<typename Cursor, typename PageSpace>
+frg::expected<Error> faultLargePageByCursor(PageSpace *ps, VirtualAddr va,
+		MemoryView *view, uintptr_t offset, PageFlags flags) {
+	assert(!(va & (kHugePageSize - 1)));
+	assert(!(offset & (kHugePageSize - 1)));
+
+	if constexpr (Cursor::supportsLargePages) {
+		static_assert(Cursor::largePageSize == kHugePageSize);
+
+		auto physicalRange = view->peekRange(offset);
+		if(physicalRange.template get<0>() == PhysicalAddr(-1))
+			return Error::fault;
+		if(!canMapLargePage(view, offset, physicalRange.template get<0>()))
+			return Error::noHardwareSupport;
+
+		Cursor c{ps, va};
+		auto [status, _] = c.unmapLarge();
+		if(!c.mapLarge(physicalRange.template get<0>(), flags, physicalRange.template get<1>()))
+			return Error::noHardwareSupport;
+
+		if(status & page_status::present) {
+			if(status & page_status::dirty)
+				view->markDirty(offset, kHugePageSize);
+		}
+		return {};
+	}else{
+		(void)ps;
+		(void)view;
+		(void)flags;
+		return Error::noHardwareSupport;
+	}
+}
+
 template<typename Cursor, typename PageSpace>
 frg::expected<Error> cleanPagesByCursor(PageSpace *ps, VirtualAddr va,
 		MemoryView *view, uintptr_t offset, size_t size) {
@@ -102,6 +155,20 @@ frg::expected<Error> cleanPagesByCursor(PageSpace *ps, VirtualAddr va,
 	while(c.findDirty(va + size)) {
 		auto progress = c.virtualAddress() - va;
 
+		if constexpr (Cursor::supportsLargePages) {
+			if(!(c.virtualAddress() & (kHugePageSize - 1))
+					&& progress + kHugePageSize <= size
+					&& c.isLargeMapped()) {
+				auto status = c.cleanLarge();
+				assert(status & page_status::present);
+				assert(status & page_status::dirty);
+				view->markDirty(offset + progress, kHugePageSize);
+
+				c.advanceLarge();
+				continue;
+			}
+		}
+
 		auto status = c.clean4k();
 		assert(status & page_status::present);
 		assert(status & page_status::dirty);
@@ -123,6 +190,21 @@ frg::expected<Error> unmapPagesByCursor(PageSpace *ps, VirtualAddr va,
 	while(c.findPresent(va + size)) {
 		auto progress = c.virtualAddress() - va;
 
+		// Large pages that are only partially unmapped are split by unmap4k().
+		if constexpr (Cursor::supportsLargePages) {
+			if(!(c.virtualAddress() & (kHugePageSize - 1))
+					&& progress + kHugePageSize <= size
+					&& c.isLargeMapped()) {
+				auto [status, _] = c.unmapLarge();
+				assert(status & page_status::present);
+				if(status & page_status::dirty)
+					view->markDirty(offset + progress, kHugePageSize);
+
+				c.advanceLarge();
+				continue;
+			}
+		}
+
 		auto [status, _] = c.unmap4k();
 		assert(status & page_status::present);
 		if(status & page_status::dirty)
@@ -177,6 +259,11 @@ struct VirtualOperations {
 	virtual frg::expected<Error> faultPage(VirtualAddr va, MemoryView *view,
 			uintptr_t offset, PageFlags flags);
 
+	// Maps a large page of kHugePageSize bytes at va (which must be suitably aligned).
+	// Returns Error::noHardwareSupport if no large page can be used.
+	virtual frg::expected<Error> faultLargePage(VirtualAddr va, MemoryView *view,
+			uintptr_t offset, PageFlags flags);
+
 	virtual frg::expected<Error> cleanPages(VirtualAddr va, MemoryView *view,
 			uintptr_t offset, size_t size);
 
@@ -456,6 +543,62 @@ public:
 	frg::ticket_spinlock pagingMutex;
 };
 
+// Keeps a single page of a VirtualSpace resident (see VirtualSpace::pinPage()).
+struct PinnedPage {
+	PinnedPage() = default;
+
+	PinnedPage(smarter::shared_ptr<Mapping> mapping, uintptr_t offset,
+			PhysicalAddr physical, CachingMode cachingMode)
+	: _mapping{std::move(mapping)}, _offset{offset}, _physical{physical},
+			_cachingMode{cachingMode} { }
+
+	PinnedPage(const PinnedPage &) = delete;
+
+	PinnedPage(PinnedPage &&other)
+	: _mapping{std::move(other._mapping)}, _offset{other._offset},
+			_physical{other._physical}, _cachingMode{other._cachingMode} { }
+
+	~PinnedPage() {
+		unpin();
+	}
+
+	PinnedPage &operator= (PinnedPage other) {
+		unpin();
+		_mapping = std::move(other._mapping);
+		_offset = other._offset;
+		_physical = other._physical;
+		_cachingMode = other._cachingMode;
+		return *this;
+	}
+
+	explicit operator bool () {
+		return static_cast<bool>(_mapping);
+	}
+
+	PhysicalAddr physical() {
+		assert(_mapping);
+		return _physical;
+	}
+
+	CachingMode cachingMode() {
+		assert(_mapping);
+		return _cachingMode;
+	}
+
+	void unpin() {
+		if(!_mapping)
+			return;
+		_mapping->unlockVirtualRange(_offset, kPageSize);
+		_mapping = nullptr;
+	}
+
+private:
+	smarter::shared_ptr<Mapping> _mapping;
+	uintptr_t _offset = 0;
+	PhysicalAddr _physical = 0;
+	CachingMode _cachingMode = CachingMode::null;
+};
+
 struct HoleLess {
 	bool operator() (const Hole &a, const Hole &b) {
 		return a.address() < b.address();
@@ -576,6 +719,12 @@ public:
 		);
 	}
 
+	// Makes the (readable) page at the given address resident and locks it until the
+	// returned PinnedPage is destructed. This allows other address spaces to copy from
+	// the page without going through an intermediate buffer.
+	coroutine<frg::expected<Error, PinnedPage>> pinPage(uintptr_t address,
+			smarter::shared_ptr<WorkQueue> wq);
+
 	// ----------------------------------------------------------------------------------
 	// GlobalFutex support.
 	// ----------------------------------------------------------------------------------
@@ -627,7 +776,8 @@ public:
 
 private:
 	// Allocates a new mapping of the given length somewhere in the address space.
-	frg::expected<Error, VirtualAddr> _allocate(size_t length, MapFlags flags);
+	frg::expected<Error, VirtualAddr> _allocate(size_t length, MapFlags flags,
+			size_t align = kPageSize);
 
 	frg::expected<Error, VirtualAddr> _allocateAt(VirtualAddr address, size_t length);
 
@@ -700,6 +850,12 @@ struct AddressSpace final : VirtualSpace, smarter::crtp_counter<AddressSpace, Bi
 					va, view, offset, flags);
 		}
 
+		frg::expected<Error> faultLargePage(VirtualAddr va, MemoryView *view,
+				uintptr_t offset, PageFlags flags) override {
+			return faultLargePageByCursor<ClientPageSpace::Cursor>(&space_->pageSpace_,
+					va, view, offset, flags);
+		}
+
 		frg::expected<Error> cleanPages(VirtualAddr va, MemoryView *view,
 				uintptr_t offset, size_t size) override {
 			return cleanPagesByCursor<ClientPageSpace::Cursor>(&space_->pageSpace_,
@@ -740,7 +896,7 @@ public:
 
 	void dispose(BindableHandle);
 
-	FutexRealm localFutexRealm;
+	FutexRealm localFutexRealm{FutexRealm::localBucketShift};
 
 	bool updatePageAccess(VirtualAddr address, PageFlags flags) {
 		return pageSpace_.updatePageAccess(address, flags);
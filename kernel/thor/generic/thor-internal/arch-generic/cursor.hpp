@@ -41,11 +41,30 @@ concept CursorPolicy = requires (uint64_t pte, uint64_t *ptePtr,
 	{ T::pteNewTable() } -> std::same_as<uint64_t>;
 };
 
+// Policies that satisfy this concept can map large pages
+// in the level above the last level (i.e., 2 MiB pages on x86).
+template <typename T>
+concept LargePageCursorPolicy = CursorPolicy<T> && requires (uint64_t pte, size_t index,
+		PhysicalAddr pa, PageFlags flags, CachingMode cachingMode) {
+	// Check whether the given PTE maps a large page.
+	{ T::pteLargePresent(pte) } -> std::same_as<bool>;
+	// Get the page address from the given large PTE.
+	{ T::pteLargeAddress(pte) } -> std::same_as<PhysicalAddr>;
+	// Construct a new large PTE from the given parameters.
+	{ T::pteBuildLarge(pa, flags, cachingMode) } -> std::same_as<uint64_t>;
+	// Construct the last level PTE that maps the index-th page of a large PTE.
+	{ T::pteSplitLarge(pte, index) } -> std::same_as<uint64_t>;
+};
+
 template <CursorPolicy Policy>
 struct PageCursor {
 	inline static constexpr uintptr_t levelMask = (uintptr_t{1} << Policy::bitsPerLevel) - 1;
 	inline static constexpr size_t lastLevel = Policy::maxLevels - 1;
 
+	inline static constexpr bool supportsLargePages = LargePageCursorPolicy<Policy>;
+	// Size of the pages that are mapped by mapLarge().
+	inline static constexpr size_t largePageSize = size_t{1} << (Policy::bitsPerLevel + 12);
+
 	PageCursor(PageSpace *space, uintptr_t va)
 	: space_{space}, va_{}, initialLevel_{Policy::maxLevels - Policy::numLevels()} {
 		accessors_[initialLevel_] = {space->rootTable()};
@@ -53,7 +72,7 @@ struct PageCursor {
 	}
 
 private:
-	constexpr size_t levelShift(size_t level) {
+	static constexpr size_t levelShift(size_t level) {
 		return Policy::bitsPerLevel * (Policy::maxLevels - 1 - level) + 12;
 	}
 
@@ -70,6 +89,28 @@ private:
 		return __atomic_exchange_n(currentPtePtr_(), value, __ATOMIC_RELAXED);
 	}
 
+	// Returns the entry in the level above the last level that covers the current address.
+	// This entry either points to a last level table or maps a large page.
+	uint64_t *largePtePtr_() {
+		if(!reloadLevel_(lastLevel - 1))
+			return nullptr;
+		return reinterpret_cast<uint64_t *>(accessors_[lastLevel - 1].get())
+			+ ((va_ >> levelShift(lastLevel - 1)) & levelMask);
+	}
+
+	// Returns true if the current address is covered by a large page.
+	// Only valid if there is no last level table.
+	bool inLargePage_() {
+		if constexpr (supportsLargePages) {
+			auto ptePtr = largePtePtr_();
+			if(!ptePtr)
+				return false;
+			return Policy::pteLargePresent(__atomic_load_n(ptePtr, __ATOMIC_RELAXED));
+		}else{
+			return false;
+		}
+	}
+
 public:
 	uintptr_t virtualAddress() {
 		return va_;
@@ -96,6 +137,8 @@ public:
 	bool findPresent(uintptr_t limit) {
 		while(va_ < limit) {
 			if(!accessors_[lastLevel]) {
+				if(inLargePage_())
+					return true;
 				advance4k();
 				continue;
 			}
@@ -113,6 +156,11 @@ public:
 	bool findDirty(uintptr_t limit) {
 		while(va_ < limit) {
 			if(!accessors_[lastLevel]) {
+				if(inLargePage_()) {
+					auto ptEnt = __atomic_load_n(largePtePtr_(), __ATOMIC_RELAXED);
+					if(Policy::ptePageStatus(ptEnt) & page_status::dirty)
+						return true;
+				}
 				advance4k();
 				continue;
 			}
@@ -150,20 +198,93 @@ public:
 	}
 
 	PageStatus clean4k() {
-		if(!accessors_[lastLevel])
-			return 0;
+		if(!accessors_[lastLevel]) {
+			// Large pages are split such that we can clean individual pages.
+			if(!inLargePage_())
+				return 0;
+			realizePts_();
+		}
 
 		return Policy::pteClean(currentPtePtr_());
 	}
 
 	std::tuple<PageStatus, PhysicalAddr> unmap4k() {
-		if(!accessors_[lastLevel])
-			return {0, 0};
+		if(!accessors_[lastLevel]) {
+			// Large pages are split such that we can unmap individual pages.
+			if(!inLargePage_())
+				return {0, 0};
+			realizePts_();
+		}
 
 		auto ptEnt = exchangeCurrentPte_(0);
 		return {Policy::ptePageStatus(ptEnt), Policy::ptePageAddress(ptEnt)};
 	}
 
+	// Large page API. The cursor must be aligned to largePageSize.
+	// These functions are only available if the policy supports large pages.
+
+	void advanceLarge() {
+		moveTo(va_ + largePageSize);
+	}
+
+	// Returns true if a large page is mapped at the current address.
+	bool isLargeMapped() {
+		assert(!(va_ & (largePageSize - 1)));
+		if(accessors_[lastLevel])
+			return false;
+		return inLargePage_();
+	}
+
+	// Maps a large page, replacing an existing large page.
+	// Fails if the range is already covered by a last level table.
+	bool mapLarge(PhysicalAddr pa, PageFlags flags, CachingMode cachingMode)
+	requires supportsLargePages {
+		assert(!(va_ & (largePageSize - 1)));
+		assert(!(pa & (largePageSize - 1)));
+
+		auto irqLock = frg::guard(&irqMutex());
+		auto lock = frg::guard(&space_->tableMutex());
+
+		realizeLevel_(lastLevel - 1);
+		auto ptePtr = largePtePtr_();
+		assert(ptePtr);
+		auto ptEnt = __atomic_load_n(ptePtr, __ATOMIC_RELAXED);
+		if(Policy::pteTablePresent(ptEnt))
+			return false;
+
+		__atomic_store_n(ptePtr, Policy::pteBuildLarge(pa, flags, cachingMode), __ATOMIC_RELAXED);
+		return true;
+	}
+
+	std::tuple<PageStatus, PhysicalAddr> unmapLarge()
+	requires supportsLargePages {
+		assert(!(va_ & (largePageSize - 1)));
+
+		if(accessors_[lastLevel])
+			return {0, 0};
+		auto ptePtr = largePtePtr_();
+		if(!ptePtr)
+			return {0, 0};
+		auto ptEnt = __atomic_load_n(ptePtr, __ATOMIC_RELAXED);
+		if(!Policy::pteLargePresent(ptEnt))
+			return {0, 0};
+
+		ptEnt = __atomic_exchange_n(ptePtr, 0, __ATOMIC_RELAXED);
+		return {Policy::ptePageStatus(ptEnt), Policy::pteLargeAddress(ptEnt)};
+	}
+
+	PageStatus cleanLarge()
+	requires supportsLargePages {
+		assert(!(va_ & (largePageSize - 1)));
+
+		if(accessors_[lastLevel])
+			return 0;
+		auto ptePtr = largePtePtr_();
+		if(!ptePtr || !Policy::pteLargePresent(__atomic_load_n(ptePtr, __ATOMIC_RELAXED)))
+			return 0;
+		return Policy::pteClean(ptePtr);
+	}
+
 	// Low-level API for use by arch-specific code.
 public:
 	uint64_t *getPtePtr() {
@@ -207,11 +328,21 @@ private:
 			return;
 		}
 
-		ptEnt = Policy::pteNewTable();
-		auto subPtPtr = Policy::pteTableAddress(ptEnt);
+		auto newEnt = Policy::pteNewTable();
+		auto subPtPtr = Policy::pteTableAddress(newEnt);
 		subPt = PageAccessor{subPtPtr};
 
-		__atomic_store_n(ptPtr, ptEnt, __ATOMIC_RELEASE);
+		// Split large pages into last level pages that map the same memory.
+		// Since the translation does not change, no shootdown is required.
+		if constexpr (supportsLargePages) {
+			if(level == lastLevel - 1 && Policy::pteLargePresent(ptEnt)) {
+				auto tbl = reinterpret_cast<uint64_t *>(subPt.get());
+				for(size_t i = 0; i <= levelMask; i++)
+					tbl[i] = Policy::pteSplitLarge(ptEnt, i);
+			}
+		}
+
+		__atomic_store_n(ptPtr, newEnt, __ATOMIC_RELEASE);
 	}
 
 	void realizeLevel_(size_t level) {
@@ -6,7 +6,10 @@ namespace thor {
 
 enum {
 	kPageSize = 0x1000,
-	kPageShift = 12
+	kPageShift = 12,
+	// Size of the large pages that are used for suitably aligned mappings (if supported).
+	kHugePageSize = 0x20'0000,
+	kHugePageShift = 21
 };
 
 constexpr Word kPfAccess = 1;
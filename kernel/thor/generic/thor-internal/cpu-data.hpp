@@ -3,6 +3,7 @@
 #include <thor-internal/arch-generic/cpu.hpp>
 #include <thor-internal/executor-context.hpp>
 #include <thor-internal/kernel-locks.hpp>
+#include <thor-internal/physical.hpp>
 #include <thor-internal/schedule.hpp>
 
 namespace thor {
@@ -10,6 +11,7 @@ namespace thor {
 // Forward defined for pointers that are part of CpuData.
 struct Thread;
 struct KernelFiber;
+struct PrecisionTimerEngine;
 struct SingleContextRecordRing;
 struct ReentrantRecordRing;
 struct SelfIntCallBase;
@@ -35,6 +37,7 @@ struct CpuData : public PlatformCpuData {
 	UniqueKernelStack detachedStack;
 	UniqueKernelStack idleStack;
 	Scheduler scheduler;
+	PhysicalChunkCache physicalCache;
 	bool haveVirtualization;
 
 	int cpuIndex;
@@ -45,6 +48,8 @@ struct CpuData : public PlatformCpuData {
 	KernelFiber *wqFiber{nullptr};
 	std::atomic<SelfIntCallBase *> selfIntCallPtr{nullptr};
 	smarter::shared_ptr<WorkQueue> generalWorkQueue;
+	// Timer engine that is driven by this CPU's local timer (if supported by the architecture).
+	PrecisionTimerEngine *localTimerEngine{nullptr};
 	std::atomic<uint64_t> heartbeat;
 
 	IseqContext regularIseq;
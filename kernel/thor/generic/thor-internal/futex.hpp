@@ -1,6 +1,9 @@
 #pragma once
 
+#include <atomic>
+
 #include <async/cancellation.hpp>
+#include <frg/allocation.hpp>
 #include <frg/functional.hpp>
 #include <frg/hash_map.hpp>
 #include <frg/list.hpp>
@@ -71,11 +74,12 @@ private:
 	private:
 		void cancel_() {
 			{
+				auto bucket = realm_->_getBucket(id_);
 				auto irqLock = frg::guard(&irqMutex());
-				auto lock = frg::guard(&realm_->_mutex);
+				auto lock = frg::guard(&bucket->mutex);
 
 				if(!result_) {
-					auto sit = realm_->_slots.get(id_);
+					auto sit = bucket->slots.get(id_);
 					assert(sit);			
 
 					// Invariant: If the slot exists then its queue is not empty.
@@ -86,7 +90,7 @@ private:
 					result_ = Error::cancelled;
 
 					if(sit->queue.empty())
-						realm_->_slots.remove(id_);
+						bucket->slots.remove(id_);
 				}else{
 					assert(!queueHook_.in_list);
 				}
@@ -113,12 +117,54 @@ private:
 		> queue;
 	};
 
+	// Futexes are distributed over a fixed number of buckets that are locked independently.
+	// Waiters on different futexes thus only contend if their futexes share a bucket.
+	// The buckets are allocated on first use since most realms never see a futex.
+	struct Bucket {
+		Bucket()
+		: slots{FutexIdentity::Hash{}, *kernelAlloc} { }
+
+		frg::ticket_spinlock mutex;
+
+		frg::hash_map<
+			FutexIdentity,
+			Slot,
+			FutexIdentity::Hash,
+			KernelAlloc
+		> slots;
+	};
+
 public:
-	FutexRealm()
-	: _slots{FutexIdentity::Hash{}, *kernelAlloc} { }
+	// The global realm is shared by all processes while local realms are per address space.
+	static constexpr int globalBucketShift = 6;
+	static constexpr int localBucketShift = 2;
+
+	explicit FutexRealm(int bucketShift = globalBucketShift)
+	: _bucketShift{bucketShift} {
+		assert(bucketShift >= 0 && bucketShift < 64);
+	}
+
+	FutexRealm(const FutexRealm &) = delete;
+
+	FutexRealm &operator= (const FutexRealm &) = delete;
+
+	~FutexRealm() {
+		auto buckets = _buckets.load(std::memory_order_relaxed);
+		if(buckets)
+			frg::destruct_n(*kernelAlloc, buckets, _numBuckets());
+	}
 
 	bool empty() {
-		return _slots.empty();
+		auto buckets = _buckets.load(std::memory_order_acquire);
+		if(!buckets)
+			return true;
+		for(size_t i = 0; i < _numBuckets(); ++i) {
+			auto irqLock = frg::guard(&irqMutex());
+			auto lock = frg::guard(&buckets[i].mutex);
+			if(!buckets[i].slots.empty())
+				return false;
+		}
+		return true;
 	}
 
 	// ----------------------------------------------------------------------------------
@@ -143,8 +189,9 @@ public:
 			F f = std::move(f_);
 
 			auto fastPath = [&] {
+				auto bucket = realm_->_getBucket(id_);
 				auto irqLock = frg::guard(&irqMutex());
-				auto lock = frg::guard(&realm_->_mutex);
+				auto lock = frg::guard(&bucket->mutex);
 
 				if(f.read() != expected_) {
 					result_ = Error::futexRace;
@@ -156,10 +203,10 @@ public:
 					return true;
 				}
 
-				auto sit = realm_->_slots.get(id_);
+				auto sit = bucket->slots.get(id_);
 				if(!sit) {
-					realm_->_slots.insert(id_, Slot());
-					sit = realm_->_slots.get(id_);
+					bucket->slots.insert(id_, Slot());
+					sit = bucket->slots.get(id_);
 				}
 
 				assert(!queueHook_.in_list);
@@ -224,10 +271,11 @@ public:
 			>
 		> pending;
 		{
+			auto bucket = _getBucket(id);
 			auto irqLock = frg::guard(&irqMutex());
-			auto lock = frg::guard(&_mutex);
+			auto lock = frg::guard(&bucket->mutex);
 
-			auto sit = _slots.get(id);
+			auto sit = bucket->slots.get(id);
 			if(!sit)
 				return;
 			// Invariant: If the slot exists then its queue is not empty.
@@ -246,7 +294,7 @@ public:
 			}
 
 			if(sit->queue.empty())
-				_slots.remove(id);
+				bucket->slots.remove(id);
 		}
 
 		while(!pending.empty()) {
@@ -256,18 +304,34 @@ public:
 	}
 
 private:
-	using Mutex = frg::ticket_spinlock;
-
-	// TODO: use a scalable hash table with fine-grained locks to
-	// improve the scalability of the futex algorithm.
-	Mutex _mutex;
-
-	frg::hash_map<
-		FutexIdentity,
-		Slot,
-		FutexIdentity::Hash,
-		KernelAlloc
-	> _slots;
+	size_t _numBuckets() {
+		return size_t{1} << _bucketShift;
+	}
+
+	Bucket *_getBucket(FutexIdentity id) {
+		auto buckets = _buckets.load(std::memory_order_acquire);
+		if(!buckets) [[unlikely]] {
+			// Concurrent first users race to install their array; the loser frees its copy.
+			auto fresh = frg::construct_n<Bucket>(*kernelAlloc, _numBuckets());
+			if(_buckets.compare_exchange_strong(buckets, fresh,
+					std::memory_order_acq_rel, std::memory_order_acquire)) {
+				buckets = fresh;
+			}else{
+				frg::destruct_n(*kernelAlloc, fresh, _numBuckets());
+			}
+		}
+
+		if(!_bucketShift)
+			return &buckets[0];
+		// The hash maps within each bucket use the low bits of the hash,
+		// hence we select the bucket based on the high bits.
+		static_assert(sizeof(size_t) == 8);
+		auto h = FutexIdentity::Hash{}(id);
+		return &buckets[h >> (64 - _bucketShift)];
+	}
+
+	int _bucketShift;
+	std::atomic<Bucket *> _buckets{nullptr};
 };
 
 } // namespace thor
@@ -303,6 +303,11 @@ public:
 	// Result stays valid until the range is evicted.
 	virtual frg::tuple<PhysicalAddr, CachingMode> peekRange(uintptr_t offset) = 0;
 
+	// Returns the size of the naturally aligned block around offset that is backed by
+	// physically contiguous memory, aligned to the same size (at least kPageSize).
+	// Used to decide whether a range can be mapped by large pages.
+	virtual size_t peekContiguity(uintptr_t offset);
+
 	// Makes a range of memory available for peekRange().
 	virtual coroutine<frg::expected<Error>>
 	touchRange(uintptr_t offset, size_t size, FetchFlags flags, smarter::shared_ptr<WorkQueue> wq);
@@ -805,6 +810,7 @@ struct AllocatedMemory final : MemoryView, GlobalFutexSpace {
 	Error lockRange(uintptr_t offset, size_t size) override;
 	void unlockRange(uintptr_t offset, size_t size) override;
 	frg::tuple<PhysicalAddr, CachingMode> peekRange(uintptr_t offset) override;
+	size_t peekContiguity(uintptr_t offset) override;
 	coroutine<frg::expected<Error, PhysicalRange>>
 			fetchRange(uintptr_t offset, FetchFlags flags,
 			smarter::shared_ptr<WorkQueue> wq) override;
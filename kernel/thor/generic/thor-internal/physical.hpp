@@ -76,6 +76,31 @@ void poisonPhysicalAccess(PhysicalAddr physical);
 void poisonPhysicalWriteAccess(PhysicalAddr physical);
 
 
+// Per-CPU cache of free chunks of small orders.
+// Each order has a magazine that is refilled from / drained to the buddy allocator
+// in batches, such that most allocations and frees do not need to take the global lock.
+// Accesses must happen with IRQs disabled and the cache's mutex held; the mutex is only
+// contended if the allocator runs out of memory and drains the caches of all CPUs.
+struct PhysicalChunkCache {
+	// Orders (relative to kPageSize) that are served from the cache.
+	static constexpr int numOrders = 4;
+	static constexpr size_t magazineSize = 64;
+	// Number of chunks that are moved to / from the buddy allocator at once.
+	static constexpr size_t batchSize = 32;
+
+	struct Magazine {
+		size_t count = 0;
+		PhysicalAddr chunks[magazineSize];
+	};
+
+	frg::ticket_spinlock mutex;
+	Magazine magazines[numOrders];
+
+	// Statistics. These are only written by the owning CPU.
+	std::atomic<uint64_t> numHits{0};
+	std::atomic<uint64_t> numMisses{0};
+};
+
 class PhysicalChunkAllocator {
 	typedef frg::ticket_spinlock Mutex;
 public:
@@ -97,7 +122,18 @@ public:
 		return _freePages.load(std::memory_order_relaxed);
 	}
 
+	// Sum of the per-CPU cache statistics.
+	uint64_t numCacheHits();
+	uint64_t numCacheMisses();
+
 private:
+	// Must be called with _mutex held.
+	PhysicalAddr _allocateFromBuddy(int order, int addressBits);
+	void _freeToBuddy(PhysicalAddr address, int order);
+	// Returns the chunks in the caches of all CPUs to the buddy allocator.
+	// Must be called without holding _mutex or any cache's mutex.
+	void _drainCaches();
+
 	Mutex _mutex;
 
 	struct Region {
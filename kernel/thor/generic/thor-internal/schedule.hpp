@@ -2,6 +2,7 @@
 
 #include <stddef.h>
 #include <stdint.h>
+#include <atomic>
 
 #include <frg/list.hpp>
 #include <frg/pairing_heap.hpp>
@@ -53,6 +54,11 @@ public:
 
 	virtual void handlePreemption(IrqImageAccessor image) = 0;
 
+	// Returns true if load balancing may move this entity to the CPU with the given index.
+	// By default, entities stay on the scheduler that they were associated with.
+	// Called with IRQs disabled from the CPU that currently owns the entity.
+	virtual bool mayMigrateTo(int cpuIndex);
+
 	uint64_t runTime() {
 		return _runTime;
 	}
@@ -101,6 +107,10 @@ struct Scheduler {
 	static void resume(ScheduleEntity *entity);
 	static void suspendCurrent();
 
+	// Allows schedulers to move entities between CPUs.
+	// This must only be called once all CPUs are online.
+	static void enableLoadBalancing();
+
 	Scheduler(CpuData *cpu_context);
 
 	Scheduler(const Scheduler &) = delete;
@@ -122,10 +132,43 @@ public:
 
 	ScheduleEntity *currentRunnable();
 
+	// Number of regular entities (running or waiting) on this scheduler.
+	// Written by the owning CPU but may be read from any CPU.
+	size_t loadLevel() {
+		return _loadLevel.load(std::memory_order_relaxed);
+	}
+
+	// Number of entities that this scheduler received from / gave to other CPUs.
+	uint64_t numMigratedIn() {
+		return _numMigratedIn.load(std::memory_order_relaxed);
+	}
+	uint64_t numMigratedOut() {
+		return _numMigratedOut.load(std::memory_order_relaxed);
+	}
+
 private:
 	void _unschedule();
 	void _schedule();
 
+private:
+	using EntityList = frg::intrusive_list<
+		ScheduleEntity,
+		frg::locate_member<
+			ScheduleEntity,
+			frg::default_list_hook<ScheduleEntity>,
+			&ScheduleEntity::listHook
+		>
+	>;
+
+	void _updateLoad();
+
+	// Asks the most loaded peer to donate some of its entities to us.
+	void _requestWork();
+	// Pushes entities to the least loaded peer if the imbalance is large enough.
+	void _balance();
+	// Moves waiting entities to the pending list of another scheduler.
+	void _donateTo(Scheduler *target);
+
 private:
 	void _updatePreemption();
 
@@ -169,14 +212,23 @@ private:
 	// Note that _mutex *only* protects _pendingList and nothing more!
 	frg::ticket_spinlock _mutex;
 
-	frg::intrusive_list<
-		ScheduleEntity,
-		frg::locate_member<
-			ScheduleEntity,
-			frg::default_list_hook<ScheduleEntity>,
-			&ScheduleEntity::listHook
-		>
-	> _pendingList;
+	EntityList _pendingList;
+
+	// ----------------------------------------------------------------------------------
+	// Load balancing.
+	// ----------------------------------------------------------------------------------
+
+	std::atomic<size_t> _loadLevel{0};
+	std::atomic<uint64_t> _numMigratedIn{0};
+	std::atomic<uint64_t> _numMigratedOut{0};
+
+	// Set by an idle peer that wants us to donate entities to it.
+	// Consumed by the owning CPU in update().
+	std::atomic<Scheduler *> _workRequest{nullptr};
+
+	// Clock values at which we last tried to balance / to steal work.
+	uint64_t _balanceClock = 0;
+	uint64_t _stealClock = 0;
 };
 
 Scheduler *localScheduler();
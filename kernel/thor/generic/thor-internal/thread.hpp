@@ -271,18 +271,25 @@ public:
 
 	void handlePreemption(IrqImageAccessor accessor) override;
 
+	bool mayMigrateTo(int cpuIndex) override;
+
 private:
 	void _uninvoke();
 	void _kill();
 
+	// Must be called with _affinityMutex held.
+	bool _affinityAllows(size_t cpuIndex);
+
 public:
 	frg::vector<uint8_t, KernelAlloc> getAffinityMask() {
-		auto lock = frg::guard(&_mutex);
+		auto irqLock = frg::guard(&irqMutex());
+		auto lock = frg::guard(&_affinityMutex);
 		return _affinityMask;
 	}
 
 	void setAffinityMask(frg::vector<uint8_t, KernelAlloc> &&mask) {
-		auto lock = frg::guard(&_mutex);
+		auto irqLock = frg::guard(&irqMutex());
+		auto lock = frg::guard(&_affinityMutex);
 		_affinityMask = std::move(mask);
 	}
 
@@ -364,6 +371,11 @@ private:
 	>;
 
 	ObserveQueue _observeQueue;
+
+	// Protects _affinityMask. This is a leaf lock since the scheduler
+	// inspects the mask (with IRQs disabled) during load balancing.
+	Mutex _affinityMutex;
+	// An empty mask allows all CPUs.
 	frg::vector<uint8_t, KernelAlloc> _affinityMask;
 };
 
@@ -36,16 +36,16 @@ void Thread::migrateCurrent() {
 	Scheduler::unassociate(this_thread);
 
 	size_t n = -1;
-	for (size_t i = 0; i < getCpuCount(); i++) {
-		bool bit = 0;
-		if ((i + 7) / 8 < this_thread->_affinityMask.size())
-			bit = this_thread->_affinityMask[(i + 7) / 8] & (1 << (i % 8));
-
-		if (bit) {
-			n = i;
-			break;
+	{
+		auto affinityLock = frg::guard(&this_thread->_affinityMutex);
+		for (size_t i = 0; i < getCpuCount(); i++) {
+			if (this_thread->_affinityAllows(i)) {
+				n = i;
+				break;
+			}
 		}
 	}
+	assert(n != static_cast<size_t>(-1));
 
 	auto new_scheduler = &getCpuData(n)->scheduler;
 
@@ -504,6 +504,19 @@ void Thread::handlePreemption(IrqImageAccessor image) {
 	}
 }
 
+bool Thread::mayMigrateTo(int cpuIndex) {
+	auto lock = frg::guard(&_affinityMutex);
+	return _affinityAllows(cpuIndex);
+}
+
+bool Thread::_affinityAllows(size_t cpuIndex) {
+	if(!_affinityMask.size())
+		return true;
+	if(cpuIndex / 8 >= _affinityMask.size())
+		return false;
+	return _affinityMask[cpuIndex / 8] & (1 << (cpuIndex % 8));
+}
+
 void Thread::_uninvoke() {
 	UserContext::deactivate();
 }
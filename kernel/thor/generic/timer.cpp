@@ -112,6 +112,11 @@ ClockSource *systemClockSource() {
 }
 
 PrecisionTimerEngine *generalTimerEngine() {
+	// Prefer the engine of the current CPU such that timers on different CPUs do not contend.
+	// Note that the engine may be used after migrating to another CPU; the AlarmTracker
+	// takes care of forwarding the deadline to the right CPU.
+	if(auto engine = getCpuData()->localTimerEngine; engine)
+		return engine;
 	return globalTimerEngine;
 }
 
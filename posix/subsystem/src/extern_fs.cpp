@@ -245,6 +245,35 @@ public:
 		co_return {};
 	}
 
+	async::result<frg::expected<protocols::fs::Error>> advise(int64_t offset, int64_t length,
+			int advice) override {
+		managarm::fs::CntRequest req;
+		req.set_req_type(managarm::fs::CntReqType::PT_FADVISE);
+		req.set_offset(offset);
+		req.set_length(length);
+		req.set_advice(advice);
+
+		auto ser = req.SerializeAsString();
+		auto [offer, send_req, recv_resp]
+				= co_await helix_ng::exchangeMsgs(getPassthroughLane(),
+			helix_ng::offer(
+				helix_ng::sendBuffer(ser.data(), ser.size()),
+				helix_ng::recvInline()
+			)
+		);
+		HEL_CHECK(offer.error());
+		HEL_CHECK(send_req.error());
+		HEL_CHECK(recv_resp.error());
+
+		managarm::fs::SvrResponse resp;
+		resp.ParseFromArray(recv_resp.data(), recv_resp.length());
+		recv_resp.reset();
+		if(resp.error() == managarm::fs::Errors::ILLEGAL_ARGUMENT)
+			co_return protocols::fs::Error::illegalArguments;
+		assert(resp.error() == managarm::fs::Errors::SUCCESS);
+		co_return {};
+	}
+
 private:
 	helix::UniqueLane _control;
 	protocols::fs::File _file;
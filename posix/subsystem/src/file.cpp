@@ -160,6 +160,13 @@ async::result<frg::expected<protocols::fs::Error>> File::ptAllocate(void *object
 	co_return co_await self->allocate(offset, size);
 }
 
+async::result<frg::expected<protocols::fs::Error>> File::ptAdvise(void *object,
+		int64_t offset, int64_t length, int advice) {
+	auto self = static_cast<File *>(object);
+
+	co_return co_await self->advise(offset, length, advice);
+}
+
 async::result<int> File::ptGetOption(void *object, int option) {
 	auto self = static_cast<File *>(object);
 	return self->getOption(option);
@@ -376,6 +383,10 @@ async::result<frg::expected<protocols::fs::Error>> File::allocate(int64_t, size_
 	throw std::runtime_error("posix: Object has no File::allocate()");
 }
 
+async::result<frg::expected<protocols::fs::Error>> File::advise(int64_t, int64_t, int) {
+	co_return {};
+}
+
 async::result<frg::expected<Error, off_t>> File::seek(off_t, VfsSeek) {
 	if(_defaultOps & defaultPipeLikeSeek) {
 		co_return Error::seekOnPipe;
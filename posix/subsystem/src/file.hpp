@@ -143,6 +143,9 @@ public:
 	static async::result<frg::expected<protocols::fs::Error>>
 	ptAllocate(void *object, int64_t offset, size_t size);
 
+	static async::result<frg::expected<protocols::fs::Error>>
+	ptAdvise(void *object, int64_t offset, int64_t length, int advice);
+
 	static async::result<int>
 	ptGetOption(void *object, int option);
 
@@ -223,6 +226,7 @@ public:
 		.getSeals = &ptGetSeals,
 		.addSeals = &ptAddSeals,
 		.setSocketOption = &ptSetSocketOption,
+		.fadvise = &ptAdvise,
 	};
 
 	// ------------------------------------------------------------------------
@@ -327,6 +331,11 @@ public:
 
 	virtual async::result<frg::expected<protocols::fs::Error>> allocate(int64_t offset, size_t size);
 
+	// Implements posix_fadvise() and readahead(). Advice is only a hint,
+	// hence files that do not care about it ignore it by default.
+	virtual async::result<frg::expected<protocols::fs::Error>> advise(int64_t offset, int64_t length,
+			int advice);
+
 	// poll() uses a sequence number mechansim for synchronization.
 	// Before returning, it waits until current-sequence > in-sequence.
 	// Returns (current-sequence, edges since in-sequence, current events).
@@ -1,5 +1,6 @@
 #include <memory>
 
+#include <core/polling.hpp>
 #include <protocols/mbus/client.hpp>
 
 #include "net.hpp"
@@ -161,6 +162,7 @@ async::result<void> enumeratePm() {
 
 async::detached runInit() {
 	co_await enumerateKerncfg();
+	co_await configurePolling(helix::Dispatcher::global(), "posix", 1000);
 	async::detach(enumeratePm());
 	co_await clk::enumerateTracker();
 	async::detach(net::enumerateNetserver());
@@ -1,11 +1,13 @@
 #include <string.h>
 #include <sstream>
+#include <stdexcept>
 #include <iomanip>
 
 #include "clock.hpp"
 #include "common.hpp"
 #include "procfs.hpp"
 #include "process.hpp"
+#include "requests.hpp"
 
 #include <bitset>
 
@@ -84,6 +86,8 @@ RegularFile::writeAll(Process *, const void *data, size_t length) {
 	assert(length > 0);
 
 	auto node = static_cast<RegularNode *>(associatedLink()->getTarget().get());
+	if(!node->writable())
+		co_return Error::accessDenied;
 	co_await node->store(std::string{reinterpret_cast<const char *>(data), length});
 	co_return length;
 }
@@ -174,7 +178,7 @@ async::result<frg::expected<Error, FileStats>> RegularNode::getStats() {
 	stats.inodeNumber = 0; // FIXME
 	stats.numLinks = 1;
 	stats.fileSize = 4096; // Same as in Linux.
-	stats.mode = 0666; // TODO: Some files can be written.
+	stats.mode = writable() ? 0666 : 0444;
 	stats.uid = 0;
 	stats.gid = 0;
 	stats.atimeSecs = now.tv_sec;
@@ -243,6 +247,11 @@ std::shared_ptr<Link> DirectoryNode::createRootDirectory() {
 	kernel->directMkregular("osrelease", std::make_shared<OsreleaseNode>());
 	kernel->directMkregular("arch", std::make_shared<ArchNode>());
 
+	auto posixLink = the_node->directMkdir("posix");
+	auto posix = std::static_pointer_cast<DirectoryNode>(posixLink->getTarget());
+	posix->directMkregular("requests", std::make_shared<PosixRequestsNode>());
+	posix->directMkregular("dispatcher", std::make_shared<PosixDispatcherNode>());
+
 	return link;
 }
 
@@ -396,6 +405,28 @@ async::result<void> OsreleaseNode::store(std::string) {
 	co_return;
 }
 
+async::result<std::string> PosixRequestsNode::show() {
+	co_return formatRequestStatistics();
+}
+
+async::result<void> PosixRequestsNode::store(std::string) {
+	// Rejected by RegularFile::writeAll() since the node is not writable.
+	throw std::logic_error("posix: /proc/posix/requests is not writable");
+}
+
+async::result<std::string> PosixDispatcherNode::show() {
+	auto &dispatcher = helix::Dispatcher::global();
+	std::stringstream stream;
+	stream << "avoided_sleeps " << dispatcher.numAvoidedSleeps() << "\n";
+	stream << "sleeps " << dispatcher.numSleeps() << "\n";
+	co_return stream.str();
+}
+
+async::result<void> PosixDispatcherNode::store(std::string) {
+	// Rejected by RegularFile::writeAll() since the node is not writable.
+	throw std::logic_error("posix: /proc/posix/dispatcher is not writable");
+}
+
 async::result<std::string> ArchNode::show() {
 	// See man 5 proc for more details.
 	// Based on the man page from Linux man-pages 6.01, updated on 2022-10-09.
@@ -103,6 +103,11 @@ struct RegularNode : FsNode, std::enable_shared_from_this<RegularNode> {
 			SemanticFlags semantic_flags) override;
 
 protected:
+	// Nodes that return false reject writes with EACCES; store() is never called for them.
+	virtual bool writable() {
+		return true;
+	}
+
 	virtual async::result<std::string> show() = 0;
 	virtual async::result<void> store(std::string buffer) = 0;
 };
@@ -241,6 +246,30 @@ struct ArchNode final : RegularNode {
 	async::result<void> store(std::string) override;
 };
 
+// Per-request statistics of the POSIX server (see formatRequestStatistics()).
+struct PosixRequestsNode final : RegularNode {
+	PosixRequestsNode() {}
+
+	bool writable() override {
+		return false;
+	}
+
+	async::result<std::string> show() override;
+	async::result<void> store(std::string) override;
+};
+
+// Polling statistics of the POSIX server's dispatcher (see helix::Dispatcher::setSpinLimit()).
+struct PosixDispatcherNode final : RegularNode {
+	PosixDispatcherNode() {}
+
+	bool writable() override {
+		return false;
+	}
+
+	async::result<std::string> show() override;
+	async::result<void> store(std::string) override;
+};
+
 struct CommNode final : RegularNode {
 	CommNode(Process *process)
 	: _process(process)
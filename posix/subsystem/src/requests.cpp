@@ -1,4 +1,8 @@
+#include <array>
+#include <atomic>
+#include <bit>
 #include <format>
+#include <stdexcept>
 #include <linux/netlink.h>
 #include <sys/mman.h>
 #include <sys/poll.h>
@@ -9,6 +13,7 @@
 #include <sys/wait.h>
 #include <sys/stat.h>
 #include <unistd.h>
+#include <sstream>
 
 #include <helix/timer.hpp>
 
@@ -35,3539 +40,4032 @@
 
 #include "debug-options.hpp"
 
-async::result<void> serveRequests(std::shared_ptr<Process> self,
-		std::shared_ptr<Generation> generation) {
-	async::cancellation_token cancellation = generation->cancelServe;
+namespace {
+
+// Determines how serveRequests() proceeds after a request handler returns.
+enum class RequestResult {
+	// Continue with the next request.
+	handled,
+	// Stop serving requests (e.g., because the request could not be decoded).
+	stop,
+	// Return from serveRequests() immediately.
+	abort
+};
+
+// State of a single request that is being processed.
+// The handlers are members such that they can refer to this state directly.
+struct RequestContext {
+	std::shared_ptr<Process> self;
+	helix::UniqueDescriptor conversation;
+	bragi::preamble preamble;
+	helix_ng::RecvInlineResult recv_head;
+	managarm::posix::CntRequest req;
+
+	template<typename Message = managarm::posix::SvrResponse>
+	async::result<void> sendErrorResponse(managarm::posix::Errors err) {
+		Message resp;
+		resp.set_error(err);
+
+		auto [send_resp] = co_await helix_ng::exchangeMsgs(
+				conversation,
+				helix_ng::sendBragiHeadOnly(resp, frg::stl_allocator{})
+			);
 
-	async::cancellation_callback cancel_callback{cancellation, [&] {
-		HEL_CHECK(helShutdownLane(self->posixLane().getHandle()));
-	}};
+		HEL_CHECK(send_resp.error());
+	}
 
-	while(true) {
-		auto [accept, recv_head] = co_await helix_ng::exchangeMsgs(
-				self->posixLane(),
-				helix_ng::accept(
-					helix_ng::recvInline()
-				)
-			);
+	async::result<RequestResult> handleGetPid();
+	async::result<RequestResult> handleGetPpid();
+	async::result<RequestResult> handleGetUid();
+	async::result<RequestResult> handleSetUid();
+	async::result<RequestResult> handleGetEuid();
+	async::result<RequestResult> handleSetEuid();
+	async::result<RequestResult> handleGetGid();
+	async::result<RequestResult> handleGetEgid();
+	async::result<RequestResult> handleSetGid();
+	async::result<RequestResult> handleSetEgid();
+	async::result<RequestResult> handleWaitId();
+	async::result<RequestResult> handleReboot();
+	async::result<RequestResult> handleVmMap();
+	async::result<RequestResult> handleMount();
+	async::result<RequestResult> handleAccessAt();
+	async::result<RequestResult> handleMkdirAt();
+	async::result<RequestResult> handleMkfifoAt();
+	async::result<RequestResult> handleLinkAt();
+	async::result<RequestResult> handleSymlinkAt();
+	async::result<RequestResult> handleRenameAt();
+	async::result<RequestResult> handleFstatAt();
+	async::result<RequestResult> handleFchmodAt();
+	async::result<RequestResult> handleUtimensAt();
+	async::result<RequestResult> handleReadlinkAt();
+	async::result<RequestResult> handleOpenAt();
+	async::result<RequestResult> handleClose();
+	async::result<RequestResult> handleIsTty();
+	async::result<RequestResult> handleUnlinkAt();
+	async::result<RequestResult> handleRmdir();
+	async::result<RequestResult> handleIoctlFioclex();
+	async::result<RequestResult> handleNetserver();
+	async::result<RequestResult> handleSocket();
+	async::result<RequestResult> handleSockpair();
+	async::result<RequestResult> handleAccept();
+	async::result<RequestResult> handleInotifyCreate();
+	async::result<RequestResult> handleInotifyAdd();
+	async::result<RequestResult> handleEventfdCreate();
+	async::result<RequestResult> handleMknodAt();
+	async::result<RequestResult> handleGetPgid();
+	async::result<RequestResult> handleSetPgid();
+	async::result<RequestResult> handleGetSid();
+	async::result<RequestResult> handleMemFdCreate();
+	async::result<RequestResult> handleSetAffinity();
+	async::result<RequestResult> handleGetAffinity();
+	async::result<RequestResult> handleGetMemoryInformation();
+	async::result<RequestResult> handleSysconf();
+
+	// Handlers for the different types of CntRequest.
+	async::result<RequestResult> handleCntWait();
+	async::result<RequestResult> handleCntGetResourceUsage();
+	async::result<RequestResult> handleCntVmRemap();
+	async::result<RequestResult> handleCntVmProtect();
+	async::result<RequestResult> handleCntVmUnmap();
+	async::result<RequestResult> handleCntChroot();
+	async::result<RequestResult> handleCntChdir();
+	async::result<RequestResult> handleCntFchdir();
+	async::result<RequestResult> handleCntDup();
+	async::result<RequestResult> handleCntDup2();
+	async::result<RequestResult> handleCntTtyName();
+	async::result<RequestResult> handleCntGetcwd();
+	async::result<RequestResult> handleCntFdGetFlags();
+	async::result<RequestResult> handleCntFdSetFlags();
+	async::result<RequestResult> handleCntSigAction();
+	async::result<RequestResult> handleCntPipeCreate();
+	async::result<RequestResult> handleCntSetsid();
+	async::result<RequestResult> handleCntEpollCall();
+	async::result<RequestResult> handleCntEpollCreate();
+	async::result<RequestResult> handleCntEpollAdd();
+	async::result<RequestResult> handleCntEpollModify();
+	async::result<RequestResult> handleCntEpollDelete();
+	async::result<RequestResult> handleCntEpollWait();
+	async::result<RequestResult> handleCntTimerfdCreate();
+	async::result<RequestResult> handleCntTimerfdSettime();
+	async::result<RequestResult> handleCntSignalfdCreate();
+};
+
+struct RequestEntry {
+	uint32_t id;
+	const char *name;
+	async::result<RequestResult> (RequestContext::*handler)();
+};
+
+// Handlers of all bragi messages (except for CntRequest), keyed by message ID.
+constexpr RequestEntry messageHandlers[] = {
+	{bragi::message_id<managarm::posix::GetPidRequest>, "GET_PID", &RequestContext::handleGetPid},
+	{bragi::message_id<managarm::posix::GetPpidRequest>, "GET_PPID", &RequestContext::handleGetPpid},
+	{bragi::message_id<managarm::posix::GetUidRequest>, "GET_UID", &RequestContext::handleGetUid},
+	{bragi::message_id<managarm::posix::SetUidRequest>, "SET_UID", &RequestContext::handleSetUid},
+	{bragi::message_id<managarm::posix::GetEuidRequest>, "GET_EUID", &RequestContext::handleGetEuid},
+	{bragi::message_id<managarm::posix::SetEuidRequest>, "SET_EUID", &RequestContext::handleSetEuid},
+	{bragi::message_id<managarm::posix::GetGidRequest>, "GET_GID", &RequestContext::handleGetGid},
+	{bragi::message_id<managarm::posix::GetEgidRequest>, "GET_EGID", &RequestContext::handleGetEgid},
+	{bragi::message_id<managarm::posix::SetGidRequest>, "SET_GID", &RequestContext::handleSetGid},
+	{bragi::message_id<managarm::posix::SetEgidRequest>, "SET_EGID", &RequestContext::handleSetEgid},
+	{bragi::message_id<managarm::posix::WaitIdRequest>, "WAIT_ID", &RequestContext::handleWaitId},
+	{bragi::message_id<managarm::posix::RebootRequest>, "REBOOT", &RequestContext::handleReboot},
+	{bragi::message_id<managarm::posix::VmMapRequest>, "VM_MAP", &RequestContext::handleVmMap},
+	{bragi::message_id<managarm::posix::MountRequest>, "MOUNT", &RequestContext::handleMount},
+	{bragi::message_id<managarm::posix::AccessAtRequest>, "ACCESS_AT", &RequestContext::handleAccessAt},
+	{bragi::message_id<managarm::posix::MkdirAtRequest>, "MKDIR_AT", &RequestContext::handleMkdirAt},
+	{bragi::message_id<managarm::posix::MkfifoAtRequest>, "MKFIFO_AT", &RequestContext::handleMkfifoAt},
+	{bragi::message_id<managarm::posix::LinkAtRequest>, "LINK_AT", &RequestContext::handleLinkAt},
+	{bragi::message_id<managarm::posix::SymlinkAtRequest>, "SYMLINK_AT", &RequestContext::handleSymlinkAt},
+	{bragi::message_id<managarm::posix::RenameAtRequest>, "RENAME_AT", &RequestContext::handleRenameAt},
+	{bragi::message_id<managarm::posix::FstatAtRequest>, "FSTAT_AT", &RequestContext::handleFstatAt},
+	{bragi::message_id<managarm::posix::FchmodAtRequest>, "FCHMOD_AT", &RequestContext::handleFchmodAt},
+	{bragi::message_id<managarm::posix::UtimensAtRequest>, "UTIMENS_AT", &RequestContext::handleUtimensAt},
+	{bragi::message_id<managarm::posix::ReadlinkAtRequest>, "READLINK_AT", &RequestContext::handleReadlinkAt},
+	{bragi::message_id<managarm::posix::OpenAtRequest>, "OPEN_AT", &RequestContext::handleOpenAt},
+	{bragi::message_id<managarm::posix::CloseRequest>, "CLOSE", &RequestContext::handleClose},
+	{bragi::message_id<managarm::posix::IsTtyRequest>, "IS_TTY", &RequestContext::handleIsTty},
+	{bragi::message_id<managarm::posix::UnlinkAtRequest>, "UNLINK_AT", &RequestContext::handleUnlinkAt},
+	{bragi::message_id<managarm::posix::RmdirRequest>, "RMDIR", &RequestContext::handleRmdir},
+	{bragi::message_id<managarm::posix::IoctlFioclexRequest>, "IOCTL_FIOCLEX", &RequestContext::handleIoctlFioclex},
+	{bragi::message_id<managarm::posix::NetserverRequest>, "NETSERVER", &RequestContext::handleNetserver},
+	{bragi::message_id<managarm::posix::SocketRequest>, "SOCKET", &RequestContext::handleSocket},
+	{bragi::message_id<managarm::posix::SockpairRequest>, "SOCKPAIR", &RequestContext::handleSockpair},
+	{bragi::message_id<managarm::posix::AcceptRequest>, "ACCEPT", &RequestContext::handleAccept},
+	{bragi::message_id<managarm::posix::InotifyCreateRequest>, "INOTIFY_CREATE", &RequestContext::handleInotifyCreate},
+	{bragi::message_id<managarm::posix::InotifyAddRequest>, "INOTIFY_ADD", &RequestContext::handleInotifyAdd},
+	{bragi::message_id<managarm::posix::EventfdCreateRequest>, "EVENTFD_CREATE", &RequestContext::handleEventfdCreate},
+	{bragi::message_id<managarm::posix::MknodAtRequest>, "MKNOD_AT", &RequestContext::handleMknodAt},
+	{bragi::message_id<managarm::posix::GetPgidRequest>, "GET_PGID", &RequestContext::handleGetPgid},
+	{bragi::message_id<managarm::posix::SetPgidRequest>, "SET_PGID", &RequestContext::handleSetPgid},
+	{bragi::message_id<managarm::posix::GetSidRequest>, "GET_SID", &RequestContext::handleGetSid},
+	{bragi::message_id<managarm::posix::MemFdCreateRequest>, "MEM_FD_CREATE", &RequestContext::handleMemFdCreate},
+	{bragi::message_id<managarm::posix::SetAffinityRequest>, "SET_AFFINITY", &RequestContext::handleSetAffinity},
+	{bragi::message_id<managarm::posix::GetAffinityRequest>, "GET_AFFINITY", &RequestContext::handleGetAffinity},
+	{bragi::message_id<managarm::posix::GetMemoryInformationRequest>, "GET_MEMORY_INFORMATION", &RequestContext::handleGetMemoryInformation},
+	{bragi::message_id<managarm::posix::SysconfRequest>, "SYSCONF", &RequestContext::handleSysconf},
+};
+
+// Handlers of CntRequest, keyed by request type.
+constexpr RequestEntry cntHandlers[] = {
+	{managarm::posix::CntReqType::WAIT, "WAIT", &RequestContext::handleCntWait},
+	{managarm::posix::CntReqType::GET_RESOURCE_USAGE, "GET_RESOURCE_USAGE", &RequestContext::handleCntGetResourceUsage},
+	{managarm::posix::CntReqType::VM_REMAP, "VM_REMAP", &RequestContext::handleCntVmRemap},
+	{managarm::posix::CntReqType::VM_PROTECT, "VM_PROTECT", &RequestContext::handleCntVmProtect},
+	{managarm::posix::CntReqType::VM_UNMAP, "VM_UNMAP", &RequestContext::handleCntVmUnmap},
+	{managarm::posix::CntReqType::CHROOT, "CHROOT", &RequestContext::handleCntChroot},
+	{managarm::posix::CntReqType::CHDIR, "CHDIR", &RequestContext::handleCntChdir},
+	{managarm::posix::CntReqType::FCHDIR, "FCHDIR", &RequestContext::handleCntFchdir},
+	{managarm::posix::CntReqType::DUP, "DUP", &RequestContext::handleCntDup},
+	{managarm::posix::CntReqType::DUP2, "DUP2", &RequestContext::handleCntDup2},
+	{managarm::posix::CntReqType::TTY_NAME, "TTY_NAME", &RequestContext::handleCntTtyName},
+	{managarm::posix::CntReqType::GETCWD, "GETCWD", &RequestContext::handleCntGetcwd},
+	{managarm::posix::CntReqType::FD_GET_FLAGS, "FD_GET_FLAGS", &RequestContext::handleCntFdGetFlags},
+	{managarm::posix::CntReqType::FD_SET_FLAGS, "FD_SET_FLAGS", &RequestContext::handleCntFdSetFlags},
+	{managarm::posix::CntReqType::SIG_ACTION, "SIG_ACTION", &RequestContext::handleCntSigAction},
+	{managarm::posix::CntReqType::PIPE_CREATE, "PIPE_CREATE", &RequestContext::handleCntPipeCreate},
+	{managarm::posix::CntReqType::SETSID, "SETSID", &RequestContext::handleCntSetsid},
+	{managarm::posix::CntReqType::EPOLL_CALL, "EPOLL_CALL", &RequestContext::handleCntEpollCall},
+	{managarm::posix::CntReqType::EPOLL_CREATE, "EPOLL_CREATE", &RequestContext::handleCntEpollCreate},
+	{managarm::posix::CntReqType::EPOLL_ADD, "EPOLL_ADD", &RequestContext::handleCntEpollAdd},
+	{managarm::posix::CntReqType::EPOLL_MODIFY, "EPOLL_MODIFY", &RequestContext::handleCntEpollModify},
+	{managarm::posix::CntReqType::EPOLL_DELETE, "EPOLL_DELETE", &RequestContext::handleCntEpollDelete},
+	{managarm::posix::CntReqType::EPOLL_WAIT, "EPOLL_WAIT", &RequestContext::handleCntEpollWait},
+	{managarm::posix::CntReqType::TIMERFD_CREATE, "TIMERFD_CREATE", &RequestContext::handleCntTimerfdCreate},
+	{managarm::posix::CntReqType::TIMERFD_SETTIME, "TIMERFD_SETTIME", &RequestContext::handleCntTimerfdSettime},
+	{managarm::posix::CntReqType::SIGNALFD_CREATE, "SIGNALFD_CREATE", &RequestContext::handleCntSignalfdCreate},
+};
+
+// Upper bound (exclusive) on message IDs and CntRequest types.
+constexpr size_t maxRequestId = 128;
+
+// Maps request IDs to indices into a handler table (or -1 if there is no handler).
+// This is computed at compile time; since a throw expression cannot be constant evaluated,
+// duplicate or out-of-range IDs fail to compile (independently of NDEBUG).
+template<size_t N>
+constexpr std::array<int, maxRequestId> buildDispatchIndex(const RequestEntry (&table)[N]) {
+	std::array<int, maxRequestId> index;
+	index.fill(-1);
+	for(size_t i = 0; i < N; ++i) {
+		if(table[i].id >= maxRequestId)
+			throw std::logic_error("posix: Request ID is out of range");
+		if(index[table[i].id] >= 0)
+			throw std::logic_error("posix: Duplicate request ID");
+		index[table[i].id] = i;
+	}
+	return index;
+}
 
-		if(accept.error() == kHelErrLaneShutdown)
-			break;
-		HEL_CHECK(accept.error());
+constexpr auto messageIndex = buildDispatchIndex(messageHandlers);
+constexpr auto cntIndex = buildDispatchIndex(cntHandlers);
 
-		if(recv_head.error() == kHelErrBufferTooSmall) {
-			std::cout << "posix: Rejecting request due to RecvInline overflow" << std::endl;
+// Statistics are kept per table entry; CntRequest types follow the bragi messages.
+constexpr size_t numRequestTypes = std::size(messageHandlers) + std::size(cntHandlers);
+
+// Bucket 0 counts requests that take less than 1us,
+// bucket i > 0 counts requests that take [2^(i - 1), 2^i) us.
+// The last bucket also counts all requests that take longer.
+constexpr size_t numLatencyBuckets = 20;
+
+// Relaxed atomics, such that the counters can be read without synchronizing with requests.
+struct RequestStatistics {
+	std::atomic<uint64_t> count{0};
+	std::atomic<uint64_t> totalNanos{0};
+	std::atomic<uint64_t> maxNanos{0};
+	std::array<std::atomic<uint64_t>, numLatencyBuckets> latencyHistogram{};
+};
+
+RequestStatistics requestStatistics[numRequestTypes];
+
+const RequestEntry &requestEntry(size_t n) {
+	if(n < std::size(messageHandlers))
+		return messageHandlers[n];
+	return cntHandlers[n - std::size(messageHandlers)];
+}
+
+void recordRequest(size_t n, uint64_t nanos) {
+	auto &stats = requestStatistics[n];
+	stats.count.fetch_add(1, std::memory_order_relaxed);
+	stats.totalNanos.fetch_add(nanos, std::memory_order_relaxed);
+
+	auto max = stats.maxNanos.load(std::memory_order_relaxed);
+	while(nanos > max && !stats.maxNanos.compare_exchange_weak(max, nanos,
+			std::memory_order_relaxed)) { }
+
+	size_t bucket = std::min<size_t>(std::bit_width(nanos / 1000), numLatencyBuckets - 1);
+	stats.latencyHistogram[bucket].fetch_add(1, std::memory_order_relaxed);
+}
+
+} // anonymous namespace
+
+std::string formatRequestStatistics() {
+	std::stringstream stream;
+	stream << "request count total_ns max_ns <1us";
+	for(size_t i = 1; i < numLatencyBuckets - 1; ++i)
+		stream << " <" << (uint64_t{1} << i) << "us";
+	stream << " >=" << (uint64_t{1} << (numLatencyBuckets - 2)) << "us\n";
+
+	for(size_t n = 0; n < numRequestTypes; ++n) {
+		auto &stats = requestStatistics[n];
+		auto count = stats.count.load(std::memory_order_relaxed);
+		if(!count)
 			continue;
-		}
-		HEL_CHECK(recv_head.error());
+		stream << requestEntry(n).name << " " << count
+				<< " " << stats.totalNanos.load(std::memory_order_relaxed)
+				<< " " << stats.maxNanos.load(std::memory_order_relaxed);
+		for(auto &bucket : stats.latencyHistogram)
+			stream << " " << bucket.load(std::memory_order_relaxed);
+		stream << "\n";
+	}
+	return stream.str();
+}
 
-		auto conversation = accept.descriptor();
+async::result<RequestResult> RequestContext::handleGetPid() {
+	auto req = bragi::parse_head_only<managarm::posix::GetPidRequest>(recv_head);
+	if (!req) {
+		std::cout << "posix: Rejecting request due to decoding failure" << std::endl;
+		co_return RequestResult::stop;
+	}
+	if(logRequests)
+		std::cout << "posix: GET_PID" << std::endl;
+
+	managarm::posix::SvrResponse resp;
+	resp.set_error(managarm::posix::Errors::SUCCESS);
+	resp.set_pid(self->pid());
+
+	auto [sendResp] = co_await helix_ng::exchangeMsgs(
+		conversation,
+		helix_ng::sendBragiHeadOnly(resp, frg::stl_allocator{})
+	);
+	HEL_CHECK(sendResp.error());
+	co_return RequestResult::handled;
+}
 
-		auto sendErrorResponse = [&conversation]<typename Message = managarm::posix::SvrResponse>(managarm::posix::Errors err) -> async::result<void> {
-			Message resp;
-			resp.set_error(err);
+async::result<RequestResult> RequestContext::handleGetPpid() {
+	auto req = bragi::parse_head_only<managarm::posix::GetPpidRequest>(recv_head);
 
-			auto [send_resp] = co_await helix_ng::exchangeMsgs(
-					conversation,
-					helix_ng::sendBragiHeadOnly(resp, frg::stl_allocator{})
-				);
+	if (!req) {
+		std::cout << "posix: Rejecting request due to decoding failure" << std::endl;
+		co_return RequestResult::stop;
+	}
 
-			HEL_CHECK(send_resp.error());
-		};
+	if(logRequests)
+		std::cout << "posix: GET_PPID" << std::endl;
 
-		auto preamble = bragi::read_preamble(recv_head);
-		assert(!preamble.error());
-		recv_head.reset();
+	managarm::posix::SvrResponse resp;
+	resp.set_error(managarm::posix::Errors::SUCCESS);
+	resp.set_pid(self->getParent()->pid());
 
-		managarm::posix::CntRequest req;
-		if (preamble.id() == managarm::posix::CntRequest::message_id) {
-			auto o = bragi::parse_head_only<managarm::posix::CntRequest>(recv_head);
-			if (!o) {
-				std::cout << "posix: Rejecting request due to decoding failure" << std::endl;
-				break;
-			}
+	auto [send_resp] = co_await helix_ng::exchangeMsgs(
+			conversation,
+			helix_ng::sendBragiHeadOnly(resp, frg::stl_allocator{})
+		);
 
-			req = *o;
-		}
+	HEL_CHECK(send_resp.error());
+	co_return RequestResult::handled;
+}
 
-		if(preamble.id() == bragi::message_id<managarm::posix::GetPidRequest>) {
-			auto req = bragi::parse_head_only<managarm::posix::GetPidRequest>(recv_head);
-			if (!req) {
-				std::cout << "posix: Rejecting request due to decoding failure" << std::endl;
-				break;
-			}
-			if(logRequests)
-				std::cout << "posix: GET_PID" << std::endl;
+async::result<RequestResult> RequestContext::handleGetUid() {
+	auto req = bragi::parse_head_only<managarm::posix::GetUidRequest>(recv_head);
 
-			managarm::posix::SvrResponse resp;
-			resp.set_error(managarm::posix::Errors::SUCCESS);
-			resp.set_pid(self->pid());
+	if (!req) {
+		std::cout << "posix: Rejecting request due to decoding failure" << std::endl;
+		co_return RequestResult::stop;
+	}
 
-			auto [sendResp] = co_await helix_ng::exchangeMsgs(
-				conversation,
-				helix_ng::sendBragiHeadOnly(resp, frg::stl_allocator{})
-			);
-			HEL_CHECK(sendResp.error());
-		}else if(preamble.id() == managarm::posix::GetPpidRequest::message_id) {
-			auto req = bragi::parse_head_only<managarm::posix::GetPpidRequest>(recv_head);
+	if(logRequests)
+		std::cout << "posix: GET_UID" << std::endl;
 
-			if (!req) {
-				std::cout << "posix: Rejecting request due to decoding failure" << std::endl;
-				break;
-			}
+	managarm::posix::SvrResponse resp;
+	resp.set_error(managarm::posix::Errors::SUCCESS);
+	resp.set_uid(self->uid());
 
-			if(logRequests)
-				std::cout << "posix: GET_PPID" << std::endl;
+	auto [send_resp] = co_await helix_ng::exchangeMsgs(
+			conversation,
+			helix_ng::sendBragiHeadOnly(resp, frg::stl_allocator{})
+		);
 
-			managarm::posix::SvrResponse resp;
-			resp.set_error(managarm::posix::Errors::SUCCESS);
-			resp.set_pid(self->getParent()->pid());
+	HEL_CHECK(send_resp.error());
+	co_return RequestResult::handled;
+}
 
-			auto [send_resp] = co_await helix_ng::exchangeMsgs(
-					conversation,
-					helix_ng::sendBragiHeadOnly(resp, frg::stl_allocator{})
-				);
+async::result<RequestResult> RequestContext::handleSetUid() {
+	auto req = bragi::parse_head_only<managarm::posix::SetUidRequest>(recv_head);
 
-			HEL_CHECK(send_resp.error());
-		}else if(preamble.id() == managarm::posix::GetUidRequest::message_id) {
-			auto req = bragi::parse_head_only<managarm::posix::GetUidRequest>(recv_head);
+	if (!req) {
+		std::cout << "posix: Rejecting request due to decoding failure" << std::endl;
+		co_return RequestResult::stop;
+	}
 
-			if (!req) {
-				std::cout << "posix: Rejecting request due to decoding failure" << std::endl;
-				break;
-			}
+	if(logRequests)
+		std::cout << "posix: SET_UID" << std::endl;
 
-			if(logRequests)
-				std::cout << "posix: GET_UID" << std::endl;
+	Error err = self->setUid(req->uid());
+	if(err == Error::accessDenied) {
+		co_await sendErrorResponse(managarm::posix::Errors::ACCESS_DENIED);
+	} else if(err == Error::illegalArguments) {
+		co_await sendErrorResponse(managarm::posix::Errors::ILLEGAL_ARGUMENTS);
+	} else {
+		co_await sendErrorResponse(managarm::posix::Errors::SUCCESS);
+	}
+	co_return RequestResult::handled;
+}
 
-			managarm::posix::SvrResponse resp;
-			resp.set_error(managarm::posix::Errors::SUCCESS);
-			resp.set_uid(self->uid());
+async::result<RequestResult> RequestContext::handleGetEuid() {
+	auto req = bragi::parse_head_only<managarm::posix::GetEuidRequest>(recv_head);
 
-			auto [send_resp] = co_await helix_ng::exchangeMsgs(
-					conversation,
-					helix_ng::sendBragiHeadOnly(resp, frg::stl_allocator{})
-				);
+	if (!req) {
+		std::cout << "posix: Rejecting request due to decoding failure" << std::endl;
+		co_return RequestResult::stop;
+	}
 
-			HEL_CHECK(send_resp.error());
-		}else if(preamble.id() == managarm::posix::SetUidRequest::message_id) {
-			auto req = bragi::parse_head_only<managarm::posix::SetUidRequest>(recv_head);
+	if(logRequests)
+		std::cout << "posix: GET_EUID" << std::endl;
 
-			if (!req) {
-				std::cout << "posix: Rejecting request due to decoding failure" << std::endl;
-				break;
-			}
+	managarm::posix::SvrResponse resp;
+	resp.set_error(managarm::posix::Errors::SUCCESS);
+	resp.set_uid(self->euid());
 
-			if(logRequests)
-				std::cout << "posix: SET_UID" << std::endl;
+	auto [send_resp] = co_await helix_ng::exchangeMsgs(
+			conversation,
+			helix_ng::sendBragiHeadOnly(resp, frg::stl_allocator{})
+		);
 
-			Error err = self->setUid(req->uid());
-			if(err == Error::accessDenied) {
-				co_await sendErrorResponse(managarm::posix::Errors::ACCESS_DENIED);
-			} else if(err == Error::illegalArguments) {
-				co_await sendErrorResponse(managarm::posix::Errors::ILLEGAL_ARGUMENTS);
-			} else {
-				co_await sendErrorResponse(managarm::posix::Errors::SUCCESS);
-			}
-		}else if(preamble.id() == managarm::posix::GetEuidRequest::message_id) {
-			auto req = bragi::parse_head_only<managarm::posix::GetEuidRequest>(recv_head);
+	HEL_CHECK(send_resp.error());
+	co_return RequestResult::handled;
+}
 
-			if (!req) {
-				std::cout << "posix: Rejecting request due to decoding failure" << std::endl;
-				break;
-			}
+async::result<RequestResult> RequestContext::handleSetEuid() {
+	auto req = bragi::parse_head_only<managarm::posix::SetEuidRequest>(recv_head);
 
-			if(logRequests)
-				std::cout << "posix: GET_EUID" << std::endl;
+	if (!req) {
+		std::cout << "posix: Rejecting request due to decoding failure" << std::endl;
+		co_return RequestResult::stop;
+	}
 
-			managarm::posix::SvrResponse resp;
-			resp.set_error(managarm::posix::Errors::SUCCESS);
-			resp.set_uid(self->euid());
+	if(logRequests)
+		std::cout << "posix: SET_EUID" << std::endl;
 
-			auto [send_resp] = co_await helix_ng::exchangeMsgs(
-					conversation,
-					helix_ng::sendBragiHeadOnly(resp, frg::stl_allocator{})
-				);
+	Error err = self->setEuid(req->uid());
+	if(err == Error::accessDenied) {
+		co_await sendErrorResponse(managarm::posix::Errors::ACCESS_DENIED);
+	} else if(err == Error::illegalArguments) {
+		co_await sendErrorResponse(managarm::posix::Errors::ILLEGAL_ARGUMENTS);
+	} else {
+		co_await sendErrorResponse(managarm::posix::Errors::SUCCESS);
+	}
+	co_return RequestResult::handled;
+}
 
-			HEL_CHECK(send_resp.error());
-		}else if(preamble.id() == managarm::posix::SetEuidRequest::message_id) {
-			auto req = bragi::parse_head_only<managarm::posix::SetEuidRequest>(recv_head);
+async::result<RequestResult> RequestContext::handleGetGid() {
+	auto req = bragi::parse_head_only<managarm::posix::GetGidRequest>(recv_head);
 
-			if (!req) {
-				std::cout << "posix: Rejecting request due to decoding failure" << std::endl;
-				break;
-			}
+	if (!req) {
+		std::cout << "posix: Rejecting request due to decoding failure" << std::endl;
+		co_return RequestResult::stop;
+	}
 
-			if(logRequests)
-				std::cout << "posix: SET_EUID" << std::endl;
+	if(logRequests)
+		std::cout << "posix: GET_GID" << std::endl;
 
-			Error err = self->setEuid(req->uid());
-			if(err == Error::accessDenied) {
-				co_await sendErrorResponse(managarm::posix::Errors::ACCESS_DENIED);
-			} else if(err == Error::illegalArguments) {
-				co_await sendErrorResponse(managarm::posix::Errors::ILLEGAL_ARGUMENTS);
-			} else {
-				co_await sendErrorResponse(managarm::posix::Errors::SUCCESS);
-			}
-		}else if(preamble.id() == managarm::posix::GetGidRequest::message_id) {
-			auto req = bragi::parse_head_only<managarm::posix::GetGidRequest>(recv_head);
+	managarm::posix::SvrResponse resp;
+	resp.set_error(managarm::posix::Errors::SUCCESS);
+	resp.set_uid(self->gid());
 
-			if (!req) {
-				std::cout << "posix: Rejecting request due to decoding failure" << std::endl;
-				break;
-			}
+	auto [send_resp] = co_await helix_ng::exchangeMsgs(
+			conversation,
+			helix_ng::sendBragiHeadOnly(resp, frg::stl_allocator{})
+		);
 
-			if(logRequests)
-				std::cout << "posix: GET_GID" << std::endl;
+	HEL_CHECK(send_resp.error());
+	co_return RequestResult::handled;
+}
 
-			managarm::posix::SvrResponse resp;
-			resp.set_error(managarm::posix::Errors::SUCCESS);
-			resp.set_uid(self->gid());
+async::result<RequestResult> RequestContext::handleGetEgid() {
+	auto req = bragi::parse_head_only<managarm::posix::GetEgidRequest>(recv_head);
 
-			auto [send_resp] = co_await helix_ng::exchangeMsgs(
-					conversation,
-					helix_ng::sendBragiHeadOnly(resp, frg::stl_allocator{})
-				);
+	if (!req) {
+		std::cout << "posix: Rejecting request due to decoding failure" << std::endl;
+		co_return RequestResult::stop;
+	}
 
-			HEL_CHECK(send_resp.error());
-		}else if(preamble.id() == managarm::posix::GetEgidRequest::message_id) {
-			auto req = bragi::parse_head_only<managarm::posix::GetEgidRequest>(recv_head);
+	if(logRequests)
+		std::cout << "posix: GET_EGID" << std::endl;
 
-			if (!req) {
-				std::cout << "posix: Rejecting request due to decoding failure" << std::endl;
-				break;
-			}
+	managarm::posix::SvrResponse resp;
+	resp.set_error(managarm::posix::Errors::SUCCESS);
+	resp.set_uid(self->egid());
 
-			if(logRequests)
-				std::cout << "posix: GET_EGID" << std::endl;
+	auto [send_resp] = co_await helix_ng::exchangeMsgs(
+			conversation,
+			helix_ng::sendBragiHeadOnly(resp, frg::stl_allocator{})
+		);
 
-			managarm::posix::SvrResponse resp;
-			resp.set_error(managarm::posix::Errors::SUCCESS);
-			resp.set_uid(self->egid());
+	HEL_CHECK(send_resp.error());
+	co_return RequestResult::handled;
+}
 
-			auto [send_resp] = co_await helix_ng::exchangeMsgs(
-					conversation,
-					helix_ng::sendBragiHeadOnly(resp, frg::stl_allocator{})
-				);
+async::result<RequestResult> RequestContext::handleSetGid() {
+	auto req = bragi::parse_head_only<managarm::posix::SetGidRequest>(recv_head);
 
-			HEL_CHECK(send_resp.error());
-		}else if(preamble.id() == managarm::posix::SetGidRequest::message_id) {
-			auto req = bragi::parse_head_only<managarm::posix::SetGidRequest>(recv_head);
+	if (!req) {
+		std::cout << "posix: Rejecting request due to decoding failure" << std::endl;
+		co_return RequestResult::stop;
+	}
 
-			if (!req) {
-				std::cout << "posix: Rejecting request due to decoding failure" << std::endl;
-				break;
-			}
+	if(logRequests)
+		std::cout << "posix: SET_GID" << std::endl;
 
-			if(logRequests)
-				std::cout << "posix: SET_GID" << std::endl;
+	Error err = self->setGid(req->uid());
+	if(err == Error::accessDenied) {
+		co_await sendErrorResponse(managarm::posix::Errors::ACCESS_DENIED);
+	} else if(err == Error::illegalArguments) {
+		co_await sendErrorResponse(managarm::posix::Errors::ILLEGAL_ARGUMENTS);
+	} else {
+		co_await sendErrorResponse(managarm::posix::Errors::SUCCESS);
+	}
+	co_return RequestResult::handled;
+}
 
-			Error err = self->setGid(req->uid());
-			if(err == Error::accessDenied) {
-				co_await sendErrorResponse(managarm::posix::Errors::ACCESS_DENIED);
-			} else if(err == Error::illegalArguments) {
-				co_await sendErrorResponse(managarm::posix::Errors::ILLEGAL_ARGUMENTS);
-			} else {
-				co_await sendErrorResponse(managarm::posix::Errors::SUCCESS);
-			}
-		}else if(preamble.id() == managarm::posix::SetEgidRequest::message_id) {
-			auto req = bragi::parse_head_only<managarm::posix::SetEgidRequest>(recv_head);
+async::result<RequestResult> RequestContext::handleSetEgid() {
+	auto req = bragi::parse_head_only<managarm::posix::SetEgidRequest>(recv_head);
 
-			if (!req) {
-				std::cout << "posix: Rejecting request due to decoding failure" << std::endl;
-				break;
-			}
+	if (!req) {
+		std::cout << "posix: Rejecting request due to decoding failure" << std::endl;
+		co_return RequestResult::stop;
+	}
 
-			if(logRequests)
-				std::cout << "posix: SET_EGID" << std::endl;
+	if(logRequests)
+		std::cout << "posix: SET_EGID" << std::endl;
 
-			Error err = self->setEgid(req->uid());
-			if(err == Error::accessDenied) {
-				co_await sendErrorResponse(managarm::posix::Errors::ACCESS_DENIED);
-			} else if(err == Error::illegalArguments) {
-				co_await sendErrorResponse(managarm::posix::Errors::ILLEGAL_ARGUMENTS);
-			} else {
-				co_await sendErrorResponse(managarm::posix::Errors::SUCCESS);
-			}
-		}else if(preamble.id() == managarm::posix::WaitIdRequest::message_id) {
-			auto req = bragi::parse_head_only<managarm::posix::WaitIdRequest>(recv_head);
+	Error err = self->setEgid(req->uid());
+	if(err == Error::accessDenied) {
+		co_await sendErrorResponse(managarm::posix::Errors::ACCESS_DENIED);
+	} else if(err == Error::illegalArguments) {
+		co_await sendErrorResponse(managarm::posix::Errors::ILLEGAL_ARGUMENTS);
+	} else {
+		co_await sendErrorResponse(managarm::posix::Errors::SUCCESS);
+	}
+	co_return RequestResult::handled;
+}
 
-			if (!req) {
-				std::cout << "posix: Rejecting request due to decoding failure" << std::endl;
-				break;
-			}
+async::result<RequestResult> RequestContext::handleWaitId() {
+	auto req = bragi::parse_head_only<managarm::posix::WaitIdRequest>(recv_head);
 
-			if(logRequests)
-				std::cout << "posix: WAIT_ID" << std::endl;
+	if (!req) {
+		std::cout << "posix: Rejecting request due to decoding failure" << std::endl;
+		co_return RequestResult::stop;
+	}
 
-			if(req->flags() & ~(WNOHANG | WCONTINUED | WEXITED | WSTOPPED | WNOWAIT)) {
-				std::cout << "posix: WAIT_ID invalid flags: " << req->flags() << std::endl;
-				co_await sendErrorResponse(managarm::posix::Errors::ILLEGAL_ARGUMENTS);
-				continue;
-			}
+	if(logRequests)
+		std::cout << "posix: WAIT_ID" << std::endl;
 
-			if(req->flags() & WSTOPPED)
-				std::cout << "\e[31mposix: WAIT_ID flag WSTOPPED is silently ignored\e[39m" << std::endl;
+	if(req->flags() & ~(WNOHANG | WCONTINUED | WEXITED | WSTOPPED | WNOWAIT)) {
+		std::cout << "posix: WAIT_ID invalid flags: " << req->flags() << std::endl;
+		co_await sendErrorResponse(managarm::posix::Errors::ILLEGAL_ARGUMENTS);
+		co_return RequestResult::handled;
+	}
 
-			if(req->flags() & WCONTINUED)
-				std::cout << "\e[31mposix: WAIT_ID flag WCONTINUED is silently ignored\e[39m" << std::endl;
+	if(req->flags() & WSTOPPED)
+		std::cout << "\e[31mposix: WAIT_ID flag WSTOPPED is silently ignored\e[39m" << std::endl;
+
+	if(req->flags() & WCONTINUED)
+		std::cout << "\e[31mposix: WAIT_ID flag WCONTINUED is silently ignored\e[39m" << std::endl;
+
+	if(req->flags() & WNOWAIT)
+		std::cout << "\e[31mposix: WAIT_ID flag WNOWAIT is silently ignored\e[39m" << std::endl;
+
+	TerminationState state;
+	int pid;
+	if(req->idtype() == P_PID) {
+		pid = co_await self->wait(req->id(), req->flags() & WNOHANG, &state);
+	} else if(req->idtype() == P_ALL) {
+		pid = co_await self->wait(-1, req->flags() & WNOHANG, &state);
+	} else {
+		std::cout << "\e[31mposix: WAIT_ID idtype other than P_PID and P_ALL are not implemented\e[39m" << std::endl;
+		co_await sendErrorResponse(managarm::posix::Errors::ILLEGAL_ARGUMENTS);
+		co_return RequestResult::handled;
+	}
 
-			if(req->flags() & WNOWAIT)
-				std::cout << "\e[31mposix: WAIT_ID flag WNOWAIT is silently ignored\e[39m" << std::endl;
+	helix::SendBuffer send_resp;
+
+	managarm::posix::WaitIdResponse resp;
+	resp.set_error(managarm::posix::Errors::SUCCESS);
+	resp.set_pid(pid);
+	resp.set_uid(self->findProcess(pid)->uid());
+
+	if(auto byExit = std::get_if<TerminationByExit>(&state); byExit) {
+		resp.set_sig_status(W_EXITCODE(byExit->code, 0));
+		resp.set_sig_code(CLD_EXITED);
+	}else if(auto bySignal = std::get_if<TerminationBySignal>(&state); bySignal) {
+		resp.set_sig_status(W_EXITCODE(0, bySignal->signo));
+		resp.set_sig_code(CLD_KILLED);
+	}else{
+		resp.set_sig_status(0);
+		resp.set_sig_code(0);
+		assert(std::holds_alternative<std::monostate>(state));
+	}
 
-			TerminationState state;
-			int pid;
-			if(req->idtype() == P_PID) {
-				pid = co_await self->wait(req->id(), req->flags() & WNOHANG, &state);
-			} else if(req->idtype() == P_ALL) {
-				pid = co_await self->wait(-1, req->flags() & WNOHANG, &state);
-			} else {
-				std::cout << "\e[31mposix: WAIT_ID idtype other than P_PID and P_ALL are not implemented\e[39m" << std::endl;
-				co_await sendErrorResponse(managarm::posix::Errors::ILLEGAL_ARGUMENTS);
-				continue;
-			}
+	auto [sendResp] = co_await helix_ng::exchangeMsgs(
+		conversation,
+		helix_ng::sendBragiHeadOnly(resp, frg::stl_allocator{})
+	);
+	HEL_CHECK(sendResp.error());
+	co_return RequestResult::handled;
+}
 
-			helix::SendBuffer send_resp;
+async::result<RequestResult> RequestContext::handleCntWait() {
+	if(logRequests)
+		std::cout << "posix: WAIT" << std::endl;
 
-			managarm::posix::WaitIdResponse resp;
-			resp.set_error(managarm::posix::Errors::SUCCESS);
-			resp.set_pid(pid);
-			resp.set_uid(self->findProcess(pid)->uid());
-
-			if(auto byExit = std::get_if<TerminationByExit>(&state); byExit) {
-				resp.set_sig_status(W_EXITCODE(byExit->code, 0));
-				resp.set_sig_code(CLD_EXITED);
-			}else if(auto bySignal = std::get_if<TerminationBySignal>(&state); bySignal) {
-				resp.set_sig_status(W_EXITCODE(0, bySignal->signo));
-				resp.set_sig_code(CLD_KILLED);
-			}else{
-				resp.set_sig_status(0);
-				resp.set_sig_code(0);
-				assert(std::holds_alternative<std::monostate>(state));
-			}
+	if(req.flags() & ~(WNOHANG | WUNTRACED | WCONTINUED)) {
+		std::cout << "posix: WAIT invalid flags: " << req.flags() << std::endl;
+		co_await sendErrorResponse(managarm::posix::Errors::ILLEGAL_ARGUMENTS);
+		co_return RequestResult::handled;
+	}
 
-			auto [sendResp] = co_await helix_ng::exchangeMsgs(
-				conversation,
-				helix_ng::sendBragiHeadOnly(resp, frg::stl_allocator{})
-			);
-			HEL_CHECK(sendResp.error());
-		}else if(req.request_type() == managarm::posix::CntReqType::WAIT) {
-			if(logRequests)
-				std::cout << "posix: WAIT" << std::endl;
+	if(req.flags() & WUNTRACED)
+		std::cout << "\e[31mposix: WAIT flag WUNTRACED is silently ignored\e[39m" << std::endl;
 
-			if(req.flags() & ~(WNOHANG | WUNTRACED | WCONTINUED)) {
-				std::cout << "posix: WAIT invalid flags: " << req.flags() << std::endl;
-				co_await sendErrorResponse(managarm::posix::Errors::ILLEGAL_ARGUMENTS);
-				continue;
-			}
+	if(req.flags() & WCONTINUED)
+		std::cout << "\e[31mposix: WAIT flag WCONTINUED is silently ignored\e[39m" << std::endl;
 
-			if(req.flags() & WUNTRACED)
-				std::cout << "\e[31mposix: WAIT flag WUNTRACED is silently ignored\e[39m" << std::endl;
+	TerminationState state;
+	ResourceUsage stats;
+	auto pid = co_await self->wait(req.pid(), req.flags() & WNOHANG, &state, &stats);
 
-			if(req.flags() & WCONTINUED)
-				std::cout << "\e[31mposix: WAIT flag WCONTINUED is silently ignored\e[39m" << std::endl;
+	helix::SendBuffer send_resp;
 
-			TerminationState state;
-			ResourceUsage stats;
-			auto pid = co_await self->wait(req.pid(), req.flags() & WNOHANG, &state, &stats);
+	managarm::posix::SvrResponse resp;
+	resp.set_error(managarm::posix::Errors::SUCCESS);
+	resp.set_pid(pid);
+	resp.set_ru_user_time(stats.userTime);
 
-			helix::SendBuffer send_resp;
+	uint32_t mode = 0;
+	if(auto byExit = std::get_if<TerminationByExit>(&state); byExit) {
+		mode |= W_EXITCODE(byExit->code, 0);
+	}else if(auto bySignal = std::get_if<TerminationBySignal>(&state); bySignal) {
+		mode |= W_EXITCODE(0, bySignal->signo);
+	}else{
+		assert(std::holds_alternative<std::monostate>(state));
+	}
+	resp.set_mode(mode);
+
+	auto ser = resp.SerializeAsString();
+	auto &&transmit = helix::submitAsync(conversation, helix::Dispatcher::global(),
+			helix::action(&send_resp, ser.data(), ser.size()));
+	co_await transmit.async_wait();
+	HEL_CHECK(send_resp.error());
+	co_return RequestResult::handled;
+}
 
-			managarm::posix::SvrResponse resp;
-			resp.set_error(managarm::posix::Errors::SUCCESS);
-			resp.set_pid(pid);
-			resp.set_ru_user_time(stats.userTime);
-
-			uint32_t mode = 0;
-			if(auto byExit = std::get_if<TerminationByExit>(&state); byExit) {
-				mode |= W_EXITCODE(byExit->code, 0);
-			}else if(auto bySignal = std::get_if<TerminationBySignal>(&state); bySignal) {
-				mode |= W_EXITCODE(0, bySignal->signo);
-			}else{
-				assert(std::holds_alternative<std::monostate>(state));
-			}
-			resp.set_mode(mode);
+async::result<RequestResult> RequestContext::handleReboot() {
+	auto req = bragi::parse_head_only<managarm::posix::RebootRequest>(recv_head);
 
-			auto ser = resp.SerializeAsString();
-			auto &&transmit = helix::submitAsync(conversation, helix::Dispatcher::global(),
-					helix::action(&send_resp, ser.data(), ser.size()));
-			co_await transmit.async_wait();
-			HEL_CHECK(send_resp.error());
-		}else if(preamble.id() == managarm::posix::RebootRequest::message_id) {
-			auto req = bragi::parse_head_only<managarm::posix::RebootRequest>(recv_head);
+	if (!req) {
+		std::cout << "posix: Rejecting request due to decoding failure" << std::endl;
+		co_return RequestResult::stop;
+	}
 
-			if (!req) {
-				std::cout << "posix: Rejecting request due to decoding failure" << std::endl;
-				break;
-			}
+	if(logRequests)
+		std::cout << "posix: REBOOT with command: " << req->cmd() << std::endl;
 
-			if(logRequests)
-				std::cout << "posix: REBOOT with command: " << req->cmd() << std::endl;
+	if(self->uid() != 0) {
+		sendErrorResponse(managarm::posix::Errors::INSUFFICIENT_PERMISSION);
+		co_return RequestResult::handled;
+	}
 
-			if(self->uid() != 0) {
-				sendErrorResponse(managarm::posix::Errors::INSUFFICIENT_PERMISSION);
-				continue;
-			}
+	managarm::hw::RebootRequest hwRequest;
+	hwRequest.set_cmd(req->cmd());
+	auto [offer, hwSendResp, hwResp] = co_await helix_ng::exchangeMsgs(
+		getPmLane(),
+		helix_ng::offer(
+			helix_ng::sendBragiHeadOnly(hwRequest, frg::stl_allocator{}),
+			helix_ng::recvInline()
+		)
+	);
+	HEL_CHECK(offer.error());
+	HEL_CHECK(hwSendResp.error());
+	HEL_CHECK(hwResp.error());
+	
+	helix::SendBuffer send_resp;
+	managarm::posix::SvrResponse resp;
+
+	resp.set_error(managarm::posix::Errors::SUCCESS);
+
+	auto ser = resp.SerializeAsString();
+	auto &&transmit = helix::submitAsync(conversation, helix::Dispatcher::global(),
+			helix::action(&send_resp, ser.data(), ser.size()));
+	co_await transmit.async_wait();
+	HEL_CHECK(send_resp.error());
+	co_return RequestResult::handled;
+}
 
-			managarm::hw::RebootRequest hwRequest;
-			hwRequest.set_cmd(req->cmd());
-			auto [offer, hwSendResp, hwResp] = co_await helix_ng::exchangeMsgs(
-				getPmLane(),
-				helix_ng::offer(
-					helix_ng::sendBragiHeadOnly(hwRequest, frg::stl_allocator{}),
-					helix_ng::recvInline()
-				)
-			);
-			HEL_CHECK(offer.error());
-			HEL_CHECK(hwSendResp.error());
-			HEL_CHECK(hwResp.error());
-			
-			helix::SendBuffer send_resp;
-			managarm::posix::SvrResponse resp;
+async::result<RequestResult> RequestContext::handleCntGetResourceUsage() {
+	if(logRequests)
+		std::cout << "posix: GET_RESOURCE_USAGE" << std::endl;
+
+	HelThreadStats stats;
+	HEL_CHECK(helQueryThreadStats(self->threadDescriptor().getHandle(), &stats));
+
+	int32_t mode = static_cast<int32_t>(req.mode());
+	uint64_t user_time;
+	if(mode == RUSAGE_SELF) {
+		user_time = stats.userTime;
+	}else if(mode == RUSAGE_CHILDREN) {
+		user_time = self->accumulatedUsage().userTime;
+	}else{
+		std::cout << "\e[31mposix: GET_RESOURCE_USAGE mode is not supported\e[39m"
+				<< std::endl;
+		user_time = 0;
+		// TODO: Return an error response.
+	}
 
-			resp.set_error(managarm::posix::Errors::SUCCESS);
+	helix::SendBuffer send_resp;
 
-			auto ser = resp.SerializeAsString();
-			auto &&transmit = helix::submitAsync(conversation, helix::Dispatcher::global(),
-					helix::action(&send_resp, ser.data(), ser.size()));
-			co_await transmit.async_wait();
-			HEL_CHECK(send_resp.error());
-		}else if(req.request_type() == managarm::posix::CntReqType::GET_RESOURCE_USAGE) {
-			if(logRequests)
-				std::cout << "posix: GET_RESOURCE_USAGE" << std::endl;
-
-			HelThreadStats stats;
-			HEL_CHECK(helQueryThreadStats(self->threadDescriptor().getHandle(), &stats));
-
-			int32_t mode = static_cast<int32_t>(req.mode());
-			uint64_t user_time;
-			if(mode == RUSAGE_SELF) {
-				user_time = stats.userTime;
-			}else if(mode == RUSAGE_CHILDREN) {
-				user_time = self->accumulatedUsage().userTime;
-			}else{
-				std::cout << "\e[31mposix: GET_RESOURCE_USAGE mode is not supported\e[39m"
-						<< std::endl;
-				user_time = 0;
-				// TODO: Return an error response.
-			}
+	managarm::posix::SvrResponse resp;
+	resp.set_error(managarm::posix::Errors::SUCCESS);
+	resp.set_ru_user_time(user_time);
 
-			helix::SendBuffer send_resp;
+	auto ser = resp.SerializeAsString();
+	auto &&transmit = helix::submitAsync(conversation, helix::Dispatcher::global(),
+			helix::action(&send_resp, ser.data(), ser.size()));
+	co_await transmit.async_wait();
+	HEL_CHECK(send_resp.error());
+	co_return RequestResult::handled;
+}
 
-			managarm::posix::SvrResponse resp;
-			resp.set_error(managarm::posix::Errors::SUCCESS);
-			resp.set_ru_user_time(user_time);
+async::result<RequestResult> RequestContext::handleVmMap() {
+	auto req = bragi::parse_head_only<managarm::posix::VmMapRequest>(recv_head);
+	if (!req) {
+		std::cout << "posix: Rejecting request due to decoding failure" << std::endl;
+		co_return RequestResult::stop;
+	}
+	if(logRequests)
+		std::cout << "posix: VM_MAP size: " << (void *)(size_t)req->size() << std::endl;
 
-			auto ser = resp.SerializeAsString();
-			auto &&transmit = helix::submitAsync(conversation, helix::Dispatcher::global(),
-					helix::action(&send_resp, ser.data(), ser.size()));
-			co_await transmit.async_wait();
-			HEL_CHECK(send_resp.error());
-		}else if(preamble.id() == bragi::message_id<managarm::posix::VmMapRequest>) {
-			auto req = bragi::parse_head_only<managarm::posix::VmMapRequest>(recv_head);
-			if (!req) {
-				std::cout << "posix: Rejecting request due to decoding failure" << std::endl;
-				break;
-			}
-			if(logRequests)
-				std::cout << "posix: VM_MAP size: " << (void *)(size_t)req->size() << std::endl;
+	// TODO: Validate req->flags().
 
-			// TODO: Validate req->flags().
+	if(req->mode() & ~(PROT_READ | PROT_WRITE | PROT_EXEC)) {
+		co_await sendErrorResponse(managarm::posix::Errors::ILLEGAL_ARGUMENTS);
+		co_return RequestResult::handled;
+	}
 
-			if(req->mode() & ~(PROT_READ | PROT_WRITE | PROT_EXEC)) {
-				co_await sendErrorResponse(managarm::posix::Errors::ILLEGAL_ARGUMENTS);
-				continue;
-			}
+	if(req->rel_offset() & 0xFFF) {
+		co_await sendErrorResponse(managarm::posix::Errors::ILLEGAL_ARGUMENTS);
+		co_return RequestResult::handled;
+	}
 
-			if(req->rel_offset() & 0xFFF) {
-				co_await sendErrorResponse(managarm::posix::Errors::ILLEGAL_ARGUMENTS);
-				continue;
-			}
+	uint32_t nativeFlags = 0;
+
+	if(req->mode() & PROT_READ)
+		nativeFlags |= kHelMapProtRead;
+	if(req->mode() & PROT_WRITE)
+		nativeFlags |= kHelMapProtWrite;
+	if(req->mode() & PROT_EXEC)
+		nativeFlags |= kHelMapProtExecute;
+
+	if(req->flags() & MAP_FIXED_NOREPLACE)
+		nativeFlags |= kHelMapFixedNoReplace;
+	else if(req->flags() & MAP_FIXED)
+		nativeFlags |= kHelMapFixed;
+
+	bool copyOnWrite;
+	if((req->flags() & (MAP_PRIVATE | MAP_SHARED)) == MAP_PRIVATE) {
+		copyOnWrite = true;
+	}else if((req->flags() & (MAP_PRIVATE | MAP_SHARED)) == MAP_SHARED) {
+		copyOnWrite = false;
+	}else{
+		throw std::runtime_error("posix: Handle illegal flags in VM_MAP");
+	}
 
-			uint32_t nativeFlags = 0;
-
-			if(req->mode() & PROT_READ)
-				nativeFlags |= kHelMapProtRead;
-			if(req->mode() & PROT_WRITE)
-				nativeFlags |= kHelMapProtWrite;
-			if(req->mode() & PROT_EXEC)
-				nativeFlags |= kHelMapProtExecute;
-
-			if(req->flags() & MAP_FIXED_NOREPLACE)
-				nativeFlags |= kHelMapFixedNoReplace;
-			else if(req->flags() & MAP_FIXED)
-				nativeFlags |= kHelMapFixed;
-
-			bool copyOnWrite;
-			if((req->flags() & (MAP_PRIVATE | MAP_SHARED)) == MAP_PRIVATE) {
-				copyOnWrite = true;
-			}else if((req->flags() & (MAP_PRIVATE | MAP_SHARED)) == MAP_SHARED) {
-				copyOnWrite = false;
-			}else{
-				throw std::runtime_error("posix: Handle illegal flags in VM_MAP");
-			}
+	uintptr_t hint = req->address_hint();
 
-			uintptr_t hint = req->address_hint();
+	frg::expected<Error, void *> result;
+	if(req->flags() & MAP_ANONYMOUS) {
+		assert(!req->rel_offset());
 
-			frg::expected<Error, void *> result;
-			if(req->flags() & MAP_ANONYMOUS) {
-				assert(!req->rel_offset());
+		if(copyOnWrite) {
+			result = co_await self->vmContext()->mapFile(hint,
+					{}, nullptr,
+					0, req->size(), true, nativeFlags);
+		}else{
+			HelHandle handle;
+			HEL_CHECK(helAllocateMemory(req->size(), 0, nullptr, &handle));
 
-				if(copyOnWrite) {
-					result = co_await self->vmContext()->mapFile(hint,
-							{}, nullptr,
-							0, req->size(), true, nativeFlags);
-				}else{
-					HelHandle handle;
-					HEL_CHECK(helAllocateMemory(req->size(), 0, nullptr, &handle));
+			result = co_await self->vmContext()->mapFile(hint,
+					helix::UniqueDescriptor{handle}, nullptr,
+					0, req->size(), false, nativeFlags);
+		}
+	}else{
+		auto file = self->fileContext()->getFile(req->fd());
+		assert(file && "Illegal FD for VM_MAP");
+		auto memory = co_await file->accessMemory();
+		assert(memory);
+		result = co_await self->vmContext()->mapFile(hint,
+				std::move(memory), std::move(file),
+				req->rel_offset(), req->size(), copyOnWrite, nativeFlags);
+	}
 
-					result = co_await self->vmContext()->mapFile(hint,
-							helix::UniqueDescriptor{handle}, nullptr,
-							0, req->size(), false, nativeFlags);
-				}
-			}else{
-				auto file = self->fileContext()->getFile(req->fd());
-				assert(file && "Illegal FD for VM_MAP");
-				auto memory = co_await file->accessMemory();
-				assert(memory);
-				result = co_await self->vmContext()->mapFile(hint,
-						std::move(memory), std::move(file),
-						req->rel_offset(), req->size(), copyOnWrite, nativeFlags);
-			}
+	if(!result) {
+		assert(result.error() == Error::alreadyExists || result.error() == Error::noMemory);
+		if(result.error() == Error::alreadyExists)
+			co_await sendErrorResponse(managarm::posix::Errors::ALREADY_EXISTS);
+		else if(result.error() == Error::noMemory)
+			co_await sendErrorResponse(managarm::posix::Errors::NO_MEMORY);
+		co_return RequestResult::handled;
+	}
+
+	void *address = result.unwrap();
+
+	managarm::posix::SvrResponse resp;
+	resp.set_error(managarm::posix::Errors::SUCCESS);
+	resp.set_offset(reinterpret_cast<uintptr_t>(address));
+
+	auto [sendResp] = co_await helix_ng::exchangeMsgs(
+		conversation,
+		helix_ng::sendBragiHeadOnly(resp, frg::stl_allocator{})
+	);
+	HEL_CHECK(sendResp.error());
+	co_return RequestResult::handled;
+}
+
+async::result<RequestResult> RequestContext::handleCntVmRemap() {
+	if(logRequests)
+		std::cout << "posix: VM_REMAP" << std::endl;
+
+	helix::SendBuffer send_resp;
+
+	auto address = co_await self->vmContext()->remapFile(
+			reinterpret_cast<void *>(req.address()), req.size(), req.new_size());
+
+	managarm::posix::SvrResponse resp;
+	resp.set_error(managarm::posix::Errors::SUCCESS);
+	resp.set_offset(reinterpret_cast<uintptr_t>(address));
+
+	auto ser = resp.SerializeAsString();
+	auto &&transmit = helix::submitAsync(conversation, helix::Dispatcher::global(),
+			helix::action(&send_resp, ser.data(), ser.size()));
+	co_await transmit.async_wait();
+	HEL_CHECK(send_resp.error());
+	co_return RequestResult::handled;
+}
+
+async::result<RequestResult> RequestContext::handleCntVmProtect() {
+	if(logRequests)
+		std::cout << "posix: VM_PROTECT" << std::endl;
+	helix::SendBuffer send_resp;
+	managarm::posix::SvrResponse resp;
+
+	if(req.mode() & ~(PROT_READ | PROT_WRITE | PROT_EXEC)) {
+		resp.set_error(managarm::posix::Errors::ILLEGAL_ARGUMENTS);
+		auto ser = resp.SerializeAsString();
+		auto &&transmit = helix::submitAsync(conversation, helix::Dispatcher::global(),
+				helix::action(&send_resp, ser.data(), ser.size()));
+		co_await transmit.async_wait();
+		HEL_CHECK(send_resp.error());
+		co_return RequestResult::handled;
+	}
 
-			if(!result) {
-				assert(result.error() == Error::alreadyExists || result.error() == Error::noMemory);
-				if(result.error() == Error::alreadyExists)
-					co_await sendErrorResponse(managarm::posix::Errors::ALREADY_EXISTS);
-				else if(result.error() == Error::noMemory)
-					co_await sendErrorResponse(managarm::posix::Errors::NO_MEMORY);
-				continue;
+	uint32_t native_flags = 0;
+	if(req.mode() & PROT_READ)
+		native_flags |= kHelMapProtRead;
+	if(req.mode() & PROT_WRITE)
+		native_flags |= kHelMapProtWrite;
+	if(req.mode() & PROT_EXEC)
+		native_flags |= kHelMapProtExecute;
+
+	co_await self->vmContext()->protectFile(
+			reinterpret_cast<void *>(req.address()), req.size(), native_flags);
+
+	resp.set_error(managarm::posix::Errors::SUCCESS);
+	auto ser = resp.SerializeAsString();
+	auto &&transmit = helix::submitAsync(conversation, helix::Dispatcher::global(),
+			helix::action(&send_resp, ser.data(), ser.size()));
+	co_await transmit.async_wait();
+	HEL_CHECK(send_resp.error());
+	co_return RequestResult::handled;
+}
+
+async::result<RequestResult> RequestContext::handleCntVmUnmap() {
+	if(logRequests)
+		std::cout << "posix: VM_UNMAP address: " << (void *)req.address()
+				<< ", size: " << (void *)(size_t)req.size() << std::endl;
+
+	helix::SendBuffer send_resp;
+
+	self->vmContext()->unmapFile(reinterpret_cast<void *>(req.address()), req.size());
+
+	managarm::posix::SvrResponse resp;
+	resp.set_error(managarm::posix::Errors::SUCCESS);
+
+	auto ser = resp.SerializeAsString();
+	auto &&transmit = helix::submitAsync(conversation, helix::Dispatcher::global(),
+			helix::action(&send_resp, ser.data(), ser.size()));
+	co_await transmit.async_wait();
+	HEL_CHECK(send_resp.error());
+	co_return RequestResult::handled;
+}
+
+async::result<RequestResult> RequestContext::handleMount() {
+	std::vector<std::byte> tail(preamble.tail_size());
+	auto [recv_tail] = co_await helix_ng::exchangeMsgs(
+			conversation,
+			helix_ng::recvBuffer(tail.data(), tail.size())
+		);
+	HEL_CHECK(recv_tail.error());
+
+	auto req = bragi::parse_head_tail<managarm::posix::MountRequest>(recv_head, tail);
+
+	if (!req) {
+		std::cout << "posix: Rejecting request due to decoding failure" << std::endl;
+		co_return RequestResult::stop;
+	}
+
+	if(logRequests)
+		std::cout << "posix: MOUNT " << req->fs_type() << " on " << req->path()
+				<< " to " << req->target_path() << std::endl;
+
+	auto resolveResult = co_await resolve(self->fsContext()->getRoot(),
+			self->fsContext()->getWorkingDirectory(), req->target_path(), self.get());
+	if(!resolveResult) {
+		if(resolveResult.error() == protocols::fs::Error::fileNotFound) {
+			co_await sendErrorResponse(managarm::posix::Errors::FILE_NOT_FOUND);
+			co_return RequestResult::handled;
+		} else if(resolveResult.error() == protocols::fs::Error::notDirectory) {
+			co_await sendErrorResponse(managarm::posix::Errors::NOT_A_DIRECTORY);
+			co_return RequestResult::handled;
+		} else {
+			std::cout << "posix: Unexpected failure from resolve()" << std::endl;
+			co_return RequestResult::abort;
+		}
+	}
+	auto target = resolveResult.value();
+
+	if(req->fs_type() == "procfs") {
+		co_await target.first->mount(target.second, getProcfs());
+	}else if(req->fs_type() == "sysfs") {
+		co_await target.first->mount(target.second, getSysfs());
+	}else if(req->fs_type() == "devtmpfs") {
+		co_await target.first->mount(target.second, getDevtmpfs());
+	}else if(req->fs_type() == "tmpfs") {
+		co_await target.first->mount(target.second, tmp_fs::createRoot());
+	}else if(req->fs_type() == "devpts") {
+		co_await target.first->mount(target.second, pts::getFsRoot());
+	}else{
+		assert(req->fs_type() == "ext2");
+		auto sourceResult = co_await resolve(self->fsContext()->getRoot(),
+				self->fsContext()->getWorkingDirectory(), req->path(), self.get());
+		if(!sourceResult) {
+			if(sourceResult.error() == protocols::fs::Error::fileNotFound) {
+				co_await sendErrorResponse(managarm::posix::Errors::FILE_NOT_FOUND);
+				co_return RequestResult::handled;
+			} else if(sourceResult.error() == protocols::fs::Error::notDirectory) {
+				co_await sendErrorResponse(managarm::posix::Errors::NOT_A_DIRECTORY);
+				co_return RequestResult::handled;
+			} else {
+				std::cout << "posix: Unexpected failure from resolve()" << std::endl;
+				co_return RequestResult::abort;
 			}
+		}
+		auto source = sourceResult.value();
+		assert(source.second);
+		assert(source.second->getTarget()->getType() == VfsType::blockDevice);
+		auto device = blockRegistry.get(source.second->getTarget()->readDevice());
+		auto link = co_await device->mount();
+		co_await target.first->mount(target.second, std::move(link));
+	}
 
-			void *address = result.unwrap();
+	if(logRequests)
+		std::cout << "posix:     MOUNT succeeds" << std::endl;
 
-			managarm::posix::SvrResponse resp;
-			resp.set_error(managarm::posix::Errors::SUCCESS);
-			resp.set_offset(reinterpret_cast<uintptr_t>(address));
+	managarm::posix::SvrResponse resp;
+	resp.set_error(managarm::posix::Errors::SUCCESS);
 
-			auto [sendResp] = co_await helix_ng::exchangeMsgs(
+	auto [send_resp] = co_await helix_ng::exchangeMsgs(
 				conversation,
 				helix_ng::sendBragiHeadOnly(resp, frg::stl_allocator{})
 			);
-			HEL_CHECK(sendResp.error());
-		}else if(req.request_type() == managarm::posix::CntReqType::VM_REMAP) {
-			if(logRequests)
-				std::cout << "posix: VM_REMAP" << std::endl;
 
-			helix::SendBuffer send_resp;
+	HEL_CHECK(send_resp.error());
+	co_return RequestResult::handled;
+}
 
-			auto address = co_await self->vmContext()->remapFile(
-					reinterpret_cast<void *>(req.address()), req.size(), req.new_size());
+async::result<RequestResult> RequestContext::handleCntChroot() {
+	if(logRequests)
+		std::cout << "posix: CHROOT" << std::endl;
+
+	helix::SendBuffer send_resp;
+
+	auto pathResult = co_await resolve(self->fsContext()->getRoot(),
+			self->fsContext()->getWorkingDirectory(), req.path(), self.get());
+	if(!pathResult) {
+		if(pathResult.error() == protocols::fs::Error::fileNotFound) {
+			co_await sendErrorResponse(managarm::posix::Errors::FILE_NOT_FOUND);
+			co_return RequestResult::handled;
+		} else if(pathResult.error() == protocols::fs::Error::notDirectory) {
+			co_await sendErrorResponse(managarm::posix::Errors::NOT_A_DIRECTORY);
+			co_return RequestResult::handled;
+		} else {
+			std::cout << "posix: Unexpected failure from resolve()" << std::endl;
+			co_return RequestResult::abort;
+		}
+	}
+	auto path = pathResult.value();
+	self->fsContext()->changeRoot(path);
+
+	managarm::posix::SvrResponse resp;
+	resp.set_error(managarm::posix::Errors::SUCCESS);
+
+	auto ser = resp.SerializeAsString();
+	auto &&transmit = helix::submitAsync(conversation, helix::Dispatcher::global(),
+			helix::action(&send_resp, ser.data(), ser.size()));
+	co_await transmit.async_wait();
+	HEL_CHECK(send_resp.error());
+	co_return RequestResult::handled;
+}
 
-			managarm::posix::SvrResponse resp;
-			resp.set_error(managarm::posix::Errors::SUCCESS);
-			resp.set_offset(reinterpret_cast<uintptr_t>(address));
+async::result<RequestResult> RequestContext::handleCntChdir() {
+	if(logRequests)
+		std::cout << "posix: CHDIR" << std::endl;
+
+	helix::SendBuffer send_resp;
+
+	auto pathResult = co_await resolve(self->fsContext()->getRoot(),
+			self->fsContext()->getWorkingDirectory(), req.path(), self.get());
+	if(!pathResult) {
+		if(pathResult.error() == protocols::fs::Error::fileNotFound) {
+			co_await sendErrorResponse(managarm::posix::Errors::FILE_NOT_FOUND);
+			co_return RequestResult::handled;
+		} else if(pathResult.error() == protocols::fs::Error::notDirectory) {
+			co_await sendErrorResponse(managarm::posix::Errors::NOT_A_DIRECTORY);
+			co_return RequestResult::handled;
+		} else {
+			std::cout << "posix: Unexpected failure from resolve()" << std::endl;
+			co_return RequestResult::abort;
+		}
+	}
+	auto path = pathResult.value();
+	self->fsContext()->changeWorkingDirectory(path);
+
+	managarm::posix::SvrResponse resp;
+	resp.set_error(managarm::posix::Errors::SUCCESS);
+
+	auto ser = resp.SerializeAsString();
+	auto &&transmit = helix::submitAsync(conversation, helix::Dispatcher::global(),
+			helix::action(&send_resp, ser.data(), ser.size()));
+	co_await transmit.async_wait();
+	HEL_CHECK(send_resp.error());
+	co_return RequestResult::handled;
+}
 
-			auto ser = resp.SerializeAsString();
-			auto &&transmit = helix::submitAsync(conversation, helix::Dispatcher::global(),
-					helix::action(&send_resp, ser.data(), ser.size()));
-			co_await transmit.async_wait();
-			HEL_CHECK(send_resp.error());
-		}else if(req.request_type() == managarm::posix::CntReqType::VM_PROTECT) {
-			if(logRequests)
-				std::cout << "posix: VM_PROTECT" << std::endl;
-			helix::SendBuffer send_resp;
-			managarm::posix::SvrResponse resp;
+async::result<RequestResult> RequestContext::handleCntFchdir() {
+	if(logRequests)
+		std::cout << "posix: CHDIR" << std::endl;
 
-			if(req.mode() & ~(PROT_READ | PROT_WRITE | PROT_EXEC)) {
-				resp.set_error(managarm::posix::Errors::ILLEGAL_ARGUMENTS);
-				auto ser = resp.SerializeAsString();
-				auto &&transmit = helix::submitAsync(conversation, helix::Dispatcher::global(),
-						helix::action(&send_resp, ser.data(), ser.size()));
-				co_await transmit.async_wait();
-				HEL_CHECK(send_resp.error());
-				continue;
-			}
+	managarm::posix::SvrResponse resp;
+	helix::SendBuffer send_resp;
 
-			uint32_t native_flags = 0;
-			if(req.mode() & PROT_READ)
-				native_flags |= kHelMapProtRead;
-			if(req.mode() & PROT_WRITE)
-				native_flags |= kHelMapProtWrite;
-			if(req.mode() & PROT_EXEC)
-				native_flags |= kHelMapProtExecute;
+	auto file = self->fileContext()->getFile(req.fd());
 
-			co_await self->vmContext()->protectFile(
-					reinterpret_cast<void *>(req.address()), req.size(), native_flags);
+	if(!file) {
+		resp.set_error(managarm::posix::Errors::NO_SUCH_FD);
 
-			resp.set_error(managarm::posix::Errors::SUCCESS);
-			auto ser = resp.SerializeAsString();
-			auto &&transmit = helix::submitAsync(conversation, helix::Dispatcher::global(),
-					helix::action(&send_resp, ser.data(), ser.size()));
-			co_await transmit.async_wait();
-			HEL_CHECK(send_resp.error());
-		}else if(req.request_type() == managarm::posix::CntReqType::VM_UNMAP) {
-			if(logRequests)
-				std::cout << "posix: VM_UNMAP address: " << (void *)req.address()
-						<< ", size: " << (void *)(size_t)req.size() << std::endl;
+		auto ser = resp.SerializeAsString();
+		auto &&transmit = helix::submitAsync(conversation, helix::Dispatcher::global(),
+				helix::action(&send_resp, ser.data(), ser.size()));
+		co_await transmit.async_wait();
+		HEL_CHECK(send_resp.error());
+		co_return RequestResult::handled;
+	}
 
-			helix::SendBuffer send_resp;
+	self->fsContext()->changeWorkingDirectory({file->associatedMount(),
+			file->associatedLink()});
 
-			self->vmContext()->unmapFile(reinterpret_cast<void *>(req.address()), req.size());
+	resp.set_error(managarm::posix::Errors::SUCCESS);
 
-			managarm::posix::SvrResponse resp;
-			resp.set_error(managarm::posix::Errors::SUCCESS);
+	auto ser = resp.SerializeAsString();
+	auto &&transmit = helix::submitAsync(conversation, helix::Dispatcher::global(),
+			helix::action(&send_resp, ser.data(), ser.size()));
+	co_await transmit.async_wait();
+	HEL_CHECK(send_resp.error());
+	co_return RequestResult::handled;
+}
 
-			auto ser = resp.SerializeAsString();
-			auto &&transmit = helix::submitAsync(conversation, helix::Dispatcher::global(),
-					helix::action(&send_resp, ser.data(), ser.size()));
-			co_await transmit.async_wait();
-			HEL_CHECK(send_resp.error());
-		}else if(preamble.id() == managarm::posix::MountRequest::message_id) {
-			std::vector<std::byte> tail(preamble.tail_size());
-			auto [recv_tail] = co_await helix_ng::exchangeMsgs(
-					conversation,
-					helix_ng::recvBuffer(tail.data(), tail.size())
-				);
-			HEL_CHECK(recv_tail.error());
+async::result<RequestResult> RequestContext::handleAccessAt() {
+	std::vector<std::byte> tail(preamble.tail_size());
+	auto [recv_tail] = co_await helix_ng::exchangeMsgs(
+			conversation,
+			helix_ng::recvBuffer(tail.data(), tail.size())
+		);
+	HEL_CHECK(recv_tail.error());
 
-			auto req = bragi::parse_head_tail<managarm::posix::MountRequest>(recv_head, tail);
+	auto req = bragi::parse_head_tail<managarm::posix::AccessAtRequest>(recv_head, tail);
 
-			if (!req) {
-				std::cout << "posix: Rejecting request due to decoding failure" << std::endl;
-				break;
-			}
+	if(!req) {
+		std::cout << "posix: Rejecting request due to decoding failure" << std::endl;
+		co_return RequestResult::stop;
+	}
 
-			if(logRequests)
-				std::cout << "posix: MOUNT " << req->fs_type() << " on " << req->path()
-						<< " to " << req->target_path() << std::endl;
-
-			auto resolveResult = co_await resolve(self->fsContext()->getRoot(),
-					self->fsContext()->getWorkingDirectory(), req->target_path(), self.get());
-			if(!resolveResult) {
-				if(resolveResult.error() == protocols::fs::Error::fileNotFound) {
-					co_await sendErrorResponse(managarm::posix::Errors::FILE_NOT_FOUND);
-					continue;
-				} else if(resolveResult.error() == protocols::fs::Error::notDirectory) {
-					co_await sendErrorResponse(managarm::posix::Errors::NOT_A_DIRECTORY);
-					continue;
-				} else {
-					std::cout << "posix: Unexpected failure from resolve()" << std::endl;
-					co_return;
-				}
-			}
-			auto target = resolveResult.value();
-
-			if(req->fs_type() == "procfs") {
-				co_await target.first->mount(target.second, getProcfs());
-			}else if(req->fs_type() == "sysfs") {
-				co_await target.first->mount(target.second, getSysfs());
-			}else if(req->fs_type() == "devtmpfs") {
-				co_await target.first->mount(target.second, getDevtmpfs());
-			}else if(req->fs_type() == "tmpfs") {
-				co_await target.first->mount(target.second, tmp_fs::createRoot());
-			}else if(req->fs_type() == "devpts") {
-				co_await target.first->mount(target.second, pts::getFsRoot());
-			}else{
-				assert(req->fs_type() == "ext2");
-				auto sourceResult = co_await resolve(self->fsContext()->getRoot(),
-						self->fsContext()->getWorkingDirectory(), req->path(), self.get());
-				if(!sourceResult) {
-					if(sourceResult.error() == protocols::fs::Error::fileNotFound) {
-						co_await sendErrorResponse(managarm::posix::Errors::FILE_NOT_FOUND);
-						continue;
-					} else if(sourceResult.error() == protocols::fs::Error::notDirectory) {
-						co_await sendErrorResponse(managarm::posix::Errors::NOT_A_DIRECTORY);
-						continue;
-					} else {
-						std::cout << "posix: Unexpected failure from resolve()" << std::endl;
-						co_return;
-					}
-				}
-				auto source = sourceResult.value();
-				assert(source.second);
-				assert(source.second->getTarget()->getType() == VfsType::blockDevice);
-				auto device = blockRegistry.get(source.second->getTarget()->readDevice());
-				auto link = co_await device->mount();
-				co_await target.first->mount(target.second, std::move(link));
-			}
+	if(logRequests || logPaths)
+		std::cout << "posix: ACCESSAT " << req->path() << std::endl;
+
+	ViewPath relative_to;
+	smarter::shared_ptr<File, FileHandle> file;
+
+	if(req->flags()) {
+		if(req->flags() & AT_SYMLINK_NOFOLLOW) {
+			std::cout << "posix: ACCESSAT flag handling AT_SYMLINK_NOFOLLOW is unimplemented" << std::endl;
+		} else if(req->flags() & AT_EACCESS) {
+			std::cout << "posix: ACCESSAT flag handling AT_EACCESS is unimplemented" << std::endl;
+		} else {
+			std::cout << "posix: ACCESSAT unknown flag is unimplemented: " << req->flags() << std::endl;
+			co_await sendErrorResponse(managarm::posix::Errors::ILLEGAL_ARGUMENTS);
+			co_return RequestResult::handled;
+		}
+	}
 
-			if(logRequests)
-				std::cout << "posix:     MOUNT succeeds" << std::endl;
+	if(req->fd() == AT_FDCWD) {
+		relative_to = self->fsContext()->getWorkingDirectory();
+	} else {
+		file = self->fileContext()->getFile(req->fd());
 
-			managarm::posix::SvrResponse resp;
-			resp.set_error(managarm::posix::Errors::SUCCESS);
+		if(!file) {
+			co_await sendErrorResponse(managarm::posix::Errors::BAD_FD);
+			co_return RequestResult::handled;
+		}
 
-			auto [send_resp] = co_await helix_ng::exchangeMsgs(
-						conversation,
-						helix_ng::sendBragiHeadOnly(resp, frg::stl_allocator{})
-					);
+		relative_to = {file->associatedMount(), file->associatedLink()};
+	}
 
-			HEL_CHECK(send_resp.error());
-		}else if(req.request_type() == managarm::posix::CntReqType::CHROOT) {
-			if(logRequests)
-				std::cout << "posix: CHROOT" << std::endl;
+	auto pathResult = co_await resolve(self->fsContext()->getRoot(),
+			relative_to, req->path(), self.get());
+	if(!pathResult) {
+		if(pathResult.error() == protocols::fs::Error::fileNotFound) {
+			co_await sendErrorResponse(managarm::posix::Errors::FILE_NOT_FOUND);
+			co_return RequestResult::handled;
+		} else if(pathResult.error() == protocols::fs::Error::notDirectory) {
+			co_await sendErrorResponse(managarm::posix::Errors::NOT_A_DIRECTORY);
+			co_return RequestResult::handled;
+		} else {
+			std::cout << "posix: Unexpected failure from resolve()" << std::endl;
+			co_return RequestResult::abort;
+		}
+	}
 
-			helix::SendBuffer send_resp;
+	co_await sendErrorResponse(managarm::posix::Errors::SUCCESS);
+	co_return RequestResult::handled;
+}
 
-			auto pathResult = co_await resolve(self->fsContext()->getRoot(),
-					self->fsContext()->getWorkingDirectory(), req.path(), self.get());
-			if(!pathResult) {
-				if(pathResult.error() == protocols::fs::Error::fileNotFound) {
-					co_await sendErrorResponse(managarm::posix::Errors::FILE_NOT_FOUND);
-					continue;
-				} else if(pathResult.error() == protocols::fs::Error::notDirectory) {
-					co_await sendErrorResponse(managarm::posix::Errors::NOT_A_DIRECTORY);
-					continue;
-				} else {
-					std::cout << "posix: Unexpected failure from resolve()" << std::endl;
-					co_return;
-				}
-			}
-			auto path = pathResult.value();
-			self->fsContext()->changeRoot(path);
+async::result<RequestResult> RequestContext::handleMkdirAt() {
+	std::vector<std::byte> tail(preamble.tail_size());
+	auto [recv_tail] = co_await helix_ng::exchangeMsgs(
+			conversation,
+			helix_ng::recvBuffer(tail.data(), tail.size())
+		);
+	HEL_CHECK(recv_tail.error());
 
-			managarm::posix::SvrResponse resp;
-			resp.set_error(managarm::posix::Errors::SUCCESS);
+	auto req = bragi::parse_head_tail<managarm::posix::MkdirAtRequest>(recv_head, tail);
 
-			auto ser = resp.SerializeAsString();
-			auto &&transmit = helix::submitAsync(conversation, helix::Dispatcher::global(),
-					helix::action(&send_resp, ser.data(), ser.size()));
-			co_await transmit.async_wait();
-			HEL_CHECK(send_resp.error());
-		}else if(req.request_type() == managarm::posix::CntReqType::CHDIR) {
-			if(logRequests)
-				std::cout << "posix: CHDIR" << std::endl;
+	if (!req) {
+		std::cout << "posix: Rejecting request due to decoding failure" << std::endl;
+		co_return RequestResult::stop;
+	}
 
-			helix::SendBuffer send_resp;
+	if(logRequests || logPaths)
+		std::cout << "posix: MKDIRAT " << req->path() << std::endl;
 
-			auto pathResult = co_await resolve(self->fsContext()->getRoot(),
-					self->fsContext()->getWorkingDirectory(), req.path(), self.get());
-			if(!pathResult) {
-				if(pathResult.error() == protocols::fs::Error::fileNotFound) {
-					co_await sendErrorResponse(managarm::posix::Errors::FILE_NOT_FOUND);
-					continue;
-				} else if(pathResult.error() == protocols::fs::Error::notDirectory) {
-					co_await sendErrorResponse(managarm::posix::Errors::NOT_A_DIRECTORY);
-					continue;
-				} else {
-					std::cout << "posix: Unexpected failure from resolve()" << std::endl;
-					co_return;
-				}
-			}
-			auto path = pathResult.value();
-			self->fsContext()->changeWorkingDirectory(path);
+	if(!req->path().size()) {
+		co_await sendErrorResponse(managarm::posix::Errors::ILLEGAL_ARGUMENTS);
+		co_return RequestResult::handled;
+	}
 
-			managarm::posix::SvrResponse resp;
-			resp.set_error(managarm::posix::Errors::SUCCESS);
+	ViewPath relative_to;
+	smarter::shared_ptr<File, FileHandle> file;
 
-			auto ser = resp.SerializeAsString();
-			auto &&transmit = helix::submitAsync(conversation, helix::Dispatcher::global(),
-					helix::action(&send_resp, ser.data(), ser.size()));
-			co_await transmit.async_wait();
-			HEL_CHECK(send_resp.error());
-		}else if(req.request_type() == managarm::posix::CntReqType::FCHDIR) {
-			if(logRequests)
-				std::cout << "posix: CHDIR" << std::endl;
+	if(req->fd() == AT_FDCWD) {
+		relative_to = self->fsContext()->getWorkingDirectory();
+	} else {
+		file = self->fileContext()->getFile(req->fd());
 
-			managarm::posix::SvrResponse resp;
-			helix::SendBuffer send_resp;
+		if (!file) {
+			co_await sendErrorResponse(managarm::posix::Errors::BAD_FD);
+			co_return RequestResult::handled;
+		}
 
-			auto file = self->fileContext()->getFile(req.fd());
+		relative_to = {file->associatedMount(), file->associatedLink()};
+	}
 
-			if(!file) {
-				resp.set_error(managarm::posix::Errors::NO_SUCH_FD);
+	PathResolver resolver;
+	resolver.setup(self->fsContext()->getRoot(),
+			relative_to, req->path(), self.get());
+	auto resolveResult = co_await resolver.resolve(resolvePrefix);
+	if(!resolveResult) {
+		if(resolveResult.error() == protocols::fs::Error::fileNotFound) {
+			co_await sendErrorResponse(managarm::posix::Errors::FILE_NOT_FOUND);
+			co_return RequestResult::handled;
+		} else if(resolveResult.error() == protocols::fs::Error::notDirectory) {
+			co_await sendErrorResponse(managarm::posix::Errors::NOT_A_DIRECTORY);
+			co_return RequestResult::handled;
+		} else {
+			std::cout << "posix: Unexpected failure from resolve()" << std::endl;
+			co_return RequestResult::abort;
+		}
+	}
 
-				auto ser = resp.SerializeAsString();
-				auto &&transmit = helix::submitAsync(conversation, helix::Dispatcher::global(),
-						helix::action(&send_resp, ser.data(), ser.size()));
-				co_await transmit.async_wait();
-				HEL_CHECK(send_resp.error());
-				continue;
-			}
+	if(!resolver.hasComponent()) {
+		co_await sendErrorResponse(managarm::posix::Errors::ALREADY_EXISTS);
+		co_return RequestResult::handled;
+	}
 
-			self->fsContext()->changeWorkingDirectory({file->associatedMount(),
-					file->associatedLink()});
+	auto parent = resolver.currentLink()->getTarget();
+	auto existsResult = co_await parent->getLink(resolver.nextComponent());
+	assert(existsResult);
+	auto exists = existsResult.value();
+	if(exists) {
+		co_await sendErrorResponse(managarm::posix::Errors::ALREADY_EXISTS);
+		co_return RequestResult::handled;
+	}
 
-			resp.set_error(managarm::posix::Errors::SUCCESS);
+	auto result = co_await parent->mkdir(resolver.nextComponent());
 
-			auto ser = resp.SerializeAsString();
-			auto &&transmit = helix::submitAsync(conversation, helix::Dispatcher::global(),
-					helix::action(&send_resp, ser.data(), ser.size()));
-			co_await transmit.async_wait();
-			HEL_CHECK(send_resp.error());
-		}else if(preamble.id() == managarm::posix::AccessAtRequest::message_id) {
-			std::vector<std::byte> tail(preamble.tail_size());
-			auto [recv_tail] = co_await helix_ng::exchangeMsgs(
-					conversation,
-					helix_ng::recvBuffer(tail.data(), tail.size())
-				);
-			HEL_CHECK(recv_tail.error());
+	if(auto error = std::get_if<Error>(&result); error) {
+		assert(*error == Error::illegalOperationTarget);
+		co_await sendErrorResponse(managarm::posix::Errors::ILLEGAL_ARGUMENTS);
+		co_return RequestResult::handled;
+	}
 
-			auto req = bragi::parse_head_tail<managarm::posix::AccessAtRequest>(recv_head, tail);
+	co_await sendErrorResponse(managarm::posix::Errors::SUCCESS);
+	co_return RequestResult::handled;
+}
 
-			if(!req) {
-				std::cout << "posix: Rejecting request due to decoding failure" << std::endl;
-				break;
-			}
+async::result<RequestResult> RequestContext::handleMkfifoAt() {
+	std::vector<std::byte> tail(preamble.tail_size());
+	auto [recv_tail] = co_await helix_ng::exchangeMsgs(
+			conversation,
+			helix_ng::recvBuffer(tail.data(), tail.size())
+		);
+	HEL_CHECK(recv_tail.error());
 
-			if(logRequests || logPaths)
-				std::cout << "posix: ACCESSAT " << req->path() << std::endl;
+	auto req = bragi::parse_head_tail<managarm::posix::MkfifoAtRequest>(recv_head, tail);
 
-			ViewPath relative_to;
-			smarter::shared_ptr<File, FileHandle> file;
+	if (!req) {
+		std::cout << "posix: Rejecting request due to decoding failure" << std::endl;
+		co_return RequestResult::stop;
+	}
 
-			if(req->flags()) {
-				if(req->flags() & AT_SYMLINK_NOFOLLOW) {
-					std::cout << "posix: ACCESSAT flag handling AT_SYMLINK_NOFOLLOW is unimplemented" << std::endl;
-				} else if(req->flags() & AT_EACCESS) {
-					std::cout << "posix: ACCESSAT flag handling AT_EACCESS is unimplemented" << std::endl;
-				} else {
-					std::cout << "posix: ACCESSAT unknown flag is unimplemented: " << req->flags() << std::endl;
-					co_await sendErrorResponse(managarm::posix::Errors::ILLEGAL_ARGUMENTS);
-					continue;
-				}
-			}
+	if(logRequests || logPaths)
+		std::cout << "posix: MKFIFOAT " << req->fd() << " " << req->path() << std::endl;
 
-			if(req->fd() == AT_FDCWD) {
-				relative_to = self->fsContext()->getWorkingDirectory();
-			} else {
-				file = self->fileContext()->getFile(req->fd());
+	if (!req->path().size()) {
+		co_await sendErrorResponse(managarm::posix::Errors::ILLEGAL_ARGUMENTS);
+		co_return RequestResult::handled;
+	}
 
-				if(!file) {
-					co_await sendErrorResponse(managarm::posix::Errors::BAD_FD);
-					continue;
-				}
+	ViewPath relative_to;
+	smarter::shared_ptr<File, FileHandle> file;
+	std::shared_ptr<FsLink> target_link;
 
-				relative_to = {file->associatedMount(), file->associatedLink()};
-			}
+	if (req->fd() == AT_FDCWD) {
+		relative_to = self->fsContext()->getWorkingDirectory();
+	} else {
+		file = self->fileContext()->getFile(req->fd());
 
-			auto pathResult = co_await resolve(self->fsContext()->getRoot(),
-					relative_to, req->path(), self.get());
-			if(!pathResult) {
-				if(pathResult.error() == protocols::fs::Error::fileNotFound) {
-					co_await sendErrorResponse(managarm::posix::Errors::FILE_NOT_FOUND);
-					continue;
-				} else if(pathResult.error() == protocols::fs::Error::notDirectory) {
-					co_await sendErrorResponse(managarm::posix::Errors::NOT_A_DIRECTORY);
-					continue;
-				} else {
-					std::cout << "posix: Unexpected failure from resolve()" << std::endl;
-					co_return;
-				}
-			}
+		if (!file) {
+			co_await sendErrorResponse(managarm::posix::Errors::BAD_FD);
+			co_return RequestResult::handled;
+		}
 
-			co_await sendErrorResponse(managarm::posix::Errors::SUCCESS);
-		}else if(preamble.id() == managarm::posix::MkdirAtRequest::message_id) {
-			std::vector<std::byte> tail(preamble.tail_size());
-			auto [recv_tail] = co_await helix_ng::exchangeMsgs(
-					conversation,
-					helix_ng::recvBuffer(tail.data(), tail.size())
-				);
-			HEL_CHECK(recv_tail.error());
+		relative_to = {file->associatedMount(), file->associatedLink()};
+	}
 
-			auto req = bragi::parse_head_tail<managarm::posix::MkdirAtRequest>(recv_head, tail);
+	PathResolver resolver;
+	resolver.setup(self->fsContext()->getRoot(),
+			relative_to, req->path(), self.get());
+	auto resolveResult = co_await resolver.resolve(resolvePrefix | resolveNoTrailingSlash);
+	if(!resolveResult) {
+		if(resolveResult.error() == protocols::fs::Error::fileNotFound) {
+			co_await sendErrorResponse(managarm::posix::Errors::FILE_NOT_FOUND);
+			co_return RequestResult::handled;
+		} else if(resolveResult.error() == protocols::fs::Error::notDirectory) {
+			co_await sendErrorResponse(managarm::posix::Errors::NOT_A_DIRECTORY);
+			co_return RequestResult::handled;
+		} else {
+			std::cout << "posix: Unexpected failure from resolve()" << std::endl;
+			co_return RequestResult::abort;
+		}
+	}
 
-			if (!req) {
-				std::cout << "posix: Rejecting request due to decoding failure" << std::endl;
-				break;
-			}
+	auto parent = resolver.currentLink()->getTarget();
+	if((co_await parent->getLink(resolver.nextComponent())).unwrap()) {
+		co_await sendErrorResponse(managarm::posix::Errors::ALREADY_EXISTS);
+		co_return RequestResult::handled;
+	}
 
-			if(logRequests || logPaths)
-				std::cout << "posix: MKDIRAT " << req->path() << std::endl;
+	auto result = co_await parent->mkfifo(resolver.nextComponent(), req->mode());
+	if(!result) {
+		std::cout << "posix: Unexpected failure from mkfifo()" << std::endl;
+		co_return RequestResult::abort;
+	}
 
-			if(!req->path().size()) {
-				co_await sendErrorResponse(managarm::posix::Errors::ILLEGAL_ARGUMENTS);
-				continue;
-			}
+	co_await sendErrorResponse(managarm::posix::Errors::SUCCESS);
+	co_return RequestResult::handled;
+}
 
-			ViewPath relative_to;
-			smarter::shared_ptr<File, FileHandle> file;
+async::result<RequestResult> RequestContext::handleLinkAt() {
+	std::vector<std::byte> tail(preamble.tail_size());
+	auto [recv_tail] = co_await helix_ng::exchangeMsgs(
+			conversation,
+			helix_ng::recvBuffer(tail.data(), tail.size())
+		);
+	HEL_CHECK(recv_tail.error());
 
-			if(req->fd() == AT_FDCWD) {
-				relative_to = self->fsContext()->getWorkingDirectory();
-			} else {
-				file = self->fileContext()->getFile(req->fd());
+	auto req = bragi::parse_head_tail<managarm::posix::LinkAtRequest>(recv_head, tail);
 
-				if (!file) {
-					co_await sendErrorResponse(managarm::posix::Errors::BAD_FD);
-					continue;
-				}
+	if(logRequests)
+		std::cout << "posix: LINKAT" << std::endl;
 
-				relative_to = {file->associatedMount(), file->associatedLink()};
-			}
+	if(req->flags() & ~(AT_EMPTY_PATH | AT_SYMLINK_FOLLOW)) {
+		co_await sendErrorResponse(managarm::posix::Errors::ILLEGAL_ARGUMENTS);
+		co_return RequestResult::handled;
+	}
 
-			PathResolver resolver;
-			resolver.setup(self->fsContext()->getRoot(),
-					relative_to, req->path(), self.get());
-			auto resolveResult = co_await resolver.resolve(resolvePrefix);
-			if(!resolveResult) {
-				if(resolveResult.error() == protocols::fs::Error::fileNotFound) {
-					co_await sendErrorResponse(managarm::posix::Errors::FILE_NOT_FOUND);
-					continue;
-				} else if(resolveResult.error() == protocols::fs::Error::notDirectory) {
-					co_await sendErrorResponse(managarm::posix::Errors::NOT_A_DIRECTORY);
-					continue;
-				} else {
-					std::cout << "posix: Unexpected failure from resolve()" << std::endl;
-					co_return;
-				}
-			}
+	if(req->flags() & AT_EMPTY_PATH) {
+		std::cout << "posix: AT_EMPTY_PATH is unimplemented for linkat" << std::endl;
+	}
 
-			if(!resolver.hasComponent()) {
-				co_await sendErrorResponse(managarm::posix::Errors::ALREADY_EXISTS);
-				continue;
-			}
+	if(req->flags() & AT_SYMLINK_FOLLOW) {
+		std::cout << "posix: AT_SYMLINK_FOLLOW is unimplemented for linkat" << std::endl;
+	}
 
-			auto parent = resolver.currentLink()->getTarget();
-			auto existsResult = co_await parent->getLink(resolver.nextComponent());
-			assert(existsResult);
-			auto exists = existsResult.value();
-			if(exists) {
-				co_await sendErrorResponse(managarm::posix::Errors::ALREADY_EXISTS);
-				continue;
-			}
+	ViewPath relative_to;
+	smarter::shared_ptr<File, FileHandle> file;
 
-			auto result = co_await parent->mkdir(resolver.nextComponent());
+	if(req->fd() == AT_FDCWD) {
+		relative_to = self->fsContext()->getWorkingDirectory();
+	} else {
+		file = self->fileContext()->getFile(req->fd());
 
-			if(auto error = std::get_if<Error>(&result); error) {
-				assert(*error == Error::illegalOperationTarget);
-				co_await sendErrorResponse(managarm::posix::Errors::ILLEGAL_ARGUMENTS);
-				continue;
-			}
+		if(!file) {
+			co_await sendErrorResponse(managarm::posix::Errors::BAD_FD);
+			co_return RequestResult::handled;
+		}
 
-			co_await sendErrorResponse(managarm::posix::Errors::SUCCESS);
-		}else if(preamble.id() == managarm::posix::MkfifoAtRequest::message_id) {
-			std::vector<std::byte> tail(preamble.tail_size());
-			auto [recv_tail] = co_await helix_ng::exchangeMsgs(
-					conversation,
-					helix_ng::recvBuffer(tail.data(), tail.size())
-				);
-			HEL_CHECK(recv_tail.error());
+		relative_to = {file->associatedMount(), file->associatedLink()};
+	}
 
-			auto req = bragi::parse_head_tail<managarm::posix::MkfifoAtRequest>(recv_head, tail);
+	PathResolver resolver;
+	resolver.setup(self->fsContext()->getRoot(),
+			relative_to, req->path(), self.get());
+	auto resolveResult = co_await resolver.resolve();
+	if(!resolveResult) {
+		if(resolveResult.error() == protocols::fs::Error::fileNotFound) {
+			co_await sendErrorResponse(managarm::posix::Errors::FILE_NOT_FOUND);
+			co_return RequestResult::handled;
+		} else if(resolveResult.error() == protocols::fs::Error::notDirectory) {
+			co_await sendErrorResponse(managarm::posix::Errors::NOT_A_DIRECTORY);
+			co_return RequestResult::handled;
+		} else {
+			std::cout << "posix: Unexpected failure from resolve()" << std::endl;
+			co_return RequestResult::abort;
+		}
+	}
 
-			if (!req) {
-				std::cout << "posix: Rejecting request due to decoding failure" << std::endl;
-				break;
-			}
+	if (req->newfd() == AT_FDCWD) {
+		relative_to = self->fsContext()->getWorkingDirectory();
+	} else {
+		file = self->fileContext()->getFile(req->newfd());
 
-			if(logRequests || logPaths)
-				std::cout << "posix: MKFIFOAT " << req->fd() << " " << req->path() << std::endl;
+		if(!file) {
+			co_await sendErrorResponse(managarm::posix::Errors::BAD_FD);
+			co_return RequestResult::handled;
+		}
 
-			if (!req->path().size()) {
-				co_await sendErrorResponse(managarm::posix::Errors::ILLEGAL_ARGUMENTS);
-				continue;
-			}
+		relative_to = {file->associatedMount(), file->associatedLink()};
+	}
 
-			ViewPath relative_to;
-			smarter::shared_ptr<File, FileHandle> file;
-			std::shared_ptr<FsLink> target_link;
+	PathResolver new_resolver;
+	new_resolver.setup(self->fsContext()->getRoot(),
+			relative_to, req->target_path(), self.get());
+	auto new_resolveResult = co_await new_resolver.resolve(
+			resolvePrefix | resolveNoTrailingSlash);
+	if(!new_resolveResult) {
+		if(new_resolveResult.error() == protocols::fs::Error::illegalOperationTarget) {
+			co_await sendErrorResponse(managarm::posix::Errors::ILLEGAL_OPERATION_TARGET);
+			co_return RequestResult::handled;
+		} else if(new_resolveResult.error() == protocols::fs::Error::fileNotFound) {
+			co_await sendErrorResponse(managarm::posix::Errors::FILE_NOT_FOUND);
+			co_return RequestResult::handled;
+		} else if(new_resolveResult.error() == protocols::fs::Error::notDirectory) {
+			co_await sendErrorResponse(managarm::posix::Errors::NOT_A_DIRECTORY);
+			co_return RequestResult::handled;
+		} else {
+			std::cout << "posix: Unexpected failure from resolve()" << std::endl;
+			co_return RequestResult::abort;
+		}
+	}
 
-			if (req->fd() == AT_FDCWD) {
-				relative_to = self->fsContext()->getWorkingDirectory();
-			} else {
-				file = self->fileContext()->getFile(req->fd());
+	auto target = resolver.currentLink()->getTarget();
+	auto directory = new_resolver.currentLink()->getTarget();
+	assert(target->superblock() == directory->superblock()); // Hard links across mount points are not allowed, return EXDEV
+	auto result = co_await directory->link(new_resolver.nextComponent(), target);
+	if(!result) {
+		std::cout << "posix: Unexpected failure from link()" << std::endl;
+		co_return RequestResult::abort;
+	}
 
-				if (!file) {
-					co_await sendErrorResponse(managarm::posix::Errors::BAD_FD);
-					continue;
-				}
+	co_await sendErrorResponse(managarm::posix::Errors::SUCCESS);
+	co_return RequestResult::handled;
+}
 
-				relative_to = {file->associatedMount(), file->associatedLink()};
-			}
+async::result<RequestResult> RequestContext::handleSymlinkAt() {
+	std::vector<std::byte> tail(preamble.tail_size());
+	auto [recv_tail] = co_await helix_ng::exchangeMsgs(
+			conversation,
+			helix_ng::recvBuffer(tail.data(), tail.size())
+		);
+	HEL_CHECK(recv_tail.error());
 
-			PathResolver resolver;
-			resolver.setup(self->fsContext()->getRoot(),
-					relative_to, req->path(), self.get());
-			auto resolveResult = co_await resolver.resolve(resolvePrefix | resolveNoTrailingSlash);
-			if(!resolveResult) {
-				if(resolveResult.error() == protocols::fs::Error::fileNotFound) {
-					co_await sendErrorResponse(managarm::posix::Errors::FILE_NOT_FOUND);
-					continue;
-				} else if(resolveResult.error() == protocols::fs::Error::notDirectory) {
-					co_await sendErrorResponse(managarm::posix::Errors::NOT_A_DIRECTORY);
-					continue;
-				} else {
-					std::cout << "posix: Unexpected failure from resolve()" << std::endl;
-					co_return;
-				}
-			}
+	auto req = bragi::parse_head_tail<managarm::posix::SymlinkAtRequest>(recv_head, tail);
 
-			auto parent = resolver.currentLink()->getTarget();
-			if((co_await parent->getLink(resolver.nextComponent())).unwrap()) {
-				co_await sendErrorResponse(managarm::posix::Errors::ALREADY_EXISTS);
-				continue;
-			}
+	if (!req) {
+		std::cout << "posix: Rejecting request due to decoding failure" << std::endl;
+		co_return RequestResult::stop;
+	}
 
-			auto result = co_await parent->mkfifo(resolver.nextComponent(), req->mode());
-			if(!result) {
-				std::cout << "posix: Unexpected failure from mkfifo()" << std::endl;
-				co_return;
-			}
+	if(logRequests || logPaths)
+		std::cout << "posix: SYMLINK " << req->path() << std::endl;
+
+	ViewPath relativeTo;
+	smarter::shared_ptr<File, FileHandle> file;
 
-			co_await sendErrorResponse(managarm::posix::Errors::SUCCESS);
-		}else if(preamble.id() == managarm::posix::LinkAtRequest::message_id) {
-			std::vector<std::byte> tail(preamble.tail_size());
-			auto [recv_tail] = co_await helix_ng::exchangeMsgs(
-					conversation,
-					helix_ng::recvBuffer(tail.data(), tail.size())
-				);
-			HEL_CHECK(recv_tail.error());
+	if (!req->path().size()) {
+		co_await sendErrorResponse(managarm::posix::Errors::ILLEGAL_ARGUMENTS);
+		co_return RequestResult::handled;
+	}
 
-			auto req = bragi::parse_head_tail<managarm::posix::LinkAtRequest>(recv_head, tail);
+	if(req->fd() == AT_FDCWD) {
+		relativeTo = self->fsContext()->getWorkingDirectory();
+	} else {
+		file = self->fileContext()->getFile(req->fd());
+		if (!file) {
+			co_await sendErrorResponse(managarm::posix::Errors::BAD_FD);
+			co_return RequestResult::handled;
+		}
 
-			if(logRequests)
-				std::cout << "posix: LINKAT" << std::endl;
+		relativeTo = {file->associatedMount(), file->associatedLink()};
+	}
 
-			if(req->flags() & ~(AT_EMPTY_PATH | AT_SYMLINK_FOLLOW)) {
-				co_await sendErrorResponse(managarm::posix::Errors::ILLEGAL_ARGUMENTS);
-				continue;
-			}
+	PathResolver resolver;
+	resolver.setup(self->fsContext()->getRoot(),
+			relativeTo, req->path(), self.get());
+	auto resolveResult = co_await resolver.resolve(
+			resolvePrefix | resolveNoTrailingSlash);
+	if(!resolveResult) {
+		if(resolveResult.error() == protocols::fs::Error::fileNotFound) {
+			co_await sendErrorResponse(managarm::posix::Errors::FILE_NOT_FOUND);
+			co_return RequestResult::handled;
+		} else if(resolveResult.error() == protocols::fs::Error::notDirectory) {
+			co_await sendErrorResponse(managarm::posix::Errors::NOT_A_DIRECTORY);
+			co_return RequestResult::handled;
+		} else {
+			std::cout << "posix: Unexpected failure from resolve()" << std::endl;
+			co_return RequestResult::abort;
+		}
+	}
 
-			if(req->flags() & AT_EMPTY_PATH) {
-				std::cout << "posix: AT_EMPTY_PATH is unimplemented for linkat" << std::endl;
-			}
+	auto parent = resolver.currentLink()->getTarget();
+	auto result = co_await parent->symlink(resolver.nextComponent(), req->target_path());
+	if(auto error = std::get_if<Error>(&result); error) {
+		if(*error == Error::alreadyExists) {
+			co_await sendErrorResponse(managarm::posix::Errors::ALREADY_EXISTS);
+			co_return RequestResult::handled;
+		} else {
+			assert(*error == Error::illegalOperationTarget);
+			co_await sendErrorResponse(managarm::posix::Errors::ILLEGAL_ARGUMENTS);
+			co_return RequestResult::handled;
+		}
+	}
+
+	managarm::posix::SvrResponse resp;
+	resp.set_error(managarm::posix::Errors::SUCCESS);
+
+	auto [sendResp] = co_await helix_ng::exchangeMsgs(
+		conversation,
+		helix_ng::sendBragiHeadOnly(resp, frg::stl_allocator{})
+	);
+	HEL_CHECK(sendResp.error());
+	co_return RequestResult::handled;
+}
+
+async::result<RequestResult> RequestContext::handleRenameAt() {
+	std::vector<std::byte> tail(preamble.tail_size());
+	auto [recv_tail] = co_await helix_ng::exchangeMsgs(
+			conversation,
+			helix_ng::recvBuffer(tail.data(), tail.size())
+		);
+	HEL_CHECK(recv_tail.error());
+
+	auto req = bragi::parse_head_tail<managarm::posix::RenameAtRequest>(recv_head, tail);
+
+	if (!req) {
+		std::cout << "posix: Rejecting request due to decoding failure" << std::endl;
+		co_return RequestResult::stop;
+	}
+
+	if(logRequests || logPaths)
+		std::cout << "posix: RENAMEAT " << req->path()
+				<< " to " << req->target_path() << std::endl;
+
+	ViewPath relative_to;
+	smarter::shared_ptr<File, FileHandle> file;
+
+	if (req->fd() == AT_FDCWD) {
+		relative_to = self->fsContext()->getWorkingDirectory();
+	} else {
+		file = self->fileContext()->getFile(req->fd());
+
+		if (!file) {
+			co_await sendErrorResponse(managarm::posix::Errors::BAD_FD);
+			co_return RequestResult::handled;
+		}
+
+		relative_to = {file->associatedMount(), file->associatedLink()};
+	}
+
+	PathResolver resolver;
+	resolver.setup(self->fsContext()->getRoot(),
+			relative_to, req->path(), self.get());
+	auto resolveResult = co_await resolver.resolve();
+	if(!resolveResult) {
+		if(resolveResult.error() == protocols::fs::Error::isDirectory) {
+			co_await sendErrorResponse(managarm::posix::Errors::IS_DIRECTORY);
+			co_return RequestResult::handled;
+		} else if(resolveResult.error() == protocols::fs::Error::fileNotFound) {
+			co_await sendErrorResponse(managarm::posix::Errors::FILE_NOT_FOUND);
+			co_return RequestResult::handled;
+		} else if(resolveResult.error() == protocols::fs::Error::notDirectory) {
+			co_await sendErrorResponse(managarm::posix::Errors::NOT_A_DIRECTORY);
+			co_return RequestResult::handled;
+		} else {
+			std::cout << "posix: Unexpected failure from resolve()" << std::endl;
+			co_return RequestResult::abort;
+		}
+	}
+
+	if (req->newfd() == AT_FDCWD) {
+		relative_to = self->fsContext()->getWorkingDirectory();
+	} else {
+		file = self->fileContext()->getFile(req->newfd());
+
+		if (!file) {
+			co_await sendErrorResponse(managarm::posix::Errors::BAD_FD);
+			co_return RequestResult::handled;
+		}
+
+		relative_to = {file->associatedMount(), file->associatedLink()};
+	}
+
+	// TODO: Add resolveNoTrailingSlash if source is not a directory?
+	PathResolver new_resolver;
+	new_resolver.setup(self->fsContext()->getRoot(),
+			relative_to, req->target_path(), self.get());
+	auto new_resolveResult = co_await new_resolver.resolve(resolvePrefix);
+	if(!new_resolveResult) {
+		if(new_resolveResult.error() == protocols::fs::Error::isDirectory) {
+			co_await sendErrorResponse(managarm::posix::Errors::IS_DIRECTORY);
+			co_return RequestResult::handled;
+		} else if(new_resolveResult.error() == protocols::fs::Error::fileNotFound) {
+			co_await sendErrorResponse(managarm::posix::Errors::FILE_NOT_FOUND);
+			co_return RequestResult::handled;
+		} else if(new_resolveResult.error() == protocols::fs::Error::notDirectory) {
+			co_await sendErrorResponse(managarm::posix::Errors::NOT_A_DIRECTORY);
+			co_return RequestResult::handled;
+		} else {
+			std::cout << "posix: Unexpected failure from resolve()" << std::endl;
+			co_return RequestResult::abort;
+		}
+	}
+
+	auto superblock = resolver.currentLink()->getTarget()->superblock();
+	auto directory = new_resolver.currentLink()->getTarget();
+	assert(superblock == directory->superblock());
+	auto result = co_await superblock->rename(resolver.currentLink().get(),
+			directory.get(), new_resolver.nextComponent());
+	if(!result) {
+		assert(result.error() == Error::alreadyExists);
+		co_await sendErrorResponse(managarm::posix::Errors::ALREADY_EXISTS);
+		co_return RequestResult::handled;
+	}
+
+	co_await sendErrorResponse(managarm::posix::Errors::SUCCESS);
+	co_return RequestResult::handled;
+}
+
+async::result<RequestResult> RequestContext::handleFstatAt() {
+	std::vector<std::byte> tail(preamble.tail_size());
+	auto [recv_tail] = co_await helix_ng::exchangeMsgs(
+			conversation,
+			helix_ng::recvBuffer(tail.data(), tail.size())
+		);
+	HEL_CHECK(recv_tail.error());
+
+	auto req = bragi::parse_head_tail<managarm::posix::FstatAtRequest>(recv_head, tail);
+
+	if (!req) {
+		std::cout << "posix: Rejecting request due to decoding failure" << std::endl;
+		co_return RequestResult::stop;
+	}
+
+	if(logRequests)
+		std::cout << "posix: FSTATAT request" << std::endl;
+
+	ViewPath relative_to;
+	smarter::shared_ptr<File, FileHandle> file;
+	std::shared_ptr<FsLink> target_link;
+
+	if (req->fd() == AT_FDCWD) {
+		relative_to = self->fsContext()->getWorkingDirectory();
+	} else {
+		file = self->fileContext()->getFile(req->fd());
+
+		if (!file) {
+			co_await sendErrorResponse(managarm::posix::Errors::BAD_FD);
+			co_return RequestResult::handled;
+		}
+
+		relative_to = {file->associatedMount(), file->associatedLink()};
+	}
 
-			if(req->flags() & AT_SYMLINK_FOLLOW) {
-				std::cout << "posix: AT_SYMLINK_FOLLOW is unimplemented for linkat" << std::endl;
-			}
+	if (req->flags() & AT_EMPTY_PATH) {
+		target_link = file->associatedLink();
+	} else {
+		PathResolver resolver;
+		resolver.setup(self->fsContext()->getRoot(),
+				relative_to, req->path(), self.get());
 
-			ViewPath relative_to;
-			smarter::shared_ptr<File, FileHandle> file;
+		ResolveFlags resolveFlags = 0;
+		if (req->flags() & AT_SYMLINK_NOFOLLOW)
+		    resolveFlags |= resolveDontFollow;
 
-			if(req->fd() == AT_FDCWD) {
-				relative_to = self->fsContext()->getWorkingDirectory();
+		auto resolveResult = co_await resolver.resolve(resolveFlags);
+		if(!resolveResult) {
+			if(resolveResult.error() == protocols::fs::Error::fileNotFound) {
+				co_await sendErrorResponse(managarm::posix::Errors::FILE_NOT_FOUND);
+				co_return RequestResult::handled;
+			} else if(resolveResult.error() == protocols::fs::Error::notDirectory) {
+				co_await sendErrorResponse(managarm::posix::Errors::NOT_A_DIRECTORY);
+				co_return RequestResult::handled;
 			} else {
-				file = self->fileContext()->getFile(req->fd());
+				std::cout << "posix: Unexpected failure from resolve()" << std::endl;
+				co_return RequestResult::abort;
+			}
+		}
 
-				if(!file) {
-					co_await sendErrorResponse(managarm::posix::Errors::BAD_FD);
-					continue;
-				}
+		target_link = resolver.currentLink();
+	}
 
-				relative_to = {file->associatedMount(), file->associatedLink()};
-			}
+	// This catches cases where associatedLink is called on a file, but the file doesn't implement that.
+	// Instead of blowing up, return ENOENT.
+	if(target_link == nullptr) {
+		co_await sendErrorResponse(managarm::posix::Errors::FILE_NOT_FOUND);
+		co_return RequestResult::handled;
+	}
 
-			PathResolver resolver;
-			resolver.setup(self->fsContext()->getRoot(),
-					relative_to, req->path(), self.get());
-			auto resolveResult = co_await resolver.resolve();
-			if(!resolveResult) {
-				if(resolveResult.error() == protocols::fs::Error::fileNotFound) {
-					co_await sendErrorResponse(managarm::posix::Errors::FILE_NOT_FOUND);
-					continue;
-				} else if(resolveResult.error() == protocols::fs::Error::notDirectory) {
-					co_await sendErrorResponse(managarm::posix::Errors::NOT_A_DIRECTORY);
-					continue;
-				} else {
-					std::cout << "posix: Unexpected failure from resolve()" << std::endl;
-					co_return;
-				}
-			}
+	auto statsResult = co_await target_link->getTarget()->getStats();
+	assert(statsResult);
+	auto stats = statsResult.value();
+
+	managarm::posix::SvrResponse resp;
+	resp.set_error(managarm::posix::Errors::SUCCESS);
+
+	DeviceId devnum;
+	switch(target_link->getTarget()->getType()) {
+	case VfsType::regular:
+		resp.set_file_type(managarm::posix::FileType::FT_REGULAR);
+		break;
+	case VfsType::directory:
+		resp.set_file_type(managarm::posix::FileType::FT_DIRECTORY);
+		break;
+	case VfsType::symlink:
+		resp.set_file_type(managarm::posix::FileType::FT_SYMLINK);
+		break;
+	case VfsType::charDevice:
+		resp.set_file_type(managarm::posix::FileType::FT_CHAR_DEVICE);
+		devnum = target_link->getTarget()->readDevice();
+		resp.set_ref_devnum(makedev(devnum.first, devnum.second));
+		break;
+	case VfsType::blockDevice:
+		resp.set_file_type(managarm::posix::FileType::FT_BLOCK_DEVICE);
+		devnum = target_link->getTarget()->readDevice();
+		resp.set_ref_devnum(makedev(devnum.first, devnum.second));
+		break;
+	case VfsType::socket:
+		resp.set_file_type(managarm::posix::FileType::FT_SOCKET);
+		break;
+	case VfsType::fifo:
+		resp.set_file_type(managarm::posix::FileType::FT_FIFO);
+		break;
+	default:
+		assert(target_link->getTarget()->getType() == VfsType::null);
+	}
 
-			if (req->newfd() == AT_FDCWD) {
-				relative_to = self->fsContext()->getWorkingDirectory();
-			} else {
-				file = self->fileContext()->getFile(req->newfd());
+	if(stats.mode & ~0xFFFu)
+		std::cout << "\e[31m" "posix: FsNode::getStats() returned illegal mode of "
+				<< stats.mode << "\e[39m" << std::endl;
+
+	resp.set_fs_inode(stats.inodeNumber);
+	resp.set_mode(stats.mode);
+	resp.set_num_links(stats.numLinks);
+	resp.set_uid(stats.uid);
+	resp.set_gid(stats.gid);
+	resp.set_file_size(stats.fileSize);
+	resp.set_atime_secs(stats.atimeSecs);
+	resp.set_atime_nanos(stats.atimeNanos);
+	resp.set_mtime_secs(stats.mtimeSecs);
+	resp.set_mtime_nanos(stats.mtimeNanos);
+	resp.set_ctime_secs(stats.ctimeSecs);
+	resp.set_ctime_nanos(stats.ctimeNanos);
+
+	auto [send_resp] = co_await helix_ng::exchangeMsgs(
+			conversation,
+			helix_ng::sendBragiHeadOnly(resp, frg::stl_allocator{})
+		);
+
+	HEL_CHECK(send_resp.error());
+	co_return RequestResult::handled;
+}
 
-				if(!file) {
-					co_await sendErrorResponse(managarm::posix::Errors::BAD_FD);
-					continue;
-				}
+async::result<RequestResult> RequestContext::handleFchmodAt() {
+	std::vector<std::byte> tail(preamble.tail_size());
+	auto [recv_tail] = co_await helix_ng::exchangeMsgs(
+			conversation,
+			helix_ng::recvBuffer(tail.data(), tail.size())
+		);
+	HEL_CHECK(recv_tail.error());
 
-				relative_to = {file->associatedMount(), file->associatedLink()};
-			}
+	auto req = bragi::parse_head_tail<managarm::posix::FchmodAtRequest>(recv_head, tail);
 
-			PathResolver new_resolver;
-			new_resolver.setup(self->fsContext()->getRoot(),
-					relative_to, req->target_path(), self.get());
-			auto new_resolveResult = co_await new_resolver.resolve(
-					resolvePrefix | resolveNoTrailingSlash);
-			if(!new_resolveResult) {
-				if(new_resolveResult.error() == protocols::fs::Error::illegalOperationTarget) {
-					co_await sendErrorResponse(managarm::posix::Errors::ILLEGAL_OPERATION_TARGET);
-					continue;
-				} else if(new_resolveResult.error() == protocols::fs::Error::fileNotFound) {
-					co_await sendErrorResponse(managarm::posix::Errors::FILE_NOT_FOUND);
-					continue;
-				} else if(new_resolveResult.error() == protocols::fs::Error::notDirectory) {
-					co_await sendErrorResponse(managarm::posix::Errors::NOT_A_DIRECTORY);
-					continue;
-				} else {
-					std::cout << "posix: Unexpected failure from resolve()" << std::endl;
-					co_return;
-				}
-			}
+	if(logRequests)
+		std::cout << "posix: FCHMODAT request" << std::endl;
 
-			auto target = resolver.currentLink()->getTarget();
-			auto directory = new_resolver.currentLink()->getTarget();
-			assert(target->superblock() == directory->superblock()); // Hard links across mount points are not allowed, return EXDEV
-			auto result = co_await directory->link(new_resolver.nextComponent(), target);
-			if(!result) {
-				std::cout << "posix: Unexpected failure from link()" << std::endl;
-				co_return;
-			}
+	ViewPath relative_to;
+	smarter::shared_ptr<File, FileHandle> file;
+	std::shared_ptr<FsLink> target_link;
 
-			co_await sendErrorResponse(managarm::posix::Errors::SUCCESS);
-		}else if(preamble.id() == managarm::posix::SymlinkAtRequest::message_id) {
-			std::vector<std::byte> tail(preamble.tail_size());
-			auto [recv_tail] = co_await helix_ng::exchangeMsgs(
-					conversation,
-					helix_ng::recvBuffer(tail.data(), tail.size())
-				);
-			HEL_CHECK(recv_tail.error());
+	if(req->fd() == AT_FDCWD) {
+		relative_to = self->fsContext()->getWorkingDirectory();
+	} else {
+		file = self->fileContext()->getFile(req->fd());
 
-			auto req = bragi::parse_head_tail<managarm::posix::SymlinkAtRequest>(recv_head, tail);
+		if (!file) {
+			co_await sendErrorResponse(managarm::posix::Errors::BAD_FD);
+			co_return RequestResult::handled;
+		}
 
-			if (!req) {
-				std::cout << "posix: Rejecting request due to decoding failure" << std::endl;
-				break;
-			}
+		relative_to = {file->associatedMount(), file->associatedLink()};
+	}
 
-			if(logRequests || logPaths)
-				std::cout << "posix: SYMLINK " << req->path() << std::endl;
+	if(req->flags()) {
+		if(req->flags() & AT_SYMLINK_NOFOLLOW) {
+			co_await sendErrorResponse(managarm::posix::Errors::NOT_SUPPORTED);
+			co_return RequestResult::handled;
+		} else if(req->flags() & AT_EMPTY_PATH) {
+			// Allowed, managarm extension
+		} else {
+			co_await sendErrorResponse(managarm::posix::Errors::ILLEGAL_ARGUMENTS);
+			co_return RequestResult::handled;
+		}
+	}
 
-			ViewPath relativeTo;
-			smarter::shared_ptr<File, FileHandle> file;
+	if(req->flags() & AT_EMPTY_PATH) {
+		target_link = file->associatedLink();
+	} else {
+		PathResolver resolver;
+		resolver.setup(self->fsContext()->getRoot(),
+			relative_to, req->path(), self.get());
 
-			if (!req->path().size()) {
-				co_await sendErrorResponse(managarm::posix::Errors::ILLEGAL_ARGUMENTS);
-				continue;
-			}
+		auto resolveResult = co_await resolver.resolve();
 
-			if(req->fd() == AT_FDCWD) {
-				relativeTo = self->fsContext()->getWorkingDirectory();
+		if(!resolveResult) {
+			if(resolveResult.error() == protocols::fs::Error::fileNotFound) {
+				co_await sendErrorResponse(managarm::posix::Errors::FILE_NOT_FOUND);
+				co_return RequestResult::handled;
+			} else if(resolveResult.error() == protocols::fs::Error::notDirectory) {
+				co_await sendErrorResponse(managarm::posix::Errors::NOT_A_DIRECTORY);
+				co_return RequestResult::handled;
 			} else {
-				file = self->fileContext()->getFile(req->fd());
-				if (!file) {
-					co_await sendErrorResponse(managarm::posix::Errors::BAD_FD);
-					continue;
-				}
-
-				relativeTo = {file->associatedMount(), file->associatedLink()};
+				std::cout << "posix: Unexpected failure from resolve()" << std::endl;
+				co_return RequestResult::abort;
 			}
+		}
 
-			PathResolver resolver;
-			resolver.setup(self->fsContext()->getRoot(),
-					relativeTo, req->path(), self.get());
-			auto resolveResult = co_await resolver.resolve(
-					resolvePrefix | resolveNoTrailingSlash);
-			if(!resolveResult) {
-				if(resolveResult.error() == protocols::fs::Error::fileNotFound) {
-					co_await sendErrorResponse(managarm::posix::Errors::FILE_NOT_FOUND);
-					continue;
-				} else if(resolveResult.error() == protocols::fs::Error::notDirectory) {
-					co_await sendErrorResponse(managarm::posix::Errors::NOT_A_DIRECTORY);
-					continue;
-				} else {
-					std::cout << "posix: Unexpected failure from resolve()" << std::endl;
-					co_return;
-				}
-			}
+		target_link = resolver.currentLink();
+	}
 
-			auto parent = resolver.currentLink()->getTarget();
-			auto result = co_await parent->symlink(resolver.nextComponent(), req->target_path());
-			if(auto error = std::get_if<Error>(&result); error) {
-				if(*error == Error::alreadyExists) {
-					co_await sendErrorResponse(managarm::posix::Errors::ALREADY_EXISTS);
-					continue;
-				} else {
-					assert(*error == Error::illegalOperationTarget);
-					co_await sendErrorResponse(managarm::posix::Errors::ILLEGAL_ARGUMENTS);
-					continue;
-				}
-			}
+	co_await target_link->getTarget()->chmod(req->mode());
 
-			managarm::posix::SvrResponse resp;
-			resp.set_error(managarm::posix::Errors::SUCCESS);
+	co_await sendErrorResponse(managarm::posix::Errors::SUCCESS);
+	co_return RequestResult::handled;
+}
 
-			auto [sendResp] = co_await helix_ng::exchangeMsgs(
-				conversation,
-				helix_ng::sendBragiHeadOnly(resp, frg::stl_allocator{})
-			);
-			HEL_CHECK(sendResp.error());
-		}else if(preamble.id() == managarm::posix::RenameAtRequest::message_id) {
-			std::vector<std::byte> tail(preamble.tail_size());
-			auto [recv_tail] = co_await helix_ng::exchangeMsgs(
-					conversation,
-					helix_ng::recvBuffer(tail.data(), tail.size())
-				);
-			HEL_CHECK(recv_tail.error());
-
-			auto req = bragi::parse_head_tail<managarm::posix::RenameAtRequest>(recv_head, tail);
-
-			if (!req) {
-				std::cout << "posix: Rejecting request due to decoding failure" << std::endl;
-				break;
-			}
+async::result<RequestResult> RequestContext::handleUtimensAt() {
+	std::vector<std::byte> tail(preamble.tail_size());
+	auto [recv_tail] = co_await helix_ng::exchangeMsgs(
+			conversation,
+			helix_ng::recvBuffer(tail.data(), tail.size())
+		);
+	HEL_CHECK(recv_tail.error());
 
-			if(logRequests || logPaths)
-				std::cout << "posix: RENAMEAT " << req->path()
-						<< " to " << req->target_path() << std::endl;
+	auto req = bragi::parse_head_tail<managarm::posix::UtimensAtRequest>(recv_head, tail);
 
-			ViewPath relative_to;
-			smarter::shared_ptr<File, FileHandle> file;
+	if (!req) {
+		std::cout << "posix: Rejecting request due to decoding failure" << std::endl;
+		co_return RequestResult::stop;
+	}
 
-			if (req->fd() == AT_FDCWD) {
-				relative_to = self->fsContext()->getWorkingDirectory();
-			} else {
-				file = self->fileContext()->getFile(req->fd());
+	if(logRequests || logPaths)
+		std::cout << "posix: UTIMENSAT " << req->path() << std::endl;
 
-				if (!file) {
-					co_await sendErrorResponse(managarm::posix::Errors::BAD_FD);
-					continue;
-				}
+	ViewPath relativeTo;
+	smarter::shared_ptr<File, FileHandle> file;
+	std::shared_ptr<FsNode> target = nullptr;
 
-				relative_to = {file->associatedMount(), file->associatedLink()};
-			}
+	if(!req->path().size()) {
+		target = self->fileContext()->getFile(req->fd())->associatedLink()->getTarget();
+	} else {
+		if(req->flags() & ~AT_SYMLINK_NOFOLLOW) {
+			co_await sendErrorResponse(managarm::posix::Errors::ILLEGAL_ARGUMENTS);
+			co_return RequestResult::handled;
+		}
 
-			PathResolver resolver;
-			resolver.setup(self->fsContext()->getRoot(),
-					relative_to, req->path(), self.get());
-			auto resolveResult = co_await resolver.resolve();
-			if(!resolveResult) {
-				if(resolveResult.error() == protocols::fs::Error::isDirectory) {
-					co_await sendErrorResponse(managarm::posix::Errors::IS_DIRECTORY);
-					continue;
-				} else if(resolveResult.error() == protocols::fs::Error::fileNotFound) {
-					co_await sendErrorResponse(managarm::posix::Errors::FILE_NOT_FOUND);
-					continue;
-				} else if(resolveResult.error() == protocols::fs::Error::notDirectory) {
-					co_await sendErrorResponse(managarm::posix::Errors::NOT_A_DIRECTORY);
-					continue;
-				} else {
-					std::cout << "posix: Unexpected failure from resolve()" << std::endl;
-					co_return;
-				}
-			}
+		ResolveFlags resolveFlags = 0;
+		if(req->flags() & AT_SYMLINK_NOFOLLOW) {
+			resolveFlags |= resolveDontFollow;
+		}
 
-			if (req->newfd() == AT_FDCWD) {
-				relative_to = self->fsContext()->getWorkingDirectory();
-			} else {
-				file = self->fileContext()->getFile(req->newfd());
+		if(req->fd() == AT_FDCWD) {
+			relativeTo = self->fsContext()->getWorkingDirectory();
+		} else {
+			file = self->fileContext()->getFile(req->fd());
+			if (!file) {
+				co_await sendErrorResponse(managarm::posix::Errors::BAD_FD);
+				co_return RequestResult::handled;
+			}
 
-				if (!file) {
-					co_await sendErrorResponse(managarm::posix::Errors::BAD_FD);
-					continue;
-				}
+			relativeTo = {file->associatedMount(), file->associatedLink()};
+		}
 
-				relative_to = {file->associatedMount(), file->associatedLink()};
+		PathResolver resolver;
+		resolver.setup(self->fsContext()->getRoot(),
+				relativeTo, req->path(), self.get());
+		auto resolveResult = co_await resolver.resolve(resolveFlags);
+		if(!resolveResult) {
+			if(resolveResult.error() == protocols::fs::Error::fileNotFound) {
+				co_await sendErrorResponse(managarm::posix::Errors::FILE_NOT_FOUND);
+				co_return RequestResult::handled;
+			} else if(resolveResult.error() == protocols::fs::Error::notDirectory) {
+				co_await sendErrorResponse(managarm::posix::Errors::NOT_A_DIRECTORY);
+				co_return RequestResult::handled;
+			} else {
+				std::cout << "posix: Unexpected failure from resolve()" << std::endl;
+				co_return RequestResult::abort;
 			}
+		}
 
-			// TODO: Add resolveNoTrailingSlash if source is not a directory?
-			PathResolver new_resolver;
-			new_resolver.setup(self->fsContext()->getRoot(),
-					relative_to, req->target_path(), self.get());
-			auto new_resolveResult = co_await new_resolver.resolve(resolvePrefix);
-			if(!new_resolveResult) {
-				if(new_resolveResult.error() == protocols::fs::Error::isDirectory) {
-					co_await sendErrorResponse(managarm::posix::Errors::IS_DIRECTORY);
-					continue;
-				} else if(new_resolveResult.error() == protocols::fs::Error::fileNotFound) {
-					co_await sendErrorResponse(managarm::posix::Errors::FILE_NOT_FOUND);
-					continue;
-				} else if(new_resolveResult.error() == protocols::fs::Error::notDirectory) {
-					co_await sendErrorResponse(managarm::posix::Errors::NOT_A_DIRECTORY);
-					continue;
-				} else {
-					std::cout << "posix: Unexpected failure from resolve()" << std::endl;
-					co_return;
-				}
-			}
+		target = resolver.currentLink()->getTarget();
+	}
 
-			auto superblock = resolver.currentLink()->getTarget()->superblock();
-			auto directory = new_resolver.currentLink()->getTarget();
-			assert(superblock == directory->superblock());
-			auto result = co_await superblock->rename(resolver.currentLink().get(),
-					directory.get(), new_resolver.nextComponent());
-			if(!result) {
-				assert(result.error() == Error::alreadyExists);
-				co_await sendErrorResponse(managarm::posix::Errors::ALREADY_EXISTS);
-				continue;
-			}
+	co_await target->utimensat(req->atimeSec(), req->atimeNsec(), req->mtimeSec(), req->mtimeNsec());
 
-			co_await sendErrorResponse(managarm::posix::Errors::SUCCESS);
-		}else if(preamble.id() == managarm::posix::FstatAtRequest::message_id) {
-			std::vector<std::byte> tail(preamble.tail_size());
-			auto [recv_tail] = co_await helix_ng::exchangeMsgs(
-					conversation,
-					helix_ng::recvBuffer(tail.data(), tail.size())
-				);
-			HEL_CHECK(recv_tail.error());
+	co_await sendErrorResponse(managarm::posix::Errors::SUCCESS);
+	co_return RequestResult::handled;
+}
 
-			auto req = bragi::parse_head_tail<managarm::posix::FstatAtRequest>(recv_head, tail);
+async::result<RequestResult> RequestContext::handleReadlinkAt() {
+	std::vector<std::byte> tail(preamble.tail_size());
+	auto [recvTail] = co_await helix_ng::exchangeMsgs(
+			conversation,
+			helix_ng::recvBuffer(tail.data(), tail.size())
+		);
+	HEL_CHECK(recvTail.error());
+
+	auto req = bragi::parse_head_tail<managarm::posix::ReadlinkAtRequest>(recv_head, tail);
+	if (!req) {
+		std::cout << "posix: Rejecting request due to decoding failure" << std::endl;
+		co_return RequestResult::stop;
+	}
 
-			if (!req) {
-				std::cout << "posix: Rejecting request due to decoding failure" << std::endl;
-				break;
-			}
+	if(logRequests || logPaths)
+		std::cout << "posix: READLINKAT path: " << req->path() << std::endl;
 
-			if(logRequests)
-				std::cout << "posix: FSTATAT request" << std::endl;
+	helix::SendBuffer send_resp;
+	helix::SendBuffer send_data;
 
-			ViewPath relative_to;
-			smarter::shared_ptr<File, FileHandle> file;
-			std::shared_ptr<FsLink> target_link;
+	ViewPath relative_to;
+	smarter::shared_ptr<File, FileHandle> file;
 
-			if (req->fd() == AT_FDCWD) {
-				relative_to = self->fsContext()->getWorkingDirectory();
-			} else {
-				file = self->fileContext()->getFile(req->fd());
+	if(req->fd() == AT_FDCWD) {
+		relative_to = self->fsContext()->getWorkingDirectory();
+	} else {
+		file = self->fileContext()->getFile(req->fd());
 
-				if (!file) {
-					co_await sendErrorResponse(managarm::posix::Errors::BAD_FD);
-					continue;
-				}
+		if (!file) {
+			co_await sendErrorResponse(managarm::posix::Errors::BAD_FD);
+			co_return RequestResult::handled;
+		}
 
-				relative_to = {file->associatedMount(), file->associatedLink()};
-			}
+		relative_to = {file->associatedMount(), file->associatedLink()};
+	}
 
-			if (req->flags() & AT_EMPTY_PATH) {
-				target_link = file->associatedLink();
-			} else {
-				PathResolver resolver;
-				resolver.setup(self->fsContext()->getRoot(),
-						relative_to, req->path(), self.get());
-
-				ResolveFlags resolveFlags = 0;
-				if (req->flags() & AT_SYMLINK_NOFOLLOW)
-				    resolveFlags |= resolveDontFollow;
-
-				auto resolveResult = co_await resolver.resolve(resolveFlags);
-				if(!resolveResult) {
-					if(resolveResult.error() == protocols::fs::Error::fileNotFound) {
-						co_await sendErrorResponse(managarm::posix::Errors::FILE_NOT_FOUND);
-						continue;
-					} else if(resolveResult.error() == protocols::fs::Error::notDirectory) {
-						co_await sendErrorResponse(managarm::posix::Errors::NOT_A_DIRECTORY);
-						continue;
-					} else {
-						std::cout << "posix: Unexpected failure from resolve()" << std::endl;
-						co_return;
-					}
-				}
+	auto pathResult = co_await resolve(self->fsContext()->getRoot(),
+			relative_to, req->path(), self.get(), resolveDontFollow);
+	if(!pathResult) {
+		if(pathResult.error() == protocols::fs::Error::fileNotFound) {
+			managarm::posix::SvrResponse resp;
+			resp.set_error(managarm::posix::Errors::FILE_NOT_FOUND);
 
-				target_link = resolver.currentLink();
-			}
+			auto ser = resp.SerializeAsString();
+			auto &&transmit = helix::submitAsync(conversation, helix::Dispatcher::global(),
+					helix::action(&send_resp, ser.data(), ser.size(), kHelItemChain),
+					helix::action(&send_data, nullptr, 0));
+			co_await transmit.async_wait();
+			HEL_CHECK(send_resp.error());
+			co_return RequestResult::handled;
+		} else if(pathResult.error() == protocols::fs::Error::notDirectory) {
+			managarm::posix::SvrResponse resp;
+			resp.set_error(managarm::posix::Errors::NOT_A_DIRECTORY);
 
-			// This catches cases where associatedLink is called on a file, but the file doesn't implement that.
-			// Instead of blowing up, return ENOENT.
-			if(target_link == nullptr) {
-				co_await sendErrorResponse(managarm::posix::Errors::FILE_NOT_FOUND);
-				continue;
-			}
+			auto ser = resp.SerializeAsString();
+			auto &&transmit = helix::submitAsync(conversation, helix::Dispatcher::global(),
+					helix::action(&send_resp, ser.data(), ser.size(), kHelItemChain),
+					helix::action(&send_data, nullptr, 0));
+			co_await transmit.async_wait();
+			HEL_CHECK(send_resp.error());
+			co_return RequestResult::handled;
+		} else {
+			std::cout << "posix: Unexpected failure from resolve()" << std::endl;
+			co_return RequestResult::abort;
+		}
+	}
+	auto path = pathResult.value();
+
+	auto result = co_await path.second->getTarget()->readSymlink(path.second.get(), self.get());
+	if(auto error = std::get_if<Error>(&result); error) {
+		assert(*error == Error::illegalOperationTarget);
+
+		managarm::posix::SvrResponse resp;
+		resp.set_error(managarm::posix::Errors::ILLEGAL_ARGUMENTS);
+
+		auto ser = resp.SerializeAsString();
+		auto &&transmit = helix::submitAsync(conversation, helix::Dispatcher::global(),
+				helix::action(&send_resp, ser.data(), ser.size(), kHelItemChain),
+				helix::action(&send_data, nullptr, 0));
+		co_await transmit.async_wait();
+		HEL_CHECK(send_resp.error());
+	}else{
+		auto &target = std::get<std::string>(result);
+
+		managarm::posix::SvrResponse resp;
+		resp.set_error(managarm::posix::Errors::SUCCESS);
+
+		auto ser = resp.SerializeAsString();
+		auto &&transmit = helix::submitAsync(conversation, helix::Dispatcher::global(),
+				helix::action(&send_resp, ser.data(), ser.size(), kHelItemChain),
+				helix::action(&send_data, target.data(), target.size()));
+		co_await transmit.async_wait();
+		HEL_CHECK(send_resp.error());
+	}
+	co_return RequestResult::handled;
+}
 
-			auto statsResult = co_await target_link->getTarget()->getStats();
-			assert(statsResult);
-			auto stats = statsResult.value();
+async::result<RequestResult> RequestContext::handleOpenAt() {
+	std::vector<std::byte> tail(preamble.tail_size());
+	auto [recvTail] = co_await helix_ng::exchangeMsgs(
+			conversation,
+			helix_ng::recvBuffer(tail.data(), tail.size())
+		);
+	HEL_CHECK(recvTail.error());
+
+	auto req = bragi::parse_head_tail<managarm::posix::OpenAtRequest>(recv_head, tail);
+	if (!req) {
+		std::cout << "posix: Rejecting request due to decoding failure" << std::endl;
+		co_return RequestResult::stop;
+	}
+	if(logRequests || logPaths)
+		std::cout << "posix: OPENAT path: " << req->path() << std::endl;
+
+	if((req->flags() & ~(managarm::posix::OpenFlags::OF_CREATE
+			| managarm::posix::OpenFlags::OF_EXCLUSIVE
+			| managarm::posix::OpenFlags::OF_NONBLOCK
+			| managarm::posix::OpenFlags::OF_CLOEXEC
+			| managarm::posix::OpenFlags::OF_TRUNC
+			| managarm::posix::OpenFlags::OF_RDONLY
+			| managarm::posix::OpenFlags::OF_WRONLY
+			| managarm::posix::OpenFlags::OF_RDWR
+			| managarm::posix::OpenFlags::OF_PATH
+			| managarm::posix::OpenFlags::OF_NOCTTY
+			| managarm::posix::OpenFlags::OF_APPEND))) {
+		std::cout << "posix: OPENAT flags not recognized: " << req->flags() << std::endl;
+		co_await sendErrorResponse(managarm::posix::Errors::ILLEGAL_ARGUMENTS);
+		co_return RequestResult::handled;
+	}
 
-			managarm::posix::SvrResponse resp;
-			resp.set_error(managarm::posix::Errors::SUCCESS);
+	SemanticFlags semantic_flags = 0;
+	if(req->flags() & managarm::posix::OpenFlags::OF_NONBLOCK)
+		semantic_flags |= semanticNonBlock;
 
-			DeviceId devnum;
-			switch(target_link->getTarget()->getType()) {
-			case VfsType::regular:
-				resp.set_file_type(managarm::posix::FileType::FT_REGULAR);
-				break;
-			case VfsType::directory:
-				resp.set_file_type(managarm::posix::FileType::FT_DIRECTORY);
-				break;
-			case VfsType::symlink:
-				resp.set_file_type(managarm::posix::FileType::FT_SYMLINK);
-				break;
-			case VfsType::charDevice:
-				resp.set_file_type(managarm::posix::FileType::FT_CHAR_DEVICE);
-				devnum = target_link->getTarget()->readDevice();
-				resp.set_ref_devnum(makedev(devnum.first, devnum.second));
-				break;
-			case VfsType::blockDevice:
-				resp.set_file_type(managarm::posix::FileType::FT_BLOCK_DEVICE);
-				devnum = target_link->getTarget()->readDevice();
-				resp.set_ref_devnum(makedev(devnum.first, devnum.second));
-				break;
-			case VfsType::socket:
-				resp.set_file_type(managarm::posix::FileType::FT_SOCKET);
-				break;
-			case VfsType::fifo:
-				resp.set_file_type(managarm::posix::FileType::FT_FIFO);
-				break;
-			default:
-				assert(target_link->getTarget()->getType() == VfsType::null);
-			}
+	if (req->flags() & managarm::posix::OpenFlags::OF_RDONLY)
+		semantic_flags |= semanticRead;
+	else if (req->flags() & managarm::posix::OpenFlags::OF_WRONLY)
+		semantic_flags |= semanticWrite;
+	else if (req->flags() & managarm::posix::OpenFlags::OF_RDWR)
+		semantic_flags |= semanticRead | semanticWrite;
 
-			if(stats.mode & ~0xFFFu)
-				std::cout << "\e[31m" "posix: FsNode::getStats() returned illegal mode of "
-						<< stats.mode << "\e[39m" << std::endl;
-
-			resp.set_fs_inode(stats.inodeNumber);
-			resp.set_mode(stats.mode);
-			resp.set_num_links(stats.numLinks);
-			resp.set_uid(stats.uid);
-			resp.set_gid(stats.gid);
-			resp.set_file_size(stats.fileSize);
-			resp.set_atime_secs(stats.atimeSecs);
-			resp.set_atime_nanos(stats.atimeNanos);
-			resp.set_mtime_secs(stats.mtimeSecs);
-			resp.set_mtime_nanos(stats.mtimeNanos);
-			resp.set_ctime_secs(stats.ctimeSecs);
-			resp.set_ctime_nanos(stats.ctimeNanos);
-
-			auto [send_resp] = co_await helix_ng::exchangeMsgs(
-					conversation,
-					helix_ng::sendBragiHeadOnly(resp, frg::stl_allocator{})
-				);
+	if(req->flags() & managarm::posix::OpenFlags::OF_APPEND)
+		semantic_flags |= semanticAppend;
 
-			HEL_CHECK(send_resp.error());
-		}else if(preamble.id() == managarm::posix::FchmodAtRequest::message_id) {
-			std::vector<std::byte> tail(preamble.tail_size());
-			auto [recv_tail] = co_await helix_ng::exchangeMsgs(
-					conversation,
-					helix_ng::recvBuffer(tail.data(), tail.size())
-				);
-			HEL_CHECK(recv_tail.error());
+	ViewPath relative_to;
+	smarter::shared_ptr<File, FileHandle> file;
+	std::shared_ptr<FsLink> target_link;
 
-			auto req = bragi::parse_head_tail<managarm::posix::FchmodAtRequest>(recv_head, tail);
+	if(req->fd() == AT_FDCWD) {
+		relative_to = self->fsContext()->getWorkingDirectory();
+	} else {
+		file = self->fileContext()->getFile(req->fd());
 
-			if(logRequests)
-				std::cout << "posix: FCHMODAT request" << std::endl;
+		if (!file) {
+			co_await sendErrorResponse(managarm::posix::Errors::BAD_FD);
+			co_return RequestResult::handled;
+		}
 
-			ViewPath relative_to;
-			smarter::shared_ptr<File, FileHandle> file;
-			std::shared_ptr<FsLink> target_link;
+		relative_to = {file->associatedMount(), file->associatedLink()};
+	}
 
-			if(req->fd() == AT_FDCWD) {
-				relative_to = self->fsContext()->getWorkingDirectory();
+	PathResolver resolver;
+	resolver.setup(self->fsContext()->getRoot(),
+			relative_to, req->path(), self.get());
+	if(req->flags() & managarm::posix::OpenFlags::OF_CREATE) {
+		auto resolveResult = co_await resolver.resolve(
+				resolvePrefix | resolveNoTrailingSlash);
+		if(!resolveResult) {
+			if(resolveResult.error() == protocols::fs::Error::isDirectory) {
+				// TODO: Verify additional constraints for sending EISDIR.
+				co_await sendErrorResponse(managarm::posix::Errors::IS_DIRECTORY);
+				co_return RequestResult::handled;
+			} else if(resolveResult.error() == protocols::fs::Error::fileNotFound) {
+				co_await sendErrorResponse(managarm::posix::Errors::FILE_NOT_FOUND);
+				co_return RequestResult::handled;
+			} else if(resolveResult.error() == protocols::fs::Error::notDirectory) {
+				co_await sendErrorResponse(managarm::posix::Errors::NOT_A_DIRECTORY);
+				co_return RequestResult::handled;
 			} else {
-				file = self->fileContext()->getFile(req->fd());
+				std::cout << "posix: Unexpected failure from resolve()" << std::endl;
+				co_return RequestResult::abort;
+			}
+		}
 
-				if (!file) {
-					co_await sendErrorResponse(managarm::posix::Errors::BAD_FD);
-					continue;
-				}
+		if(logRequests)
+			std::cout << "posix: Creating file " << req->path() << std::endl;
 
-				relative_to = {file->associatedMount(), file->associatedLink()};
+		auto directory = resolver.currentLink()->getTarget();
+		auto tailResult = co_await directory->getLink(resolver.nextComponent());
+		assert(tailResult);
+		auto tail = tailResult.value();
+		if(tail) {
+			if(req->flags() & managarm::posix::OpenFlags::OF_EXCLUSIVE) {
+				co_await sendErrorResponse(managarm::posix::Errors::ALREADY_EXISTS);
+				co_return RequestResult::handled;
+			}else{
+				auto target = tail->getTarget();
+				auto fileResult = co_await target->open(
+									resolver.currentView(), std::move(tail),
+									semantic_flags);
+				assert(fileResult);
+				file = fileResult.value();
+				assert(file);
 			}
-
-			if(req->flags()) {
-				if(req->flags() & AT_SYMLINK_NOFOLLOW) {
-					co_await sendErrorResponse(managarm::posix::Errors::NOT_SUPPORTED);
-					continue;
-				} else if(req->flags() & AT_EMPTY_PATH) {
-					// Allowed, managarm extension
-				} else {
-					co_await sendErrorResponse(managarm::posix::Errors::ILLEGAL_ARGUMENTS);
-					continue;
-				}
+		}else{
+			assert(directory->superblock());
+			auto node = co_await directory->superblock()->createRegular(self.get());
+			if (!node) {
+				co_await sendErrorResponse(managarm::posix::Errors::FILE_NOT_FOUND);
+				co_return RequestResult::handled;
 			}
-
-			if(req->flags() & AT_EMPTY_PATH) {
-				target_link = file->associatedLink();
+			auto chmodResult = co_await node->chmod(req->mode());
+			if (chmodResult != Error::success) {
+				std::cout << "posix: chmod failed when creating file for OpenAtRequest!" << std::endl;
+				co_await sendErrorResponse(managarm::posix::Errors::INTERNAL_ERROR);
+				co_return RequestResult::handled;
+			}
+			// Due to races, link() can fail here.
+			// TODO: Implement a version of link() that eithers links the new node
+			// or returns the current node without failing.
+			auto linkResult = co_await directory->link(resolver.nextComponent(), node);
+			assert(linkResult);
+			auto link = linkResult.value();
+			auto fileResult = co_await node->open(resolver.currentView(), std::move(link),
+								semantic_flags);
+			assert(fileResult);
+			file = fileResult.value();
+			assert(file);
+		}
+	}else{
+		auto resolveResult = co_await resolver.resolve();
+		if(!resolveResult) {
+			if(resolveResult.error() == protocols::fs::Error::isDirectory) {
+				// TODO: Verify additional constraints for sending EISDIR.
+				co_await sendErrorResponse(managarm::posix::Errors::IS_DIRECTORY);
+				co_return RequestResult::handled;
+			} else if(resolveResult.error() == protocols::fs::Error::fileNotFound) {
+				co_await sendErrorResponse(managarm::posix::Errors::FILE_NOT_FOUND);
+				co_return RequestResult::handled;
+			} else if(resolveResult.error() == protocols::fs::Error::notDirectory) {
+				co_await sendErrorResponse(managarm::posix::Errors::NOT_A_DIRECTORY);
+				co_return RequestResult::handled;
 			} else {
-				PathResolver resolver;
-				resolver.setup(self->fsContext()->getRoot(),
-					relative_to, req->path(), self.get());
-
-				auto resolveResult = co_await resolver.resolve();
-
-				if(!resolveResult) {
-					if(resolveResult.error() == protocols::fs::Error::fileNotFound) {
-						co_await sendErrorResponse(managarm::posix::Errors::FILE_NOT_FOUND);
-						continue;
-					} else if(resolveResult.error() == protocols::fs::Error::notDirectory) {
-						co_await sendErrorResponse(managarm::posix::Errors::NOT_A_DIRECTORY);
-						continue;
-					} else {
-						std::cout << "posix: Unexpected failure from resolve()" << std::endl;
-						co_return;
-					}
-				}
+				std::cout << "posix: Unexpected failure from resolve()" << std::endl;
+				co_return RequestResult::abort;
+			}
+		}
 
-				target_link = resolver.currentLink();
+		auto target = resolver.currentLink()->getTarget();
+
+		if(req->flags() & managarm::posix::OpenFlags::OF_PATH) {
+			auto dummyFile = smarter::make_shared<DummyFile>(resolver.currentView(), resolver.currentLink());
+			DummyFile::serve(dummyFile);
+			file = File::constructHandle(std::move(dummyFile));
+		} else {
+			auto fileResult = co_await target->open(resolver.currentView(), resolver.currentLink(), semantic_flags);
+			if(!fileResult) {
+				if(fileResult.error() == Error::noBackingDevice) {
+					co_await sendErrorResponse(managarm::posix::Errors::NO_BACKING_DEVICE);
+					co_return RequestResult::handled;
+				} else if(fileResult.error() == Error::illegalArguments) {
+					co_await sendErrorResponse(managarm::posix::Errors::ILLEGAL_ARGUMENTS);
+					co_return RequestResult::handled;
+				} else {
+					std::cout << "posix: Unexpected failure from open()" << std::endl;
+					co_return RequestResult::abort;
+				}
 			}
+			assert(fileResult);
+			file = fileResult.value();
+		}
+	}
 
-			co_await target_link->getTarget()->chmod(req->mode());
+	if(!file) {
+		if(logRequests)
+			std::cout << "posix:     OPEN failed: file not found" << std::endl;
+		co_await sendErrorResponse(managarm::posix::Errors::FILE_NOT_FOUND);
+		co_return RequestResult::handled;
+	}
 
-			co_await sendErrorResponse(managarm::posix::Errors::SUCCESS);
-		}else if(preamble.id() == managarm::posix::UtimensAtRequest::message_id) {
-			std::vector<std::byte> tail(preamble.tail_size());
-			auto [recv_tail] = co_await helix_ng::exchangeMsgs(
-					conversation,
-					helix_ng::recvBuffer(tail.data(), tail.size())
-				);
-			HEL_CHECK(recv_tail.error());
+	if(file->isTerminal() &&
+		!(req->flags() & managarm::posix::OpenFlags::OF_NOCTTY) &&
+		self->pgPointer()->getSession()->getSessionId() == (pid_t)self->pid() &&
+		self->pgPointer()->getSession()->getControllingTerminal() == nullptr) {
+		// POSIX 1003.1-2017 11.1.3
+		auto cts = co_await file->getControllingTerminal();
+		if(!cts) {
+			std::cout << "posix: Unable to get controlling terminal (" << (int)cts.error() << ")" << std::endl;
+		} else {
+			cts.value()->assignSessionOf(self.get());
+		}
+	}
 
-			auto req = bragi::parse_head_tail<managarm::posix::UtimensAtRequest>(recv_head, tail);
+	if(req->flags() & managarm::posix::OpenFlags::OF_TRUNC) {
+		auto result = co_await file->truncate(0);
+		assert(result || result.error() == protocols::fs::Error::illegalOperationTarget);
+	}
+	int fd = self->fileContext()->attachFile(file,
+			req->flags() & managarm::posix::OpenFlags::OF_CLOEXEC);
+
+	managarm::posix::SvrResponse resp;
+	resp.set_error(managarm::posix::Errors::SUCCESS);
+	resp.set_fd(fd);
+
+	auto [sendResp] = co_await helix_ng::exchangeMsgs(
+			conversation,
+			helix_ng::sendBragiHeadOnly(resp, frg::stl_allocator{})
+		);
+	HEL_CHECK(sendResp.error());
+	co_return RequestResult::handled;
+}
 
-			if (!req) {
-				std::cout << "posix: Rejecting request due to decoding failure" << std::endl;
-				break;
-			}
+async::result<RequestResult> RequestContext::handleClose() {
+	auto req = bragi::parse_head_only<managarm::posix::CloseRequest>(recv_head);
+	if (!req) {
+		std::cout << "posix: Rejecting request due to decoding failure" << std::endl;
+		co_return RequestResult::stop;
+	}
+	if(logRequests)
+		std::cout << "posix: CLOSE file descriptor " << req->fd() << std::endl;
+
+	auto closeErr = self->fileContext()->closeFile(req->fd());
+
+	if(closeErr != Error::success) {
+		if(closeErr == Error::noSuchFile) {
+			co_await sendErrorResponse(managarm::posix::Errors::NO_SUCH_FD);
+			co_return RequestResult::handled;
+		} else {
+			std::cout << "posix: Unhandled error returned from closeFile" << std::endl;
+			co_return RequestResult::stop;
+		}
+	}
 
-			if(logRequests || logPaths)
-				std::cout << "posix: UTIMENSAT " << req->path() << std::endl;
+	managarm::posix::SvrResponse resp;
+	resp.set_error(managarm::posix::Errors::SUCCESS);
 
-			ViewPath relativeTo;
-			smarter::shared_ptr<File, FileHandle> file;
-			std::shared_ptr<FsNode> target = nullptr;
+	auto [sendResp] = co_await helix_ng::exchangeMsgs(
+			conversation,
+			helix_ng::sendBragiHeadOnly(resp, frg::stl_allocator{})
+		);
+	HEL_CHECK(sendResp.error());
+	co_return RequestResult::handled;
+}
 
-			if(!req->path().size()) {
-				target = self->fileContext()->getFile(req->fd())->associatedLink()->getTarget();
-			} else {
-				if(req->flags() & ~AT_SYMLINK_NOFOLLOW) {
-					co_await sendErrorResponse(managarm::posix::Errors::ILLEGAL_ARGUMENTS);
-					continue;
-				}
+async::result<RequestResult> RequestContext::handleCntDup() {
+	if(logRequests)
+		std::cout << "posix: DUP" << std::endl;
 
-				ResolveFlags resolveFlags = 0;
-				if(req->flags() & AT_SYMLINK_NOFOLLOW) {
-					resolveFlags |= resolveDontFollow;
-				}
+	auto file = self->fileContext()->getFile(req.fd());
 
-				if(req->fd() == AT_FDCWD) {
-					relativeTo = self->fsContext()->getWorkingDirectory();
-				} else {
-					file = self->fileContext()->getFile(req->fd());
-					if (!file) {
-						co_await sendErrorResponse(managarm::posix::Errors::BAD_FD);
-						continue;
-					}
+	if (!file) {
+		helix::SendBuffer send_resp;
 
-					relativeTo = {file->associatedMount(), file->associatedLink()};
-				}
+		managarm::posix::SvrResponse resp;
+		resp.set_error(managarm::posix::Errors::BAD_FD);
 
-				PathResolver resolver;
-				resolver.setup(self->fsContext()->getRoot(),
-						relativeTo, req->path(), self.get());
-				auto resolveResult = co_await resolver.resolve(resolveFlags);
-				if(!resolveResult) {
-					if(resolveResult.error() == protocols::fs::Error::fileNotFound) {
-						co_await sendErrorResponse(managarm::posix::Errors::FILE_NOT_FOUND);
-						continue;
-					} else if(resolveResult.error() == protocols::fs::Error::notDirectory) {
-						co_await sendErrorResponse(managarm::posix::Errors::NOT_A_DIRECTORY);
-						continue;
-					} else {
-						std::cout << "posix: Unexpected failure from resolve()" << std::endl;
-						co_return;
-					}
-				}
+		auto ser = resp.SerializeAsString();
+		auto &&transmit = helix::submitAsync(conversation, helix::Dispatcher::global(),
+				helix::action(&send_resp, ser.data(), ser.size()));
+		co_await transmit.async_wait();
+		HEL_CHECK(send_resp.error());
+		co_return RequestResult::handled;
+	}
 
-				target = resolver.currentLink()->getTarget();
-			}
+	if(req.flags() & ~(managarm::posix::OpenFlags::OF_CLOEXEC)) {
+		helix::SendBuffer send_resp;
 
-			co_await target->utimensat(req->atimeSec(), req->atimeNsec(), req->mtimeSec(), req->mtimeNsec());
+		managarm::posix::SvrResponse resp;
+		resp.set_error(managarm::posix::Errors::ILLEGAL_ARGUMENTS);
 
-			co_await sendErrorResponse(managarm::posix::Errors::SUCCESS);
-		}else if(preamble.id() == bragi::message_id<managarm::posix::ReadlinkAtRequest>) {
-			std::vector<std::byte> tail(preamble.tail_size());
-			auto [recvTail] = co_await helix_ng::exchangeMsgs(
-					conversation,
-					helix_ng::recvBuffer(tail.data(), tail.size())
-				);
-			HEL_CHECK(recvTail.error());
+		auto ser = resp.SerializeAsString();
+		auto &&transmit = helix::submitAsync(conversation, helix::Dispatcher::global(),
+				helix::action(&send_resp, ser.data(), ser.size()));
+		co_await transmit.async_wait();
+		HEL_CHECK(send_resp.error());
+		co_return RequestResult::handled;
+	}
 
-			auto req = bragi::parse_head_tail<managarm::posix::ReadlinkAtRequest>(recv_head, tail);
-			if (!req) {
-				std::cout << "posix: Rejecting request due to decoding failure" << std::endl;
-				break;
-			}
+	int newfd = self->fileContext()->attachFile(file,
+			req.flags() & managarm::posix::OpenFlags::OF_CLOEXEC);
 
-			if(logRequests || logPaths)
-				std::cout << "posix: READLINKAT path: " << req->path() << std::endl;
+	helix::SendBuffer send_resp;
 
-			helix::SendBuffer send_resp;
-			helix::SendBuffer send_data;
+	managarm::posix::SvrResponse resp;
+	resp.set_error(managarm::posix::Errors::SUCCESS);
+	resp.set_fd(newfd);
 
-			ViewPath relative_to;
-			smarter::shared_ptr<File, FileHandle> file;
+	auto ser = resp.SerializeAsString();
+	auto &&transmit = helix::submitAsync(conversation, helix::Dispatcher::global(),
+			helix::action(&send_resp, ser.data(), ser.size()));
+	co_await transmit.async_wait();
+	HEL_CHECK(send_resp.error());
+	co_return RequestResult::handled;
+}
 
-			if(req->fd() == AT_FDCWD) {
-				relative_to = self->fsContext()->getWorkingDirectory();
-			} else {
-				file = self->fileContext()->getFile(req->fd());
+async::result<RequestResult> RequestContext::handleCntDup2() {
+	if(logRequests)
+		std::cout << "posix: DUP2" << std::endl;
 
-				if (!file) {
-					co_await sendErrorResponse(managarm::posix::Errors::BAD_FD);
-					continue;
-				}
+	auto file = self->fileContext()->getFile(req.fd());
 
-				relative_to = {file->associatedMount(), file->associatedLink()};
-			}
+	if (!file || req.newfd() < 0) {
+		helix::SendBuffer send_resp;
 
-			auto pathResult = co_await resolve(self->fsContext()->getRoot(),
-					relative_to, req->path(), self.get(), resolveDontFollow);
-			if(!pathResult) {
-				if(pathResult.error() == protocols::fs::Error::fileNotFound) {
-					managarm::posix::SvrResponse resp;
-					resp.set_error(managarm::posix::Errors::FILE_NOT_FOUND);
-
-					auto ser = resp.SerializeAsString();
-					auto &&transmit = helix::submitAsync(conversation, helix::Dispatcher::global(),
-							helix::action(&send_resp, ser.data(), ser.size(), kHelItemChain),
-							helix::action(&send_data, nullptr, 0));
-					co_await transmit.async_wait();
-					HEL_CHECK(send_resp.error());
-					continue;
-				} else if(pathResult.error() == protocols::fs::Error::notDirectory) {
-					managarm::posix::SvrResponse resp;
-					resp.set_error(managarm::posix::Errors::NOT_A_DIRECTORY);
-
-					auto ser = resp.SerializeAsString();
-					auto &&transmit = helix::submitAsync(conversation, helix::Dispatcher::global(),
-							helix::action(&send_resp, ser.data(), ser.size(), kHelItemChain),
-							helix::action(&send_data, nullptr, 0));
-					co_await transmit.async_wait();
-					HEL_CHECK(send_resp.error());
-					continue;
-				} else {
-					std::cout << "posix: Unexpected failure from resolve()" << std::endl;
-					co_return;
-				}
-			}
-			auto path = pathResult.value();
+		managarm::posix::SvrResponse resp;
+		resp.set_error(managarm::posix::Errors::BAD_FD);
 
-			auto result = co_await path.second->getTarget()->readSymlink(path.second.get(), self.get());
-			if(auto error = std::get_if<Error>(&result); error) {
-				assert(*error == Error::illegalOperationTarget);
+		auto ser = resp.SerializeAsString();
+		auto &&transmit = helix::submitAsync(conversation, helix::Dispatcher::global(),
+				helix::action(&send_resp, ser.data(), ser.size()));
+		co_await transmit.async_wait();
+		HEL_CHECK(send_resp.error());
+		co_return RequestResult::handled;
+	}
 
-				managarm::posix::SvrResponse resp;
-				resp.set_error(managarm::posix::Errors::ILLEGAL_ARGUMENTS);
+	if(req.flags()) {
+		helix::SendBuffer send_resp;
 
-				auto ser = resp.SerializeAsString();
-				auto &&transmit = helix::submitAsync(conversation, helix::Dispatcher::global(),
-						helix::action(&send_resp, ser.data(), ser.size(), kHelItemChain),
-						helix::action(&send_data, nullptr, 0));
-				co_await transmit.async_wait();
-				HEL_CHECK(send_resp.error());
-			}else{
-				auto &target = std::get<std::string>(result);
+		managarm::posix::SvrResponse resp;
+		resp.set_error(managarm::posix::Errors::ILLEGAL_ARGUMENTS);
 
-				managarm::posix::SvrResponse resp;
-				resp.set_error(managarm::posix::Errors::SUCCESS);
+		auto ser = resp.SerializeAsString();
+		auto &&transmit = helix::submitAsync(conversation, helix::Dispatcher::global(),
+				helix::action(&send_resp, ser.data(), ser.size()));
+		co_await transmit.async_wait();
+		HEL_CHECK(send_resp.error());
+		co_return RequestResult::handled;
+	}
 
-				auto ser = resp.SerializeAsString();
-				auto &&transmit = helix::submitAsync(conversation, helix::Dispatcher::global(),
-						helix::action(&send_resp, ser.data(), ser.size(), kHelItemChain),
-						helix::action(&send_data, target.data(), target.size()));
-				co_await transmit.async_wait();
-				HEL_CHECK(send_resp.error());
-			}
-		}else if(preamble.id() == bragi::message_id<managarm::posix::OpenAtRequest>) {
-			std::vector<std::byte> tail(preamble.tail_size());
-			auto [recvTail] = co_await helix_ng::exchangeMsgs(
-					conversation,
-					helix_ng::recvBuffer(tail.data(), tail.size())
-				);
-			HEL_CHECK(recvTail.error());
-
-			auto req = bragi::parse_head_tail<managarm::posix::OpenAtRequest>(recv_head, tail);
-			if (!req) {
-				std::cout << "posix: Rejecting request due to decoding failure" << std::endl;
-				break;
-			}
-			if(logRequests || logPaths)
-				std::cout << "posix: OPENAT path: " << req->path() << std::endl;
-
-			if((req->flags() & ~(managarm::posix::OpenFlags::OF_CREATE
-					| managarm::posix::OpenFlags::OF_EXCLUSIVE
-					| managarm::posix::OpenFlags::OF_NONBLOCK
-					| managarm::posix::OpenFlags::OF_CLOEXEC
-					| managarm::posix::OpenFlags::OF_TRUNC
-					| managarm::posix::OpenFlags::OF_RDONLY
-					| managarm::posix::OpenFlags::OF_WRONLY
-					| managarm::posix::OpenFlags::OF_RDWR
-					| managarm::posix::OpenFlags::OF_PATH
-					| managarm::posix::OpenFlags::OF_NOCTTY
-					| managarm::posix::OpenFlags::OF_APPEND))) {
-				std::cout << "posix: OPENAT flags not recognized: " << req->flags() << std::endl;
-				co_await sendErrorResponse(managarm::posix::Errors::ILLEGAL_ARGUMENTS);
-				continue;
-			}
+	self->fileContext()->attachFile(req.newfd(), file);
 
-			SemanticFlags semantic_flags = 0;
-			if(req->flags() & managarm::posix::OpenFlags::OF_NONBLOCK)
-				semantic_flags |= semanticNonBlock;
+	helix::SendBuffer send_resp;
 
-			if (req->flags() & managarm::posix::OpenFlags::OF_RDONLY)
-				semantic_flags |= semanticRead;
-			else if (req->flags() & managarm::posix::OpenFlags::OF_WRONLY)
-				semantic_flags |= semanticWrite;
-			else if (req->flags() & managarm::posix::OpenFlags::OF_RDWR)
-				semantic_flags |= semanticRead | semanticWrite;
+	managarm::posix::SvrResponse resp;
+	resp.set_error(managarm::posix::Errors::SUCCESS);
 
-			if(req->flags() & managarm::posix::OpenFlags::OF_APPEND)
-				semantic_flags |= semanticAppend;
+	auto ser = resp.SerializeAsString();
+	auto &&transmit = helix::submitAsync(conversation, helix::Dispatcher::global(),
+			helix::action(&send_resp, ser.data(), ser.size()));
+	co_await transmit.async_wait();
+	HEL_CHECK(send_resp.error());
+	co_return RequestResult::handled;
+}
 
-			ViewPath relative_to;
-			smarter::shared_ptr<File, FileHandle> file;
-			std::shared_ptr<FsLink> target_link;
+async::result<RequestResult> RequestContext::handleIsTty() {
+	auto req = bragi::parse_head_only<managarm::posix::IsTtyRequest>(recv_head);
+	if (!req) {
+		std::cout << "posix: Rejecting request due to decoding failure" << std::endl;
+		co_return RequestResult::stop;
+	}
+	if(logRequests)
+		std::cout << "posix: IS_TTY" << std::endl;
 
-			if(req->fd() == AT_FDCWD) {
-				relative_to = self->fsContext()->getWorkingDirectory();
-			} else {
-				file = self->fileContext()->getFile(req->fd());
+	auto file = self->fileContext()->getFile(req->fd());
+	if(!file) {
+		co_await sendErrorResponse(managarm::posix::Errors::NO_SUCH_FD);
+		co_return RequestResult::handled;
+	}
 
-				if (!file) {
-					co_await sendErrorResponse(managarm::posix::Errors::BAD_FD);
-					continue;
-				}
+	helix::SendBuffer send_resp;
 
-				relative_to = {file->associatedMount(), file->associatedLink()};
-			}
+	managarm::posix::SvrResponse resp;
+	resp.set_error(managarm::posix::Errors::SUCCESS);
+	resp.set_mode(file->isTerminal());
 
-			PathResolver resolver;
-			resolver.setup(self->fsContext()->getRoot(),
-					relative_to, req->path(), self.get());
-			if(req->flags() & managarm::posix::OpenFlags::OF_CREATE) {
-				auto resolveResult = co_await resolver.resolve(
-						resolvePrefix | resolveNoTrailingSlash);
-				if(!resolveResult) {
-					if(resolveResult.error() == protocols::fs::Error::isDirectory) {
-						// TODO: Verify additional constraints for sending EISDIR.
-						co_await sendErrorResponse(managarm::posix::Errors::IS_DIRECTORY);
-						continue;
-					} else if(resolveResult.error() == protocols::fs::Error::fileNotFound) {
-						co_await sendErrorResponse(managarm::posix::Errors::FILE_NOT_FOUND);
-						continue;
-					} else if(resolveResult.error() == protocols::fs::Error::notDirectory) {
-						co_await sendErrorResponse(managarm::posix::Errors::NOT_A_DIRECTORY);
-						continue;
-					} else {
-						std::cout << "posix: Unexpected failure from resolve()" << std::endl;
-						co_return;
-					}
-				}
+	auto [sendResp] = co_await helix_ng::exchangeMsgs(
+			conversation,
+			helix_ng::sendBragiHeadOnly(resp, frg::stl_allocator{})
+		);
+	HEL_CHECK(sendResp.error());
+	co_return RequestResult::handled;
+}
 
-				if(logRequests)
-					std::cout << "posix: Creating file " << req->path() << std::endl;
-
-				auto directory = resolver.currentLink()->getTarget();
-				auto tailResult = co_await directory->getLink(resolver.nextComponent());
-				assert(tailResult);
-				auto tail = tailResult.value();
-				if(tail) {
-					if(req->flags() & managarm::posix::OpenFlags::OF_EXCLUSIVE) {
-						co_await sendErrorResponse(managarm::posix::Errors::ALREADY_EXISTS);
-						continue;
-					}else{
-						auto target = tail->getTarget();
-						auto fileResult = co_await target->open(
-											resolver.currentView(), std::move(tail),
-											semantic_flags);
-						assert(fileResult);
-						file = fileResult.value();
-						assert(file);
-					}
-				}else{
-					assert(directory->superblock());
-					auto node = co_await directory->superblock()->createRegular(self.get());
-					if (!node) {
-						co_await sendErrorResponse(managarm::posix::Errors::FILE_NOT_FOUND);
-						continue;
-					}
-					auto chmodResult = co_await node->chmod(req->mode());
-					if (chmodResult != Error::success) {
-						std::cout << "posix: chmod failed when creating file for OpenAtRequest!" << std::endl;
-						co_await sendErrorResponse(managarm::posix::Errors::INTERNAL_ERROR);
-						continue;
-					}
-					// Due to races, link() can fail here.
-					// TODO: Implement a version of link() that eithers links the new node
-					// or returns the current node without failing.
-					auto linkResult = co_await directory->link(resolver.nextComponent(), node);
-					assert(linkResult);
-					auto link = linkResult.value();
-					auto fileResult = co_await node->open(resolver.currentView(), std::move(link),
-										semantic_flags);
-					assert(fileResult);
-					file = fileResult.value();
-					assert(file);
-				}
-			}else{
-				auto resolveResult = co_await resolver.resolve();
-				if(!resolveResult) {
-					if(resolveResult.error() == protocols::fs::Error::isDirectory) {
-						// TODO: Verify additional constraints for sending EISDIR.
-						co_await sendErrorResponse(managarm::posix::Errors::IS_DIRECTORY);
-						continue;
-					} else if(resolveResult.error() == protocols::fs::Error::fileNotFound) {
-						co_await sendErrorResponse(managarm::posix::Errors::FILE_NOT_FOUND);
-						continue;
-					} else if(resolveResult.error() == protocols::fs::Error::notDirectory) {
-						co_await sendErrorResponse(managarm::posix::Errors::NOT_A_DIRECTORY);
-						continue;
-					} else {
-						std::cout << "posix: Unexpected failure from resolve()" << std::endl;
-						co_return;
-					}
-				}
+async::result<RequestResult> RequestContext::handleCntTtyName() {
+	if(logRequests)
+		std::cout << "posix: TTY_NAME" << std::endl;
 
-				auto target = resolver.currentLink()->getTarget();
+	helix::SendBuffer send_resp;
 
-				if(req->flags() & managarm::posix::OpenFlags::OF_PATH) {
-					auto dummyFile = smarter::make_shared<DummyFile>(resolver.currentView(), resolver.currentLink());
-					DummyFile::serve(dummyFile);
-					file = File::constructHandle(std::move(dummyFile));
-				} else {
-					auto fileResult = co_await target->open(resolver.currentView(), resolver.currentLink(), semantic_flags);
-					if(!fileResult) {
-						if(fileResult.error() == Error::noBackingDevice) {
-							co_await sendErrorResponse(managarm::posix::Errors::NO_BACKING_DEVICE);
-							continue;
-						} else if(fileResult.error() == Error::illegalArguments) {
-							co_await sendErrorResponse(managarm::posix::Errors::ILLEGAL_ARGUMENTS);
-							continue;
-						} else {
-							std::cout << "posix: Unexpected failure from open()" << std::endl;
-							co_return;
-						}
-					}
-					assert(fileResult);
-					file = fileResult.value();
-				}
-			}
+	std::cout << "\e[31mposix: Fix TTY_NAME\e[39m" << std::endl;
+	managarm::posix::SvrResponse resp;
 
-			if(!file) {
-				if(logRequests)
-					std::cout << "posix:     OPEN failed: file not found" << std::endl;
-				co_await sendErrorResponse(managarm::posix::Errors::FILE_NOT_FOUND);
-				continue;
-			}
+	auto file = self->fileContext()->getFile(req.fd());
+	if(!file) {
+	    co_await sendErrorResponse(managarm::posix::Errors::NO_SUCH_FD);
+	    co_return RequestResult::handled;
+	}
 
-			if(file->isTerminal() &&
-				!(req->flags() & managarm::posix::OpenFlags::OF_NOCTTY) &&
-				self->pgPointer()->getSession()->getSessionId() == (pid_t)self->pid() &&
-				self->pgPointer()->getSession()->getControllingTerminal() == nullptr) {
-				// POSIX 1003.1-2017 11.1.3
-				auto cts = co_await file->getControllingTerminal();
-				if(!cts) {
-					std::cout << "posix: Unable to get controlling terminal (" << (int)cts.error() << ")" << std::endl;
-				} else {
-					cts.value()->assignSessionOf(self.get());
-				}
-			}
+	auto ttynameResult = co_await file->ttyname();
+	if(!ttynameResult) {
+	    assert(ttynameResult.error() == Error::notTerminal);
+	    co_await sendErrorResponse(managarm::posix::Errors::NOT_A_TTY);
+	    co_return RequestResult::handled;
+	}
 
-			if(req->flags() & managarm::posix::OpenFlags::OF_TRUNC) {
-				auto result = co_await file->truncate(0);
-				assert(result || result.error() == protocols::fs::Error::illegalOperationTarget);
-			}
-			int fd = self->fileContext()->attachFile(file,
-					req->flags() & managarm::posix::OpenFlags::OF_CLOEXEC);
+	resp.set_path(ttynameResult.value());
+	resp.set_error(managarm::posix::Errors::SUCCESS);
 
-			managarm::posix::SvrResponse resp;
-			resp.set_error(managarm::posix::Errors::SUCCESS);
-			resp.set_fd(fd);
-
-			auto [sendResp] = co_await helix_ng::exchangeMsgs(
-					conversation,
-					helix_ng::sendBragiHeadOnly(resp, frg::stl_allocator{})
-				);
-			HEL_CHECK(sendResp.error());
-		}else if(preamble.id() == bragi::message_id<managarm::posix::CloseRequest>) {
-			auto req = bragi::parse_head_only<managarm::posix::CloseRequest>(recv_head);
-			if (!req) {
-				std::cout << "posix: Rejecting request due to decoding failure" << std::endl;
-				break;
-			}
-			if(logRequests)
-				std::cout << "posix: CLOSE file descriptor " << req->fd() << std::endl;
+	auto ser = resp.SerializeAsString();
+	auto &&transmit = helix::submitAsync(conversation, helix::Dispatcher::global(),
+			helix::action(&send_resp, ser.data(), ser.size()));
+	co_await transmit.async_wait();
+	HEL_CHECK(send_resp.error());
+	co_return RequestResult::handled;
+}
 
-			auto closeErr = self->fileContext()->closeFile(req->fd());
+async::result<RequestResult> RequestContext::handleCntGetcwd() {
+	if(logRequests)
+		std::cout << "posix: GETCWD" << std::endl;
+
+	std::string path = self->fsContext()->getWorkingDirectory().getPath(
+			self->fsContext()->getRoot());
+
+	helix::SendBuffer send_resp;
+	helix::SendBuffer send_path;
+
+	managarm::posix::SvrResponse resp;
+	resp.set_error(managarm::posix::Errors::SUCCESS);
+	resp.set_size(path.size());
+
+	auto ser = resp.SerializeAsString();
+	auto &&transmit = helix::submitAsync(conversation, helix::Dispatcher::global(),
+			helix::action(&send_resp, ser.data(), ser.size(), kHelItemChain),
+			helix::action(&send_path, path.data(),
+					std::min(static_cast<size_t>(req.size()), path.size() + 1)));
+	co_await transmit.async_wait();
+	HEL_CHECK(send_resp.error());
+	HEL_CHECK(send_path.error());
+	co_return RequestResult::handled;
+}
 
-			if(closeErr != Error::success) {
-				if(closeErr == Error::noSuchFile) {
-					co_await sendErrorResponse(managarm::posix::Errors::NO_SUCH_FD);
-					continue;
-				} else {
-					std::cout << "posix: Unhandled error returned from closeFile" << std::endl;
-					break;
-				}
-			}
+async::result<RequestResult> RequestContext::handleUnlinkAt() {
+	std::vector<std::byte> tail(preamble.tail_size());
+	auto [recv_tail] = co_await helix_ng::exchangeMsgs(
+			conversation,
+			helix_ng::recvBuffer(tail.data(), tail.size())
+		);
+	HEL_CHECK(recv_tail.error());
 
-			managarm::posix::SvrResponse resp;
-			resp.set_error(managarm::posix::Errors::SUCCESS);
+	auto req = bragi::parse_head_tail<managarm::posix::UnlinkAtRequest>(recv_head, tail);
 
-			auto [sendResp] = co_await helix_ng::exchangeMsgs(
-					conversation,
-					helix_ng::sendBragiHeadOnly(resp, frg::stl_allocator{})
-				);
-			HEL_CHECK(sendResp.error());
-		}else if(req.request_type() == managarm::posix::CntReqType::DUP) {
-			if(logRequests)
-				std::cout << "posix: DUP" << std::endl;
+	if (!req) {
+		std::cout << "posix: Rejecting request due to decoding failure" << std::endl;
+		co_return RequestResult::stop;
+	}
 
-			auto file = self->fileContext()->getFile(req.fd());
+	if(logRequests || logPaths)
+		std::cout << "posix: UNLINKAT path: " << req->path() << std::endl;
 
-			if (!file) {
-				helix::SendBuffer send_resp;
+	ViewPath relative_to;
+	smarter::shared_ptr<File, FileHandle> file;
+	std::shared_ptr<FsLink> target_link;
 
-				managarm::posix::SvrResponse resp;
-				resp.set_error(managarm::posix::Errors::BAD_FD);
+	if(req->flags()) {
+		if(req->flags() & AT_REMOVEDIR) {
+			std::cout << "posix: UNLINKAT flag AT_REMOVEDIR handling unimplemented" << std::endl;
+		} else {
+			std::cout << "posix: UNLINKAT flag handling unimplemented with unknown flag: " << req->flags() << std::endl;
+			co_await sendErrorResponse(managarm::posix::Errors::ILLEGAL_ARGUMENTS);
+		}
+	}
 
-				auto ser = resp.SerializeAsString();
-				auto &&transmit = helix::submitAsync(conversation, helix::Dispatcher::global(),
-						helix::action(&send_resp, ser.data(), ser.size()));
-				co_await transmit.async_wait();
-				HEL_CHECK(send_resp.error());
-				continue;
-			}
+	if(req->fd() == AT_FDCWD) {
+		relative_to = self->fsContext()->getWorkingDirectory();
+	} else {
+		file = self->fileContext()->getFile(req->fd());
 
-			if(req.flags() & ~(managarm::posix::OpenFlags::OF_CLOEXEC)) {
-				helix::SendBuffer send_resp;
+		if (!file) {
+			co_await sendErrorResponse(managarm::posix::Errors::BAD_FD);
+			co_return RequestResult::handled;
+		}
 
-				managarm::posix::SvrResponse resp;
-				resp.set_error(managarm::posix::Errors::ILLEGAL_ARGUMENTS);
+		relative_to = {file->associatedMount(), file->associatedLink()};
+	}
 
-				auto ser = resp.SerializeAsString();
-				auto &&transmit = helix::submitAsync(conversation, helix::Dispatcher::global(),
-						helix::action(&send_resp, ser.data(), ser.size()));
-				co_await transmit.async_wait();
-				HEL_CHECK(send_resp.error());
-				continue;
-			}
+	PathResolver resolver;
+	resolver.setup(self->fsContext()->getRoot(),
+			relative_to, req->path(), self.get());
+
+	auto resolveResult = co_await resolver.resolve(resolveDontFollow);
+	if(!resolveResult) {
+		if(resolveResult.error() == protocols::fs::Error::isDirectory) {
+			// TODO: Only when AT_REMOVEDIR is not specified, fix this when flag handling is implemented.
+			co_await sendErrorResponse(managarm::posix::Errors::IS_DIRECTORY);
+			co_return RequestResult::handled;
+		} else if(resolveResult.error() == protocols::fs::Error::fileNotFound) {
+			co_await sendErrorResponse(managarm::posix::Errors::FILE_NOT_FOUND);
+			co_return RequestResult::handled;
+		} else if(resolveResult.error() == protocols::fs::Error::notDirectory) {
+			co_await sendErrorResponse(managarm::posix::Errors::NOT_A_DIRECTORY);
+			co_return RequestResult::handled;
+		} else {
+			std::cout << "posix: Unexpected failure from resolve()" << std::endl;
+			co_return RequestResult::abort;
+		}
+	}
 
-			int newfd = self->fileContext()->attachFile(file,
-					req.flags() & managarm::posix::OpenFlags::OF_CLOEXEC);
+	target_link = resolver.currentLink();
 
-			helix::SendBuffer send_resp;
+	auto owner = target_link->getOwner();
+	if(!owner) {
+		co_await sendErrorResponse(managarm::posix::Errors::RESOURCE_IN_USE);
+		co_return RequestResult::handled;
+	}
+	auto result = co_await owner->unlink(target_link->getName());
+	if(!result) {
+		if(result.error() == Error::noSuchFile) {
+			co_await sendErrorResponse(managarm::posix::Errors::FILE_NOT_FOUND);
+			co_return RequestResult::handled;
+		}else if(result.error() == Error::directoryNotEmpty) {
+			co_await sendErrorResponse(managarm::posix::Errors::DIRECTORY_NOT_EMPTY);
+			co_return RequestResult::handled;
+		}else{
+			std::cout << "posix: Unexpected failure from unlink()" << std::endl;
+			co_return RequestResult::abort;
+		}
+	}
 
-			managarm::posix::SvrResponse resp;
-			resp.set_error(managarm::posix::Errors::SUCCESS);
-			resp.set_fd(newfd);
+	co_await sendErrorResponse(managarm::posix::Errors::SUCCESS);
+	co_return RequestResult::handled;
+}
 
-			auto ser = resp.SerializeAsString();
-			auto &&transmit = helix::submitAsync(conversation, helix::Dispatcher::global(),
-					helix::action(&send_resp, ser.data(), ser.size()));
-			co_await transmit.async_wait();
-			HEL_CHECK(send_resp.error());
-		}else if(req.request_type() == managarm::posix::CntReqType::DUP2) {
-			if(logRequests)
-				std::cout << "posix: DUP2" << std::endl;
+async::result<RequestResult> RequestContext::handleRmdir() {
+	std::vector<std::byte> tail(preamble.tail_size());
+	auto [recv_tail] = co_await helix_ng::exchangeMsgs(
+			conversation,
+			helix_ng::recvBuffer(tail.data(), tail.size())
+		);
+	HEL_CHECK(recv_tail.error());
 
-			auto file = self->fileContext()->getFile(req.fd());
+	auto req = bragi::parse_head_tail<managarm::posix::RmdirRequest>(recv_head, tail);
 
-			if (!file || req.newfd() < 0) {
-				helix::SendBuffer send_resp;
+	if (!req) {
+		std::cout << "posix: Rejecting request due to decoding failure" << std::endl;
+		co_return RequestResult::stop;
+	}
 
-				managarm::posix::SvrResponse resp;
-				resp.set_error(managarm::posix::Errors::BAD_FD);
+	if(logRequests || logPaths)
+		std::cout << "posix: RMDIR " << req->path() << std::endl;
+
+	std::shared_ptr<FsLink> target_link;
+
+	PathResolver resolver;
+	resolver.setup(self->fsContext()->getRoot(), self->fsContext()->getWorkingDirectory(),
+			req->path(), self.get());
+
+	auto resolveResult = co_await resolver.resolve();
+	if(!resolveResult) {
+		if(resolveResult.error() == protocols::fs::Error::fileNotFound) {
+			co_await sendErrorResponse(managarm::posix::Errors::FILE_NOT_FOUND);
+			co_return RequestResult::handled;
+		} else if(resolveResult.error() == protocols::fs::Error::notDirectory) {
+			co_await sendErrorResponse(managarm::posix::Errors::NOT_A_DIRECTORY);
+			co_return RequestResult::handled;
+		} else {
+			std::cout << "posix: Unexpected failure from resolve()" << std::endl;
+			co_return RequestResult::abort;
+		}
+	}
 
-				auto ser = resp.SerializeAsString();
-				auto &&transmit = helix::submitAsync(conversation, helix::Dispatcher::global(),
-						helix::action(&send_resp, ser.data(), ser.size()));
-				co_await transmit.async_wait();
-				HEL_CHECK(send_resp.error());
-				continue;
-			}
+	target_link = resolver.currentLink();
 
-			if(req.flags()) {
-				helix::SendBuffer send_resp;
+	auto owner = target_link->getOwner();
+	auto result = co_await owner->rmdir(target_link->getName());
+	if(!result) {
+		if(result.error() == Error::directoryNotEmpty) {
+			co_await sendErrorResponse(managarm::posix::Errors::DIRECTORY_NOT_EMPTY);
+			co_return RequestResult::handled;
+		}
 
-				managarm::posix::SvrResponse resp;
-				resp.set_error(managarm::posix::Errors::ILLEGAL_ARGUMENTS);
+		std::cout << "posix: Unexpected failure from rmdir()" << std::endl;
+		co_await sendErrorResponse(managarm::posix::Errors::INTERNAL_ERROR);
+		co_return RequestResult::abort;
+	}
 
-				auto ser = resp.SerializeAsString();
-				auto &&transmit = helix::submitAsync(conversation, helix::Dispatcher::global(),
-						helix::action(&send_resp, ser.data(), ser.size()));
-				co_await transmit.async_wait();
-				HEL_CHECK(send_resp.error());
-				continue;
-			}
+	co_await sendErrorResponse(managarm::posix::Errors::SUCCESS);
+	co_return RequestResult::handled;
+}
 
-			self->fileContext()->attachFile(req.newfd(), file);
+async::result<RequestResult> RequestContext::handleCntFdGetFlags() {
+	if(logRequests)
+		std::cout << "posix: FD_GET_FLAGS" << std::endl;
 
-			helix::SendBuffer send_resp;
+	helix::SendBuffer send_resp;
 
-			managarm::posix::SvrResponse resp;
-			resp.set_error(managarm::posix::Errors::SUCCESS);
+	auto descriptor = self->fileContext()->getDescriptor(req.fd());
+	if(!descriptor) {
+		managarm::posix::SvrResponse resp;
+		resp.set_error(managarm::posix::Errors::NO_SUCH_FD);
 
-			auto ser = resp.SerializeAsString();
-			auto &&transmit = helix::submitAsync(conversation, helix::Dispatcher::global(),
-					helix::action(&send_resp, ser.data(), ser.size()));
-			co_await transmit.async_wait();
-			HEL_CHECK(send_resp.error());
-		}else if(preamble.id() == bragi::message_id<managarm::posix::IsTtyRequest>) {
-			auto req = bragi::parse_head_only<managarm::posix::IsTtyRequest>(recv_head);
-			if (!req) {
-				std::cout << "posix: Rejecting request due to decoding failure" << std::endl;
-				break;
-			}
-			if(logRequests)
-				std::cout << "posix: IS_TTY" << std::endl;
+		auto ser = resp.SerializeAsString();
+		auto &&transmit = helix::submitAsync(conversation, helix::Dispatcher::global(),
+				helix::action(&send_resp, ser.data(), ser.size()));
+		co_await transmit.async_wait();
+		HEL_CHECK(send_resp.error());
+		co_return RequestResult::handled;
+	}
 
-			auto file = self->fileContext()->getFile(req->fd());
-			if(!file) {
-				co_await sendErrorResponse(managarm::posix::Errors::NO_SUCH_FD);
-				continue;
-			}
+	int flags = 0;
+	if(descriptor->closeOnExec)
+		flags |= FD_CLOEXEC;
 
-			helix::SendBuffer send_resp;
+	managarm::posix::SvrResponse resp;
+	resp.set_error(managarm::posix::Errors::SUCCESS);
+	resp.set_flags(flags);
 
-			managarm::posix::SvrResponse resp;
-			resp.set_error(managarm::posix::Errors::SUCCESS);
-			resp.set_mode(file->isTerminal());
-
-			auto [sendResp] = co_await helix_ng::exchangeMsgs(
-					conversation,
-					helix_ng::sendBragiHeadOnly(resp, frg::stl_allocator{})
-				);
-			HEL_CHECK(sendResp.error());
-		}else if(req.request_type() == managarm::posix::CntReqType::TTY_NAME) {
-			if(logRequests)
-				std::cout << "posix: TTY_NAME" << std::endl;
+	auto ser = resp.SerializeAsString();
+	auto &&transmit = helix::submitAsync(conversation, helix::Dispatcher::global(),
+			helix::action(&send_resp, ser.data(), ser.size()));
+	co_await transmit.async_wait();
+	HEL_CHECK(send_resp.error());
+	co_return RequestResult::handled;
+}
 
-			helix::SendBuffer send_resp;
+async::result<RequestResult> RequestContext::handleCntFdSetFlags() {
+	if(logRequests)
+		std::cout << "posix: FD_SET_FLAGS" << std::endl;
 
-			std::cout << "\e[31mposix: Fix TTY_NAME\e[39m" << std::endl;
-			managarm::posix::SvrResponse resp;
+	if(req.flags() & ~FD_CLOEXEC) {
+		std::cout << "posix: FD_SET_FLAGS unknown flags: " << req.flags() << std::endl;
+		co_await sendErrorResponse(managarm::posix::Errors::ILLEGAL_ARGUMENTS);
+		co_return RequestResult::handled;
+	}
+	int closeOnExec = req.flags() & FD_CLOEXEC;
+	if(self->fileContext()->setDescriptor(req.fd(), closeOnExec) != Error::success) {
+		co_await sendErrorResponse(managarm::posix::Errors::NO_SUCH_FD);
+		co_return RequestResult::handled;
+	}
 
-			auto file = self->fileContext()->getFile(req.fd());
-			if(!file) {
-			    co_await sendErrorResponse(managarm::posix::Errors::NO_SUCH_FD);
-			    continue;
-			}
+	managarm::posix::SvrResponse resp;
+	resp.set_error(managarm::posix::Errors::SUCCESS);
 
-			auto ttynameResult = co_await file->ttyname();
-			if(!ttynameResult) {
-			    assert(ttynameResult.error() == Error::notTerminal);
-			    co_await sendErrorResponse(managarm::posix::Errors::NOT_A_TTY);
-			    continue;
-			}
+	auto ser = resp.SerializeAsString();
+	auto [send_resp] = co_await helix_ng::exchangeMsgs(conversation,
+			helix_ng::sendBuffer(ser.data(), ser.size()));
+	HEL_CHECK(send_resp.error());
+	co_return RequestResult::handled;
+}
 
-			resp.set_path(ttynameResult.value());
-			resp.set_error(managarm::posix::Errors::SUCCESS);
+async::result<RequestResult> RequestContext::handleIoctlFioclex() {
+	auto req = bragi::parse_head_only<managarm::posix::IoctlFioclexRequest>(recv_head);
+	if (!req) {
+		std::cout << "posix: Rejecting request due to decoding failure" << std::endl;
+		co_return RequestResult::stop;
+	}
 
-			auto ser = resp.SerializeAsString();
-			auto &&transmit = helix::submitAsync(conversation, helix::Dispatcher::global(),
-					helix::action(&send_resp, ser.data(), ser.size()));
-			co_await transmit.async_wait();
-			HEL_CHECK(send_resp.error());
-		}else if(req.request_type() == managarm::posix::CntReqType::GETCWD) {
-			if(logRequests)
-				std::cout << "posix: GETCWD" << std::endl;
+	if(logRequests)
+		std::cout << "posix: FIOCLEX" << std::endl;
 
-			std::string path = self->fsContext()->getWorkingDirectory().getPath(
-					self->fsContext()->getRoot());
+	if(self->fileContext()->setDescriptor(req->fd(), true) != Error::success) {
+		co_await sendErrorResponse(managarm::posix::Errors::NO_SUCH_FD);
+		co_return RequestResult::handled;
+	}
 
-			helix::SendBuffer send_resp;
-			helix::SendBuffer send_path;
+	managarm::posix::SvrResponse resp;
+	resp.set_error(managarm::posix::Errors::SUCCESS);
 
-			managarm::posix::SvrResponse resp;
-			resp.set_error(managarm::posix::Errors::SUCCESS);
-			resp.set_size(path.size());
+	auto ser = resp.SerializeAsString();
+	auto [send_resp] = co_await helix_ng::exchangeMsgs(conversation,
+			helix_ng::sendBuffer(ser.data(), ser.size()));
+	HEL_CHECK(send_resp.error());
+	co_return RequestResult::handled;
+}
 
-			auto ser = resp.SerializeAsString();
-			auto &&transmit = helix::submitAsync(conversation, helix::Dispatcher::global(),
-					helix::action(&send_resp, ser.data(), ser.size(), kHelItemChain),
-					helix::action(&send_path, path.data(),
-							std::min(static_cast<size_t>(req.size()), path.size() + 1)));
-			co_await transmit.async_wait();
-			HEL_CHECK(send_resp.error());
-			HEL_CHECK(send_path.error());
-		}else if(preamble.id() == managarm::posix::UnlinkAtRequest::message_id) {
-			std::vector<std::byte> tail(preamble.tail_size());
-			auto [recv_tail] = co_await helix_ng::exchangeMsgs(
-					conversation,
-					helix_ng::recvBuffer(tail.data(), tail.size())
-				);
-			HEL_CHECK(recv_tail.error());
-
-			auto req = bragi::parse_head_tail<managarm::posix::UnlinkAtRequest>(recv_head, tail);
-
-			if (!req) {
-				std::cout << "posix: Rejecting request due to decoding failure" << std::endl;
-				break;
-			}
+async::result<RequestResult> RequestContext::handleCntSigAction() {
+	if(logRequests)
+		std::cout << "posix: SIG_ACTION" << std::endl;
 
-			if(logRequests || logPaths)
-				std::cout << "posix: UNLINKAT path: " << req->path() << std::endl;
+	if(req.flags() & ~(SA_ONSTACK | SA_SIGINFO | SA_RESETHAND | SA_NODEFER | SA_RESTART | SA_NOCLDSTOP)) {
+		std::cout << "\e[31mposix: Unknown SIG_ACTION flags: 0x"
+				<< std::hex << req.flags()
+				<< std::dec << "\e[39m" << std::endl;
+		assert(!"Flags not implemented");
+	}
 
-			ViewPath relative_to;
-			smarter::shared_ptr<File, FileHandle> file;
-			std::shared_ptr<FsLink> target_link;
+	helix::SendBuffer send_resp;
 
-			if(req->flags()) {
-				if(req->flags() & AT_REMOVEDIR) {
-					std::cout << "posix: UNLINKAT flag AT_REMOVEDIR handling unimplemented" << std::endl;
-				} else {
-					std::cout << "posix: UNLINKAT flag handling unimplemented with unknown flag: " << req->flags() << std::endl;
-					co_await sendErrorResponse(managarm::posix::Errors::ILLEGAL_ARGUMENTS);
-				}
-			}
+	managarm::posix::SvrResponse resp;
 
-			if(req->fd() == AT_FDCWD) {
-				relative_to = self->fsContext()->getWorkingDirectory();
-			} else {
-				file = self->fileContext()->getFile(req->fd());
+	if(req.sig_number() <= 0 || req.sig_number() > 64) {
+		resp.set_error(managarm::posix::Errors::ILLEGAL_ARGUMENTS);
+		auto ser = resp.SerializeAsString();
+		auto &&transmit = helix::submitAsync(conversation, helix::Dispatcher::global(),
+				helix::action(&send_resp, ser.data(), ser.size()));
+		co_await transmit.async_wait();
+		HEL_CHECK(send_resp.error());
+		co_return RequestResult::handled;
+	}
 
-				if (!file) {
-					co_await sendErrorResponse(managarm::posix::Errors::BAD_FD);
-					continue;
-				}
+	SignalHandler saved_handler;
+	if(req.mode()) {
+		SignalHandler handler;
+		if(req.sig_handler() == uintptr_t(SIG_DFL)) {
+			handler.disposition = SignalDisposition::none;
+		}else if(req.sig_handler() == uintptr_t(SIG_IGN)) {
+			handler.disposition = SignalDisposition::ignore;
+		}else{
+			handler.disposition = SignalDisposition::handle;
+			handler.handlerIp = req.sig_handler();
+		}
 
-				relative_to = {file->associatedMount(), file->associatedLink()};
-			}
+		handler.flags = 0;
+		handler.mask = req.sig_mask();
+		handler.restorerIp = req.sig_restorer();
+
+		if(req.flags() & SA_SIGINFO)
+			handler.flags |= signalInfo;
+		if(req.flags() & SA_RESETHAND)
+			handler.flags |= signalOnce;
+		if(req.flags() & SA_NODEFER)
+			handler.flags |= signalReentrant;
+		if(req.flags() & SA_ONSTACK)
+			handler.flags |= signalOnStack;
+		if(req.flags() & SA_RESTART)
+			std::cout << "\e[31mposix: Ignoring SA_RESTART\e[39m" << std::endl;
+		if(req.flags() & SA_NOCLDSTOP)
+			std::cout << "\e[31mposix: Ignoring SA_NOCLDSTOP\e[39m" << std::endl;
+
+		saved_handler = self->signalContext()->changeHandler(req.sig_number(), handler);
+	}else{
+		saved_handler = self->signalContext()->getHandler(req.sig_number());
+	}
 
-			PathResolver resolver;
-			resolver.setup(self->fsContext()->getRoot(),
-					relative_to, req->path(), self.get());
-
-			auto resolveResult = co_await resolver.resolve(resolveDontFollow);
-			if(!resolveResult) {
-				if(resolveResult.error() == protocols::fs::Error::isDirectory) {
-					// TODO: Only when AT_REMOVEDIR is not specified, fix this when flag handling is implemented.
-					co_await sendErrorResponse(managarm::posix::Errors::IS_DIRECTORY);
-					continue;
-				} else if(resolveResult.error() == protocols::fs::Error::fileNotFound) {
-					co_await sendErrorResponse(managarm::posix::Errors::FILE_NOT_FOUND);
-					continue;
-				} else if(resolveResult.error() == protocols::fs::Error::notDirectory) {
-					co_await sendErrorResponse(managarm::posix::Errors::NOT_A_DIRECTORY);
-					continue;
-				} else {
-					std::cout << "posix: Unexpected failure from resolve()" << std::endl;
-					co_return;
-				}
-			}
+	int saved_flags = 0;
+	if(saved_handler.flags & signalInfo)
+		saved_flags |= SA_SIGINFO;
+	if(saved_handler.flags & signalOnce)
+		saved_flags |= SA_RESETHAND;
+	if(saved_handler.flags & signalReentrant)
+		saved_flags |= SA_NODEFER;
+	if(saved_handler.flags & signalOnStack)
+		saved_flags |= SA_ONSTACK;
+
+	resp.set_error(managarm::posix::Errors::SUCCESS);
+	resp.set_flags(saved_flags);
+	resp.set_sig_mask(saved_handler.mask);
+	if(saved_handler.disposition == SignalDisposition::handle) {
+		resp.set_sig_handler(saved_handler.handlerIp);
+		resp.set_sig_restorer(saved_handler.restorerIp);
+	}else if(saved_handler.disposition == SignalDisposition::none) {
+		resp.set_sig_handler((uint64_t)SIG_DFL);
+	}else{
+		assert(saved_handler.disposition == SignalDisposition::ignore);
+		resp.set_sig_handler((uint64_t)SIG_IGN);
+	}
 
-			target_link = resolver.currentLink();
+	auto ser = resp.SerializeAsString();
+	auto &&transmit = helix::submitAsync(conversation, helix::Dispatcher::global(),
+			helix::action(&send_resp, ser.data(), ser.size()));
+	co_await transmit.async_wait();
+	HEL_CHECK(send_resp.error());
+	co_return RequestResult::handled;
+}
 
-			auto owner = target_link->getOwner();
-			if(!owner) {
-				co_await sendErrorResponse(managarm::posix::Errors::RESOURCE_IN_USE);
-				continue;
-			}
-			auto result = co_await owner->unlink(target_link->getName());
-			if(!result) {
-				if(result.error() == Error::noSuchFile) {
-					co_await sendErrorResponse(managarm::posix::Errors::FILE_NOT_FOUND);
-					continue;
-				}else if(result.error() == Error::directoryNotEmpty) {
-					co_await sendErrorResponse(managarm::posix::Errors::DIRECTORY_NOT_EMPTY);
-					continue;
-				}else{
-					std::cout << "posix: Unexpected failure from unlink()" << std::endl;
-					co_return;
-				}
-			}
+async::result<RequestResult> RequestContext::handleCntPipeCreate() {
+	if(logRequests)
+		std::cout << "posix: PIPE_CREATE" << std::endl;
 
-			co_await sendErrorResponse(managarm::posix::Errors::SUCCESS);
-		}else if(preamble.id() == managarm::posix::RmdirRequest::message_id) {
-			std::vector<std::byte> tail(preamble.tail_size());
-			auto [recv_tail] = co_await helix_ng::exchangeMsgs(
-					conversation,
-					helix_ng::recvBuffer(tail.data(), tail.size())
-				);
-			HEL_CHECK(recv_tail.error());
+	assert(!(req.flags() & ~(O_CLOEXEC | O_NONBLOCK)));
 
-			auto req = bragi::parse_head_tail<managarm::posix::RmdirRequest>(recv_head, tail);
+	bool nonBlock = false;
 
-			if (!req) {
-				std::cout << "posix: Rejecting request due to decoding failure" << std::endl;
-				break;
-			}
+	if(req.flags() & O_NONBLOCK)
+		nonBlock = true;
 
-			if(logRequests || logPaths)
-				std::cout << "posix: RMDIR " << req->path() << std::endl;
+	helix::SendBuffer send_resp;
 
-			std::shared_ptr<FsLink> target_link;
+	auto pair = fifo::createPair(nonBlock);
+	auto r_fd = self->fileContext()->attachFile(std::get<0>(pair),
+			req.flags() & O_CLOEXEC);
+	auto w_fd = self->fileContext()->attachFile(std::get<1>(pair),
+			req.flags() & O_CLOEXEC);
 
-			PathResolver resolver;
-			resolver.setup(self->fsContext()->getRoot(), self->fsContext()->getWorkingDirectory(),
-					req->path(), self.get());
+	managarm::posix::SvrResponse resp;
+	resp.set_error(managarm::posix::Errors::SUCCESS);
+	resp.add_fds(r_fd);
+	resp.add_fds(w_fd);
 
-			auto resolveResult = co_await resolver.resolve();
-			if(!resolveResult) {
-				if(resolveResult.error() == protocols::fs::Error::fileNotFound) {
-					co_await sendErrorResponse(managarm::posix::Errors::FILE_NOT_FOUND);
-					continue;
-				} else if(resolveResult.error() == protocols::fs::Error::notDirectory) {
-					co_await sendErrorResponse(managarm::posix::Errors::NOT_A_DIRECTORY);
-					continue;
-				} else {
-					std::cout << "posix: Unexpected failure from resolve()" << std::endl;
-					co_return;
-				}
-			}
+	auto ser = resp.SerializeAsString();
+	auto &&transmit = helix::submitAsync(conversation, helix::Dispatcher::global(),
+			helix::action(&send_resp, ser.data(), ser.size()));
+	co_await transmit.async_wait();
+	HEL_CHECK(send_resp.error());
+	co_return RequestResult::handled;
+}
 
-			target_link = resolver.currentLink();
+async::result<RequestResult> RequestContext::handleCntSetsid() {
+	if(logRequests)
+		std::cout << "posix: SETSID" << std::endl;
 
-			auto owner = target_link->getOwner();
-			auto result = co_await owner->rmdir(target_link->getName());
-			if(!result) {
-				if(result.error() == Error::directoryNotEmpty) {
-					co_await sendErrorResponse(managarm::posix::Errors::DIRECTORY_NOT_EMPTY);
-					continue;
-				}
+	managarm::posix::SvrResponse resp;
 
-				std::cout << "posix: Unexpected failure from rmdir()" << std::endl;
-				co_await sendErrorResponse(managarm::posix::Errors::INTERNAL_ERROR);
-				co_return;
-			}
+	if(self->pgPointer()->getSession()->getSessionId() == self->pid()) {
+		co_await sendErrorResponse(managarm::posix::Errors::ACCESS_DENIED);
+		co_return RequestResult::handled;
+	}
 
-			co_await sendErrorResponse(managarm::posix::Errors::SUCCESS);
-		}else if(req.request_type() == managarm::posix::CntReqType::FD_GET_FLAGS) {
-			if(logRequests)
-				std::cout << "posix: FD_GET_FLAGS" << std::endl;
+	auto session = TerminalSession::initializeNewSession(self.get());
 
-			helix::SendBuffer send_resp;
+	resp.set_error(managarm::posix::Errors::SUCCESS);
+	resp.set_sid(session->getSessionId());
 
-			auto descriptor = self->fileContext()->getDescriptor(req.fd());
-			if(!descriptor) {
-				managarm::posix::SvrResponse resp;
-				resp.set_error(managarm::posix::Errors::NO_SUCH_FD);
-
-				auto ser = resp.SerializeAsString();
-				auto &&transmit = helix::submitAsync(conversation, helix::Dispatcher::global(),
-						helix::action(&send_resp, ser.data(), ser.size()));
-				co_await transmit.async_wait();
-				HEL_CHECK(send_resp.error());
-				continue;
-			}
+	auto ser = resp.SerializeAsString();
+	auto [send_resp] = co_await helix_ng::exchangeMsgs(conversation,
+			helix_ng::sendBuffer(ser.data(), ser.size()));
+	HEL_CHECK(send_resp.error());
+	co_return RequestResult::handled;
+}
 
-			int flags = 0;
-			if(descriptor->closeOnExec)
-				flags |= FD_CLOEXEC;
+async::result<RequestResult> RequestContext::handleNetserver() {
+	auto [pt_msg] = co_await helix_ng::exchangeMsgs(conversation, helix_ng::RecvInline());
+
+	HEL_CHECK(pt_msg.error());
+
+	if(logRequests)
+		std::cout << "posix: passing through ioctl to netserver" << std::endl;
+
+	auto [offer, send_req, recv_resp] = co_await helix_ng::exchangeMsgs(
+		co_await net::getNetLane(),
+		helix_ng::offer(
+			helix_ng::want_lane,
+			helix_ng::sendBuffer(pt_msg.data(), pt_msg.size()),
+			helix_ng::recvInline()
+		)
+	);
+	HEL_CHECK(offer.error());
+	HEL_CHECK(send_req.error());
+	HEL_CHECK(recv_resp.error());
+
+	auto recv_preamble = bragi::read_preamble(recv_resp);
+	assert(!recv_preamble.error());
+
+	if(recv_preamble.id() == managarm::fs::IfreqReply::message_id) {
+		auto resp = *bragi::parse_head_only<managarm::fs::IfreqReply>(recv_resp);
+
+		auto [send_resp] = co_await helix_ng::exchangeMsgs(
+			conversation,
+			helix_ng::sendBragiHeadOnly(resp, frg::stl_allocator{})
+		);
+
+		HEL_CHECK(send_resp.error());
+	} else if(recv_preamble.id() == managarm::fs::IfconfReply::message_id) {
+		std::vector<std::byte> tail(recv_preamble.tail_size());
+		auto [recv_tail] =
+			co_await helix_ng::exchangeMsgs(
+				offer.descriptor(),
+				helix_ng::recvBuffer(tail.data(), tail.size())
+			);
+		HEL_CHECK(recv_tail.error());
 
-			managarm::posix::SvrResponse resp;
-			resp.set_error(managarm::posix::Errors::SUCCESS);
-			resp.set_flags(flags);
+		auto resp = *bragi::parse_head_tail<managarm::fs::IfconfReply>(recv_resp, tail);
 
-			auto ser = resp.SerializeAsString();
-			auto &&transmit = helix::submitAsync(conversation, helix::Dispatcher::global(),
-					helix::action(&send_resp, ser.data(), ser.size()));
-			co_await transmit.async_wait();
-			HEL_CHECK(send_resp.error());
-		}else if(req.request_type() == managarm::posix::CntReqType::FD_SET_FLAGS) {
-			if(logRequests)
-				std::cout << "posix: FD_SET_FLAGS" << std::endl;
+		auto [send_resp, send_tail] = co_await helix_ng::exchangeMsgs(
+			conversation,
+			helix_ng::sendBragiHeadTail(resp, frg::stl_allocator{})
+		);
 
-			if(req.flags() & ~FD_CLOEXEC) {
-				std::cout << "posix: FD_SET_FLAGS unknown flags: " << req.flags() << std::endl;
-				co_await sendErrorResponse(managarm::posix::Errors::ILLEGAL_ARGUMENTS);
-				continue;
-			}
-			int closeOnExec = req.flags() & FD_CLOEXEC;
-			if(self->fileContext()->setDescriptor(req.fd(), closeOnExec) != Error::success) {
-				co_await sendErrorResponse(managarm::posix::Errors::NO_SUCH_FD);
-				continue;
-			}
+		HEL_CHECK(send_resp.error());
+		HEL_CHECK(send_tail.error());
+	} else {
+		std::cout << "posix: unexpected message in netserver forward" << std::endl;
+		co_return RequestResult::stop;
+	}
+	co_return RequestResult::handled;
+}
 
-			managarm::posix::SvrResponse resp;
-			resp.set_error(managarm::posix::Errors::SUCCESS);
+async::result<RequestResult> RequestContext::handleSocket() {
+	auto req = bragi::parse_head_only<managarm::posix::SocketRequest>(recv_head);
 
-			auto ser = resp.SerializeAsString();
-			auto [send_resp] = co_await helix_ng::exchangeMsgs(conversation,
-					helix_ng::sendBuffer(ser.data(), ser.size()));
-			HEL_CHECK(send_resp.error());
-		}else if(preamble.id() == bragi::message_id<managarm::posix::IoctlFioclexRequest>) {
-			auto req = bragi::parse_head_only<managarm::posix::IoctlFioclexRequest>(recv_head);
-			if (!req) {
-				std::cout << "posix: Rejecting request due to decoding failure" << std::endl;
-				break;
-			}
+	if (!req) {
+		std::cout << "posix: Rejecting request due to decoding failure" << std::endl;
+		co_return RequestResult::stop;
+	}
 
-			if(logRequests)
-				std::cout << "posix: FIOCLEX" << std::endl;
+	if(logRequests)
+		std::cout << "posix: SOCKET" << std::endl;
 
-			if(self->fileContext()->setDescriptor(req->fd(), true) != Error::success) {
-				co_await sendErrorResponse(managarm::posix::Errors::NO_SUCH_FD);
-				continue;
-			}
+	managarm::posix::SvrResponse resp;
+	resp.set_error(managarm::posix::Errors::SUCCESS);
 
-			managarm::posix::SvrResponse resp;
-			resp.set_error(managarm::posix::Errors::SUCCESS);
+	assert(!(req->flags() & ~(SOCK_NONBLOCK | SOCK_CLOEXEC)));
 
-			auto ser = resp.SerializeAsString();
-			auto [send_resp] = co_await helix_ng::exchangeMsgs(conversation,
-					helix_ng::sendBuffer(ser.data(), ser.size()));
-			HEL_CHECK(send_resp.error());
-		}else if(req.request_type() == managarm::posix::CntReqType::SIG_ACTION) {
-			if(logRequests)
-				std::cout << "posix: SIG_ACTION" << std::endl;
-
-			if(req.flags() & ~(SA_ONSTACK | SA_SIGINFO | SA_RESETHAND | SA_NODEFER | SA_RESTART | SA_NOCLDSTOP)) {
-				std::cout << "\e[31mposix: Unknown SIG_ACTION flags: 0x"
-						<< std::hex << req.flags()
-						<< std::dec << "\e[39m" << std::endl;
-				assert(!"Flags not implemented");
-			}
+	smarter::shared_ptr<File, FileHandle> file;
+	if(req->domain() == AF_UNIX) {
+		assert(req->socktype() == SOCK_DGRAM || req->socktype() == SOCK_STREAM
+				|| req->socktype() == SOCK_SEQPACKET);
+		assert(!req->protocol());
 
-			helix::SendBuffer send_resp;
+		file = un_socket::createSocketFile(req->flags() & SOCK_NONBLOCK, req->socktype());
+	}else if(req->domain() == AF_NETLINK) {
+		assert(req->socktype() == SOCK_RAW || req->socktype() == SOCK_DGRAM);
+		// NL_ROUTE gets handled by the netserver.
+		if(req->protocol() == NETLINK_ROUTE)
+			file = co_await extern_socket::createSocket(
+				co_await net::getNetLane(),
+				req->domain(),
+				req->socktype(), req->protocol(),
+				req->flags() & SOCK_NONBLOCK
+			);
+		else if(netlink::nl_socket::protocol_supported(req->protocol()))
+			file = netlink::nl_socket::createSocketFile(req->protocol(), req->flags() & SOCK_NONBLOCK);
+		else {
+			std::cout << std::format("posix: unhandled netlink protocol 0x{:X}",
+				req->protocol()) << std::endl;
+			co_await sendErrorResponse(managarm::posix::Errors::ILLEGAL_ARGUMENTS);
+			co_return RequestResult::handled;
+		}
+	} else if (req->domain() == AF_INET || req->domain() == AF_PACKET) {
+		file = co_await extern_socket::createSocket(
+			co_await net::getNetLane(),
+			req->domain(),
+			req->socktype(), req->protocol(),
+			req->flags() & SOCK_NONBLOCK);
+	}else{
+		std::cout << "posix: SOCKET: Handle unknown protocols families, this is: " << req->domain() << std::endl;
+		co_await sendErrorResponse(managarm::posix::Errors::ILLEGAL_ARGUMENTS);
+		co_return RequestResult::handled;
+	}
 
-			managarm::posix::SvrResponse resp;
+	auto fd = self->fileContext()->attachFile(file,
+			req->flags() & SOCK_CLOEXEC);
 
-			if(req.sig_number() <= 0 || req.sig_number() > 64) {
-				resp.set_error(managarm::posix::Errors::ILLEGAL_ARGUMENTS);
-				auto ser = resp.SerializeAsString();
-				auto &&transmit = helix::submitAsync(conversation, helix::Dispatcher::global(),
-						helix::action(&send_resp, ser.data(), ser.size()));
-				co_await transmit.async_wait();
-				HEL_CHECK(send_resp.error());
-				continue;
-			}
+	resp.set_fd(fd);
 
-			SignalHandler saved_handler;
-			if(req.mode()) {
-				SignalHandler handler;
-				if(req.sig_handler() == uintptr_t(SIG_DFL)) {
-					handler.disposition = SignalDisposition::none;
-				}else if(req.sig_handler() == uintptr_t(SIG_IGN)) {
-					handler.disposition = SignalDisposition::ignore;
-				}else{
-					handler.disposition = SignalDisposition::handle;
-					handler.handlerIp = req.sig_handler();
-				}
+	auto [send_resp] = co_await helix_ng::exchangeMsgs(
+			conversation,
+			helix_ng::sendBragiHeadOnly(resp, frg::stl_allocator{})
+		);
 
-				handler.flags = 0;
-				handler.mask = req.sig_mask();
-				handler.restorerIp = req.sig_restorer();
-
-				if(req.flags() & SA_SIGINFO)
-					handler.flags |= signalInfo;
-				if(req.flags() & SA_RESETHAND)
-					handler.flags |= signalOnce;
-				if(req.flags() & SA_NODEFER)
-					handler.flags |= signalReentrant;
-				if(req.flags() & SA_ONSTACK)
-					handler.flags |= signalOnStack;
-				if(req.flags() & SA_RESTART)
-					std::cout << "\e[31mposix: Ignoring SA_RESTART\e[39m" << std::endl;
-				if(req.flags() & SA_NOCLDSTOP)
-					std::cout << "\e[31mposix: Ignoring SA_NOCLDSTOP\e[39m" << std::endl;
-
-				saved_handler = self->signalContext()->changeHandler(req.sig_number(), handler);
-			}else{
-				saved_handler = self->signalContext()->getHandler(req.sig_number());
-			}
+	HEL_CHECK(send_resp.error());
+	co_return RequestResult::handled;
+}
 
-			int saved_flags = 0;
-			if(saved_handler.flags & signalInfo)
-				saved_flags |= SA_SIGINFO;
-			if(saved_handler.flags & signalOnce)
-				saved_flags |= SA_RESETHAND;
-			if(saved_handler.flags & signalReentrant)
-				saved_flags |= SA_NODEFER;
-			if(saved_handler.flags & signalOnStack)
-				saved_flags |= SA_ONSTACK;
-
-			resp.set_error(managarm::posix::Errors::SUCCESS);
-			resp.set_flags(saved_flags);
-			resp.set_sig_mask(saved_handler.mask);
-			if(saved_handler.disposition == SignalDisposition::handle) {
-				resp.set_sig_handler(saved_handler.handlerIp);
-				resp.set_sig_restorer(saved_handler.restorerIp);
-			}else if(saved_handler.disposition == SignalDisposition::none) {
-				resp.set_sig_handler((uint64_t)SIG_DFL);
-			}else{
-				assert(saved_handler.disposition == SignalDisposition::ignore);
-				resp.set_sig_handler((uint64_t)SIG_IGN);
-			}
+async::result<RequestResult> RequestContext::handleSockpair() {
+	auto req = bragi::parse_head_only<managarm::posix::SockpairRequest>(recv_head);
 
-			auto ser = resp.SerializeAsString();
-			auto &&transmit = helix::submitAsync(conversation, helix::Dispatcher::global(),
-					helix::action(&send_resp, ser.data(), ser.size()));
-			co_await transmit.async_wait();
-			HEL_CHECK(send_resp.error());
-		}else if(req.request_type() == managarm::posix::CntReqType::PIPE_CREATE) {
-			if(logRequests)
-				std::cout << "posix: PIPE_CREATE" << std::endl;
+	if (!req) {
+		std::cout << "posix: Rejecting request due to decoding failure" << std::endl;
+		co_return RequestResult::stop;
+	}
 
-			assert(!(req.flags() & ~(O_CLOEXEC | O_NONBLOCK)));
+	if(logRequests)
+		std::cout << "posix: SOCKPAIR" << std::endl;
 
-			bool nonBlock = false;
+	assert(!(req->flags() & ~(SOCK_NONBLOCK | SOCK_CLOEXEC)));
 
-			if(req.flags() & O_NONBLOCK)
-				nonBlock = true;
+	if(req->flags() & SOCK_NONBLOCK)
+		std::cout << "\e[31mposix: socketpair(SOCK_NONBLOCK)"
+				" is not implemented correctly\e[39m" << std::endl;
 
-			helix::SendBuffer send_resp;
+	if(req->domain() != AF_UNIX) {
+		std::cout << "\e[31mposix: socketpair() with domain " << req->domain() <<
+				" is not implemented correctly\e[39m" << std::endl;
+		co_await sendErrorResponse(managarm::posix::Errors::ADDRESS_FAMILY_NOT_SUPPORTED);
+		co_return RequestResult::handled;
+	}
+	if(req->socktype() != SOCK_DGRAM && req->socktype() != SOCK_STREAM
+			&& req->socktype() != SOCK_SEQPACKET) {
+		std::cout << "\e[31mposix: socketpair() with socktype " << req->socktype() <<
+				" is not implemented correctly\e[39m" << std::endl;
+		co_await sendErrorResponse(managarm::posix::Errors::ILLEGAL_ARGUMENTS);
+		co_return RequestResult::handled;
+	}
+	if(req->protocol() && req->protocol() != PF_UNSPEC) {
+		std::cout << "\e[31mposix: socketpair() with protocol " << req->protocol() <<
+				" is not implemented correctly\e[39m" << std::endl;
+		co_await sendErrorResponse(managarm::posix::Errors::PROTOCOL_NOT_SUPPORTED);
+		co_return RequestResult::handled;
+	}
 
-			auto pair = fifo::createPair(nonBlock);
-			auto r_fd = self->fileContext()->attachFile(std::get<0>(pair),
-					req.flags() & O_CLOEXEC);
-			auto w_fd = self->fileContext()->attachFile(std::get<1>(pair),
-					req.flags() & O_CLOEXEC);
+	auto pair = un_socket::createSocketPair(self.get());
+	auto fd0 = self->fileContext()->attachFile(std::get<0>(pair),
+			req->flags() & SOCK_CLOEXEC);
+	auto fd1 = self->fileContext()->attachFile(std::get<1>(pair),
+			req->flags() & SOCK_CLOEXEC);
 
-			managarm::posix::SvrResponse resp;
-			resp.set_error(managarm::posix::Errors::SUCCESS);
-			resp.add_fds(r_fd);
-			resp.add_fds(w_fd);
+	managarm::posix::SvrResponse resp;
+	resp.set_error(managarm::posix::Errors::SUCCESS);
+	resp.add_fds(fd0);
+	resp.add_fds(fd1);
 
-			auto ser = resp.SerializeAsString();
-			auto &&transmit = helix::submitAsync(conversation, helix::Dispatcher::global(),
-					helix::action(&send_resp, ser.data(), ser.size()));
-			co_await transmit.async_wait();
-			HEL_CHECK(send_resp.error());
-		}else if(req.request_type() == managarm::posix::CntReqType::SETSID) {
-			if(logRequests)
-				std::cout << "posix: SETSID" << std::endl;
+	auto [send_resp] = co_await helix_ng::exchangeMsgs(
+			conversation,
+			helix_ng::sendBragiHeadOnly(resp, frg::stl_allocator{})
+		);
 
-			managarm::posix::SvrResponse resp;
+	HEL_CHECK(send_resp.error());
+	co_return RequestResult::handled;
+}
 
-			if(self->pgPointer()->getSession()->getSessionId() == self->pid()) {
-				co_await sendErrorResponse(managarm::posix::Errors::ACCESS_DENIED);
-				continue;
-			}
+async::result<RequestResult> RequestContext::handleAccept() {
+	auto req = bragi::parse_head_only<managarm::posix::AcceptRequest>(recv_head);
 
-			auto session = TerminalSession::initializeNewSession(self.get());
+	if (!req) {
+		std::cout << "posix: Rejecting request due to decoding failure" << std::endl;
+		co_return RequestResult::stop;
+	}
 
-			resp.set_error(managarm::posix::Errors::SUCCESS);
-			resp.set_sid(session->getSessionId());
+	if(logRequests)
+		std::cout << "posix: ACCEPT" << std::endl;
 
-			auto ser = resp.SerializeAsString();
-			auto [send_resp] = co_await helix_ng::exchangeMsgs(conversation,
-					helix_ng::sendBuffer(ser.data(), ser.size()));
-			HEL_CHECK(send_resp.error());
-		}else if(preamble.id() == managarm::posix::NetserverRequest::message_id) {
-			auto [pt_msg] = co_await helix_ng::exchangeMsgs(conversation, helix_ng::RecvInline());
+	auto sockfile = self->fileContext()->getFile(req->fd());
+	if(!sockfile) {
+		co_await sendErrorResponse(managarm::posix::Errors::BAD_FD);
+		co_return RequestResult::handled;
+	}
 
-			HEL_CHECK(pt_msg.error());
+	auto newfileResult = co_await sockfile->accept(self.get());
+	if(!newfileResult) {
+		assert(newfileResult.error() == Error::wouldBlock);
+		co_await sendErrorResponse(managarm::posix::Errors::WOULD_BLOCK);
+		co_return RequestResult::handled;
+	}
+	auto newfile = newfileResult.value();
+	auto fd = self->fileContext()->attachFile(std::move(newfile));
 
-			if(logRequests)
-				std::cout << "posix: passing through ioctl to netserver" << std::endl;
+	managarm::posix::SvrResponse resp;
+	resp.set_error(managarm::posix::Errors::SUCCESS);
+	resp.set_fd(fd);
 
-			auto [offer, send_req, recv_resp] = co_await helix_ng::exchangeMsgs(
-				co_await net::getNetLane(),
-				helix_ng::offer(
-					helix_ng::want_lane,
-					helix_ng::sendBuffer(pt_msg.data(), pt_msg.size()),
-					helix_ng::recvInline()
-				)
-			);
-			HEL_CHECK(offer.error());
-			HEL_CHECK(send_req.error());
-			HEL_CHECK(recv_resp.error());
-
-			auto recv_preamble = bragi::read_preamble(recv_resp);
-			assert(!recv_preamble.error());
-
-			if(recv_preamble.id() == managarm::fs::IfreqReply::message_id) {
-				auto resp = *bragi::parse_head_only<managarm::fs::IfreqReply>(recv_resp);
-
-				auto [send_resp] = co_await helix_ng::exchangeMsgs(
-					conversation,
-					helix_ng::sendBragiHeadOnly(resp, frg::stl_allocator{})
-				);
-
-				HEL_CHECK(send_resp.error());
-			} else if(recv_preamble.id() == managarm::fs::IfconfReply::message_id) {
-				std::vector<std::byte> tail(recv_preamble.tail_size());
-				auto [recv_tail] =
-					co_await helix_ng::exchangeMsgs(
-						offer.descriptor(),
-						helix_ng::recvBuffer(tail.data(), tail.size())
-					);
-				HEL_CHECK(recv_tail.error());
-
-				auto resp = *bragi::parse_head_tail<managarm::fs::IfconfReply>(recv_resp, tail);
-
-				auto [send_resp, send_tail] = co_await helix_ng::exchangeMsgs(
-					conversation,
-					helix_ng::sendBragiHeadTail(resp, frg::stl_allocator{})
-				);
-
-				HEL_CHECK(send_resp.error());
-				HEL_CHECK(send_tail.error());
-			} else {
-				std::cout << "posix: unexpected message in netserver forward" << std::endl;
-				break;
-			}
-		}else if(preamble.id() == managarm::posix::SocketRequest::message_id) {
-			auto req = bragi::parse_head_only<managarm::posix::SocketRequest>(recv_head);
+	auto [send_resp] = co_await helix_ng::exchangeMsgs(
+			conversation,
+			helix_ng::sendBragiHeadOnly(resp, frg::stl_allocator{})
+		);
 
-			if (!req) {
-				std::cout << "posix: Rejecting request due to decoding failure" << std::endl;
-				break;
-			}
+	HEL_CHECK(send_resp.error());
+	co_return RequestResult::handled;
+}
 
-			if(logRequests)
-				std::cout << "posix: SOCKET" << std::endl;
+async::result<RequestResult> RequestContext::handleCntEpollCall() {
+	if(logRequests)
+		std::cout << "posix: EPOLL_CALL" << std::endl;
 
-			managarm::posix::SvrResponse resp;
-			resp.set_error(managarm::posix::Errors::SUCCESS);
-
-			assert(!(req->flags() & ~(SOCK_NONBLOCK | SOCK_CLOEXEC)));
-
-			smarter::shared_ptr<File, FileHandle> file;
-			if(req->domain() == AF_UNIX) {
-				assert(req->socktype() == SOCK_DGRAM || req->socktype() == SOCK_STREAM
-						|| req->socktype() == SOCK_SEQPACKET);
-				assert(!req->protocol());
-
-				file = un_socket::createSocketFile(req->flags() & SOCK_NONBLOCK, req->socktype());
-			}else if(req->domain() == AF_NETLINK) {
-				assert(req->socktype() == SOCK_RAW || req->socktype() == SOCK_DGRAM);
-				// NL_ROUTE gets handled by the netserver.
-				if(req->protocol() == NETLINK_ROUTE)
-					file = co_await extern_socket::createSocket(
-						co_await net::getNetLane(),
-						req->domain(),
-						req->socktype(), req->protocol(),
-						req->flags() & SOCK_NONBLOCK
-					);
-				else if(netlink::nl_socket::protocol_supported(req->protocol()))
-					file = netlink::nl_socket::createSocketFile(req->protocol(), req->flags() & SOCK_NONBLOCK);
-				else {
-					std::cout << std::format("posix: unhandled netlink protocol 0x{:X}",
-						req->protocol()) << std::endl;
-					co_await sendErrorResponse(managarm::posix::Errors::ILLEGAL_ARGUMENTS);
-					continue;
-				}
-			} else if (req->domain() == AF_INET || req->domain() == AF_PACKET) {
-				file = co_await extern_socket::createSocket(
-					co_await net::getNetLane(),
-					req->domain(),
-					req->socktype(), req->protocol(),
-					req->flags() & SOCK_NONBLOCK);
-			}else{
-				std::cout << "posix: SOCKET: Handle unknown protocols families, this is: " << req->domain() << std::endl;
-				co_await sendErrorResponse(managarm::posix::Errors::ILLEGAL_ARGUMENTS);
-				continue;
-			}
+	helix::SendBuffer send_resp;
 
-			auto fd = self->fileContext()->attachFile(file,
-					req->flags() & SOCK_CLOEXEC);
+	// Since file descriptors may appear multiple times in a poll() call,
+	// we need to de-duplicate them here.
+	std::unordered_map<int, unsigned int> fdsToEvents;
 
-			resp.set_fd(fd);
+	auto epfile = epoll::createFile();
+	assert(req.fds_size() == req.events_size());
 
-			auto [send_resp] = co_await helix_ng::exchangeMsgs(
-					conversation,
-					helix_ng::sendBragiHeadOnly(resp, frg::stl_allocator{})
-				);
+	bool errorOut = false;
+	for(size_t i = 0; i < req.fds_size(); i++) {
+		auto [mapIt, inserted] = fdsToEvents.insert({req.fds(i), 0});
+		if(!inserted)
+			continue;
 
-			HEL_CHECK(send_resp.error());
-		}else if(preamble.id() == managarm::posix::SockpairRequest::message_id) {
-			auto req = bragi::parse_head_only<managarm::posix::SockpairRequest>(recv_head);
+		auto file = self->fileContext()->getFile(req.fds(i));
+		if(!file) {
+			// poll() is supposed to fail on a per-FD basis.
+			mapIt->second = POLLNVAL;
+			continue;
+		}
+		auto locked = file->weakFile().lock();
+		assert(locked);
+
+		// Translate POLL events to EPOLL events.
+		if(req.events(i) & ~(POLLIN | POLLPRI | POLLOUT | POLLRDHUP | POLLERR | POLLHUP
+				| POLLNVAL | POLLWRNORM)) {
+			std::cout << "\e[31mposix: Unexpected events for poll()\e[39m" << std::endl;
+			co_await sendErrorResponse(managarm::posix::Errors::ILLEGAL_ARGUMENTS);
+			errorOut = true;
+			break;
+		}
 
-			if (!req) {
-				std::cout << "posix: Rejecting request due to decoding failure" << std::endl;
-				break;
-			}
+		unsigned int mask = 0;
+		if(req.events(i) & POLLIN) mask |= EPOLLIN;
+		if(req.events(i) & POLLOUT) mask |= EPOLLOUT;
+		if(req.events(i) & POLLWRNORM) mask |= EPOLLOUT;
+		if(req.events(i) & POLLPRI) mask |= EPOLLPRI;
+		if(req.events(i) & POLLRDHUP) mask |= EPOLLRDHUP;
+		if(req.events(i) & POLLERR) mask |= EPOLLERR;
+		if(req.events(i) & POLLHUP) mask |= EPOLLHUP;
+
+		// addItem() can fail with EEXIST but we check for duplicate FDs above
+		// so that cannot happen here.
+		Error ret = epoll::addItem(epfile.get(), self.get(),
+				std::move(locked), req.fds(i), mask, req.fds(i));
+		assert(ret == Error::success);
+	}
+	if(errorOut)
+		co_return RequestResult::handled;
+
+	struct epoll_event events[16];
+	size_t k;
+	if(req.timeout() < 0) {
+		k = co_await epoll::wait(epfile.get(), events, 16);
+	}else if(!req.timeout()) {
+		// Do not bother to set up a timer for zero timeouts.
+		async::cancellation_event cancel_wait;
+		cancel_wait.cancel();
+		k = co_await epoll::wait(epfile.get(), events, 16, cancel_wait);
+	}else{
+		assert(req.timeout() > 0);
+		async::cancellation_event cancel_wait;
+		helix::TimeoutCancellation timer{static_cast<uint64_t>(req.timeout()), cancel_wait};
+		k = co_await epoll::wait(epfile.get(), events, 16, cancel_wait);
+		co_await timer.retire();
+	}
 
-			if(logRequests)
-				std::cout << "posix: SOCKPAIR" << std::endl;
+	// Assigned the returned events to each FD.
+	for(size_t j = 0; j < k; ++j) {
+		auto it = fdsToEvents.find(events[j].data.fd);
+		assert(it != fdsToEvents.end());
+
+		// Translate EPOLL events back to POLL events.
+		assert(!it->second);
+		if(events[j].events & EPOLLIN) it->second |= POLLIN;
+		if(events[j].events & EPOLLOUT) it->second |= POLLOUT;
+		if(events[j].events & EPOLLPRI) it->second |= POLLPRI;
+		if(events[j].events & EPOLLRDHUP) it->second |= POLLRDHUP;
+		if(events[j].events & EPOLLERR) it->second |= POLLERR;
+		if(events[j].events & EPOLLHUP) it->second |= POLLHUP;
+	}
 
-			assert(!(req->flags() & ~(SOCK_NONBLOCK | SOCK_CLOEXEC)));
+	managarm::posix::SvrResponse resp;
+	resp.set_error(managarm::posix::Errors::SUCCESS);
 
-			if(req->flags() & SOCK_NONBLOCK)
-				std::cout << "\e[31mposix: socketpair(SOCK_NONBLOCK)"
-						" is not implemented correctly\e[39m" << std::endl;
+	for(size_t i = 0; i < req.fds_size(); ++i) {
+		auto it = fdsToEvents.find(req.fds(i));
+		assert(it != fdsToEvents.end());
+		resp.add_events(it->second);
+	}
 
-			if(req->domain() != AF_UNIX) {
-				std::cout << "\e[31mposix: socketpair() with domain " << req->domain() <<
-						" is not implemented correctly\e[39m" << std::endl;
-				co_await sendErrorResponse(managarm::posix::Errors::ADDRESS_FAMILY_NOT_SUPPORTED);
-				continue;
-			}
-			if(req->socktype() != SOCK_DGRAM && req->socktype() != SOCK_STREAM
-					&& req->socktype() != SOCK_SEQPACKET) {
-				std::cout << "\e[31mposix: socketpair() with socktype " << req->socktype() <<
-						" is not implemented correctly\e[39m" << std::endl;
-				co_await sendErrorResponse(managarm::posix::Errors::ILLEGAL_ARGUMENTS);
-				continue;
-			}
-			if(req->protocol() && req->protocol() != PF_UNSPEC) {
-				std::cout << "\e[31mposix: socketpair() with protocol " << req->protocol() <<
-						" is not implemented correctly\e[39m" << std::endl;
-				co_await sendErrorResponse(managarm::posix::Errors::PROTOCOL_NOT_SUPPORTED);
-				continue;
-			}
+	auto ser = resp.SerializeAsString();
+	auto &&transmit = helix::submitAsync(conversation, helix::Dispatcher::global(),
+			helix::action(&send_resp, ser.data(), ser.size()));
+	co_await transmit.async_wait();
+	HEL_CHECK(send_resp.error());
+	co_return RequestResult::handled;
+}
 
-			auto pair = un_socket::createSocketPair(self.get());
-			auto fd0 = self->fileContext()->attachFile(std::get<0>(pair),
-					req->flags() & SOCK_CLOEXEC);
-			auto fd1 = self->fileContext()->attachFile(std::get<1>(pair),
-					req->flags() & SOCK_CLOEXEC);
+async::result<RequestResult> RequestContext::handleCntEpollCreate() {
+	if(logRequests)
+		std::cout << "posix: EPOLL_CREATE" << std::endl;
 
-			managarm::posix::SvrResponse resp;
-			resp.set_error(managarm::posix::Errors::SUCCESS);
-			resp.add_fds(fd0);
-			resp.add_fds(fd1);
+	helix::SendBuffer send_resp;
 
-			auto [send_resp] = co_await helix_ng::exchangeMsgs(
-					conversation,
-					helix_ng::sendBragiHeadOnly(resp, frg::stl_allocator{})
-				);
+	assert(!(req.flags() & ~(managarm::posix::OpenFlags::OF_CLOEXEC)));
 
-			HEL_CHECK(send_resp.error());
-		}else if(preamble.id() == managarm::posix::AcceptRequest::message_id) {
-			auto req = bragi::parse_head_only<managarm::posix::AcceptRequest>(recv_head);
+	auto file = epoll::createFile();
+	auto fd = self->fileContext()->attachFile(file,
+			req.flags() & managarm::posix::OpenFlags::OF_CLOEXEC);
 
-			if (!req) {
-				std::cout << "posix: Rejecting request due to decoding failure" << std::endl;
-				break;
-			}
+	managarm::posix::SvrResponse resp;
+	resp.set_error(managarm::posix::Errors::SUCCESS);
+	resp.set_fd(fd);
 
-			if(logRequests)
-				std::cout << "posix: ACCEPT" << std::endl;
+	auto ser = resp.SerializeAsString();
+	auto &&transmit = helix::submitAsync(conversation, helix::Dispatcher::global(),
+			helix::action(&send_resp, ser.data(), ser.size()));
+	co_await transmit.async_wait();
+	HEL_CHECK(send_resp.error());
+	co_return RequestResult::handled;
+}
 
-			auto sockfile = self->fileContext()->getFile(req->fd());
-			if(!sockfile) {
-				co_await sendErrorResponse(managarm::posix::Errors::BAD_FD);
-				continue;
-			}
+async::result<RequestResult> RequestContext::handleCntEpollAdd() {
+	if(logRequests)
+		std::cout << "posix: EPOLL_ADD" << std::endl;
 
-			auto newfileResult = co_await sockfile->accept(self.get());
-			if(!newfileResult) {
-				assert(newfileResult.error() == Error::wouldBlock);
-				co_await sendErrorResponse(managarm::posix::Errors::WOULD_BLOCK);
-				continue;
-			}
-			auto newfile = newfileResult.value();
-			auto fd = self->fileContext()->attachFile(std::move(newfile));
+	helix::SendBuffer send_resp;
 
-			managarm::posix::SvrResponse resp;
-			resp.set_error(managarm::posix::Errors::SUCCESS);
-			resp.set_fd(fd);
+	auto epfile = self->fileContext()->getFile(req.fd());
+	auto file = self->fileContext()->getFile(req.newfd());
+	if(!file || !epfile) {
+		co_await sendErrorResponse(managarm::posix::Errors::BAD_FD);
+		co_return RequestResult::handled;
+	}
 
-			auto [send_resp] = co_await helix_ng::exchangeMsgs(
-					conversation,
-					helix_ng::sendBragiHeadOnly(resp, frg::stl_allocator{})
-				);
+	auto locked = file->weakFile().lock();
+	assert(locked);
+	Error ret = epoll::addItem(epfile.get(), self.get(),
+			std::move(locked), req.newfd(), req.flags(), req.cookie());
+	if(ret == Error::alreadyExists) {
+		co_await sendErrorResponse(managarm::posix::Errors::ALREADY_EXISTS);
+		co_return RequestResult::handled;
+	}
+	assert(ret == Error::success);
 
-			HEL_CHECK(send_resp.error());
-		}else if(req.request_type() == managarm::posix::CntReqType::EPOLL_CALL) {
-			if(logRequests)
-				std::cout << "posix: EPOLL_CALL" << std::endl;
+	managarm::posix::SvrResponse resp;
+	resp.set_error(managarm::posix::Errors::SUCCESS);
 
-			helix::SendBuffer send_resp;
+	auto ser = resp.SerializeAsString();
+	auto &&transmit = helix::submitAsync(conversation, helix::Dispatcher::global(),
+			helix::action(&send_resp, ser.data(), ser.size()));
+	co_await transmit.async_wait();
+	HEL_CHECK(send_resp.error());
+	co_return RequestResult::handled;
+}
 
-			// Since file descriptors may appear multiple times in a poll() call,
-			// we need to de-duplicate them here.
-			std::unordered_map<int, unsigned int> fdsToEvents;
+async::result<RequestResult> RequestContext::handleCntEpollModify() {
+	if(logRequests)
+		std::cout << "posix: EPOLL_MODIFY" << std::endl;
 
-			auto epfile = epoll::createFile();
-			assert(req.fds_size() == req.events_size());
+	helix::SendBuffer send_resp;
 
-			bool errorOut = false;
-			for(size_t i = 0; i < req.fds_size(); i++) {
-				auto [mapIt, inserted] = fdsToEvents.insert({req.fds(i), 0});
-				if(!inserted)
-					continue;
+	auto epfile = self->fileContext()->getFile(req.fd());
+	auto file = self->fileContext()->getFile(req.newfd());
+	assert(epfile && "Illegal FD for EPOLL_MODIFY");
+	assert(file && "Illegal FD for EPOLL_MODIFY item");
 
-				auto file = self->fileContext()->getFile(req.fds(i));
-				if(!file) {
-					// poll() is supposed to fail on a per-FD basis.
-					mapIt->second = POLLNVAL;
-					continue;
-				}
-				auto locked = file->weakFile().lock();
-				assert(locked);
+	Error ret = epoll::modifyItem(epfile.get(), file.get(), req.newfd(),
+			req.flags(), req.cookie());
+	if(ret == Error::noSuchFile) {
+		co_await sendErrorResponse(managarm::posix::Errors::FILE_NOT_FOUND);
+		co_return RequestResult::handled;
+	}
+	assert(ret == Error::success);
 
-				// Translate POLL events to EPOLL events.
-				if(req.events(i) & ~(POLLIN | POLLPRI | POLLOUT | POLLRDHUP | POLLERR | POLLHUP
-						| POLLNVAL | POLLWRNORM)) {
-					std::cout << "\e[31mposix: Unexpected events for poll()\e[39m" << std::endl;
-					co_await sendErrorResponse(managarm::posix::Errors::ILLEGAL_ARGUMENTS);
-					errorOut = true;
-					break;
-				}
+	managarm::posix::SvrResponse resp;
+	resp.set_error(managarm::posix::Errors::SUCCESS);
 
-				unsigned int mask = 0;
-				if(req.events(i) & POLLIN) mask |= EPOLLIN;
-				if(req.events(i) & POLLOUT) mask |= EPOLLOUT;
-				if(req.events(i) & POLLWRNORM) mask |= EPOLLOUT;
-				if(req.events(i) & POLLPRI) mask |= EPOLLPRI;
-				if(req.events(i) & POLLRDHUP) mask |= EPOLLRDHUP;
-				if(req.events(i) & POLLERR) mask |= EPOLLERR;
-				if(req.events(i) & POLLHUP) mask |= EPOLLHUP;
-
-				// addItem() can fail with EEXIST but we check for duplicate FDs above
-				// so that cannot happen here.
-				Error ret = epoll::addItem(epfile.get(), self.get(),
-						std::move(locked), req.fds(i), mask, req.fds(i));
-				assert(ret == Error::success);
-			}
-			if(errorOut)
-				continue;
-
-			struct epoll_event events[16];
-			size_t k;
-			if(req.timeout() < 0) {
-				k = co_await epoll::wait(epfile.get(), events, 16);
-			}else if(!req.timeout()) {
-				// Do not bother to set up a timer for zero timeouts.
-				async::cancellation_event cancel_wait;
-				cancel_wait.cancel();
-				k = co_await epoll::wait(epfile.get(), events, 16, cancel_wait);
-			}else{
-				assert(req.timeout() > 0);
-				async::cancellation_event cancel_wait;
-				helix::TimeoutCancellation timer{static_cast<uint64_t>(req.timeout()), cancel_wait};
-				k = co_await epoll::wait(epfile.get(), events, 16, cancel_wait);
-				co_await timer.retire();
-			}
+	auto ser = resp.SerializeAsString();
+	auto &&transmit = helix::submitAsync(conversation, helix::Dispatcher::global(),
+			helix::action(&send_resp, ser.data(), ser.size()));
+	co_await transmit.async_wait();
+	HEL_CHECK(send_resp.error());
+	co_return RequestResult::handled;
+}
 
-			// Assigned the returned events to each FD.
-			for(size_t j = 0; j < k; ++j) {
-				auto it = fdsToEvents.find(events[j].data.fd);
-				assert(it != fdsToEvents.end());
-
-				// Translate EPOLL events back to POLL events.
-				assert(!it->second);
-				if(events[j].events & EPOLLIN) it->second |= POLLIN;
-				if(events[j].events & EPOLLOUT) it->second |= POLLOUT;
-				if(events[j].events & EPOLLPRI) it->second |= POLLPRI;
-				if(events[j].events & EPOLLRDHUP) it->second |= POLLRDHUP;
-				if(events[j].events & EPOLLERR) it->second |= POLLERR;
-				if(events[j].events & EPOLLHUP) it->second |= POLLHUP;
-			}
+async::result<RequestResult> RequestContext::handleCntEpollDelete() {
+	if(logRequests)
+		std::cout << "posix: EPOLL_DELETE" << std::endl;
 
-			managarm::posix::SvrResponse resp;
-			resp.set_error(managarm::posix::Errors::SUCCESS);
+	helix::SendBuffer send_resp;
 
-			for(size_t i = 0; i < req.fds_size(); ++i) {
-				auto it = fdsToEvents.find(req.fds(i));
-				assert(it != fdsToEvents.end());
-				resp.add_events(it->second);
-			}
+	auto epfile = self->fileContext()->getFile(req.fd());
+	auto file = self->fileContext()->getFile(req.newfd());
+	if(!epfile || !file) {
+		std::cout << "posix: Illegal FD for EPOLL_DELETE" << std::endl;
+		co_await sendErrorResponse(managarm::posix::Errors::BAD_FD);
+		co_return RequestResult::handled;
+	}
 
-			auto ser = resp.SerializeAsString();
-			auto &&transmit = helix::submitAsync(conversation, helix::Dispatcher::global(),
-					helix::action(&send_resp, ser.data(), ser.size()));
-			co_await transmit.async_wait();
-			HEL_CHECK(send_resp.error());
-		}else if(req.request_type() == managarm::posix::CntReqType::EPOLL_CREATE) {
-			if(logRequests)
-				std::cout << "posix: EPOLL_CREATE" << std::endl;
+	Error ret = epoll::deleteItem(epfile.get(), file.get(), req.newfd(), req.flags());
+	if(ret == Error::noSuchFile) {
+		co_await sendErrorResponse(managarm::posix::Errors::FILE_NOT_FOUND);
+		co_return RequestResult::handled;
+	}
+	assert(ret == Error::success);
 
-			helix::SendBuffer send_resp;
+	managarm::posix::SvrResponse resp;
+	resp.set_error(managarm::posix::Errors::SUCCESS);
 
-			assert(!(req.flags() & ~(managarm::posix::OpenFlags::OF_CLOEXEC)));
+	auto ser = resp.SerializeAsString();
+	auto &&transmit = helix::submitAsync(conversation, helix::Dispatcher::global(),
+			helix::action(&send_resp, ser.data(), ser.size()));
+	co_await transmit.async_wait();
+	HEL_CHECK(send_resp.error());
+	co_return RequestResult::handled;
+}
 
-			auto file = epoll::createFile();
-			auto fd = self->fileContext()->attachFile(file,
-					req.flags() & managarm::posix::OpenFlags::OF_CLOEXEC);
+async::result<RequestResult> RequestContext::handleCntEpollWait() {
+	if(logRequests)
+		std::cout << "posix: EPOLL_WAIT request" << std::endl;
 
-			managarm::posix::SvrResponse resp;
-			resp.set_error(managarm::posix::Errors::SUCCESS);
-			resp.set_fd(fd);
+	helix::SendBuffer send_resp;
+	helix::SendBuffer send_data;
+	uint64_t former = self->signalMask();
 
-			auto ser = resp.SerializeAsString();
-			auto &&transmit = helix::submitAsync(conversation, helix::Dispatcher::global(),
-					helix::action(&send_resp, ser.data(), ser.size()));
-			co_await transmit.async_wait();
-			HEL_CHECK(send_resp.error());
-		}else if(req.request_type() == managarm::posix::CntReqType::EPOLL_ADD) {
-			if(logRequests)
-				std::cout << "posix: EPOLL_ADD" << std::endl;
+	auto epfile = self->fileContext()->getFile(req.fd());
+	if(!epfile) {
+		co_await sendErrorResponse(managarm::posix::Errors::BAD_FD);
+		co_return RequestResult::handled;
+	}
+	if(req.sigmask_needed()) {
+		self->setSignalMask(req.sigmask());
+	}
 
-			helix::SendBuffer send_resp;
+	struct epoll_event events[16];
+	size_t k;
+	if(req.timeout() < 0) {
+		k = co_await epoll::wait(epfile.get(), events,
+				std::min(req.size(), uint32_t(16)));
+	}else if(!req.timeout()) {
+		// Do not bother to set up a timer for zero timeouts.
+		async::cancellation_event cancel_wait;
+		cancel_wait.cancel();
+		k = co_await epoll::wait(epfile.get(), events,
+				std::min(req.size(), uint32_t(16)), cancel_wait);
+	}else{
+		assert(req.timeout() > 0);
+		async::cancellation_event cancel_wait;
+		helix::TimeoutCancellation timer{static_cast<uint64_t>(req.timeout()), cancel_wait};
+		k = co_await epoll::wait(epfile.get(), events, 16, cancel_wait);
+		co_await timer.retire();
+	}
+	if(req.sigmask_needed()) {
+		self->setSignalMask(former);
+	}
 
-			auto epfile = self->fileContext()->getFile(req.fd());
-			auto file = self->fileContext()->getFile(req.newfd());
-			if(!file || !epfile) {
-				co_await sendErrorResponse(managarm::posix::Errors::BAD_FD);
-				continue;
-			}
+	managarm::posix::SvrResponse resp;
+	resp.set_error(managarm::posix::Errors::SUCCESS);
 
-			auto locked = file->weakFile().lock();
-			assert(locked);
-			Error ret = epoll::addItem(epfile.get(), self.get(),
-					std::move(locked), req.newfd(), req.flags(), req.cookie());
-			if(ret == Error::alreadyExists) {
-				co_await sendErrorResponse(managarm::posix::Errors::ALREADY_EXISTS);
-				continue;
-			}
-			assert(ret == Error::success);
+	auto ser = resp.SerializeAsString();
+	auto &&transmit = helix::submitAsync(conversation, helix::Dispatcher::global(),
+			helix::action(&send_resp, ser.data(), ser.size(), kHelItemChain),
+			helix::action(&send_data, events, k * sizeof(struct epoll_event)));
+	co_await transmit.async_wait();
+	HEL_CHECK(send_resp.error());
+	co_return RequestResult::handled;
+}
 
-			managarm::posix::SvrResponse resp;
-			resp.set_error(managarm::posix::Errors::SUCCESS);
+async::result<RequestResult> RequestContext::handleCntTimerfdCreate() {
+	if(logRequests)
+		std::cout << "posix: TIMERFD_CREATE" << std::endl;
 
-			auto ser = resp.SerializeAsString();
-			auto &&transmit = helix::submitAsync(conversation, helix::Dispatcher::global(),
-					helix::action(&send_resp, ser.data(), ser.size()));
-			co_await transmit.async_wait();
-			HEL_CHECK(send_resp.error());
-		}else if(req.request_type() == managarm::posix::CntReqType::EPOLL_MODIFY) {
-			if(logRequests)
-				std::cout << "posix: EPOLL_MODIFY" << std::endl;
+	helix::SendBuffer send_resp;
 
-			helix::SendBuffer send_resp;
+	assert(!(req.flags() & ~(TFD_CLOEXEC | TFD_NONBLOCK)));
 
-			auto epfile = self->fileContext()->getFile(req.fd());
-			auto file = self->fileContext()->getFile(req.newfd());
-			assert(epfile && "Illegal FD for EPOLL_MODIFY");
-			assert(file && "Illegal FD for EPOLL_MODIFY item");
+	auto file = timerfd::createFile(req.flags() & TFD_NONBLOCK);
+	auto fd = self->fileContext()->attachFile(file, req.flags() & TFD_CLOEXEC);
 
-			Error ret = epoll::modifyItem(epfile.get(), file.get(), req.newfd(),
-					req.flags(), req.cookie());
-			if(ret == Error::noSuchFile) {
-				co_await sendErrorResponse(managarm::posix::Errors::FILE_NOT_FOUND);
-				continue;
-			}
-			assert(ret == Error::success);
+	managarm::posix::SvrResponse resp;
+	resp.set_error(managarm::posix::Errors::SUCCESS);
+	resp.set_fd(fd);
 
-			managarm::posix::SvrResponse resp;
-			resp.set_error(managarm::posix::Errors::SUCCESS);
+	auto ser = resp.SerializeAsString();
+	auto &&transmit = helix::submitAsync(conversation, helix::Dispatcher::global(),
+			helix::action(&send_resp, ser.data(), ser.size()));
+	co_await transmit.async_wait();
+	HEL_CHECK(send_resp.error());
+	co_return RequestResult::handled;
+}
 
-			auto ser = resp.SerializeAsString();
-			auto &&transmit = helix::submitAsync(conversation, helix::Dispatcher::global(),
-					helix::action(&send_resp, ser.data(), ser.size()));
-			co_await transmit.async_wait();
-			HEL_CHECK(send_resp.error());
-		}else if(req.request_type() == managarm::posix::CntReqType::EPOLL_DELETE) {
-			if(logRequests)
-				std::cout << "posix: EPOLL_DELETE" << std::endl;
+async::result<RequestResult> RequestContext::handleCntTimerfdSettime() {
+	if(logRequests)
+		std::cout << "posix: TIMERFD_SETTIME" << std::endl;
 
-			helix::SendBuffer send_resp;
+	helix::SendBuffer send_resp;
 
-			auto epfile = self->fileContext()->getFile(req.fd());
-			auto file = self->fileContext()->getFile(req.newfd());
-			if(!epfile || !file) {
-				std::cout << "posix: Illegal FD for EPOLL_DELETE" << std::endl;
-				co_await sendErrorResponse(managarm::posix::Errors::BAD_FD);
-				continue;
-			}
+	auto file = self->fileContext()->getFile(req.fd());
+	assert(file && "Illegal FD for TIMERFD_SETTIME");
+	timerfd::setTime(file.get(),
+			{static_cast<time_t>(req.time_secs()), static_cast<long>(req.time_nanos())},
+			{static_cast<time_t>(req.interval_secs()), static_cast<long>(req.interval_nanos())});
 
-			Error ret = epoll::deleteItem(epfile.get(), file.get(), req.newfd(), req.flags());
-			if(ret == Error::noSuchFile) {
-				co_await sendErrorResponse(managarm::posix::Errors::FILE_NOT_FOUND);
-				continue;
-			}
-			assert(ret == Error::success);
+	managarm::posix::SvrResponse resp;
+	resp.set_error(managarm::posix::Errors::SUCCESS);
 
-			managarm::posix::SvrResponse resp;
-			resp.set_error(managarm::posix::Errors::SUCCESS);
+	auto ser = resp.SerializeAsString();
+	auto &&transmit = helix::submitAsync(conversation, helix::Dispatcher::global(),
+			helix::action(&send_resp, ser.data(), ser.size()));
+	co_await transmit.async_wait();
+	HEL_CHECK(send_resp.error());
+	co_return RequestResult::handled;
+}
 
-			auto ser = resp.SerializeAsString();
-			auto &&transmit = helix::submitAsync(conversation, helix::Dispatcher::global(),
-					helix::action(&send_resp, ser.data(), ser.size()));
-			co_await transmit.async_wait();
-			HEL_CHECK(send_resp.error());
-		}else if(req.request_type() == managarm::posix::CntReqType::EPOLL_WAIT) {
-			if(logRequests)
-				std::cout << "posix: EPOLL_WAIT request" << std::endl;
+async::result<RequestResult> RequestContext::handleCntSignalfdCreate() {
+	if(logRequests)
+		std::cout << "posix: SIGNALFD_CREATE" << std::endl;
 
-			helix::SendBuffer send_resp;
-			helix::SendBuffer send_data;
-			uint64_t former = self->signalMask();
+	helix::SendBuffer send_resp;
 
-			auto epfile = self->fileContext()->getFile(req.fd());
-			if(!epfile) {
-				co_await sendErrorResponse(managarm::posix::Errors::BAD_FD);
-				continue;
-			}
-			if(req.sigmask_needed()) {
-				self->setSignalMask(req.sigmask());
-			}
+	if(req.flags() & ~(managarm::posix::OpenFlags::OF_CLOEXEC
+			| managarm::posix::OpenFlags::OF_NONBLOCK)) {
+		co_await sendErrorResponse(managarm::posix::Errors::ILLEGAL_ARGUMENTS);
+		co_return RequestResult::handled;
+	}
 
-			struct epoll_event events[16];
-			size_t k;
-			if(req.timeout() < 0) {
-				k = co_await epoll::wait(epfile.get(), events,
-						std::min(req.size(), uint32_t(16)));
-			}else if(!req.timeout()) {
-				// Do not bother to set up a timer for zero timeouts.
-				async::cancellation_event cancel_wait;
-				cancel_wait.cancel();
-				k = co_await epoll::wait(epfile.get(), events,
-						std::min(req.size(), uint32_t(16)), cancel_wait);
-			}else{
-				assert(req.timeout() > 0);
-				async::cancellation_event cancel_wait;
-				helix::TimeoutCancellation timer{static_cast<uint64_t>(req.timeout()), cancel_wait};
-				k = co_await epoll::wait(epfile.get(), events, 16, cancel_wait);
-				co_await timer.retire();
-			}
-			if(req.sigmask_needed()) {
-				self->setSignalMask(former);
-			}
+	auto file = createSignalFile(req.sigset(),
+			req.flags() & managarm::posix::OpenFlags::OF_NONBLOCK);
+	auto fd = self->fileContext()->attachFile(file,
+			req.flags() & managarm::posix::OpenFlags::OF_CLOEXEC);
+
+	managarm::posix::SvrResponse resp;
+	resp.set_error(managarm::posix::Errors::SUCCESS);
+	resp.set_fd(fd);
+
+	auto ser = resp.SerializeAsString();
+	auto &&transmit = helix::submitAsync(conversation, helix::Dispatcher::global(),
+			helix::action(&send_resp, ser.data(), ser.size()));
+	co_await transmit.async_wait();
+	HEL_CHECK(send_resp.error());
+	co_return RequestResult::handled;
+}
 
-			managarm::posix::SvrResponse resp;
-			resp.set_error(managarm::posix::Errors::SUCCESS);
+async::result<RequestResult> RequestContext::handleInotifyCreate() {
+	auto req = bragi::parse_head_only<managarm::posix::InotifyCreateRequest>(recv_head);
 
-			auto ser = resp.SerializeAsString();
-			auto &&transmit = helix::submitAsync(conversation, helix::Dispatcher::global(),
-					helix::action(&send_resp, ser.data(), ser.size(), kHelItemChain),
-					helix::action(&send_data, events, k * sizeof(struct epoll_event)));
-			co_await transmit.async_wait();
-			HEL_CHECK(send_resp.error());
-		}else if(req.request_type() == managarm::posix::CntReqType::TIMERFD_CREATE) {
-			if(logRequests)
-				std::cout << "posix: TIMERFD_CREATE" << std::endl;
+	if (!req) {
+		std::cout << "posix: Rejecting request due to decoding failure" << std::endl;
+		co_return RequestResult::stop;
+	}
+
+	if(logRequests)
+		std::cout << "posix: INOTIFY_CREATE" << std::endl;
 
-			helix::SendBuffer send_resp;
+	assert(!(req->flags() & ~(managarm::posix::OpenFlags::OF_CLOEXEC | managarm::posix::OpenFlags::OF_NONBLOCK)));
 
-			assert(!(req.flags() & ~(TFD_CLOEXEC | TFD_NONBLOCK)));
+	// TODO: Implement blocking reads
+	if(!(req->flags() & managarm::posix::OpenFlags::OF_NONBLOCK))
+		std::cout << "posix: INOTIFY_CREATE doesn't do blocking reads" << std::endl;
 
-			auto file = timerfd::createFile(req.flags() & TFD_NONBLOCK);
-			auto fd = self->fileContext()->attachFile(file, req.flags() & TFD_CLOEXEC);
+	auto file = inotify::createFile();
+	auto fd = self->fileContext()->attachFile(file,
+			req->flags() & managarm::posix::OpenFlags::OF_CLOEXEC);
 
-			managarm::posix::SvrResponse resp;
-			resp.set_error(managarm::posix::Errors::SUCCESS);
-			resp.set_fd(fd);
+	managarm::posix::SvrResponse resp;
+	resp.set_error(managarm::posix::Errors::SUCCESS);
+	resp.set_fd(fd);
 
-			auto ser = resp.SerializeAsString();
-			auto &&transmit = helix::submitAsync(conversation, helix::Dispatcher::global(),
-					helix::action(&send_resp, ser.data(), ser.size()));
-			co_await transmit.async_wait();
-			HEL_CHECK(send_resp.error());
-		}else if(req.request_type() == managarm::posix::CntReqType::TIMERFD_SETTIME) {
-			if(logRequests)
-				std::cout << "posix: TIMERFD_SETTIME" << std::endl;
+	auto [send_resp] = co_await helix_ng::exchangeMsgs(
+			conversation,
+			helix_ng::sendBragiHeadOnly(resp, frg::stl_allocator{})
+		);
 
-			helix::SendBuffer send_resp;
+	HEL_CHECK(send_resp.error());
+	co_return RequestResult::handled;
+}
 
-			auto file = self->fileContext()->getFile(req.fd());
-			assert(file && "Illegal FD for TIMERFD_SETTIME");
-			timerfd::setTime(file.get(),
-					{static_cast<time_t>(req.time_secs()), static_cast<long>(req.time_nanos())},
-					{static_cast<time_t>(req.interval_secs()), static_cast<long>(req.interval_nanos())});
+async::result<RequestResult> RequestContext::handleInotifyAdd() {
+	std::vector<std::byte> tail(preamble.tail_size());
+	auto [recv_tail] = co_await helix_ng::exchangeMsgs(
+			conversation,
+			helix_ng::recvBuffer(tail.data(), tail.size())
+		);
+	HEL_CHECK(recv_tail.error());
 
-			managarm::posix::SvrResponse resp;
-			resp.set_error(managarm::posix::Errors::SUCCESS);
+	auto req = bragi::parse_head_tail<managarm::posix::InotifyAddRequest>(recv_head, tail);
 
-			auto ser = resp.SerializeAsString();
-			auto &&transmit = helix::submitAsync(conversation, helix::Dispatcher::global(),
-					helix::action(&send_resp, ser.data(), ser.size()));
-			co_await transmit.async_wait();
-			HEL_CHECK(send_resp.error());
-		}else if(req.request_type() == managarm::posix::CntReqType::SIGNALFD_CREATE) {
-			if(logRequests)
-				std::cout << "posix: SIGNALFD_CREATE" << std::endl;
+	if (!req) {
+		std::cout << "posix: Rejecting request due to decoding failure" << std::endl;
+		co_return RequestResult::stop;
+	}
 
-			helix::SendBuffer send_resp;
+	managarm::posix::SvrResponse resp;
 
-			if(req.flags() & ~(managarm::posix::OpenFlags::OF_CLOEXEC
-					| managarm::posix::OpenFlags::OF_NONBLOCK)) {
-				co_await sendErrorResponse(managarm::posix::Errors::ILLEGAL_ARGUMENTS);
-				continue;
-			}
+	if(logRequests || logPaths)
+		std::cout << "posix: INOTIFY_ADD" << req->path() << std::endl;
 
-			auto file = createSignalFile(req.sigset(),
-					req.flags() & managarm::posix::OpenFlags::OF_NONBLOCK);
-			auto fd = self->fileContext()->attachFile(file,
-					req.flags() & managarm::posix::OpenFlags::OF_CLOEXEC);
+	auto ifile = self->fileContext()->getFile(req->fd());
+	if(!ifile) {
+		co_await sendErrorResponse(managarm::posix::Errors::BAD_FD);
+		co_return RequestResult::handled;
+	}
 
-			managarm::posix::SvrResponse resp;
-			resp.set_error(managarm::posix::Errors::SUCCESS);
-			resp.set_fd(fd);
+	PathResolver resolver;
+	resolver.setup(self->fsContext()->getRoot(),
+			self->fsContext()->getWorkingDirectory(), req->path(), self.get());
+	auto resolveResult = co_await resolver.resolve();
+	if(!resolveResult) {
+		if(resolveResult.error() == protocols::fs::Error::fileNotFound) {
+			co_await sendErrorResponse(managarm::posix::Errors::FILE_NOT_FOUND);
+			co_return RequestResult::handled;
+		} else if(resolveResult.error() == protocols::fs::Error::notDirectory) {
+			co_await sendErrorResponse(managarm::posix::Errors::NOT_A_DIRECTORY);
+			co_return RequestResult::handled;
+		} else {
+			std::cout << "posix: Unexpected failure from resolve()" << std::endl;
+			co_return RequestResult::abort;
+		}
+	}
 
-			auto ser = resp.SerializeAsString();
-			auto &&transmit = helix::submitAsync(conversation, helix::Dispatcher::global(),
-					helix::action(&send_resp, ser.data(), ser.size()));
-			co_await transmit.async_wait();
-			HEL_CHECK(send_resp.error());
-		}else if(preamble.id() == managarm::posix::InotifyCreateRequest::message_id) {
-			auto req = bragi::parse_head_only<managarm::posix::InotifyCreateRequest>(recv_head);
+	auto wd = inotify::addWatch(ifile.get(), resolver.currentLink()->getTarget(),
+			req->flags());
 
-			if (!req) {
-				std::cout << "posix: Rejecting request due to decoding failure" << std::endl;
-				break;
-			}
+	resp.set_error(managarm::posix::Errors::SUCCESS);
+	resp.set_wd(wd);
+
+	auto [send_resp] = co_await helix_ng::exchangeMsgs(
+			conversation,
+			helix_ng::sendBragiHeadOnly(resp, frg::stl_allocator{})
+		);
 
-			if(logRequests)
-				std::cout << "posix: INOTIFY_CREATE" << std::endl;
+	HEL_CHECK(send_resp.error());
+	co_return RequestResult::handled;
+}
 
-			assert(!(req->flags() & ~(managarm::posix::OpenFlags::OF_CLOEXEC | managarm::posix::OpenFlags::OF_NONBLOCK)));
+async::result<RequestResult> RequestContext::handleEventfdCreate() {
+	auto req = bragi::parse_head_only<managarm::posix::EventfdCreateRequest>(recv_head);
 
-			// TODO: Implement blocking reads
-			if(!(req->flags() & managarm::posix::OpenFlags::OF_NONBLOCK))
-				std::cout << "posix: INOTIFY_CREATE doesn't do blocking reads" << std::endl;
+	if (!req) {
+		std::cout << "posix: Rejecting request due to decoding failure" << std::endl;
+		co_return RequestResult::stop;
+	}
 
-			auto file = inotify::createFile();
-			auto fd = self->fileContext()->attachFile(file,
-					req->flags() & managarm::posix::OpenFlags::OF_CLOEXEC);
+	if(logRequests)
+		std::cout << "posix: EVENTFD_CREATE" << std::endl;
+
+	managarm::posix::SvrResponse resp;
+
+	if (req->flags() & ~(managarm::posix::EventFdFlags::CLOEXEC
+			| managarm::posix::EventFdFlags::NONBLOCK
+			| managarm::posix::EventFdFlags::SEMAPHORE)) {
+		std::cout << "posix: invalid flag specified" << std::endl;
+		std::cout << "posix: flags specified: " << req->flags() << std::endl;
+		resp.set_error(managarm::posix::Errors::ILLEGAL_ARGUMENTS);
+	} else {
+		auto file = eventfd::createFile(req->initval(),
+			req->flags() & managarm::posix::EventFdFlags::NONBLOCK,
+			req->flags() & managarm::posix::EventFdFlags::SEMAPHORE);
+		auto fd = self->fileContext()->attachFile(file,
+				req->flags() & managarm::posix::EventFdFlags::CLOEXEC);
+
+		resp.set_error(managarm::posix::Errors::SUCCESS);
+		resp.set_fd(fd);
+	}
 
-			managarm::posix::SvrResponse resp;
-			resp.set_error(managarm::posix::Errors::SUCCESS);
-			resp.set_fd(fd);
+	auto [send_resp] = co_await helix_ng::exchangeMsgs(
+			conversation,
+			helix_ng::sendBragiHeadOnly(resp, frg::stl_allocator{})
+		);
 
-			auto [send_resp] = co_await helix_ng::exchangeMsgs(
-					conversation,
-					helix_ng::sendBragiHeadOnly(resp, frg::stl_allocator{})
-				);
+	HEL_CHECK(send_resp.error());
+	co_return RequestResult::handled;
+}
 
-			HEL_CHECK(send_resp.error());
-		}else if(preamble.id() == managarm::posix::InotifyAddRequest::message_id) {
-			std::vector<std::byte> tail(preamble.tail_size());
-			auto [recv_tail] = co_await helix_ng::exchangeMsgs(
-					conversation,
-					helix_ng::recvBuffer(tail.data(), tail.size())
-				);
-			HEL_CHECK(recv_tail.error());
+async::result<RequestResult> RequestContext::handleMknodAt() {
+	std::vector<std::byte> tail(preamble.tail_size());
+	auto [recv_tail] = co_await helix_ng::exchangeMsgs(
+			conversation,
+			helix_ng::recvBuffer(tail.data(), tail.size())
+		);
+	HEL_CHECK(recv_tail.error());
 
-			auto req = bragi::parse_head_tail<managarm::posix::InotifyAddRequest>(recv_head, tail);
+	auto req = bragi::parse_head_tail<managarm::posix::MknodAtRequest>(recv_head, tail);
 
-			if (!req) {
-				std::cout << "posix: Rejecting request due to decoding failure" << std::endl;
-				break;
-			}
+	if(!req) {
+		std::cout << "posix: Rejecting request due to decoding failure" << std::endl;
+		co_return RequestResult::stop;
+	}
 
-			managarm::posix::SvrResponse resp;
+	if(logRequests || logPaths)
+		std::cout << "posix: MKNODAT for path " << req->path() << " with mode " << req->mode() << " and device " << req->device() << std::endl;
 
-			if(logRequests || logPaths)
-				std::cout << "posix: INOTIFY_ADD" << req->path() << std::endl;
+	managarm::posix::SvrResponse resp;
 
-			auto ifile = self->fileContext()->getFile(req->fd());
-			if(!ifile) {
-				co_await sendErrorResponse(managarm::posix::Errors::BAD_FD);
-				continue;
-			}
+	ViewPath relative_to;
+	smarter::shared_ptr<File, FileHandle> file;
 
-			PathResolver resolver;
-			resolver.setup(self->fsContext()->getRoot(),
-					self->fsContext()->getWorkingDirectory(), req->path(), self.get());
-			auto resolveResult = co_await resolver.resolve();
-			if(!resolveResult) {
-				if(resolveResult.error() == protocols::fs::Error::fileNotFound) {
-					co_await sendErrorResponse(managarm::posix::Errors::FILE_NOT_FOUND);
-					continue;
-				} else if(resolveResult.error() == protocols::fs::Error::notDirectory) {
-					co_await sendErrorResponse(managarm::posix::Errors::NOT_A_DIRECTORY);
-					continue;
-				} else {
-					std::cout << "posix: Unexpected failure from resolve()" << std::endl;
-					co_return;
-				}
-			}
+	if(!req->path().size()) {
+		co_await sendErrorResponse(managarm::posix::Errors::ILLEGAL_ARGUMENTS);
+		co_return RequestResult::handled;
+	}
 
-			auto wd = inotify::addWatch(ifile.get(), resolver.currentLink()->getTarget(),
-					req->flags());
+	if(req->dirfd() == AT_FDCWD) {
+		relative_to = self->fsContext()->getWorkingDirectory();
+	} else {
+		file = self->fileContext()->getFile(req->dirfd());
 
-			resp.set_error(managarm::posix::Errors::SUCCESS);
-			resp.set_wd(wd);
+		if(!file) {
+			co_await sendErrorResponse(managarm::posix::Errors::BAD_FD);
+			co_return RequestResult::handled;
+		}
 
-			auto [send_resp] = co_await helix_ng::exchangeMsgs(
-					conversation,
-					helix_ng::sendBragiHeadOnly(resp, frg::stl_allocator{})
-				);
+		relative_to = {file->associatedMount(), file->associatedLink()};
+	}
 
-			HEL_CHECK(send_resp.error());
-		}else if(preamble.id() == managarm::posix::EventfdCreateRequest::message_id) {
-			auto req = bragi::parse_head_only<managarm::posix::EventfdCreateRequest>(recv_head);
+	// TODO: Add resolveNoTrailingSlash if not making a directory?
+	PathResolver resolver;
+	resolver.setup(self->fsContext()->getRoot(),
+			relative_to, req->path(), self.get());
+	auto resolveResult = co_await resolver.resolve(resolvePrefix);
+	if(!resolveResult) {
+		if(resolveResult.error() == protocols::fs::Error::fileNotFound) {
+			co_await sendErrorResponse(managarm::posix::Errors::FILE_NOT_FOUND);
+			co_return RequestResult::handled;
+		} else if(resolveResult.error() == protocols::fs::Error::notDirectory) {
+			co_await sendErrorResponse(managarm::posix::Errors::NOT_A_DIRECTORY);
+			co_return RequestResult::handled;
+		} else {
+			std::cout << "posix: Unexpected failure from resolve()" << std::endl;
+			co_return RequestResult::abort;
+		}
+	}
 
-			if (!req) {
-				std::cout << "posix: Rejecting request due to decoding failure" << std::endl;
-				break;
-			}
+	auto parent = resolver.currentLink()->getTarget();
+	auto existsResult = co_await parent->getLink(resolver.nextComponent());
+	assert(existsResult);
+	auto exists = existsResult.value();
+	if(exists) {
+		co_await sendErrorResponse(managarm::posix::Errors::ALREADY_EXISTS);
+		co_return RequestResult::handled;
+	}
 
-			if(logRequests)
-				std::cout << "posix: EVENTFD_CREATE" << std::endl;
+	VfsType type;
+	DeviceId dev;
+	if(S_ISDIR(req->mode())) {
+		type = VfsType::directory;
+	} else if(S_ISCHR(req->mode())) {
+		type = VfsType::charDevice;
+	} else if(S_ISBLK(req->mode())) {
+		type = VfsType::blockDevice;
+	} else if(S_ISREG(req->mode())) {
+		type = VfsType::regular;
+	} else if(S_ISFIFO(req->mode())) {
+		type = VfsType::fifo;
+	} else if(S_ISLNK(req->mode())) {
+		type = VfsType::symlink;
+	} else if(S_ISSOCK(req->mode())) {
+		type = VfsType::socket;
+	} else {
+		type = VfsType::null;
+	}
 
-			managarm::posix::SvrResponse resp;
+	// TODO: Verify the proper error return here.
+	if(type == VfsType::charDevice || type == VfsType::blockDevice) {
+		dev.first = major(req->device());
+		dev.second = minor(req->device());
 
-			if (req->flags() & ~(managarm::posix::EventFdFlags::CLOEXEC
-					| managarm::posix::EventFdFlags::NONBLOCK
-					| managarm::posix::EventFdFlags::SEMAPHORE)) {
-				std::cout << "posix: invalid flag specified" << std::endl;
-				std::cout << "posix: flags specified: " << req->flags() << std::endl;
-				resp.set_error(managarm::posix::Errors::ILLEGAL_ARGUMENTS);
+		auto result = co_await parent->mkdev(resolver.nextComponent(), type, dev);
+		if(!result) {
+			if(result.error() == Error::illegalOperationTarget) {
+				co_await sendErrorResponse(managarm::posix::Errors::ILLEGAL_ARGUMENTS);
+				co_return RequestResult::handled;
 			} else {
-				auto file = eventfd::createFile(req->initval(),
-					req->flags() & managarm::posix::EventFdFlags::NONBLOCK,
-					req->flags() & managarm::posix::EventFdFlags::SEMAPHORE);
-				auto fd = self->fileContext()->attachFile(file,
-						req->flags() & managarm::posix::EventFdFlags::CLOEXEC);
-
-				resp.set_error(managarm::posix::Errors::SUCCESS);
-				resp.set_fd(fd);
+				std::cout << "posix: Unexpected failure from mkdev()" << std::endl;
+				co_return RequestResult::abort;
 			}
+		}
+	} else if(type == VfsType::fifo) {
+		auto result = co_await parent->mkfifo(resolver.nextComponent(), req->mode());
+		if(!result) {
+			if(result.error() == Error::illegalOperationTarget) {
+				co_await sendErrorResponse(managarm::posix::Errors::ILLEGAL_ARGUMENTS);
+				co_return RequestResult::handled;
+			} else {
+				std::cout << "posix: Unexpected failure from mkfifo()" << std::endl;
+				co_return RequestResult::abort;
+			}
+		}
+	} else if(type == VfsType::socket) {
+		auto result = co_await parent->mksocket(resolver.nextComponent());
+		if(!result) {
+			if(result.error() == Error::illegalOperationTarget) {
+				co_await sendErrorResponse(managarm::posix::Errors::ILLEGAL_ARGUMENTS);
+				co_return RequestResult::handled;
+			} else {
+				std::cout << "posix: Unexpected failure from mksocket()" << std::endl;
+				co_return RequestResult::abort;
+			}
+		}
+	} else {
+		// TODO: Handle regular files.
+		std::cout << "\e[31mposix: Creating regular files with mknod is not supported.\e[39m" << std::endl;
+		co_await sendErrorResponse(managarm::posix::Errors::ILLEGAL_ARGUMENTS);
+		co_return RequestResult::handled;
+	}
+	resp.set_error(managarm::posix::Errors::SUCCESS);
 
-			auto [send_resp] = co_await helix_ng::exchangeMsgs(
-					conversation,
-					helix_ng::sendBragiHeadOnly(resp, frg::stl_allocator{})
-				);
-
-			HEL_CHECK(send_resp.error());
-		}else if(preamble.id() == managarm::posix::MknodAtRequest::message_id) {
-			std::vector<std::byte> tail(preamble.tail_size());
-			auto [recv_tail] = co_await helix_ng::exchangeMsgs(
-					conversation,
-					helix_ng::recvBuffer(tail.data(), tail.size())
-				);
-			HEL_CHECK(recv_tail.error());
+	auto [send_resp] = co_await helix_ng::exchangeMsgs(
+			conversation,
+			helix_ng::sendBragiHeadOnly(resp, frg::stl_allocator{})
+		);
 
-			auto req = bragi::parse_head_tail<managarm::posix::MknodAtRequest>(recv_head, tail);
+	HEL_CHECK(send_resp.error());
+	co_return RequestResult::handled;
+}
 
-			if(!req) {
-				std::cout << "posix: Rejecting request due to decoding failure" << std::endl;
-				break;
-			}
+async::result<RequestResult> RequestContext::handleGetPgid() {
+	auto req = bragi::parse_head_only<managarm::posix::GetPgidRequest>(recv_head);
 
-			if(logRequests || logPaths)
-				std::cout << "posix: MKNODAT for path " << req->path() << " with mode " << req->mode() << " and device " << req->device() << std::endl;
+	if (!req) {
+		std::cout << "posix: Rejecting request due to decoding failure" << std::endl;
+		co_return RequestResult::stop;
+	}
 
-			managarm::posix::SvrResponse resp;
+	if(logRequests)
+		std::cout << "posix: GET_PGID" << std::endl;
 
-			ViewPath relative_to;
-			smarter::shared_ptr<File, FileHandle> file;
+	std::shared_ptr<Process> target;
+	if(req->pid()) {
+		target = Process::findProcess(req->pid());
+		if(!target) {
+			co_await sendErrorResponse(managarm::posix::Errors::NO_SUCH_RESOURCE);
+			co_return RequestResult::handled;
+		}
+	} else {
+		target = self;
+	}
 
-			if(!req->path().size()) {
-				co_await sendErrorResponse(managarm::posix::Errors::ILLEGAL_ARGUMENTS);
-				continue;
-			}
+	managarm::posix::SvrResponse resp;
+	resp.set_error(managarm::posix::Errors::SUCCESS);
+	resp.set_pid(target->pgPointer()->getHull()->getPid());
 
-			if(req->dirfd() == AT_FDCWD) {
-				relative_to = self->fsContext()->getWorkingDirectory();
-			} else {
-				file = self->fileContext()->getFile(req->dirfd());
+	auto [send_resp] = co_await helix_ng::exchangeMsgs(
+			conversation,
+			helix_ng::sendBragiHeadOnly(resp, frg::stl_allocator{})
+		);
 
-				if(!file) {
-					co_await sendErrorResponse(managarm::posix::Errors::BAD_FD);
-					continue;
-				}
+	HEL_CHECK(send_resp.error());
+	co_return RequestResult::handled;
+}
 
-				relative_to = {file->associatedMount(), file->associatedLink()};
-			}
+async::result<RequestResult> RequestContext::handleSetPgid() {
+	auto req = bragi::parse_head_only<managarm::posix::SetPgidRequest>(recv_head);
 
-			// TODO: Add resolveNoTrailingSlash if not making a directory?
-			PathResolver resolver;
-			resolver.setup(self->fsContext()->getRoot(),
-					relative_to, req->path(), self.get());
-			auto resolveResult = co_await resolver.resolve(resolvePrefix);
-			if(!resolveResult) {
-				if(resolveResult.error() == protocols::fs::Error::fileNotFound) {
-					co_await sendErrorResponse(managarm::posix::Errors::FILE_NOT_FOUND);
-					continue;
-				} else if(resolveResult.error() == protocols::fs::Error::notDirectory) {
-					co_await sendErrorResponse(managarm::posix::Errors::NOT_A_DIRECTORY);
-					continue;
-				} else {
-					std::cout << "posix: Unexpected failure from resolve()" << std::endl;
-					co_return;
-				}
-			}
+	if (!req) {
+		std::cout << "posix: Rejecting request due to decoding failure" << std::endl;
+		co_return RequestResult::stop;
+	}
 
-			auto parent = resolver.currentLink()->getTarget();
-			auto existsResult = co_await parent->getLink(resolver.nextComponent());
-			assert(existsResult);
-			auto exists = existsResult.value();
-			if(exists) {
-				co_await sendErrorResponse(managarm::posix::Errors::ALREADY_EXISTS);
-				continue;
-			}
+	if(logRequests)
+		std::cout << "posix: SET_PGID" << std::endl;
 
-			VfsType type;
-			DeviceId dev;
-			if(S_ISDIR(req->mode())) {
-				type = VfsType::directory;
-			} else if(S_ISCHR(req->mode())) {
-				type = VfsType::charDevice;
-			} else if(S_ISBLK(req->mode())) {
-				type = VfsType::blockDevice;
-			} else if(S_ISREG(req->mode())) {
-				type = VfsType::regular;
-			} else if(S_ISFIFO(req->mode())) {
-				type = VfsType::fifo;
-			} else if(S_ISLNK(req->mode())) {
-				type = VfsType::symlink;
-			} else if(S_ISSOCK(req->mode())) {
-				type = VfsType::socket;
-			} else {
-				type = VfsType::null;
-			}
+	std::shared_ptr<Process> target;
+	if(req->pid()) {
+		target = Process::findProcess(req->pid());
+		if(!target) {
+			co_await sendErrorResponse(managarm::posix::Errors::NO_SUCH_RESOURCE);
+			co_return RequestResult::handled;
+		}
+	} else {
+		target = self;
+	}
 
-			// TODO: Verify the proper error return here.
-			if(type == VfsType::charDevice || type == VfsType::blockDevice) {
-				dev.first = major(req->device());
-				dev.second = minor(req->device());
-
-				auto result = co_await parent->mkdev(resolver.nextComponent(), type, dev);
-				if(!result) {
-					if(result.error() == Error::illegalOperationTarget) {
-						co_await sendErrorResponse(managarm::posix::Errors::ILLEGAL_ARGUMENTS);
-						continue;
-					} else {
-						std::cout << "posix: Unexpected failure from mkdev()" << std::endl;
-						co_return;
-					}
-				}
-			} else if(type == VfsType::fifo) {
-				auto result = co_await parent->mkfifo(resolver.nextComponent(), req->mode());
-				if(!result) {
-					if(result.error() == Error::illegalOperationTarget) {
-						co_await sendErrorResponse(managarm::posix::Errors::ILLEGAL_ARGUMENTS);
-						continue;
-					} else {
-						std::cout << "posix: Unexpected failure from mkfifo()" << std::endl;
-						co_return;
-					}
-				}
-			} else if(type == VfsType::socket) {
-				auto result = co_await parent->mksocket(resolver.nextComponent());
-				if(!result) {
-					if(result.error() == Error::illegalOperationTarget) {
-						co_await sendErrorResponse(managarm::posix::Errors::ILLEGAL_ARGUMENTS);
-						continue;
-					} else {
-						std::cout << "posix: Unexpected failure from mksocket()" << std::endl;
-						co_return;
-					}
-				}
-			} else {
-				// TODO: Handle regular files.
-				std::cout << "\e[31mposix: Creating regular files with mknod is not supported.\e[39m" << std::endl;
-				co_await sendErrorResponse(managarm::posix::Errors::ILLEGAL_ARGUMENTS);
-				continue;
-			}
-			resp.set_error(managarm::posix::Errors::SUCCESS);
+	if(target->pgPointer()->getSession() != self->pgPointer()->getSession()) {
+		co_await sendErrorResponse(managarm::posix::Errors::INSUFFICIENT_PERMISSION);
+		co_return RequestResult::handled;
+	}
 
-			auto [send_resp] = co_await helix_ng::exchangeMsgs(
-					conversation,
-					helix_ng::sendBragiHeadOnly(resp, frg::stl_allocator{})
-				);
+	// We can't change the process group ID of the session leader
+	if(target->pid() == target->pgPointer()->getSession()->getSessionId()) {
+		co_await sendErrorResponse(managarm::posix::Errors::INSUFFICIENT_PERMISSION);
+		co_return RequestResult::handled;
+	}
 
-			HEL_CHECK(send_resp.error());
-		}else if(preamble.id() == managarm::posix::GetPgidRequest::message_id) {
-			auto req = bragi::parse_head_only<managarm::posix::GetPgidRequest>(recv_head);
+	if(target->getParent()->pid() == self->pid()) {
+		if(target->didExecute()) {
+			co_await sendErrorResponse(managarm::posix::Errors::ACCESS_DENIED);
+			co_return RequestResult::handled;
+		}
+	}
 
-			if (!req) {
-				std::cout << "posix: Rejecting request due to decoding failure" << std::endl;
-				break;
-			}
+	std::shared_ptr<ProcessGroup> group;
+	// If pgid is 0, we're going to set it to the calling process's pid, use the target group.
+	if(req->pgid()) {
+		group = target->pgPointer()->getSession()->getProcessGroupById(req->pgid());
+	} else {
+		group = target->pgPointer();
+	}
 
-			if(logRequests)
-				std::cout << "posix: GET_PGID" << std::endl;
+	if(group) {
+		// Found, do permission checking and join
+		group->reassociateProcess(target.get());
+	} else {
+		// Not found, making it if pgid and pid match, or if pgid is 0, indicating that we should make one
+		if(target->pid() == req->pgid() || !req->pgid()) {
+			target->pgPointer()->getSession()->spawnProcessGroup(target.get());
+		} else {
+			// Doesn't exists, and not requesting a make?
+			co_await sendErrorResponse(managarm::posix::Errors::NO_SUCH_RESOURCE);
+			co_return RequestResult::handled;
+		}
+	}
 
-			std::shared_ptr<Process> target;
-			if(req->pid()) {
-				target = Process::findProcess(req->pid());
-				if(!target) {
-					co_await sendErrorResponse(managarm::posix::Errors::NO_SUCH_RESOURCE);
-					continue;
-				}
-			} else {
-				target = self;
-			}
+	managarm::posix::SvrResponse resp;
+	resp.set_error(managarm::posix::Errors::SUCCESS);
 
-			managarm::posix::SvrResponse resp;
-			resp.set_error(managarm::posix::Errors::SUCCESS);
-			resp.set_pid(target->pgPointer()->getHull()->getPid());
+	auto [send_resp] = co_await helix_ng::exchangeMsgs(
+			conversation,
+			helix_ng::sendBragiHeadOnly(resp, frg::stl_allocator{})
+		);
 
-			auto [send_resp] = co_await helix_ng::exchangeMsgs(
-					conversation,
-					helix_ng::sendBragiHeadOnly(resp, frg::stl_allocator{})
-				);
+	HEL_CHECK(send_resp.error());
+	co_return RequestResult::handled;
+}
 
-			HEL_CHECK(send_resp.error());
-		}else if(preamble.id() == managarm::posix::SetPgidRequest::message_id) {
-			auto req = bragi::parse_head_only<managarm::posix::SetPgidRequest>(recv_head);
+async::result<RequestResult> RequestContext::handleGetSid() {
+	auto req = bragi::parse_head_only<managarm::posix::GetSidRequest>(recv_head);
 
-			if (!req) {
-				std::cout << "posix: Rejecting request due to decoding failure" << std::endl;
-				break;
-			}
+	if (!req) {
+		std::cout << "posix: Rejecting request due to decoding failure" << std::endl;
+		co_return RequestResult::stop;
+	}
 
-			if(logRequests)
-				std::cout << "posix: SET_PGID" << std::endl;
+	if(logRequests)
+		std::cout << "posix: GET_SID on pid " << req->pid() << std::endl;
 
-			std::shared_ptr<Process> target;
-			if(req->pid()) {
-				target = Process::findProcess(req->pid());
-				if(!target) {
-					co_await sendErrorResponse(managarm::posix::Errors::NO_SUCH_RESOURCE);
-					continue;
-				}
-			} else {
-				target = self;
-			}
+	std::shared_ptr<Process> target;
+	if(req->pid()) {
+		target = Process::findProcess(req->pid());
+		if(!target) {
+			co_await sendErrorResponse(managarm::posix::Errors::NO_SUCH_RESOURCE);
+			co_return RequestResult::handled;
+		}
+	} else {
+		target = self;
+	}
+	managarm::posix::SvrResponse resp;
+	resp.set_error(managarm::posix::Errors::SUCCESS);
+	resp.set_pid(target->pgPointer()->getSession()->getSessionId());
 
-			if(target->pgPointer()->getSession() != self->pgPointer()->getSession()) {
-				co_await sendErrorResponse(managarm::posix::Errors::INSUFFICIENT_PERMISSION);
-				continue;
-			}
+	auto [send_resp] = co_await helix_ng::exchangeMsgs(
+			conversation,
+			helix_ng::sendBragiHeadOnly(resp, frg::stl_allocator{})
+		);
 
-			// We can't change the process group ID of the session leader
-			if(target->pid() == target->pgPointer()->getSession()->getSessionId()) {
-				co_await sendErrorResponse(managarm::posix::Errors::INSUFFICIENT_PERMISSION);
-				continue;
-			}
+	HEL_CHECK(send_resp.error());
+	co_return RequestResult::handled;
+}
 
-			if(target->getParent()->pid() == self->pid()) {
-				if(target->didExecute()) {
-					co_await sendErrorResponse(managarm::posix::Errors::ACCESS_DENIED);
-					continue;
-				}
-			}
+async::result<RequestResult> RequestContext::handleMemFdCreate() {
+	managarm::posix::SvrResponse resp;
+	std::vector<std::byte> tail(preamble.tail_size());
+	auto [recv_tail] = co_await helix_ng::exchangeMsgs(
+			conversation,
+			helix_ng::recvBuffer(tail.data(), tail.size())
+		);
+	HEL_CHECK(recv_tail.error());
 
-			std::shared_ptr<ProcessGroup> group;
-			// If pgid is 0, we're going to set it to the calling process's pid, use the target group.
-			if(req->pgid()) {
-				group = target->pgPointer()->getSession()->getProcessGroupById(req->pgid());
-			} else {
-				group = target->pgPointer();
-			}
+	auto req = bragi::parse_head_tail<managarm::posix::MemFdCreateRequest>(recv_head, tail);
 
-			if(group) {
-				// Found, do permission checking and join
-				group->reassociateProcess(target.get());
-			} else {
-				// Not found, making it if pgid and pid match, or if pgid is 0, indicating that we should make one
-				if(target->pid() == req->pgid() || !req->pgid()) {
-					target->pgPointer()->getSession()->spawnProcessGroup(target.get());
-				} else {
-					// Doesn't exists, and not requesting a make?
-					co_await sendErrorResponse(managarm::posix::Errors::NO_SUCH_RESOURCE);
-					continue;
-				}
-			}
+	if (!req) {
+		std::cout << "posix: Rejecting request due to decoding failure" << std::endl;
+		co_return RequestResult::stop;
+	}
 
-			managarm::posix::SvrResponse resp;
-			resp.set_error(managarm::posix::Errors::SUCCESS);
+	if(logRequests)
+		std::cout << "posix: MEMFD_CREATE " << req->name() << std::endl;
 
-			auto [send_resp] = co_await helix_ng::exchangeMsgs(
-					conversation,
-					helix_ng::sendBragiHeadOnly(resp, frg::stl_allocator{})
-				);
+	if(req->flags() & ~(MFD_CLOEXEC | MFD_ALLOW_SEALING)) {
+		co_await sendErrorResponse(managarm::posix::Errors::ILLEGAL_ARGUMENTS);
+		co_return RequestResult::handled;
+	}
 
-			HEL_CHECK(send_resp.error());
-		}else if(preamble.id() == managarm::posix::GetSidRequest::message_id) {
-			auto req = bragi::parse_head_only<managarm::posix::GetSidRequest>(recv_head);
+	auto link = SpecialLink::makeSpecialLink(VfsType::regular, 0777);
+	auto memFile = smarter::make_shared<MemoryFile>(nullptr, link, (req->flags() & MFD_ALLOW_SEALING) == true);
+	MemoryFile::serve(memFile);
+	auto file = File::constructHandle(std::move(memFile));
 
-			if (!req) {
-				std::cout << "posix: Rejecting request due to decoding failure" << std::endl;
-				break;
-			}
+	int flags = 0;
 
-			if(logRequests)
-				std::cout << "posix: GET_SID on pid " << req->pid() << std::endl;
+	if(req->flags() & MFD_CLOEXEC) {
+		flags |= managarm::posix::OpenFlags::OF_CLOEXEC;
+	}
 
-			std::shared_ptr<Process> target;
-			if(req->pid()) {
-				target = Process::findProcess(req->pid());
-				if(!target) {
-					co_await sendErrorResponse(managarm::posix::Errors::NO_SUCH_RESOURCE);
-					continue;
-				}
-			} else {
-				target = self;
-			}
-			managarm::posix::SvrResponse resp;
-			resp.set_error(managarm::posix::Errors::SUCCESS);
-			resp.set_pid(target->pgPointer()->getSession()->getSessionId());
+	int fd = self->fileContext()->attachFile(file, flags);
 
-			auto [send_resp] = co_await helix_ng::exchangeMsgs(
-					conversation,
-					helix_ng::sendBragiHeadOnly(resp, frg::stl_allocator{})
-				);
+	resp.set_error(managarm::posix::Errors::SUCCESS);
+	resp.set_fd(fd);
 
-			HEL_CHECK(send_resp.error());
-		}else if(preamble.id() == managarm::posix::MemFdCreateRequest::message_id) {
-			managarm::posix::SvrResponse resp;
-			std::vector<std::byte> tail(preamble.tail_size());
-			auto [recv_tail] = co_await helix_ng::exchangeMsgs(
-					conversation,
-					helix_ng::recvBuffer(tail.data(), tail.size())
-				);
-			HEL_CHECK(recv_tail.error());
+	auto [sendResp] = co_await helix_ng::exchangeMsgs(
+			conversation,
+			helix_ng::sendBragiHeadOnly(resp, frg::stl_allocator{})
+		);
+	HEL_CHECK(sendResp.error());
+	co_return RequestResult::handled;
+}
 
-			auto req = bragi::parse_head_tail<managarm::posix::MemFdCreateRequest>(recv_head, tail);
+async::result<RequestResult> RequestContext::handleSetAffinity() {
+	std::vector<uint8_t> tail(preamble.tail_size());
+	auto [recv_tail] = co_await helix_ng::exchangeMsgs(
+			conversation,
+			helix_ng::recvBuffer(tail.data(), tail.size())
+		);
+	HEL_CHECK(recv_tail.error());
+
+	auto req = bragi::parse_head_tail<managarm::posix::SetAffinityRequest>(recv_head, tail);
+	
+	if (!req) {
+		std::cout << "posix: Rejecting request due to decoding failure" << std::endl;
+		co_return RequestResult::stop;
+	}
 
-			if (!req) {
-				std::cout << "posix: Rejecting request due to decoding failure" << std::endl;
-				break;
-			}
+	if(logRequests)
+		std::cout << "posix: SET_AFFINITY" << std::endl;
 
-			if(logRequests)
-				std::cout << "posix: MEMFD_CREATE " << req->name() << std::endl;
+	auto handle = self->threadDescriptor().getHandle();
 
-			if(req->flags() & ~(MFD_CLOEXEC | MFD_ALLOW_SEALING)) {
-				co_await sendErrorResponse(managarm::posix::Errors::ILLEGAL_ARGUMENTS);
-				continue;
-			}
+	if(self->pid() != req->pid()) {
+		// TODO: permission checking
+		auto target_process = self->findProcess(req->pid());
+		if(target_process == nullptr) {
+			co_await sendErrorResponse(managarm::posix::Errors::ILLEGAL_ARGUMENTS);
+			co_return RequestResult::handled;
+		}
+		handle = target_process->threadDescriptor().getHandle();
+	}
 
-			auto link = SpecialLink::makeSpecialLink(VfsType::regular, 0777);
-			auto memFile = smarter::make_shared<MemoryFile>(nullptr, link, (req->flags() & MFD_ALLOW_SEALING) == true);
-			MemoryFile::serve(memFile);
-			auto file = File::constructHandle(std::move(memFile));
+	HelError e = helSetAffinity(handle, req->mask().data(), req->mask().size());
 
-			int flags = 0;
+	if(e == kHelErrIllegalArgs) {
+		co_await sendErrorResponse(managarm::posix::Errors::ILLEGAL_ARGUMENTS);
+		co_return RequestResult::handled;
+	} else if(e != kHelErrNone) {
+		std::cout << "posix: SET_AFFINITY hel call returned unexpected error: " << e << std::endl;
+		co_await sendErrorResponse(managarm::posix::Errors::INTERNAL_ERROR);
+		co_return RequestResult::handled;
+	}
 
-			if(req->flags() & MFD_CLOEXEC) {
-				flags |= managarm::posix::OpenFlags::OF_CLOEXEC;
-			}
+	managarm::posix::SvrResponse resp;
+	resp.set_error(managarm::posix::Errors::SUCCESS);
 
-			int fd = self->fileContext()->attachFile(file, flags);
-
-			resp.set_error(managarm::posix::Errors::SUCCESS);
-			resp.set_fd(fd);
-
-			auto [sendResp] = co_await helix_ng::exchangeMsgs(
-					conversation,
-					helix_ng::sendBragiHeadOnly(resp, frg::stl_allocator{})
-				);
-			HEL_CHECK(sendResp.error());
-		}else if(preamble.id() == managarm::posix::SetAffinityRequest::message_id) {
-			std::vector<uint8_t> tail(preamble.tail_size());
-			auto [recv_tail] = co_await helix_ng::exchangeMsgs(
-					conversation,
-					helix_ng::recvBuffer(tail.data(), tail.size())
-				);
-			HEL_CHECK(recv_tail.error());
-
-			auto req = bragi::parse_head_tail<managarm::posix::SetAffinityRequest>(recv_head, tail);
-			
-			if (!req) {
-				std::cout << "posix: Rejecting request due to decoding failure" << std::endl;
-				break;
-			}
+	auto [sendResp] = co_await helix_ng::exchangeMsgs(
+		conversation,
+		helix_ng::sendBragiHeadOnly(resp, frg::stl_allocator{})
+	);
+	HEL_CHECK(sendResp.error());
+	co_return RequestResult::handled;
+}
 
-			if(logRequests)
-				std::cout << "posix: SET_AFFINITY" << std::endl;
+async::result<RequestResult> RequestContext::handleGetAffinity() {
+	auto req = bragi::parse_head_only<managarm::posix::GetAffinityRequest>(recv_head);
+	
+	if (!req) {
+		std::cout << "posix: Rejecting request due to decoding failure" << std::endl;
+		co_return RequestResult::stop;
+	}
 
-			auto handle = self->threadDescriptor().getHandle();
+	if(logRequests)
+		std::cout << "posix: GET_AFFINITY" << std::endl;
 
-			if(self->pid() != req->pid()) {
-				// TODO: permission checking
-				auto target_process = self->findProcess(req->pid());
-				if(target_process == nullptr) {
-					co_await sendErrorResponse(managarm::posix::Errors::ILLEGAL_ARGUMENTS);
-					continue;
-				}
-				handle = target_process->threadDescriptor().getHandle();
-			}
+	if(!req->size()) {
+		co_await sendErrorResponse(managarm::posix::Errors::ILLEGAL_ARGUMENTS);
+		co_return RequestResult::handled;
+	}
 
-			HelError e = helSetAffinity(handle, req->mask().data(), req->mask().size());
+	std::vector<uint8_t> affinity(req->size());
 
-			if(e == kHelErrIllegalArgs) {
-				co_await sendErrorResponse(managarm::posix::Errors::ILLEGAL_ARGUMENTS);
-				continue;
-			} else if(e != kHelErrNone) {
-				std::cout << "posix: SET_AFFINITY hel call returned unexpected error: " << e << std::endl;
-				co_await sendErrorResponse(managarm::posix::Errors::INTERNAL_ERROR);
-				continue;
-			}
+	auto handle = self->threadDescriptor().getHandle();
 
-			managarm::posix::SvrResponse resp;
-			resp.set_error(managarm::posix::Errors::SUCCESS);
+	if(self->pid() != req->pid()) {
+		// TODO: permission checking
+		auto target_process = self->findProcess(req->pid());
+		if(target_process == nullptr) {
+			co_await sendErrorResponse(managarm::posix::Errors::ILLEGAL_ARGUMENTS);
+			co_return RequestResult::handled;
+		}
+		handle = target_process->threadDescriptor().getHandle();
+	}
 
-			auto [sendResp] = co_await helix_ng::exchangeMsgs(
-				conversation,
-				helix_ng::sendBragiHeadOnly(resp, frg::stl_allocator{})
-			);
-			HEL_CHECK(sendResp.error());
-		}else if(preamble.id() == managarm::posix::GetAffinityRequest::message_id) {
-			auto req = bragi::parse_head_only<managarm::posix::GetAffinityRequest>(recv_head);
-			
-			if (!req) {
-				std::cout << "posix: Rejecting request due to decoding failure" << std::endl;
-				break;
-			}
+	size_t actual_size;
+	HelError e = helGetAffinity(handle, affinity.data(), req->size(), &actual_size);
 
-			if(logRequests)
-				std::cout << "posix: GET_AFFINITY" << std::endl;
+	if(e == kHelErrBufferTooSmall) {
+		co_await sendErrorResponse(managarm::posix::Errors::ILLEGAL_ARGUMENTS);
+		co_return RequestResult::handled;
+	} else if(e != kHelErrNone) {
+		std::cout << "posix: GET_AFFINITY hel call returned unexpected error: " << e << std::endl;
+		co_await sendErrorResponse(managarm::posix::Errors::INTERNAL_ERROR);
+		co_return RequestResult::handled;
+	}
 
-			if(!req->size()) {
-				co_await sendErrorResponse(managarm::posix::Errors::ILLEGAL_ARGUMENTS);
-				continue;
-			}
+	managarm::posix::SvrResponse resp;
+	resp.set_error(managarm::posix::Errors::SUCCESS);
+	resp.set_pid(self->pid());
+
+	auto [sendResp, sendData] = co_await helix_ng::exchangeMsgs(
+		conversation,
+		helix_ng::sendBragiHeadOnly(resp, frg::stl_allocator{}),
+		helix_ng::sendBuffer(affinity.data(), affinity.size())
+	);
+	HEL_CHECK(sendResp.error());
+	co_return RequestResult::handled;
+}
 
-			std::vector<uint8_t> affinity(req->size());
+async::result<RequestResult> RequestContext::handleGetMemoryInformation() {
+	auto req = bragi::parse_head_only<managarm::posix::GetMemoryInformationRequest>(recv_head);
 
-			auto handle = self->threadDescriptor().getHandle();
+	if (!req) {
+		std::cout << "posix: Rejecting request due to decoding failure" << std::endl;
+		co_return RequestResult::stop;
+	}
 
-			if(self->pid() != req->pid()) {
-				// TODO: permission checking
-				auto target_process = self->findProcess(req->pid());
-				if(target_process == nullptr) {
-					co_await sendErrorResponse(managarm::posix::Errors::ILLEGAL_ARGUMENTS);
-					continue;
-				}
-				handle = target_process->threadDescriptor().getHandle();
-			}
+	if(logRequests)
+		std::cout << "posix: GET_MEMORY_INFORMATION" << std::endl;
+
+	managarm::kerncfg::GetMemoryInformationRequest kerncfgRequest;
+	auto [offer, kerncfgSendResp, kerncfgResp] = co_await helix_ng::exchangeMsgs(
+		getKerncfgLane(),
+		helix_ng::offer(
+			helix_ng::sendBragiHeadOnly(kerncfgRequest, frg::stl_allocator{}),
+			helix_ng::recvInline()
+		)
+	);
+	HEL_CHECK(offer.error());
+	HEL_CHECK(kerncfgSendResp.error());
+	HEL_CHECK(kerncfgResp.error());
+
+	auto kernResp = bragi::parse_head_only<managarm::kerncfg::GetMemoryInformationResponse>(kerncfgResp);
+
+	managarm::posix::GetMemoryInformationResponse resp;
+	resp.set_total_usable_memory(kernResp->total_usable_memory());
+	resp.set_available_memory(kernResp->available_memory());
+	resp.set_memory_unit(kernResp->memory_unit());
+
+	auto [sendResp] = co_await helix_ng::exchangeMsgs(
+		conversation,
+		helix_ng::sendBragiHeadOnly(resp, frg::stl_allocator{})
+	);
+	HEL_CHECK(sendResp.error());
+	co_return RequestResult::handled;
+}
 
-			size_t actual_size;
-			HelError e = helGetAffinity(handle, affinity.data(), req->size(), &actual_size);
+async::result<RequestResult> RequestContext::handleSysconf() {
+	auto req = bragi::parse_head_only<managarm::posix::SysconfRequest>(recv_head);
 
-			if(e == kHelErrBufferTooSmall) {
-				co_await sendErrorResponse(managarm::posix::Errors::ILLEGAL_ARGUMENTS);
-				continue;
-			} else if(e != kHelErrNone) {
-				std::cout << "posix: GET_AFFINITY hel call returned unexpected error: " << e << std::endl;
-				co_await sendErrorResponse(managarm::posix::Errors::INTERNAL_ERROR);
-				continue;
-			}
+	if (!req) {
+		std::cout << "posix: Rejecting request due to decoding failure" << std::endl;
+		co_return RequestResult::stop;
+	}
 
-			managarm::posix::SvrResponse resp;
-			resp.set_error(managarm::posix::Errors::SUCCESS);
-			resp.set_pid(self->pid());
+	if(logRequests)
+		std::cout << "posix: SYSCONF" << std::endl;
+
+	managarm::posix::SysconfResponse resp;
+
+	// Configured == available == online
+	if(req->num() == _SC_NPROCESSORS_CONF || req->num() == _SC_NPROCESSORS_ONLN) {
+		managarm::kerncfg::GetNumCpuRequest kerncfgRequest;
+		auto [offer, kerncfgSendResp, kerncfgResp] = co_await helix_ng::exchangeMsgs(
+		getKerncfgLane(),
+		helix_ng::offer(
+				helix_ng::sendBragiHeadOnly(kerncfgRequest, frg::stl_allocator{}),
+				helix_ng::recvInline()
+			)
+		);
+		HEL_CHECK(offer.error());
+		HEL_CHECK(kerncfgSendResp.error());
+		HEL_CHECK(kerncfgResp.error());
+
+		auto kernResp = bragi::parse_head_only<managarm::kerncfg::GetNumCpuResponse>(kerncfgResp);
+
+		resp.set_error(managarm::posix::Errors::SUCCESS);
+		resp.set_value(kernResp->num_cpu());
+	} else {
+		// Not handled, bubble up EINVAL.
+		resp.set_error(managarm::posix::Errors::ILLEGAL_ARGUMENTS);
+	}
+	auto [send_resp] = co_await helix_ng::exchangeMsgs(
+		conversation,
+		helix_ng::sendBragiHeadOnly(resp, frg::stl_allocator{})
+	);
 
-			auto [sendResp, sendData] = co_await helix_ng::exchangeMsgs(
-				conversation,
-				helix_ng::sendBragiHeadOnly(resp, frg::stl_allocator{}),
-				helix_ng::sendBuffer(affinity.data(), affinity.size())
-			);
-			HEL_CHECK(sendResp.error());
-		}else if(preamble.id() == managarm::posix::GetMemoryInformationRequest::message_id) {
-			auto req = bragi::parse_head_only<managarm::posix::GetMemoryInformationRequest>(recv_head);
+	HEL_CHECK(send_resp.error());
+	co_return RequestResult::handled;
+}
 
-			if (!req) {
-				std::cout << "posix: Rejecting request due to decoding failure" << std::endl;
-				break;
-			}
+async::result<void> serveRequests(std::shared_ptr<Process> self,
+		std::shared_ptr<Generation> generation) {
+	async::cancellation_token cancellation = generation->cancelServe;
 
-			if(logRequests)
-				std::cout << "posix: GET_MEMORY_INFORMATION" << std::endl;
+	async::cancellation_callback cancel_callback{cancellation, [&] {
+		HEL_CHECK(helShutdownLane(self->posixLane().getHandle()));
+	}};
 
-			managarm::kerncfg::GetMemoryInformationRequest kerncfgRequest;
-			auto [offer, kerncfgSendResp, kerncfgResp] = co_await helix_ng::exchangeMsgs(
-				getKerncfgLane(),
-				helix_ng::offer(
-					helix_ng::sendBragiHeadOnly(kerncfgRequest, frg::stl_allocator{}),
+	while(true) {
+		auto [accept, recv_head] = co_await helix_ng::exchangeMsgs(
+				self->posixLane(),
+				helix_ng::accept(
 					helix_ng::recvInline()
 				)
 			);
-			HEL_CHECK(offer.error());
-			HEL_CHECK(kerncfgSendResp.error());
-			HEL_CHECK(kerncfgResp.error());
 
-			auto kernResp = bragi::parse_head_only<managarm::kerncfg::GetMemoryInformationResponse>(kerncfgResp);
+		if(accept.error() == kHelErrLaneShutdown)
+			break;
+		HEL_CHECK(accept.error());
+
+		if(recv_head.error() == kHelErrBufferTooSmall) {
+			std::cout << "posix: Rejecting request due to RecvInline overflow" << std::endl;
+			continue;
+		}
+		HEL_CHECK(recv_head.error());
 
-			managarm::posix::GetMemoryInformationResponse resp;
-			resp.set_total_usable_memory(kernResp->total_usable_memory());
-			resp.set_available_memory(kernResp->available_memory());
-			resp.set_memory_unit(kernResp->memory_unit());
+		auto conversation = accept.descriptor();
 
-			auto [sendResp] = co_await helix_ng::exchangeMsgs(
-				conversation,
-				helix_ng::sendBragiHeadOnly(resp, frg::stl_allocator{})
-			);
-			HEL_CHECK(sendResp.error());
-		}else if(preamble.id() == managarm::posix::SysconfRequest::message_id) {
-			auto req = bragi::parse_head_only<managarm::posix::SysconfRequest>(recv_head);
+		auto preamble = bragi::read_preamble(recv_head);
+		assert(!preamble.error());
+		recv_head.reset();
 
-			if (!req) {
+		managarm::posix::CntRequest req;
+		if (preamble.id() == managarm::posix::CntRequest::message_id) {
+			auto o = bragi::parse_head_only<managarm::posix::CntRequest>(recv_head);
+			if (!o) {
 				std::cout << "posix: Rejecting request due to decoding failure" << std::endl;
 				break;
 			}
 
-			if(logRequests)
-				std::cout << "posix: SYSCONF" << std::endl;
-
-			managarm::posix::SysconfResponse resp;
-
-			// Configured == available == online
-			if(req->num() == _SC_NPROCESSORS_CONF || req->num() == _SC_NPROCESSORS_ONLN) {
-				managarm::kerncfg::GetNumCpuRequest kerncfgRequest;
-				auto [offer, kerncfgSendResp, kerncfgResp] = co_await helix_ng::exchangeMsgs(
-				getKerncfgLane(),
-				helix_ng::offer(
-						helix_ng::sendBragiHeadOnly(kerncfgRequest, frg::stl_allocator{}),
-						helix_ng::recvInline()
-					)
-				);
-				HEL_CHECK(offer.error());
-				HEL_CHECK(kerncfgSendResp.error());
-				HEL_CHECK(kerncfgResp.error());
-
-				auto kernResp = bragi::parse_head_only<managarm::kerncfg::GetNumCpuResponse>(kerncfgResp);
-
-				resp.set_error(managarm::posix::Errors::SUCCESS);
-				resp.set_value(kernResp->num_cpu());
-			} else {
-				// Not handled, bubble up EINVAL.
-				resp.set_error(managarm::posix::Errors::ILLEGAL_ARGUMENTS);
-			}
-			auto [send_resp] = co_await helix_ng::exchangeMsgs(
-				conversation,
-				helix_ng::sendBragiHeadOnly(resp, frg::stl_allocator{})
-			);
+			req = *o;
+		}
 
-			HEL_CHECK(send_resp.error());
-		}else{
+		// Look up the handler (and the index of its statistics).
+		int n = -1;
+		if(preamble.id() == managarm::posix::CntRequest::message_id) {
+			if(req.request_type() < maxRequestId && cntIndex[req.request_type()] >= 0)
+				n = std::size(messageHandlers) + cntIndex[req.request_type()];
+		}else if(preamble.id() < maxRequestId) {
+			n = messageIndex[preamble.id()];
+		}
+
+		if(n < 0) {
 			std::cout << "posix: Illegal request" << std::endl;
 			helix::SendBuffer send_resp;
 
@@ -3579,7 +4077,25 @@ async::result<void> serveRequests(std::shared_ptr<Process> self,
 					helix::action(&send_resp, ser.data(), ser.size()));
 			co_await transmit.async_wait();
 			HEL_CHECK(send_resp.error());
+			continue;
 		}
+
+		RequestContext context{self, std::move(conversation), preamble,
+				std::move(recv_head), std::move(req)};
+
+		uint64_t startTime;
+		HEL_CHECK(helGetClock(&startTime));
+
+		auto result = co_await (context.*requestEntry(n).handler)();
+
+		uint64_t endTime;
+		HEL_CHECK(helGetClock(&endTime));
+		recordRequest(n, endTime - startTime);
+
+		if(result == RequestResult::stop)
+			break;
+		if(result == RequestResult::abort)
+			co_return;
 	}
 
 	if(logCleanup)
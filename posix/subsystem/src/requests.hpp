@@ -5,5 +5,8 @@
 async::result<void> serveRequests(std::shared_ptr<Process> self,
 		std::shared_ptr<Generation> generation);
 
+// Returns per-request counters and latency histograms in a human-readable format.
+std::string formatRequestStatistics();
+
 helix::UniqueLane &getKerncfgLane();
 helix::UniqueLane &getPmLane();
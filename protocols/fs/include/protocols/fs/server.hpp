@@ -190,6 +190,7 @@ struct FileOperations {
 	async::result<frg::expected<Error, int>> (*getSeals)(void *object) = nullptr;
 	async::result<frg::expected<Error, int>> (*addSeals)(void *object, int seals) = nullptr;
 	async::result<frg::expected<Error>> (*setSocketOption)(void *object, int layer, int number, std::vector<char> optbuf) = nullptr;
+	async::result<frg::expected<Error>> (*fadvise)(void *object, int64_t offset, int64_t length, int advice) = nullptr;
 
 	bool logRequests = false;
 };
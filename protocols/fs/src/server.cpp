@@ -2,6 +2,7 @@
 #include <stdio.h>
 #include <string.h>
 #include <unistd.h>
+#include <sys/epoll.h>
 #include <iostream>
 #include <vector>
 
@@ -465,6 +466,27 @@ async::detached handlePassthrough(smarter::shared_ptr<void> file,
 			resp.set_error(managarm::fs::Errors::ILLEGAL_OPERATION_TARGET);
 		}
 
+		auto ser = resp.SerializeAsString();
+		auto [send_resp] = co_await helix_ng::exchangeMsgs(
+			conversation,
+			helix_ng::sendBuffer(ser.data(), ser.size())
+		);
+		HEL_CHECK(send_resp.error());
+	}else if(req.req_type() == managarm::fs::CntReqType::PT_FADVISE) {
+		managarm::fs::SvrResponse resp;
+		if(file_ops->fadvise) {
+			auto result = co_await file_ops->fadvise(file.get(),
+					req.offset(), req.length(), req.advice());
+			if(result) {
+				resp.set_error(managarm::fs::Errors::SUCCESS);
+			}else{
+				resp.set_error(mapFsError(result.error()));
+			}
+		}else{
+			// Advice is only a hint; files without readahead simply ignore it.
+			resp.set_error(managarm::fs::Errors::SUCCESS);
+		}
+
 		auto ser = resp.SerializeAsString();
 		auto [send_resp] = co_await helix_ng::exchangeMsgs(
 			conversation,
@@ -1066,6 +1088,113 @@ async::result<void> servePassthrough(helix::UniqueLane lane,
 			HEL_CHECK(send_addr.error());
 			HEL_CHECK(send_data.error());
 			HEL_CHECK(send_ctrl.error());
+		} else if(preamble.id() == managarm::fs::RecvMmsgRequest::message_id) {
+			auto req = bragi::parse_head_only<managarm::fs::RecvMmsgRequest>(recv_req);
+			recv_req.reset();
+
+			if(!req) {
+				std::cout << "posix: Rejecting request due to decoding failure" << std::endl;
+				break;
+			}
+
+			auto [extract_creds] = co_await helix_ng::exchangeMsgs(
+				conversation,
+				helix_ng::extractCredentials()
+			);
+			HEL_CHECK(extract_creds.error());
+
+			if(!file_ops->recvMsg || !req->max_messages()) {
+				managarm::fs::SvrResponse resp;
+				resp.set_error(file_ops->recvMsg ? managarm::fs::Errors::ILLEGAL_ARGUMENT
+						: managarm::fs::Errors::ILLEGAL_OPERATION_TARGET);
+
+				auto ser = resp.SerializeAsString();
+				auto [send_resp] = co_await helix_ng::exchangeMsgs(
+					conversation,
+					helix_ng::sendBuffer(ser.data(), ser.size())
+				);
+				HEL_CHECK(send_resp.error());
+				continue;
+			}
+
+			managarm::fs::RecvMmsgReply resp;
+			std::vector<char> addrs;
+			std::vector<char> buffers;
+			std::vector<char> ctrls;
+			std::vector<char> addr;
+			addr.resize(req->addr_size());
+
+			// Receive messages directly into the concatenated buffers.
+			// Only the first recvMsg() call may block; afterwards, we stop
+			// as soon as the file does not report further input.
+			size_t count = 0;
+			std::optional<Error> error;
+			while(count < req->max_messages()) {
+				if(count) {
+					if(!file_ops->pollStatus)
+						break;
+					auto status = co_await file_ops->pollStatus(file.get());
+					if(!status || !(std::get<1>(status.value()) & EPOLLIN))
+						break;
+				}
+
+				auto offset = buffers.size();
+				buffers.resize(offset + req->size());
+
+				auto result = co_await file_ops->recvMsg(file.get(),
+					extract_creds.credentials(), req->flags(),
+					buffers.data() + offset, req->size(),
+					addr.data(), addr.size(),
+					req->ctrl_size());
+
+				if(auto e = std::get_if<Error>(&result)) {
+					buffers.resize(offset);
+					// Errors are only reported if no message was received.
+					if(!count)
+						error = *e;
+					break;
+				}
+
+				auto data = std::get<RecvData>(result);
+				auto data_size = std::min(data.dataLength, size_t(req->size()));
+				buffers.resize(offset + data_size);
+				addrs.insert(addrs.end(), addr.begin(),
+					addr.begin() + std::min(addr.size(), data.addressLength));
+				ctrls.insert(ctrls.end(), data.ctrl.begin(), data.ctrl.end());
+
+				resp.add_addr_sizes(data.addressLength);
+				resp.add_ret_vals(data.dataLength);
+				resp.add_flags(data.flags);
+				resp.add_ctrl_sizes(data.ctrl.size());
+				count++;
+			}
+
+			if(error) {
+				managarm::fs::SvrResponse resp;
+				resp.set_error(mapFsError(*error));
+
+				auto ser = resp.SerializeAsString();
+				auto [send_resp] = co_await helix_ng::exchangeMsgs(
+					conversation,
+					helix_ng::sendBuffer(ser.data(), ser.size())
+				);
+				HEL_CHECK(send_resp.error());
+				continue;
+			}
+
+			resp.set_error(managarm::fs::Errors::SUCCESS);
+			auto [send_head, send_tail, send_addrs, send_data, send_ctrls] = co_await helix_ng::exchangeMsgs(
+				conversation,
+				helix_ng::sendBragiHeadTail(resp, frg::stl_allocator{}),
+				helix_ng::sendBuffer(addrs.data(), addrs.size()),
+				helix_ng::sendBuffer(buffers.data(), buffers.size()),
+				helix_ng::sendBuffer(ctrls.data(), ctrls.size())
+			);
+			HEL_CHECK(send_head.error());
+			HEL_CHECK(send_tail.error());
+			HEL_CHECK(send_addrs.error());
+			HEL_CHECK(send_data.error());
+			HEL_CHECK(send_ctrls.error());
 		} else if(preamble.id() == managarm::fs::SendMsgRequest::message_id) {
 			std::vector<std::byte> tail(preamble.tail_size());
 			auto [recv_tail] = co_await helix_ng::exchangeMsgs(
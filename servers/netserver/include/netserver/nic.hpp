@@ -2,15 +2,18 @@
 
 #include <array>
 #include <arch/dma_pool.hpp>
+#include <async/recurring-event.hpp>
 #include <async/result.hpp>
 #include <frg/logging.hpp>
 #include <frg/formatting.hpp>
 #include <cstdint>
+#include <deque>
 #include <memory>
 #include <optional>
 #include <ostream>
 #include <protocols/mbus/client.hpp>
 #include <unordered_map>
+#include <vector>
 
 namespace nic {
 struct MacAddress {
@@ -49,7 +52,63 @@ enum EtherType : uint16_t {
 	ETHER_TYPE_ARP = 0x0806,
 };
 
-// TODO(arsen): Expose interface for csum offloading, constructing frames, and
+// DMA pool that keeps freed buffers of a fixed size around such that
+// they can be reused without going through the upstream pool.
+// Allocations of other sizes are forwarded to the upstream pool.
+struct RecyclingPool final : arch::dma_pool {
+	RecyclingPool(arch::dma_pool *upstream, size_t bufferSize, size_t maxCached);
+
+	RecyclingPool(const RecyclingPool &) = delete;
+	RecyclingPool &operator= (const RecyclingPool &) = delete;
+
+	void *allocate(size_t size, size_t count, size_t align) override;
+	void deallocate(void *pointer, size_t size, size_t count, size_t align) override;
+
+private:
+	arch::dma_pool *upstream_;
+	size_t bufferSize_;
+	size_t maxCached_;
+	std::vector<void *> cached_;
+};
+
+// Offloads that a link supports.
+struct LinkOffloads {
+	// The device can compute TCP/UDP checksums of outgoing frames.
+	bool txChecksum = false;
+	// The device validates TCP/UDP checksums of incoming frames.
+	bool rxChecksum = false;
+	// The device can segment TCP/IPv4 frames (TSO), requires txChecksum.
+	bool tso4 = false;
+	// Maximal size of an IP packet that is passed to the device for segmentation.
+	size_t maxTsoSize = 0;
+};
+
+// Offloads that are requested for an outgoing frame.
+// All offsets are relative to the start of the frame.
+struct TransmitOffload {
+	// The device computes the 16-bit one's complement checksum from checksumStart
+	// to the end of the frame and stores it at checksumStart + checksumOffset.
+	// That field must be initialized to the (non-inverted) pseudo header sum.
+	bool checksum = false;
+	uint16_t checksumStart = 0;
+	uint16_t checksumOffset = 0;
+
+	// The device splits the frame into TCP segments carrying segmentSize bytes
+	// of payload each. headerLength covers all headers, including TCP options.
+	bool tcpSegmentation = false;
+	uint16_t segmentSize = 0;
+	uint16_t headerLength = 0;
+
+	// Hash of the flow that the frame belongs to. Multi-queue links use it
+	// to transmit all frames of a flow on the same queue.
+	uint32_t flowHash = 0;
+};
+
+// Shared ownership of a received frame. Sockets hold on to it while they queue
+// views into the frame, such that received data is only copied when it is read.
+using FrameOwner = std::shared_ptr<arch::dma_buffer>;
+
+// TODO(arsen): Expose interface for constructing frames, and
 // other features of NICs
 struct Link {
 	struct AllocatedBuffer {
@@ -57,12 +116,37 @@ struct Link {
 		arch::dma_buffer_view payload;
 	};
 
+	struct ReceivedFrame {
+		arch::dma_buffer buffer;
+		size_t length;
+		// Set if the device already validated the TCP/UDP checksum.
+		bool checksumValid = false;
+	};
+
 	Link(unsigned int mtu, arch::dma_pool *dmaPool);
 	virtual ~Link() = default;
 	//! Receives an entire frame from the network
 	virtual async::result<size_t> receive(arch::dma_buffer_view) = 0;
 	//! Sends an entire ethernet frame
 	virtual async::result<void> send(const arch::dma_buffer_view) = 0;
+	//! Sends an entire ethernet frame, applying the given offloads.
+	//! Only offloads that are advertised by offloads() may be requested;
+	//! the default implementation computes the checksum in software.
+	virtual async::result<void> sendOffloaded(const arch::dma_buffer_view,
+		TransmitOffload offload);
+
+	//! Number of receive queues; netserver runs one receive loop per queue
+	//! (all of them on the same dispatcher).
+	virtual size_t numReceiveQueues();
+	//! Maximal number of receive buffers that can be posted to each queue at the same time.
+	//! The default implementation calls receive() for each posted buffer;
+	//! it returns 1 since drivers do not necessarily support concurrent receive() calls.
+	virtual size_t receiveQueueDepth();
+	//! Posts buffers that the device fills with received frames.
+	virtual async::result<void> postReceives(std::vector<arch::dma_buffer> buffers, size_t queue);
+	//! Waits until at least one posted buffer was filled, then returns all filled buffers
+	//! (in the order in which they were posted).
+	virtual async::result<std::vector<ReceivedFrame>> harvestReceived(size_t queue);
 	arch::dma_pool *dmaPool();
 	AllocatedBuffer allocateFrame(size_t payloadSize);
 	AllocatedBuffer allocateFrame(MacAddress to, EtherType type,
@@ -81,6 +165,14 @@ struct Link {
 		return raw_ip_;
 	}
 
+	bool loopback() {
+		return loopback_;
+	}
+
+	const LinkOffloads &offloads() {
+		return offloads_;
+	}
+
 	mbus_ng::Properties mbusNetworkProperties() {
 		return {
 			{"net.ifname", mbus_ng::StringItem{name()}},
@@ -106,6 +198,22 @@ protected:
 	bool l1_up_ = false;
 
 	bool raw_ip_ = false;
+	bool loopback_ = false;
+
+	LinkOffloads offloads_;
+
+private:
+	struct PostedReceive {
+		arch::dma_buffer buffer;
+		size_t length = 0;
+		bool done = false;
+	};
+
+	async::detached runReceive_(PostedReceive *posted);
+
+	// State of the default implementation of postReceives() and harvestReceived().
+	std::deque<std::unique_ptr<PostedReceive>> postedReceives_;
+	async::recurring_event receiveEvent_;
 };
 
 async::detached runDevice(std::shared_ptr<Link> dev);
@@ -0,0 +1,63 @@
+#include <algorithm>
+#include <limits>
+
+#include "congestion.hpp"
+
+namespace {
+
+struct NewReno final : CongestionControl {
+	NewReno(size_t mss)
+	// Initial window according to RFC 5681, 3.1.
+	: mss_{mss}, cwnd_{std::min(4 * mss, std::max(2 * mss, size_t{4380}))} { }
+
+	size_t window() override {
+		return cwnd_;
+	}
+
+	void onAck(size_t ackedBytes) override {
+		if(cwnd_ < ssthresh_) {
+			// Slow start.
+			cwnd_ += std::min(ackedBytes, mss_);
+		}else{
+			// Congestion avoidance: grow by (roughly) one MSS per RTT.
+			cwnd_ += std::max(size_t{1}, mss_ * mss_ / cwnd_);
+		}
+	}
+
+	void enterRecovery(size_t flightSize) override {
+		ssthresh_ = std::max(flightSize / 2, 2 * mss_);
+		cwnd_ = ssthresh_ + 3 * mss_;
+	}
+
+	void onRecoveryDupAck() override {
+		cwnd_ += mss_;
+	}
+
+	void onPartialAck(size_t ackedBytes) override {
+		// Deflate the window by the amount of acknowledged data (RFC 6582, 3.2).
+		cwnd_ -= std::min(cwnd_, ackedBytes);
+		if(ackedBytes >= mss_)
+			cwnd_ += mss_;
+		cwnd_ = std::max(cwnd_, mss_);
+	}
+
+	void exitRecovery(size_t flightSize) override {
+		cwnd_ = std::min(ssthresh_, std::max(flightSize, mss_) + mss_);
+	}
+
+	void onTimeout(size_t flightSize) override {
+		ssthresh_ = std::max(flightSize / 2, 2 * mss_);
+		cwnd_ = mss_;
+	}
+
+private:
+	size_t mss_;
+	size_t cwnd_;
+	size_t ssthresh_ = std::numeric_limits<size_t>::max();
+};
+
+} // anonymous namespace
+
+std::unique_ptr<CongestionControl> makeNewReno(size_t mss) {
+	return std::make_unique<NewReno>(mss);
+}
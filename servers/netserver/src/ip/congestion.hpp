@@ -0,0 +1,36 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+
+// Interface of TCP congestion control algorithms.
+// The TCP socket detects duplicate ACKs, partial ACKs and timeouts (RFC 5681, RFC 6582)
+// and reports them to the algorithm, which only maintains the congestion window.
+// All sizes are in bytes.
+struct CongestionControl {
+	virtual ~CongestionControl() = default;
+
+	// Current congestion window, i.e., the maximal number of bytes in flight.
+	virtual size_t window() = 0;
+
+	// New data was acknowledged outside of fast recovery.
+	virtual void onAck(size_t ackedBytes) = 0;
+
+	// A fast retransmit was triggered by duplicate ACKs; fast recovery starts.
+	virtual void enterRecovery(size_t flightSize) = 0;
+
+	// An additional duplicate ACK arrived during fast recovery.
+	virtual void onRecoveryDupAck() = 0;
+
+	// During fast recovery, an ACK arrived that does not cover the recovery point.
+	virtual void onPartialAck(size_t ackedBytes) = 0;
+
+	// An ACK arrived that covers the recovery point; fast recovery ends.
+	virtual void exitRecovery(size_t flightSize) = 0;
+
+	// The retransmission timer expired.
+	virtual void onTimeout(size_t flightSize) = 0;
+};
+
+// NewReno, see RFC 5681 and RFC 6582.
+std::unique_ptr<CongestionControl> makeNewReno(size_t mss);
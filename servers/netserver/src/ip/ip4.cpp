@@ -1,11 +1,14 @@
 #include "ip4.hpp"
 
 #include "arp.hpp"
-#include "checksum.hpp"
 #include <async/recurring-event.hpp>
+#include <core/checksum.hpp>
 #include <sys/socket.h>
 #include <netinet/in.h>
 #include <algorithm>
+#include <array>
+#include <cassert>
+#include <cstddef>
 #include <cstring>
 #include <iostream>
 #include <iomanip>
@@ -27,28 +30,82 @@ Ip4 &ip4() {
 }
 
 bool Ip4Router::addRoute(Route r) {
-	return routes.emplace(std::move(r)).second;
+	if (!routes.emplace(std::move(r)).second)
+		return false;
+	rebuildTrie();
+	return true;
 }
 
 std::optional<Route> Ip4Router::resolveRoute(uint32_t ip, std::shared_ptr<nic::Link> link) {
-	for (auto i = routes.begin(); i != routes.end(); i++) {
-		const auto &r = *i;
-		if (r.network.sameNet(ip)) {
-			if(link && r.link.lock()->index() != link->index())
-				continue;
+	// Collect the nodes on the path of ip that carry routes; the last one is the longest match.
+	std::array<int, 33> matches;
+	size_t numMatches = 0;
+	int node = 0;
+	for (int bit = 0; node >= 0; bit++) {
+		if (!trie[node].routes.empty())
+			matches[numMatches++] = node;
+		if (bit == 32)
+			break;
+		node = trie[node].children[(ip >> (31 - bit)) & 1];
+	}
 
-			if (r.link.expired()) {
-				i = routes.erase(i);
+	std::optional<Route> result;
+	bool sawExpired = false;
+	for (size_t i = numMatches; i-- > 0 && !result; ) {
+		for (auto r : trie[matches[i]].routes) {
+			auto routeLink = r->link.lock();
+			if (!routeLink) {
+				sawExpired = true;
 				continue;
 			}
-			return { r };
+			if (link && routeLink->index() != link->index())
+				continue;
+			result = *r;
+			break;
 		}
 	}
-	return {};
+
+	if (sawExpired)
+		pruneExpired();
+	return result;
+}
+
+void Ip4Router::rebuildTrie() {
+	trie.clear();
+	trie.emplace_back();
+	for (auto &r : routes) {
+		int node = 0;
+		for (int bit = 0; bit < r.network.prefix; bit++) {
+			int side = (r.network.ip >> (31 - bit)) & 1;
+			if (trie[node].children[side] < 0) {
+				trie[node].children[side] = trie.size();
+				trie.emplace_back();
+			}
+			node = trie[node].children[side];
+		}
+		trie[node].routes.push_back(&r);
+	}
+
+	for (auto &n : trie) {
+		std::stable_sort(n.routes.begin(), n.routes.end(),
+			[] (const Route *a, const Route *b) {
+				return a->metric < b->metric;
+			});
+	}
+
+	invalidate();
 }
 
-bool operator<(const CidrAddress &lhs, const CidrAddress &) {
-	return std::tie(lhs.prefix, lhs.ip) < std::tie(lhs.prefix, lhs.ip);
+void Ip4Router::pruneExpired() {
+	std::erase_if(routes, [] (const Route &r) {
+		return r.link.expired();
+	});
+	rebuildTrie();
+}
+
+// Longer prefixes sort first.
+bool operator<(const CidrAddress &lhs, const CidrAddress &rhs) {
+	return std::tie(rhs.prefix, lhs.ip) < std::tie(lhs.prefix, rhs.ip);
 }
 
 auto operator<=>(const Route &lhs, const Route &rhs) {
@@ -71,7 +128,7 @@ bool operator==(const Route &lhs, const Route &rhs) {
 	return operator<=>(lhs, rhs) == 0;
 }
 
-bool Ip4Packet::parse(arch::dma_buffer owner, arch::dma_buffer_view frame) {
+bool Ip4Packet::parse(nic::FrameOwner owner, arch::dma_buffer_view frame) {
 	buffer_ = std::move(owner);
 	data = frame;
 	if (data.size() < sizeof(header)) {
@@ -181,6 +238,7 @@ private:
 	friend struct Ip4;
 	int proto;
 	uint32_t remote = 0;
+	Ip4RouteCache routeCache;
 	std::queue<smarter::shared_ptr<const Ip4Packet>> pqueue;
 	async::recurring_event bell;
 };
@@ -218,7 +276,7 @@ async::result<frg::expected<protocols::fs::Error, size_t>> Ip4Socket::sendmsg(vo
 		co_return protocols::fs::Error::accessDenied;
 	}
 
-	auto ti = co_await ip4().targetByRemote(address);
+	auto ti = co_await ip4().targetByRemote(self->routeCache, address);
 	if (!ti) {
 		co_return protocols::fs::Error::netUnreachable;
 	}
@@ -262,6 +320,20 @@ Ip4::targetByRemote(uint32_t remote, std::shared_ptr<nic::Link> link) {
 	co_return Ip4TargetInfo { remote, source, *oroute, std::move(target) };
 }
 
+async::result<std::optional<Ip4TargetInfo>>
+Ip4::targetByRemote(Ip4RouteCache &cache, uint32_t remote, std::shared_ptr<nic::Link> link) {
+	if (cache.target && cache.generation == ip4Router().generation()
+			&& cache.remote == remote && cache.requestedLink == link.get()
+			&& !cache.target->route.link.expired())
+		co_return cache.target;
+
+	cache.generation = ip4Router().generation();
+	cache.remote = remote;
+	cache.requestedLink = link.get();
+	cache.target = co_await targetByRemote(remote, std::move(link));
+	co_return cache.target;
+}
+
 bool Ip4::hasIp(uint32_t addr) {
 	return std::any_of(ips.cbegin(), ips.cend(),
 		[addr] (auto &x) {
@@ -270,82 +342,295 @@ bool Ip4::hasIp(uint32_t addr) {
 }
 
 async::result<protocols::fs::Error> Ip4::sendFrame(Ip4TargetInfo ti,
-		void *data, size_t len, uint16_t proto) {
+		void *data, size_t len, uint16_t proto, nic::TransmitOffload offload,
+		bool dontFragment) {
 	using arch::convert_endian;
 	using arch::endian;
 
-	// TODO(arsen): fragmentation
 	// calculate header size
 	size_t header_size = sizeof(Ip4Packet::Header);
 	size_t packet_size = len + header_size;
 	// TODO(arsen): options
-	if (ti.route.mtu != 0 && ti.route.mtu < packet_size) {
-		std::cout << "netserver: cant fragment 1" << std::endl;
+	if (packet_size > 0xFFFF) {
 		co_return protocols::fs::Error::messageSize;
 	}
 
 	auto &target = ti.link;
-	if (target->mtu < packet_size) {
-		std::cout << "netserver: cant fragment 2" << std::endl;
-		co_return protocols::fs::Error::messageSize;
+	size_t mtu = target->mtu;
+	if (ti.route.mtu != 0)
+		mtu = std::min(mtu, size_t{ti.route.mtu});
+
+	// With segmentation offload, the MTU only limits the individual segments.
+	size_t mtu_size = packet_size;
+	if (offload.tcpSegmentation) {
+		assert(target->offloads().tso4);
+		assert(packet_size <= target->offloads().maxTsoSize);
+		mtu_size = header_size + offload.headerLength + offload.segmentSize;
 	}
 
-	Ip4Packet::Header hdr;
-	// TODO(arsen): options
-	hdr.ihl = 0x45;
-	hdr.tos = 0;
-	hdr.length = packet_size;
-	// TODO(arsen): fragmentation
-	hdr.flags_offset = 0;
-	hdr.ttl = 64;
-	hdr.protocol = proto;
-	// filled out later, 0 for purposes of computation
-	hdr.checksum = 0;
-	hdr.source = ti.source;
-	hdr.destination = ti.remote;
-
-	hdr.ensureEndian();
+	bool fragment = mtu_size > mtu;
+	if (fragment && (dontFragment || offload.tcpSegmentation)) {
+		std::cout << "netserver: packet exceeds the path MTU" << std::endl;
+		co_return protocols::fs::Error::messageSize;
+	}
 
-	Checksum chk;
-	// TODO(arsen): accomodate for options
-	chk.update(reinterpret_cast<void *>(&hdr), sizeof(hdr));
-	hdr.checksum = convert_endian<endian::big>(chk.finalize());
+	// All fragments except for the last one carry a multiple of 8 bytes.
+	size_t fragment_size = len;
+	if (fragment) {
+		fragment_size = (mtu - header_size) & ~size_t{7};
+		if (!fragment_size) {
+			co_return protocols::fs::Error::messageSize;
+		}
 
-	nic::Link::AllocatedBuffer fb;
+		if (offload.checksum) {
+			// The device only sees individual fragments; checksum in software.
+			auto bytes = static_cast<uint8_t *>(data);
+			Checksum chk;
+			chk.update(bytes + offload.checksumStart, len - offload.checksumStart);
+			uint16_t sum = chk.finalize();
+			if (!sum && proto == static_cast<uint16_t>(IpProto::udp))
+				sum = 0xFFFF;
+			bytes[offload.checksumStart + offload.checksumOffset] = sum >> 8;
+			bytes[offload.checksumStart + offload.checksumOffset + 1] = sum & 0xFF;
+			offload.checksum = false;
+		}
+	}
 
+	std::optional<nic::MacAddress> mac;
 	if(!target->rawIp()) {
 		auto macTarget = ti.route.gateway;
 		if (macTarget == 0) {
 			macTarget = ti.remote;
 		}
 
-		auto mac = co_await neigh4().tryResolve(macTarget, ti.source);
+		mac = co_await neigh4().tryResolve(macTarget, ti.source);
 		if (!mac) {
 			co_return protocols::fs::Error::hostUnreachable;
 		}
-
-		fb = target->allocateFrame(*mac, nic::ETHER_TYPE_IP4, packet_size);
-	} else {
-		fb = target->allocateFrame(packet_size);
 	}
 
-	std::memcpy(fb.payload.data(), &hdr, sizeof(hdr));
-	std::memcpy(fb.payload.subview(header_size).byte_data(), data, len);
+	uint16_t ident = nextIdent++;
+	size_t offset = 0;
+	do {
+		size_t chunk = std::min(fragment_size, len - offset);
+		bool more = offset + chunk < len;
+
+		Ip4Packet::Header hdr;
+		// TODO(arsen): options
+		hdr.ihl = 0x45;
+		hdr.tos = 0;
+		hdr.length = header_size + chunk;
+		hdr.ident = ident;
+		hdr.flags_offset = offset / 8;
+		if (dontFragment)
+			hdr.flags_offset |= Ip4Packet::Header::dontFragment;
+		if (more)
+			hdr.flags_offset |= Ip4Packet::Header::moreFragments;
+		hdr.ttl = 64;
+		hdr.protocol = proto;
+		// filled out later, 0 for purposes of computation
+		hdr.checksum = 0;
+		hdr.source = ti.source;
+		hdr.destination = ti.remote;
+
+		hdr.ensureEndian();
+
+		Checksum chk;
+		// TODO(arsen): accomodate for options
+		chk.update(reinterpret_cast<void *>(&hdr), sizeof(hdr));
+		hdr.checksum = convert_endian<endian::big>(chk.finalize());
+
+		nic::Link::AllocatedBuffer fb;
+		if (mac) {
+			fb = target->allocateFrame(*mac, nic::ETHER_TYPE_IP4, header_size + chunk);
+		} else {
+			fb = target->allocateFrame(header_size + chunk);
+		}
+
+		std::memcpy(fb.payload.data(), &hdr, sizeof(hdr));
+		std::memcpy(fb.payload.subview(header_size).byte_data(),
+			static_cast<uint8_t *>(data) + offset, chunk);
+
+		if (offload.checksum || offload.tcpSegmentation) {
+			// Make the offsets relative to the start of the frame.
+			size_t l4_start = fb.frame.size() - fb.payload.size() + header_size;
+			offload.checksumStart += l4_start;
+			offload.headerLength += l4_start;
+		}
+		co_await target->sendOffloaded(std::move(fb.frame), offload);
+
+		offset += chunk;
+	} while (offset < len);
 
-	co_await target->send(std::move(fb.frame));
 	co_return protocols::fs::Error::none;
 }
 
+namespace {
+
+// Fragments of incomplete packets are dropped after this time (in nanoseconds).
+constexpr uint64_t reassemblyTimeout = 30'000'000'000;
+// Upper bound on the memory used by fragments of incomplete packets.
+constexpr size_t reassemblyMemoryLimit = 4 << 20;
+
+} // namespace
+
+std::optional<Ip4Packet> Ip4Reassembler::feed(const Ip4Packet &fragment) {
+	using arch::convert_endian;
+	using arch::endian;
+
+	uint64_t now;
+	HEL_CHECK(helGetClock(&now));
+	expire_(now);
+
+	auto payload = fragment.payload();
+	size_t header_size = fragment.header.ihl * 4;
+	size_t begin = (fragment.header.flags_offset & Ip4Packet::Header::offsetMask) * 8;
+	size_t end = begin + payload.size();
+	bool last = !(fragment.header.flags_offset & Ip4Packet::Header::moreFragments);
+
+	if (end + header_size > 0xFFFF || (!last && payload.size() % 8)) {
+		std::cout << "netserver: dropping malformed ip4 fragment" << std::endl;
+		return std::nullopt;
+	}
+
+	Key key {
+		fragment.header.source,
+		fragment.header.destination,
+		fragment.header.ident,
+		fragment.header.protocol
+	};
+	auto it = entries_.find(key);
+	if (it == entries_.end()) {
+		it = entries_.emplace(key, Entry{
+			.header = {},
+			.payload = {},
+			.ranges = {},
+			.totalSize = std::nullopt,
+			.deadline = now + reassemblyTimeout,
+			.link = fragment.link
+		}).first;
+	}
+	auto &entry = it->second;
+
+	if (last) {
+		if ((entry.totalSize && *entry.totalSize != end)
+				|| (!entry.ranges.empty() && entry.ranges.back().second > end)) {
+			erase_(it);
+			return std::nullopt;
+		}
+		entry.totalSize = end;
+	} else if (entry.totalSize && end > *entry.totalSize) {
+		erase_(it);
+		return std::nullopt;
+	}
+
+	if (!begin) {
+		auto bytes = reinterpret_cast<const uint8_t *>(fragment.header_view().data());
+		entry.header.assign(bytes, bytes + header_size);
+	}
+
+	if (end > entry.payload.size()) {
+		memoryUsed_ += end - entry.payload.size();
+		entry.payload.resize(end);
+	}
+	std::memcpy(entry.payload.data() + begin, payload.data(), payload.size());
+
+	// Insert the new range and merge it with adjacent ones.
+	auto pos = std::lower_bound(entry.ranges.begin(), entry.ranges.end(),
+		std::pair<size_t, size_t>{begin, end});
+	pos = entry.ranges.insert(pos, {begin, end});
+	if (pos != entry.ranges.begin())
+		pos--;
+	while (pos + 1 != entry.ranges.end() && pos->second >= (pos + 1)->first) {
+		pos->second = std::max(pos->second, (pos + 1)->second);
+		entry.ranges.erase(pos + 1);
+	}
+
+	// Evict the oldest packets if we run out of memory.
+	while (memoryUsed_ > reassemblyMemoryLimit) {
+		auto oldest = std::min_element(entries_.begin(), entries_.end(),
+			[] (const auto &a, const auto &b) {
+				return a.second.deadline < b.second.deadline;
+			});
+		bool self = (oldest == it);
+		erase_(oldest);
+		if (self)
+			return std::nullopt;
+	}
+
+	bool complete = entry.totalSize && !entry.header.empty()
+		&& entry.ranges.size() == 1 && entry.ranges.front().first == 0
+		&& entry.ranges.front().second == *entry.totalSize;
+	if (!complete)
+		return std::nullopt;
+
+	auto link = entry.link.lock();
+	if (!link) {
+		erase_(it);
+		return std::nullopt;
+	}
+
+	// Build the reassembled packet from the first fragment's header.
+	size_t packet_size = entry.header.size() + *entry.totalSize;
+	auto buffer = std::make_shared<arch::dma_buffer>(link->dmaPool(), packet_size);
+	auto bytes = reinterpret_cast<uint8_t *>(buffer->data());
+	std::memcpy(bytes, entry.header.data(), entry.header.size());
+	std::memcpy(bytes + entry.header.size(), entry.payload.data(), *entry.totalSize);
+
+	auto store16 = [&] (size_t offset, uint16_t value) {
+		value = convert_endian<endian::big>(value);
+		std::memcpy(bytes + offset, &value, sizeof(value));
+	};
+	store16(offsetof(Ip4Packet::Header, length), packet_size);
+	store16(offsetof(Ip4Packet::Header, flags_offset), 0);
+	store16(offsetof(Ip4Packet::Header, checksum), 0);
+	Checksum chk;
+	chk.update(bytes, entry.header.size());
+	store16(offsetof(Ip4Packet::Header, checksum), chk.finalize());
+
+	erase_(it);
+
+	Ip4Packet packet{};
+	packet.link = link;
+	arch::dma_buffer_view view = *buffer;
+	if (!packet.parse(std::move(buffer), view))
+		return std::nullopt;
+	return packet;
+}
+
+void Ip4Reassembler::expire_(uint64_t now) {
+	for (auto it = entries_.begin(); it != entries_.end(); ) {
+		auto next = std::next(it);
+		if (it->second.deadline <= now)
+			erase_(it);
+		it = next;
+	}
+}
+
+void Ip4Reassembler::erase_(std::map<Key, Entry>::iterator it) {
+	memoryUsed_ -= it->second.payload.size();
+	entries_.erase(it);
+}
+
 void Ip4::feedPacket(nic::MacAddress, nic::MacAddress,
-		arch::dma_buffer owner, arch::dma_buffer_view frame, std::weak_ptr<nic::Link> link) {
+		nic::FrameOwner owner, arch::dma_buffer_view frame, std::weak_ptr<nic::Link> link,
+		bool l4ChecksumValid) {
 	Ip4Packet hdr{};
 	hdr.link = link;
+	hdr.l4ChecksumValid = l4ChecksumValid;
 
 	if (!hdr.parse(std::move(owner), frame)) {
 		std::cout << "netserver: runt, or otherwise invalid, ip4 frame received"
 			<< std::endl;
 		return;
 	}
+
+	if (hdr.isFragment()) {
+		auto packet = reassembler.feed(hdr);
+		if (!packet)
+			return;
+		hdr = std::move(*packet);
+	}
 	auto proto = hdr.header.protocol;
 
 	auto begin = sockets.lower_bound(proto);
@@ -371,6 +656,8 @@ void Ip4::feedPacket(nic::MacAddress, nic::MacAddress,
 
 void Ip4::setLink(CidrAddress addr, std::weak_ptr<nic::Link> l) {
 	ips.emplace(addr, std::move(l));
+	// Source addresses of cached targets might change.
+	ip4Router().invalidate();
 }
 
 std::shared_ptr<nic::Link> Ip4::getLink(uint32_t addr) {
@@ -404,7 +691,10 @@ std::optional<CidrAddress> Ip4::getCidrByIndex(int index) {
 }
 
 bool Ip4::deleteLink(CidrAddress addr) {
-	return ips.erase(addr) > 0;
+	if (!ips.erase(addr))
+		return false;
+	ip4Router().invalidate();
+	return true;
 }
 
 std::optional<uint32_t> Ip4::findLinkIp(uint32_t ipOnNet, nic::Link *link) {
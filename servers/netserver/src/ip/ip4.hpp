@@ -11,6 +11,7 @@
 #include <cstdint>
 #include <memory>
 #include <optional>
+#include <vector>
 
 #include "udp4.hpp"
 #include "tcp4.hpp"
@@ -24,6 +25,20 @@ enum class IpProto : uint16_t {
 	udp = 17,
 };
 
+// Hash of a flow's addresses and ports; used to demultiplex and to select queues.
+inline uint32_t ip4FlowHash(uint32_t localAddress, uint16_t localPort,
+		uint32_t remoteAddress, uint16_t remotePort) {
+	uint64_t x = (uint64_t{localAddress} << 32) | remoteAddress;
+	x ^= (uint64_t{localPort} << 16 | remotePort) * 0x9E37'79B9'7F4A'7C15;
+	// Finalizer of MurmurHash3.
+	x ^= x >> 33;
+	x *= 0xFF51'AFD7'ED55'8CCD;
+	x ^= x >> 33;
+	x *= 0xC4CE'B9FE'1A85'EC53;
+	x ^= x >> 33;
+	return x;
+}
+
 struct CidrAddress {
 	uint32_t ip;
 	uint8_t prefix;
@@ -63,19 +78,49 @@ struct Ip4Router {
 
 	// false if insertion fails
 	bool addRoute(Route r);
+	// Returns the route with the longest matching prefix (and the lowest metric among those).
 	std::optional<Route> resolveRoute(uint32_t ip, std::shared_ptr<nic::Link> link = {});
 
 	inline const std::set<Route> &getRoutes() const {
 		return routes;
 	}
+
+	// Incremented whenever the result of a lookup might change.
+	inline uint64_t generation() const {
+		return currentGeneration;
+	}
+
+	void invalidate() {
+		currentGeneration++;
+	}
+
 private:
+	// Binary trie over the prefix bits, indexed by the routes' networks.
+	// Node 0 is the root (i.e., the zero-length prefix).
+	struct TrieNode {
+		int children[2] = {-1, -1};
+		// Routes with exactly this prefix, ordered by preference.
+		std::vector<const Route *> routes;
+	};
+
+	void rebuildTrie();
+	void pruneExpired();
+
 	std::set<Route> routes;
+	std::vector<TrieNode> trie = std::vector<TrieNode>(1);
+	uint64_t currentGeneration = 1;
 };
 
 class Ip4Packet {
-	arch::dma_buffer buffer_;
+	nic::FrameOwner buffer_;
 public:
 	struct Header {
+		// Bits of flags_offset.
+		static constexpr uint16_t dontFragment = 0x4000;
+		static constexpr uint16_t moreFragments = 0x2000;
+		// Fragment offset in units of 8 bytes.
+		static constexpr uint16_t offsetMask = 0x1FFF;
+
 		uint8_t ihl;
 		uint8_t tos;
 		uint16_t length;
@@ -107,6 +152,8 @@ public:
 	static_assert(sizeof(header) == 20, "bad header size");
 	arch::dma_buffer_view data;
 	std::weak_ptr<nic::Link> link;
+	// Set if the link already validated the TCP/UDP checksum.
+	bool l4ChecksumValid = false;
 
 	inline arch::dma_buffer_view payload() const {
 		return data.subview(header.ihl * 4);
@@ -116,8 +163,48 @@ public:
 		return data.subview(0, header.ihl * 4);
 	}
 
+	inline bool isFragment() const {
+		return header.flags_offset & (Header::moreFragments | Header::offsetMask);
+	}
+
 	// assumes frame is a valid view into owner
-	bool parse(arch::dma_buffer owner, arch::dma_buffer_view frame);
+	bool parse(nic::FrameOwner owner, arch::dma_buffer_view frame);
+};
+
+// Reassembles fragmented IPv4 packets (RFC 791, RFC 815).
+// Incomplete packets are dropped after a timeout, or (oldest first)
+// once the buffered fragments exceed a memory limit.
+struct Ip4Reassembler {
+	// Returns the reassembled packet once all fragments of it arrived.
+	std::optional<Ip4Packet> feed(const Ip4Packet &fragment);
+
+private:
+	struct Key {
+		uint32_t source;
+		uint32_t destination;
+		uint16_t ident;
+		uint8_t protocol;
+
+		auto operator<=>(const Key &) const = default;
+	};
+
+	struct Entry {
+		// Header of the first fragment (without the fragment specific fields).
+		std::vector<uint8_t> header;
+		std::vector<uint8_t> payload;
+		// Received parts of the payload, as sorted and disjoint [begin, end) ranges.
+		std::vector<std::pair<size_t, size_t>> ranges;
+		// Known once the last fragment arrived.
+		std::optional<size_t> totalSize;
+		uint64_t deadline;
+		std::weak_ptr<nic::Link> link;
+	};
+
+	void expire_(uint64_t now);
+	void erase_(std::map<Key, Entry>::iterator it);
+
+	std::map<Key, Entry> entries_;
+	size_t memoryUsed_ = 0;
 };
 
 struct Ip4TargetInfo {
@@ -127,12 +214,22 @@ struct Ip4TargetInfo {
 	std::shared_ptr<nic::Link> link;
 };
 
+// Remembers the target of a socket's most recent send,
+// such that the route does not have to be looked up for every packet.
+struct Ip4RouteCache {
+	uint32_t remote = 0;
+	nic::Link *requestedLink = nullptr;
+	uint64_t generation = 0;
+	std::optional<Ip4TargetInfo> target;
+};
+
 struct Ip4Socket;
 struct Ip4 {
 	managarm::fs::Errors serveSocket(helix::UniqueLane lane, int type, int proto, int flags);
 	// frame is a view into the owner buffer, stripping away eth bits
 	void feedPacket(nic::MacAddress dest, nic::MacAddress src,
-		arch::dma_buffer owner, arch::dma_buffer_view frame, std::weak_ptr<nic::Link> link);
+		nic::FrameOwner owner, arch::dma_buffer_view frame, std::weak_ptr<nic::Link> link,
+		bool l4ChecksumValid = false);
 
 	bool hasIp(uint32_t ip);
 	std::shared_ptr<nic::Link> getLink(uint32_t ip);
@@ -142,13 +239,22 @@ struct Ip4 {
 	std::optional<uint32_t> findLinkIp(uint32_t ipOnNet, nic::Link *link);
 
 	async::result<std::optional<Ip4TargetInfo>> targetByRemote(uint32_t, std::shared_ptr<nic::Link> link = {});
+	// Like targetByRemote(), but reuses the cached target until the routes or addresses change.
+	async::result<std::optional<Ip4TargetInfo>> targetByRemote(Ip4RouteCache &cache,
+		uint32_t remote, std::shared_ptr<nic::Link> link = {});
+	// Offsets in the offload descriptor are relative to the IP payload.
+	// Packets that exceed the path MTU are fragmented unless dontFragment is set.
 	async::result<protocols::fs::Error> sendFrame(Ip4TargetInfo,
 		void*, size_t,
-		uint16_t);
+		uint16_t, nic::TransmitOffload offload = {},
+		bool dontFragment = false);
 private:
 	std::multimap<int, smarter::shared_ptr<Ip4Socket>> sockets;
 	std::map<CidrAddress, std::weak_ptr<nic::Link>> ips;
 
+	Ip4Reassembler reassembler;
+	uint16_t nextIdent = 0;
+
 	Udp4 udp;
 	Tcp4 tcp;
 };
@@ -3,10 +3,15 @@
 #include <async/result.hpp>
 #include <arch/bit.hpp>
 #include <arch/variable.hpp>
+#include <core/checksum.hpp>
 #include <protocols/fs/server.hpp>
+#include <algorithm>
+#include <bit>
+#include <cstddef>
 #include <cstring>
 #include <format>
 #include <iomanip>
+#include <optional>
 #include <random>
 #include <fcntl.h>
 #include <sys/epoll.h>
@@ -16,8 +21,9 @@
 #include <netinet/ip.h>
 
 #include <bragi/helpers-std.hpp>
+#include <helix/timer.hpp>
 
-#include "checksum.hpp"
+#include "congestion.hpp"
 #include "ip4.hpp"
 #include "tcp4.hpp"
 
@@ -25,6 +31,41 @@ namespace {
 
 constexpr bool debugTcp = false;
 
+// TODO: Perform path MTU discovery.
+constexpr size_t maxSegmentSize = 1000;
+// MSS that is assumed if the remote does not send an MSS option.
+constexpr size_t defaultSegmentSize = 536;
+
+// Sizes of the send and receive rings (as shifts).
+// Unless they are set by SO_SNDBUF/SO_RCVBUF, the rings grow up to maxRingShift on demand.
+constexpr int defaultRingShift = 16;
+constexpr int minRingShift = 12;
+constexpr int maxRingShift = 22;
+
+// Window scale that we announce; large enough to cover the largest receive ring.
+constexpr int windowScaleShift = maxRingShift - 16;
+
+enum TcpOptionKind : uint8_t {
+	endOfOptions = 0,
+	noOperation = 1,
+	maxSegmentSizeOption = 2,
+	windowScaleOption = 3,
+	sackPermittedOption = 4,
+	sackOption = 5,
+	timestampOption = 8,
+};
+
+// Maximal number of SACK blocks that fit into the options (together with timestamps).
+constexpr size_t maxSackBlocks = 3;
+
+// Maximal number of out-of-order segments that are kept for reassembly.
+constexpr size_t maxOutOfOrderSegments = 64;
+
+// Compares sequence numbers modulo 2^32.
+bool snBefore(uint32_t a, uint32_t b) {
+	return static_cast<int32_t>(a - b) < 0;
+}
+
 struct stl_allocator {
 	void *allocate(size_t size) {
 		return operator new(size);
@@ -57,6 +98,27 @@ struct RingBuffer {
 
 	RingBuffer &operator= (const RingBuffer &) = delete;
 
+	int shift() {
+		return shift_;
+	}
+
+	size_t capacity() {
+		return size_t{1} << shift_;
+	}
+
+	// Changes the size of the ring. The current contents must fit into the new size.
+	void resize(int shift) {
+		size_t size = availableToDequeue();
+		assert(size <= (size_t{1} << shift));
+		auto storage = reinterpret_cast<char *>(operator new (size_t{1} << shift));
+		dequeueLookahead(0, storage, size);
+		operator delete(storage_);
+		storage_ = storage;
+		shift_ = shift;
+		deqPtr_ = 0;
+		enqPtr_ = size;
+	}
+
 	size_t spaceForEnqueue() {
 		return (size_t{1} << shift_) - (enqPtr_ - deqPtr_);
 	}
@@ -102,6 +164,51 @@ private:
 	uint64_t deqPtr_ = 0;
 };
 
+// Computes the retransmission timeout according to RFC 6298.
+// All times are in nanoseconds.
+struct RtoEstimator {
+	static constexpr uint64_t initialRto = 1'000'000'000;
+	// RFC 6298 recommends a lower bound of one second.
+	static constexpr uint64_t minRto = 1'000'000'000;
+	static constexpr uint64_t maxRto = 60'000'000'000;
+	// Clock granularity G.
+	static constexpr uint64_t granularity = 1'000'000;
+
+	uint64_t rto() {
+		return rto_;
+	}
+
+	uint64_t srtt() {
+		if(!haveSample_)
+			return initialRto;
+		return srtt_;
+	}
+
+	void addSample(uint64_t rtt) {
+		if(!haveSample_) {
+			srtt_ = rtt;
+			rttvar_ = rtt / 2;
+			haveSample_ = true;
+		}else{
+			uint64_t delta = (srtt_ > rtt) ? srtt_ - rtt : rtt - srtt_;
+			rttvar_ = (3 * rttvar_ + delta) / 4;
+			srtt_ = (7 * srtt_ + rtt) / 8;
+		}
+		rto_ = std::clamp(srtt_ + std::max(granularity, 4 * rttvar_), minRto, maxRto);
+	}
+
+	// Called when the retransmission timer expires.
+	void backoff() {
+		rto_ = std::min(2 * rto_, maxRto);
+	}
+
+private:
+	bool haveSample_ = false;
+	uint64_t srtt_ = 0;
+	uint64_t rttvar_ = 0;
+	uint64_t rto_ = initialRto;
+};
+
 // TODO: Use a CSPRNG, see also UDP.
 static std::mt19937 globalPrng;
 
@@ -125,6 +232,60 @@ struct TcpHeader {
 
 static_assert(sizeof(TcpHeader) == 20);
 
+struct TcpOptions {
+	std::optional<uint16_t> mss;
+	std::optional<uint8_t> windowScale;
+	bool sackPermitted = false;
+	bool hasTimestamp = false;
+	uint32_t tsVal = 0;
+	uint32_t tsEcr = 0;
+	// SACK blocks, given as [left edge, right edge).
+	std::pair<uint32_t, uint32_t> sackBlocks[4];
+	size_t numSackBlocks = 0;
+
+	// Malformed options are ignored (RFC 9293, 3.1).
+	void parse(const uint8_t *p, size_t size) {
+		auto load32 = [] (const uint8_t *q) -> uint32_t {
+			return (uint32_t{q[0]} << 24) | (uint32_t{q[1]} << 16)
+					| (uint32_t{q[2]} << 8) | uint32_t{q[3]};
+		};
+
+		size_t i = 0;
+		while(i < size) {
+			auto kind = p[i];
+			if(kind == endOfOptions)
+				break;
+			if(kind == noOperation) {
+				++i;
+				continue;
+			}
+
+			if(i + 1 >= size)
+				break;
+			size_t length = p[i + 1];
+			if(length < 2 || i + length > size)
+				break;
+
+			if(kind == maxSegmentSizeOption && length == 4) {
+				mss = (p[i + 2] << 8) | p[i + 3];
+			}else if(kind == windowScaleOption && length == 3) {
+				windowScale = std::min(p[i + 2], uint8_t{14});
+			}else if(kind == sackPermittedOption && length == 2) {
+				sackPermitted = true;
+			}else if(kind == sackOption && length >= 10 && !((length - 2) % 8)) {
+				numSackBlocks = std::min((length - 2) / 8, std::size(sackBlocks));
+				for(size_t k = 0; k < numSackBlocks; ++k)
+					sackBlocks[k] = {load32(p + i + 2 + 8 * k), load32(p + i + 6 + 8 * k)};
+			}else if(kind == timestampOption && length == 10) {
+				hasTimestamp = true;
+				tsVal = load32(p + i + 2);
+				tsEcr = load32(p + i + 6);
+			}
+			i += length;
+		}
+	}
+};
+
 struct TcpPacket {
 	arch::dma_buffer_view payload() {
 		auto words = header.flags.load() & TcpHeader::headerWords;
@@ -143,7 +304,7 @@ struct TcpPacket {
 		if (ipPayload.size() < words * 4)
 			return false;
 
-		if (header.checksum.load()) {
+		if (header.checksum.load() && !packet->l4ChecksumValid) {
 			PseudoHeader pseudo {
 				.src = packet->header.source,
 				.dst = packet->header.destination,
@@ -158,11 +319,15 @@ struct TcpPacket {
 				return false;
 		}
 
+		options.parse(reinterpret_cast<const uint8_t *>(ipPayload.data()) + sizeof(TcpHeader),
+				words * 4 - sizeof(TcpHeader));
+
 		this->packet = std::move(packet);
 		return true;
 	}
 
 	TcpHeader header;
+	TcpOptions options;
 	smarter::shared_ptr<const Ip4Packet> packet;
 };
 
@@ -186,16 +351,20 @@ protocols::fs::Error checkAddress(const void *addrPtr, size_t addrLength, TcpEnd
 
 struct Tcp4Socket {
 	Tcp4Socket(Tcp4 *parent, bool nonBlock)
-	: parent_(parent), nonBlock_{nonBlock}, recvRing_{14}, sendRing_{14} {}
+	: parent_(parent), nonBlock_{nonBlock}, recvRing_{defaultRingShift}, sendRing_{defaultRingShift},
+			congestion_{makeNewReno(maxSegmentSize)} {}
 
 	~Tcp4Socket() {
-		parent_->unbind(localEp_);
+		if (remoteEp_.port)
+			parent_->removeConnection(localEp_, remoteEp_);
+		parent_->unbind(this, localEp_);
 	}
 
 	static auto makeSocket(Tcp4 *parent, bool nonBlock) {
 		auto s = smarter::make_shared<Tcp4Socket>(parent, nonBlock);
 		s->holder_ = s;
 		async::detach(s->flushOutPackets_());
+		async::detach(s->runRetransmitTimer_());
 		return s;
 	}
 
@@ -329,7 +498,10 @@ struct Tcp4Socket {
 			co_return protocols::fs::Error::addressNotAvailable;
 		}
 
-		// Connect to the remote.
+		// Connect to the remote. Fail if another socket already uses the same 4-tuple
+		// (e.g., if it shares the local endpoint through SO_REUSEPORT).
+		if (!self->parent_->addConnection(self->holder_.lock(), self->localEp_, connectEp))
+			co_return protocols::fs::Error::addressNotAvailable;
 		self->connectState_ = ConnectState::sendSyn;
 		self->remoteEp_ = connectEp;
 		self->flushEvent_.raise();
@@ -386,6 +558,7 @@ struct Tcp4Socket {
 			if(flags & MSG_PEEK)
 				break;
 			self->recvRing_.dequeueAdvance(chunk);
+			self->autotuneReceive_(chunk);
 			self->flushEvent_.raise();
 		}
 
@@ -416,6 +589,9 @@ struct Tcp4Socket {
 		while(progress < size) {
 			size_t space = self->sendRing_.spaceForEnqueue();
 			if(!space) {
+				self->autotuneSend_();
+				if(self->sendRing_.spaceForEnqueue())
+					continue;
 				if(self->nonBlock_) {
 					if(progress)
 						break;
@@ -514,6 +690,46 @@ struct Tcp4Socket {
 			}
 		}
 
+		if(layer == SOL_SOCKET && number == SO_REUSEPORT) {
+			int value;
+			if(optbuf.size() < sizeof(value))
+				co_return protocols::fs::Error::illegalArguments;
+			memcpy(&value, optbuf.data(), sizeof(value));
+			self->reusePort_ = (value != 0);
+			co_return {};
+		}
+
+		if(layer == SOL_SOCKET && (number == SO_RCVBUF || number == SO_SNDBUF)) {
+			int value;
+			if(optbuf.size() < sizeof(value))
+				co_return protocols::fs::Error::illegalArguments;
+			memcpy(&value, optbuf.data(), sizeof(value));
+			if(value < 0)
+				co_return protocols::fs::Error::illegalArguments;
+
+			// Round up to the next power of two.
+			int shift = std::clamp(static_cast<int>(std::bit_width(
+					std::max(static_cast<unsigned int>(value), 1u) - 1)),
+					minRingShift, maxRingShift);
+
+			if(number == SO_RCVBUF) {
+				// Shrinking the window of an established connection is not allowed.
+				auto &ring = self->recvRing_;
+				self->recvBufferLocked_ = true;
+				if(shift > ring.shift() || (self->connectState_ == ConnectState::none
+						&& ring.availableToDequeue() <= (size_t{1} << shift)))
+					ring.resize(shift);
+			}else{
+				auto &ring = self->sendRing_;
+				self->sendBufferLocked_ = true;
+				if(ring.availableToDequeue() <= (size_t{1} << shift))
+					ring.resize(shift);
+			}
+			self->flushEvent_.raise();
+			self->settleEvent_.raise();
+			co_return {};
+		}
+
 		std::cout << std::format("netserver: unhandled TCP socket setsockopt layer {} number {}\n",
 			layer, number);
 
@@ -555,6 +771,36 @@ struct Tcp4Socket {
 private:
 	async::result<void> flushOutPackets_();
 
+	// Sends a segment that starts at the given Out-SN and carries chunk bytes
+	// from sendRing_ (at the given offset). The segment acknowledges all received data.
+	// Chunks larger than the MSS are sent as a single super-segment if the link supports TSO.
+	async::result<bool> sendSegment_(uint32_t sn, size_t offset, size_t chunk);
+
+	// Writes the TCP options of an outgoing segment; returns their size (a multiple of 4).
+	size_t writeOptions_(uint8_t *p, bool syn);
+
+	// Receive window (in bytes) that we can announce in the next segment.
+	size_t windowToAnnounce_();
+
+	async::result<void> runRetransmitTimer_();
+
+	void armRetransmitTimer_();
+	void handleRetransmitTimeout_();
+
+	void handleAck_(TcpPacket &packet);
+
+	void updateScoreboard_(const TcpOptions &options);
+	void pruneScoreboard_();
+	// Returns the first range (start and size) at or after sn that has not been SACKed
+	// although data above it has been SACKed, i.e., that was presumably lost.
+	std::optional<std::pair<uint32_t, size_t>> nextHole_(uint32_t sn);
+
+	void storeOutOfOrder_(uint32_t sn, arch::dma_buffer_view payload);
+	void drainOutOfOrder_();
+
+	void autotuneReceive_(size_t copied);
+	void autotuneSend_();
+
 	void handleInPacket_(TcpPacket packet);
 
 private:
@@ -579,7 +825,10 @@ private:
 	// Out-SN corresponding to the front of sendRing_.
 	uint32_t localSettledSn_ = 0;
 	// Out-SN that has already been flushed to the IP layer (>= localSettledSn_).
+	// After a retransmission timeout, this is reset to localSettledSn_.
 	uint32_t localFlushedSn_ = 0;
+	// Highest Out-SN that was ever flushed to the IP layer (>= localFlushedSn_).
+	uint32_t localHighSn_ = 0;
 	// Out-SN of the end of the remote window (>= localSettledSn_).
 	uint32_t localWindowSn_ = 0;
 	// In-SN that we already acknowledged.
@@ -588,6 +837,8 @@ private:
 	uint32_t remoteKnownSn_ = 0;
 	// Size of received window that we announced to the remote side.
 	uint32_t announcedWindow_ = 0;
+	// Send an ACK even if remoteAckedSn_ == remoteKnownSn_ (i.e., a duplicate ACK).
+	bool forceAck_ = false;
 
 	RingBuffer recvRing_;
 	RingBuffer sendRing_;
@@ -596,6 +847,58 @@ private:
 	async::recurring_event flushEvent_;
 	async::recurring_event settleEvent_;
 
+	// Retransmission and congestion control.
+	RtoEstimator rtoEstimator_;
+	std::unique_ptr<CongestionControl> congestion_;
+	// Expiration time of the retransmission timer (zero if the timer is not armed).
+	uint64_t retransmitDeadline_ = 0;
+	async::recurring_event timerEvent_;
+	// Resend the segment at localSettledSn_ during the next flush.
+	bool retransmitNow_ = false;
+	unsigned int dupAcks_ = 0;
+	bool inRecovery_ = false;
+	// Out-SN that needs to be acknowledged to leave fast recovery.
+	uint32_t recoverSn_ = 0;
+	// Karn's algorithm: only segments that were never retransmitted are timed.
+	// The sample completes once rttSn_ is acknowledged.
+	// If timestamps are enabled, they are used to take RTT samples instead.
+	bool rttPending_ = false;
+	uint32_t rttSn_ = 0;
+	uint64_t rttStart_ = 0;
+
+	// Options that were negotiated during the handshake.
+	size_t sendMss_ = maxSegmentSize;
+	// Maximal payload of a super-segment on the current link (zero if it does not support TSO).
+	size_t tsoSize_ = 0;
+	// Scale of windows sent by the remote (sendWindowShift_) and by us (recvWindowShift_).
+	int sendWindowShift_ = 0;
+	int recvWindowShift_ = 0;
+	bool tsEnabled_ = false;
+	// Most recent timestamp that was received from the remote.
+	uint32_t tsRecent_ = 0;
+	bool sackEnabled_ = false;
+
+	// Sorted, disjoint ranges [first, second) of Out-SNs above localSettledSn_
+	// that the remote reported via SACK.
+	std::vector<std::pair<uint32_t, uint32_t>> sackedRanges_;
+	// During fast recovery, the Out-SN up to which we already retransmitted holes.
+	uint32_t retransmitSn_ = 0;
+
+	struct OutOfOrderSegment {
+		uint32_t sn;
+		std::vector<char> data;
+	};
+
+	// Data above remoteKnownSn_ that arrived out of order, sorted by In-SN.
+	std::vector<OutOfOrderSegment> outOfOrder_;
+
+	// Set once the ring sizes are fixed by SO_SNDBUF/SO_RCVBUF (disables autotuning).
+	bool sendBufferLocked_ = false;
+	bool recvBufferLocked_ = false;
+	// Bytes that the application consumed since recvPeriodStart_.
+	size_t recvPeriodCopied_ = 0;
+	uint64_t recvPeriodStart_ = 0;
+
 	// The following sequence numbers are *not* TCP sequence numbers,
 	// they implement the poll() function.
 	uint64_t currentSeq_ = 1;
@@ -605,6 +908,8 @@ private:
 	async::recurring_event pollEvent_;
 
 	std::shared_ptr<nic::Link> boundInterface_ = {};
+	Ip4RouteCache routeCache_;
+	bool reusePort_ = false;
 };
 
 async::result<void> Tcp4Socket::flushOutPackets_() {
@@ -615,39 +920,58 @@ async::result<void> Tcp4Socket::flushOutPackets_() {
 		}
 
 		if(connectState_ == ConnectState::sendSyn) {
-			if(localSettledSn_ != localFlushedSn_) {
+			bool synOutstanding = (localSettledSn_ != localFlushedSn_);
+			if(synOutstanding && !retransmitNow_) {
 				co_await flushEvent_.async_wait();
 				continue;
 			}
 
-			// Obtain a new random sequence number.
-			auto randomSn = globalPrng();
-			localSettledSn_ = randomSn;
-			localFlushedSn_ = randomSn;
+			uint64_t now;
+			HEL_CHECK(helGetClock(&now));
+
+			if(!synOutstanding) {
+				// Obtain a new random sequence number.
+				auto randomSn = globalPrng();
+				localSettledSn_ = randomSn;
+				localFlushedSn_ = randomSn;
+
+				rttPending_ = true;
+				rttSn_ = localSettledSn_ + 1;
+				rttStart_ = now;
+			}else{
+				// Karn's algorithm: do not time retransmitted SYNs.
+				rttPending_ = false;
+			}
+			retransmitNow_ = false;
 
 			// Construct and transmit the initial SYN packet.
-			auto targetInfo = co_await ip4().targetByRemote(remoteEp_.ipAddress, boundInterface_);
+			auto targetInfo = co_await ip4().targetByRemote(routeCache_, remoteEp_.ipAddress, boundInterface_);
 			if (!targetInfo) {
 				// TODO: Return an error to users.
 				std::cout << "netserver: Destination unreachable" << std::endl;
 				co_return;
 			}
 
+			uint8_t options[40];
+			size_t optionsSize = writeOptions_(options, true);
+
 			std::vector<char> buf;
-			buf.resize(sizeof(TcpHeader));
+			buf.resize(sizeof(TcpHeader) + optionsSize);
 
+			// The window of SYN segments is never scaled.
 			auto header = new (buf.data()) TcpHeader {
 				.srcPort = localEp_.port,
 				.destPort = remoteEp_.port,
-				.seqNumber = localFlushedSn_,
+				.seqNumber = localSettledSn_,
 				.ackNumber = 0,
 				.flags = {},
-				.window = 0,
+				.window = std::min(recvRing_.spaceForEnqueue(), size_t{0xFFFF}),
 				.checksum = 0,
 				.urgentPointer = 0,
 			};
-			header->flags.store(TcpHeader::headerWords(sizeof(TcpHeader) / 4)
+			header->flags.store(TcpHeader::headerWords(buf.size() / 4)
 					| TcpHeader::synFlag(true));
+			memcpy(buf.data() + sizeof(TcpHeader), options, optionsSize);
 
 			// Fill in the checksum.
 			PseudoHeader pseudo {
@@ -660,12 +984,14 @@ async::result<void> Tcp4Socket::flushOutPackets_() {
 			csum.update(buf.data(), buf.size());
 			header->checksum = csum.finalize();
 
-			++localFlushedSn_;
+			localFlushedSn_ = localSettledSn_ + 1; // SYN counts as one byte.
+			localHighSn_ = localFlushedSn_;
+			armRetransmitTimer_();
 
 			if(debugTcp)
 				std::cout << "netserver: Sending TCP SYN" << std::endl;
 			auto error = co_await ip4().sendFrame(std::move(*targetInfo),
-				buf.data(), buf.size(), static_cast<uint16_t>(IpProto::tcp));
+				buf.data(), buf.size(), static_cast<uint16_t>(IpProto::tcp), {}, true);
 			if (error != protocols::fs::Error::none) {
 				// TODO: Return an error to users.
 				std::cout << "netserver: Could not send TCP packet" << std::endl;
@@ -675,79 +1001,533 @@ async::result<void> Tcp4Socket::flushOutPackets_() {
 			assert(connectState_ == ConnectState::connected);
 			size_t flushPointer = localFlushedSn_ - localSettledSn_;
 			size_t windowPointer = localWindowSn_ - localSettledSn_;
+			size_t highPointer = localHighSn_ - localSettledSn_;
 
 			size_t bytesAvailable = sendRing_.availableToDequeue();
-			assert(bytesAvailable >= flushPointer);
+			assert(bytesAvailable >= highPointer);
+
+			// Limit the data in flight by both the receive window and the congestion window.
+			size_t sendPointer = std::min(windowPointer, congestion_->window());
 
 			// Check whether we need to send a packet.
-			// TODO: Add retransmission here.
-			bool wantData = (bytesAvailable > flushPointer && windowPointer > flushPointer);
-			bool wantAck = (remoteAckedSn_ != remoteKnownSn_);
-			bool wantWindowUpdate = (announcedWindow_ < recvRing_.spaceForEnqueue());
+			bool wantRetransmit = (retransmitNow_ && highPointer);
+			bool wantData = (bytesAvailable > flushPointer && sendPointer > flushPointer);
+			bool wantAck = (remoteAckedSn_ != remoteKnownSn_ || forceAck_);
+			bool wantWindowUpdate = (announcedWindow_ < windowToAnnounce_());
+			retransmitNow_ = false;
+
+			if(wantRetransmit) {
+				// Resend the first unacknowledged segment. If the remote supports SACK,
+				// resend the next segment that was presumably lost instead.
+				auto sn = localSettledSn_;
+				auto chunk = std::min(highPointer, sendMss_);
+				if(sackEnabled_ && !sackedRanges_.empty()) {
+					auto hole = nextHole_(snBefore(retransmitSn_, localSettledSn_)
+							? localSettledSn_ : retransmitSn_);
+					if(!hole)
+						continue;
+					sn = hole->first;
+					chunk = hole->second;
+				}
+				retransmitSn_ = sn + chunk;
+
+				// Karn's algorithm: the timed segment might have been lost.
+				rttPending_ = false;
+
+				if(debugTcp)
+					std::cout << "netserver: Retransmitting TCP data (" << chunk << " bytes)"
+							<< std::endl;
+				if(!(co_await sendSegment_(sn, sn - localSettledSn_, chunk)))
+					co_return;
+				continue;
+			}
 
 			if(!wantData && !wantAck && !wantWindowUpdate) {
 				co_await flushEvent_.async_wait();
 				continue;
 			}
 
-			// Construct and transmit the TCP packet.
-			auto targetInfo = co_await ip4().targetByRemote(remoteEp_.ipAddress);
-			if (!targetInfo) {
-				// TODO: Return an error to users.
-				std::cout << "netserver: Destination unreachable" << std::endl;
-				co_return;
+			size_t chunk = 0;
+			if(wantData)
+				chunk = std::min({
+					bytesAvailable - flushPointer,
+					sendPointer - flushPointer,
+					std::max(sendMss_, tsoSize_)
+				});
+
+			auto sn = localFlushedSn_;
+			if(chunk) {
+				if(localFlushedSn_ == localHighSn_) {
+					// This segment carries new data; time it unless a sample is pending.
+					if(!rttPending_) {
+						HEL_CHECK(helGetClock(&rttStart_));
+						rttPending_ = true;
+						rttSn_ = sn + chunk;
+					}
+				}
+
+				localFlushedSn_ += chunk;
+				if(snBefore(localHighSn_, localFlushedSn_))
+					localHighSn_ = localFlushedSn_;
+				if(!retransmitDeadline_)
+					armRetransmitTimer_();
 			}
 
-			auto chunk = std::min({
-				bytesAvailable - flushPointer,
-				windowPointer - flushPointer,
-				size_t{1000} // TODO: Perform path MTU discovery.
-			});
+			if(debugTcp)
+				std::cout << "netserver: Sending TCP data (" << chunk << " bytes)" << std::endl;
+			if(!(co_await sendSegment_(sn, flushPointer, chunk)))
+				co_return;
+		}
+	}
+}
 
-			std::vector<char> buf;
-			buf.resize(sizeof(TcpHeader) + chunk);
+async::result<bool> Tcp4Socket::sendSegment_(uint32_t sn, size_t offset, size_t chunk) {
+	// Construct and transmit the TCP packet.
+	auto targetInfo = co_await ip4().targetByRemote(routeCache_, remoteEp_.ipAddress);
+	if (!targetInfo) {
+		// TODO: Return an error to users.
+		std::cout << "netserver: Destination unreachable" << std::endl;
+		co_return false;
+	}
 
-			auto header = new (buf.data()) TcpHeader {
-				.srcPort = localEp_.port,
-				.destPort = remoteEp_.port,
-				.seqNumber = localFlushedSn_,
-				.ackNumber = remoteKnownSn_,
-				.flags = {},
-				.window = std::min(recvRing_.spaceForEnqueue(), size_t{0xFFFF}),
-				.checksum = 0,
-				.urgentPointer = 0,
-			};
-			header->flags.store(TcpHeader::headerWords(sizeof(TcpHeader) / 4)
-					| TcpHeader::ackFlag(true));
+	auto &offloads = targetInfo->link->offloads();
+	if(offloads.tso4 && offloads.txChecksum) {
+		// Leave room for the headers (including maximal TCP options).
+		auto room = offloads.maxTsoSize - sizeof(Ip4Packet::Header) - sizeof(TcpHeader) - 40;
+		tsoSize_ = room / sendMss_ * sendMss_;
+	}else{
+		tsoSize_ = 0;
+	}
 
-			sendRing_.dequeueLookahead(flushPointer, buf.data() + sizeof(TcpHeader), chunk);
+	if(chunk > sendMss_ && !tsoSize_) {
+		// The route changed since the chunk was sized; segment it in software.
+		for(size_t done = 0; done < chunk; done += sendMss_) {
+			if(!(co_await sendSegment_(sn + done, offset + done,
+					std::min(sendMss_, chunk - done))))
+				co_return false;
+		}
+		co_return true;
+	}
 
-			// Fill in the checksum.
-			PseudoHeader pseudo {
-				.src = targetInfo->source,
-				.dst = remoteEp_.ipAddress,
-				.len = buf.size()
-			};
-			Checksum csum;
-			csum.update(&pseudo, sizeof(PseudoHeader));
-			csum.update(buf.data(), buf.size());
-			header->checksum = csum.finalize();
+	uint8_t options[40];
+	size_t optionsSize = writeOptions_(options, false);
+	size_t window = windowToAnnounce_();
+
+	std::vector<char> buf;
+	buf.resize(sizeof(TcpHeader) + optionsSize + chunk);
+
+	auto header = new (buf.data()) TcpHeader {
+		.srcPort = localEp_.port,
+		.destPort = remoteEp_.port,
+		.seqNumber = sn,
+		.ackNumber = remoteKnownSn_,
+		.flags = {},
+		.window = window >> recvWindowShift_,
+		.checksum = 0,
+		.urgentPointer = 0,
+	};
+	header->flags.store(TcpHeader::headerWords((sizeof(TcpHeader) + optionsSize) / 4)
+			| TcpHeader::ackFlag(true));
+	memcpy(buf.data() + sizeof(TcpHeader), options, optionsSize);
 
-			localFlushedSn_ += chunk;
-			remoteAckedSn_ = remoteKnownSn_;
-			announcedWindow_ = recvRing_.spaceForEnqueue();
+	sendRing_.dequeueLookahead(offset, buf.data() + sizeof(TcpHeader) + optionsSize, chunk);
 
-			if(debugTcp)
-				std::cout << "netserver: Sending TCP data (" << chunk << " bytes)" << std::endl;
-			auto error = co_await ip4().sendFrame(std::move(*targetInfo),
-				buf.data(), buf.size(),
-				static_cast<uint16_t>(IpProto::tcp));
-			if (error != protocols::fs::Error::none) {
-				// TODO: Return an error to users.
-				std::cout << "netserver: Could not send TCP packet" << std::endl;
-				co_return;
+	// Fill in the checksum.
+	PseudoHeader pseudo {
+		.src = targetInfo->source,
+		.dst = remoteEp_.ipAddress,
+		.len = buf.size()
+	};
+	nic::TransmitOffload offload;
+	// Keep all segments of the connection on the same transmit queue.
+	offload.flowHash = ip4FlowHash(localEp_.ipAddress, localEp_.port,
+		remoteEp_.ipAddress, remoteEp_.port);
+	Checksum csum;
+	csum.update(&pseudo, sizeof(PseudoHeader));
+	if(offloads.txChecksum) {
+		// Let the device sum up the header and the payload.
+		header->checksum = static_cast<uint16_t>(~csum.finalize());
+		offload.checksum = true;
+		offload.checksumOffset = offsetof(TcpHeader, checksum);
+	}else{
+		csum.update(buf.data(), buf.size());
+		header->checksum = csum.finalize();
+	}
+
+	if(chunk > sendMss_) {
+		offload.tcpSegmentation = true;
+		offload.segmentSize = sendMss_;
+		offload.headerLength = sizeof(TcpHeader) + optionsSize;
+	}
+
+	remoteAckedSn_ = remoteKnownSn_;
+	announcedWindow_ = window;
+	forceAck_ = false;
+
+	auto error = co_await ip4().sendFrame(std::move(*targetInfo),
+		buf.data(), buf.size(),
+		static_cast<uint16_t>(IpProto::tcp), offload, true);
+	if (error != protocols::fs::Error::none) {
+		// TODO: Return an error to users.
+		std::cout << "netserver: Could not send TCP packet" << std::endl;
+		co_return false;
+	}
+	co_return true;
+}
+
+size_t Tcp4Socket::writeOptions_(uint8_t *p, bool syn) {
+	size_t n = 0;
+	auto put8 = [&] (uint8_t v) {
+		p[n++] = v;
+	};
+	auto put16 = [&] (uint16_t v) {
+		put8(v >> 8);
+		put8(v);
+	};
+	auto put32 = [&] (uint32_t v) {
+		put16(v >> 16);
+		put16(v);
+	};
+
+	if(syn) {
+		put8(maxSegmentSizeOption);
+		put8(4);
+		put16(maxSegmentSize);
+
+		put8(noOperation);
+		put8(windowScaleOption);
+		put8(3);
+		put8(windowScaleShift);
+
+		put8(noOperation);
+		put8(noOperation);
+		put8(sackPermittedOption);
+		put8(2);
+	}
+
+	if(syn || tsEnabled_) {
+		uint64_t now;
+		HEL_CHECK(helGetClock(&now));
+
+		put8(noOperation);
+		put8(noOperation);
+		put8(timestampOption);
+		put8(10);
+		put32(now / 1'000'000);
+		put32(syn ? 0 : tsRecent_);
+	}
+
+	if(!syn && sackEnabled_ && !outOfOrder_.empty()) {
+		// Report the contiguous ranges of out-of-order data.
+		std::pair<uint32_t, uint32_t> blocks[maxSackBlocks];
+		size_t numBlocks = 0;
+		for(auto &segment : outOfOrder_) {
+			uint32_t end = segment.sn + segment.data.size();
+			if(numBlocks && !snBefore(blocks[numBlocks - 1].second, segment.sn)) {
+				if(snBefore(blocks[numBlocks - 1].second, end))
+					blocks[numBlocks - 1].second = end;
+				continue;
 			}
+			if(numBlocks == maxSackBlocks)
+				break;
+			blocks[numBlocks++] = {segment.sn, end};
+		}
+
+		put8(noOperation);
+		put8(noOperation);
+		put8(sackOption);
+		put8(2 + 8 * numBlocks);
+		for(size_t k = 0; k < numBlocks; ++k) {
+			put32(blocks[k].first);
+			put32(blocks[k].second);
+		}
+	}
+
+	assert(!(n % 4) && n <= 40);
+	return n;
+}
+
+size_t Tcp4Socket::windowToAnnounce_() {
+	// The window must be representable in the (scaled) 16-bit window field.
+	auto window = std::min(recvRing_.spaceForEnqueue(), size_t{0xFFFF} << recvWindowShift_);
+	return (window >> recvWindowShift_) << recvWindowShift_;
+}
+
+async::result<void> Tcp4Socket::runRetransmitTimer_() {
+	while(true) {
+		if(!retransmitDeadline_) {
+			co_await timerEvent_.async_wait();
+			continue;
+		}
+
+		uint64_t now;
+		HEL_CHECK(helGetClock(&now));
+		if(now < retransmitDeadline_) {
+			// If the timer is re-armed while we sleep, we re-check the deadline afterwards.
+			co_await helix::sleepFor(retransmitDeadline_ - now);
+			continue;
+		}
+
+		retransmitDeadline_ = 0;
+		handleRetransmitTimeout_();
+	}
+}
+
+void Tcp4Socket::armRetransmitTimer_() {
+	uint64_t now;
+	HEL_CHECK(helGetClock(&now));
+	retransmitDeadline_ = now + rtoEstimator_.rto();
+	timerEvent_.raise();
+}
+
+void Tcp4Socket::handleRetransmitTimeout_() {
+	if(localHighSn_ == localSettledSn_)
+		return;
+
+	if(debugTcp)
+		std::cout << "netserver: TCP retransmission timeout" << std::endl;
+
+	// RFC 6298, 5.5: back off the timer.
+	rtoEstimator_.backoff();
+	rttPending_ = false;
+
+	if(connectState_ == ConnectState::sendSyn) {
+		retransmitNow_ = true;
+	}else if(connectState_ == ConnectState::connected) {
+		congestion_->onTimeout(localHighSn_ - localSettledSn_);
+		dupAcks_ = 0;
+		inRecovery_ = false;
+		recoverSn_ = localHighSn_;
+
+		// The remote may discard SACKed data (RFC 2018, 8), so we forget about it.
+		sackedRanges_.clear();
+
+		// Go back to the first unacknowledged byte and send everything again.
+		localFlushedSn_ = localSettledSn_;
+	}
+
+	armRetransmitTimer_();
+	flushEvent_.raise();
+}
+
+void Tcp4Socket::handleAck_(TcpPacket &packet) {
+	auto ackSn = packet.header.ackNumber.load();
+	size_t validWindow = localHighSn_ - localSettledSn_;
+	size_t ackPointer = ackSn - localSettledSn_;
+	if(ackPointer > validWindow) {
+		std::cout << "netserver: Rejecting ack-number outside of valid window"
+				<< std::endl;
+		return;
+	}
+
+	size_t window = size_t{packet.header.window.load()} << sendWindowShift_;
+
+	if(sackEnabled_)
+		updateScoreboard_(packet.options);
+
+	if(!ackPointer) {
+		// Detect duplicate ACKs (RFC 5681, 2).
+		bool isDuplicate = validWindow
+				&& !packet.payload().size()
+				&& !(packet.header.flags.load() & (TcpHeader::synFlag | TcpHeader::finFlag))
+				&& localWindowSn_ == localSettledSn_ + window;
+		localWindowSn_ = localSettledSn_ + window;
+		if(!isDuplicate) {
+			flushEvent_.raise();
+			return;
+		}
+
+		++dupAcks_;
+		if(inRecovery_) {
+			congestion_->onRecoveryDupAck();
+			// With SACK, each duplicate ACK allows us to repair another hole.
+			if(sackEnabled_ && nextHole_(snBefore(retransmitSn_, localSettledSn_)
+					? localSettledSn_ : retransmitSn_))
+				retransmitNow_ = true;
+		}else if(dupAcks_ == 3 && snBefore(recoverSn_, ackSn)) {
+			// Fast retransmit (RFC 6582, 3.2).
+			congestion_->enterRecovery(validWindow);
+			inRecovery_ = true;
+			recoverSn_ = localHighSn_;
+			retransmitSn_ = localSettledSn_;
+			retransmitNow_ = true;
+		}
+		flushEvent_.raise();
+		return;
+	}
+
+	localSettledSn_ += ackPointer;
+	localWindowSn_ = localSettledSn_ + window;
+	if(snBefore(localFlushedSn_, localSettledSn_))
+		localFlushedSn_ = localSettledSn_;
+	sendRing_.dequeueAdvance(ackPointer);
+	pruneScoreboard_();
+	dupAcks_ = 0;
+
+	uint64_t now;
+	HEL_CHECK(helGetClock(&now));
+	if(tsEnabled_ && packet.options.hasTimestamp && packet.options.tsEcr) {
+		// RFC 7323, 4.1: timestamps allow RTT samples even for retransmitted segments.
+		uint32_t elapsed = static_cast<uint32_t>(now / 1'000'000) - packet.options.tsEcr;
+		rtoEstimator_.addSample(uint64_t{elapsed} * 1'000'000);
+		rttPending_ = false;
+	}else if(rttPending_ && !snBefore(localSettledSn_, rttSn_)) {
+		rtoEstimator_.addSample(now - rttStart_);
+		rttPending_ = false;
+	}
+
+	size_t flightSize = localHighSn_ - localSettledSn_;
+	if(inRecovery_) {
+		if(!snBefore(localSettledSn_, recoverSn_)) {
+			congestion_->exitRecovery(flightSize);
+			inRecovery_ = false;
+		}else{
+			// Partial ACK: the next segment was lost as well.
+			congestion_->onPartialAck(ackPointer);
+			retransmitNow_ = true;
+		}
+	}else{
+		congestion_->onAck(ackPointer);
+	}
+
+	// RFC 6298, 5.2 and 5.3: stop or restart the retransmission timer.
+	if(flightSize) {
+		retransmitDeadline_ = now + rtoEstimator_.rto();
+	}else{
+		retransmitDeadline_ = 0;
+	}
+
+	outSeq_ = ++currentSeq_;
+	flushEvent_.raise();
+	settleEvent_.raise();
+	pollEvent_.raise();
+}
+
+void Tcp4Socket::updateScoreboard_(const TcpOptions &options) {
+	bool changed = false;
+	for(size_t k = 0; k < options.numSackBlocks; ++k) {
+		auto [left, right] = options.sackBlocks[k];
+		// Ignore blocks that are not within the data in flight.
+		if(!snBefore(left, right) || !snBefore(localSettledSn_, left)
+				|| snBefore(localHighSn_, right))
+			continue;
+		sackedRanges_.push_back({left, right});
+		changed = true;
+	}
+	if(!changed)
+		return;
+
+	// Sort the ranges (relative to localSettledSn_) and merge overlapping ranges.
+	std::sort(sackedRanges_.begin(), sackedRanges_.end(), [&] (auto &a, auto &b) {
+		return a.first - localSettledSn_ < b.first - localSettledSn_;
+	});
+	size_t n = 0;
+	for(size_t k = 0; k < sackedRanges_.size(); ++k) {
+		auto range = sackedRanges_[k];
+		if(n && !snBefore(sackedRanges_[n - 1].second, range.first)) {
+			if(snBefore(sackedRanges_[n - 1].second, range.second))
+				sackedRanges_[n - 1].second = range.second;
+			continue;
+		}
+		sackedRanges_[n++] = range;
+	}
+	sackedRanges_.resize(n);
+}
+
+void Tcp4Socket::pruneScoreboard_() {
+	size_t n = 0;
+	for(auto range : sackedRanges_) {
+		if(!snBefore(localSettledSn_, range.second))
+			continue;
+		if(snBefore(range.first, localSettledSn_))
+			range.first = localSettledSn_;
+		sackedRanges_[n++] = range;
+	}
+	sackedRanges_.resize(n);
+}
+
+std::optional<std::pair<uint32_t, size_t>> Tcp4Socket::nextHole_(uint32_t sn) {
+	for(auto [left, right] : sackedRanges_) {
+		if(snBefore(sn, left))
+			return std::pair<uint32_t, size_t>{sn, std::min(size_t{left - sn}, sendMss_)};
+		if(snBefore(sn, right))
+			sn = right;
+	}
+	return std::nullopt;
+}
+
+void Tcp4Socket::storeOutOfOrder_(uint32_t sn, arch::dma_buffer_view payload) {
+	// Only keep data that fits into the window.
+	size_t offset = sn - remoteKnownSn_;
+	size_t space = recvRing_.spaceForEnqueue();
+	if(offset >= space || outOfOrder_.size() >= maxOutOfOrderSegments)
+		return;
+	size_t size = std::min(payload.size(), space - offset);
+
+	auto it = outOfOrder_.begin();
+	while(it != outOfOrder_.end() && snBefore(it->sn, sn))
+		++it;
+	if(it != outOfOrder_.end() && it->sn == sn && it->data.size() >= size)
+		return; // Duplicate segment.
+
+	std::vector<char> data(size);
+	memcpy(data.data(), payload.data(), size);
+	outOfOrder_.insert(it, OutOfOrderSegment{sn, std::move(data)});
+}
+
+void Tcp4Socket::drainOutOfOrder_() {
+	while(!outOfOrder_.empty()) {
+		auto &segment = outOfOrder_.front();
+		if(snBefore(remoteKnownSn_, segment.sn))
+			break;
+
+		size_t skip = remoteKnownSn_ - segment.sn;
+		if(skip < segment.data.size()) {
+			size_t chunk = std::min(segment.data.size() - skip, recvRing_.spaceForEnqueue());
+			recvRing_.enqueue(segment.data.data() + skip, chunk);
+			remoteKnownSn_ += chunk;
+			announcedWindow_ -= std::min(size_t{announcedWindow_}, chunk);
 		}
+		outOfOrder_.erase(outOfOrder_.begin());
+	}
+}
+
+void Tcp4Socket::autotuneReceive_(size_t copied) {
+	// There is no point in growing the ring beyond the largest window that we can announce.
+	if(recvBufferLocked_ || recvRing_.shift() >= maxRingShift
+			|| recvRing_.capacity() > (size_t{0xFFFF} << recvWindowShift_))
+		return;
+
+	uint64_t now;
+	HEL_CHECK(helGetClock(&now));
+	recvPeriodCopied_ += copied;
+	if(now - recvPeriodStart_ < rtoEstimator_.srtt())
+		return;
+
+	// If the application consumed more than half of the ring within one RTT,
+	// the window limits the throughput (similar to Linux' dynamic right-sizing).
+	if(2 * recvPeriodCopied_ > recvRing_.capacity()) {
+		recvRing_.resize(recvRing_.shift() + 1);
+		if(debugTcp)
+			std::cout << "netserver: Growing TCP receive ring to "
+					<< recvRing_.capacity() << " bytes" << std::endl;
+		flushEvent_.raise();
+	}
+	recvPeriodCopied_ = 0;
+	recvPeriodStart_ = now;
+}
+
+void Tcp4Socket::autotuneSend_() {
+	if(sendBufferLocked_ || sendRing_.shift() >= maxRingShift)
+		return;
+
+	// The ring needs to hold the data in flight plus the data for the next RTT.
+	size_t wanted = 2 * std::min(congestion_->window(), size_t{localWindowSn_ - localSettledSn_});
+	if(sendRing_.capacity() < wanted) {
+		sendRing_.resize(sendRing_.shift() + 1);
+		if(debugTcp)
+			std::cout << "netserver: Growing TCP send ring to "
+					<< sendRing_.capacity() << " bytes" << std::endl;
 	}
 }
 
@@ -778,6 +1558,34 @@ void Tcp4Socket::handleInPacket_(TcpPacket packet) {
 			return;
 		}
 
+		if(rttPending_) {
+			uint64_t now;
+			HEL_CHECK(helGetClock(&now));
+			rtoEstimator_.addSample(now - rttStart_);
+			rttPending_ = false;
+		}
+		retransmitDeadline_ = 0;
+		retransmitNow_ = false;
+
+		// Options are only in effect if both sides support them.
+		auto &options = packet.options;
+		if(options.mss) {
+			sendMss_ = std::clamp(size_t{*options.mss}, size_t{64}, maxSegmentSize);
+		}else{
+			sendMss_ = defaultSegmentSize;
+		}
+		if(options.windowScale) {
+			sendWindowShift_ = *options.windowScale;
+			recvWindowShift_ = windowScaleShift;
+		}
+		if(options.hasTimestamp) {
+			tsEnabled_ = true;
+			tsRecent_ = options.tsVal;
+		}
+		sackEnabled_ = options.sackPermitted;
+		congestion_ = makeNewReno(sendMss_);
+
+		recoverSn_ = localSettledSn_;
 		++localSettledSn_;
 		localWindowSn_ = localSettledSn_ + packet.header.window.load();
 		remoteAckedSn_ = packet.header.seqNumber.load();
@@ -789,6 +1597,9 @@ void Tcp4Socket::handleInPacket_(TcpPacket packet) {
 		if(packet.header.seqNumber.load() == remoteKnownSn_) {
 			bool gotUpdate = false;
 
+			if(tsEnabled_ && packet.options.hasTimestamp)
+				tsRecent_ = packet.options.tsVal;
+
 			auto payload = packet.payload();
 			size_t chunk = std::min(payload.size(), recvRing_.spaceForEnqueue());
 			if(chunk) {
@@ -800,6 +1611,9 @@ void Tcp4Socket::handleInPacket_(TcpPacket packet) {
 					announcedWindow_ -= chunk;
 				}
 
+				// Data that arrived out of order might be in order now.
+				drainOutOfOrder_();
+
 				inSeq_ = ++currentSeq_;
 				gotUpdate = true;
 			}
@@ -817,23 +1631,17 @@ void Tcp4Socket::handleInPacket_(TcpPacket packet) {
 				flushEvent_.raise();
 				pollEvent_.raise();
 			}
+		}else if(packet.payload().size()) {
+			// Keep out-of-order data for later. Acknowledge what we have such that
+			// the remote can detect the loss via duplicate ACKs (and SACK blocks).
+			if(snBefore(remoteKnownSn_, packet.header.seqNumber.load()))
+				storeOutOfOrder_(packet.header.seqNumber.load(), packet.payload());
+			forceAck_ = true;
+			flushEvent_.raise();
 		}
 
-		if(packet.header.flags.load() & TcpHeader::ackFlag) {
-			size_t validWindow = localFlushedSn_ - localSettledSn_;
-			size_t ackPointer = packet.header.ackNumber.load() - localSettledSn_;
-			if(ackPointer <= validWindow) {
-				localSettledSn_ += ackPointer;
-				localWindowSn_ = localSettledSn_ + packet.header.window.load();
-				sendRing_.dequeueAdvance(ackPointer);
-				outSeq_ = ++currentSeq_;
-				settleEvent_.raise();
-				pollEvent_.raise();
-			}else{
-				std::cout << "netserver: Rejecting ack-number outside of valid window"
-						<< std::endl;
-			}
-		}
+		if(packet.header.flags.load() & TcpHeader::ackFlag)
+			handleAck_(packet);
 	}
 }
 
@@ -848,33 +1656,87 @@ void Tcp4::feedDatagram(smarter::shared_ptr<const Ip4Packet> packet) {
 		std::cout << "netserver: Received TCP packet at port " << tcp.header.destPort.load()
 				<< " (" << tcp.payload().size() << " bytes)" << std::endl;
 
-	auto it = binds.lower_bound({ 0, tcp.header.destPort.load() });
-	for (; it != binds.end() && it->first.port == tcp.header.destPort.load(); it++) {
-		auto existingEp = it->first;
-		if (existingEp.ipAddress == tcp.packet->header.destination
-				|| existingEp.ipAddress == INADDR_ANY) {
+	TcpEndpoint local{tcp.packet->header.destination, tcp.header.destPort.load()};
+	TcpEndpoint remote{tcp.packet->header.source, tcp.header.srcPort.load()};
+
+	// Segments of existing connections are found by their 4-tuple.
+	// Connections that were made from a wildcard bind have an unspecified local address.
+	for (auto address : {local.ipAddress, uint32_t{INADDR_ANY}}) {
+		auto it = connections.find(ConnectionKey{{address, local.port}, remote});
+		if (it != connections.end()) {
 			it->second->handleInPacket_(std::move(tcp));
-			break;
+			return;
 		}
 	}
+
+	auto it = binds.find(local.port);
+	if (it == binds.end())
+		return;
+
+	// Sockets that are bound to the destination address take precedence over wildcard binds.
+	// Segments are spread over SO_REUSEPORT sockets by the hash of the 4-tuple.
+	auto &bound = it->second;
+	size_t numExact = std::ranges::count_if(bound, [&] (auto &socket) {
+		return socket->localEp_.ipAddress == local.ipAddress;
+	});
+	auto wanted = numExact ? local.ipAddress : uint32_t{INADDR_ANY};
+	size_t numWanted = numExact ? numExact : std::ranges::count_if(bound, [&] (auto &socket) {
+		return socket->localEp_.ipAddress == INADDR_ANY;
+	});
+	if (!numWanted)
+		return;
+
+	auto n = ConnectionKeyHash{}({local, remote}) % numWanted;
+	for (auto &socket : bound) {
+		if (socket->localEp_.ipAddress != wanted)
+			continue;
+		if (!n--) {
+			socket->handleInPacket_(std::move(tcp));
+			return;
+		}
+	}
+}
+
+size_t Tcp4::ConnectionKeyHash::operator() (const ConnectionKey &key) const {
+	return ip4FlowHash(key.local.ipAddress, key.local.port,
+		key.remote.ipAddress, key.remote.port);
 }
 
 bool Tcp4::tryBind(smarter::shared_ptr<Tcp4Socket> socket, TcpEndpoint wantedEp) {
-	auto it = binds.lower_bound(wantedEp);
-	for (; it != binds.end() && it->first.port == wantedEp.port; it++) {
-		auto existingEp = it->first;
-		if (existingEp.ipAddress == INADDR_ANY || wantedEp.ipAddress == INADDR_ANY
-				|| existingEp.ipAddress == wantedEp.ipAddress) {
-			return false;
+	auto it = binds.find(wantedEp.port);
+	if (it != binds.end()) {
+		for (auto &existing : it->second) {
+			auto existingEp = existing->localEp_;
+			if (existingEp.ipAddress == INADDR_ANY || wantedEp.ipAddress == INADDR_ANY
+					|| existingEp.ipAddress == wantedEp.ipAddress) {
+				if (!(socket->reusePort_ && existing->reusePort_ && existingEp == wantedEp))
+					return false;
+			}
 		}
 	}
 	socket->localEp_ = wantedEp;
-	binds.emplace(wantedEp, std::move(socket));
+	binds[wantedEp.port].push_back(std::move(socket));
 	return true;
 }
 
-bool Tcp4::unbind(TcpEndpoint e) {
-	return binds.erase(e) != 0;
+bool Tcp4::unbind(Tcp4Socket *socket, TcpEndpoint e) {
+	auto it = binds.find(e.port);
+	if (it == binds.end())
+		return false;
+	auto n = std::erase_if(it->second, [&] (auto &bound) {
+		return bound.get() == socket;
+	});
+	if (it->second.empty())
+		binds.erase(it);
+	return n != 0;
+}
+
+bool Tcp4::addConnection(smarter::shared_ptr<Tcp4Socket> socket, TcpEndpoint local, TcpEndpoint remote) {
+	return connections.try_emplace(ConnectionKey{local, remote}, std::move(socket)).second;
+}
+
+bool Tcp4::removeConnection(TcpEndpoint local, TcpEndpoint remote) {
+	return connections.erase(ConnectionKey{local, remote}) != 0;
 }
 
 void Tcp4::serveSocket(int flags, helix::UniqueLane lane) {
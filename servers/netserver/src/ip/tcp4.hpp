@@ -2,7 +2,8 @@
 
 #include <helix/ipc.hpp>
 #include <smarter.hpp>
-#include <map>
+#include <unordered_map>
+#include <vector>
 
 class Ip4Packet;
 
@@ -11,6 +12,8 @@ struct TcpEndpoint {
 		return std::tie(l.port, l.ipAddress) < std::tie(r.port, r.ipAddress);
 	}
 
+	friend bool operator==(const TcpEndpoint &, const TcpEndpoint &) = default;
+
 	uint32_t ipAddress = 0;
 	uint16_t port = 0;
 };
@@ -20,9 +23,26 @@ struct Tcp4Socket;
 struct Tcp4 {
 	void feedDatagram(smarter::shared_ptr<const Ip4Packet>);
 	bool tryBind(smarter::shared_ptr<Tcp4Socket> socket, TcpEndpoint ipAddress);
-	bool unbind(TcpEndpoint remote);
+	bool unbind(Tcp4Socket *socket, TcpEndpoint local);
+	// Connections are found by their 4-tuple before falling back to bound sockets.
+	// false if another connection already uses the 4-tuple.
+	bool addConnection(smarter::shared_ptr<Tcp4Socket> socket, TcpEndpoint local, TcpEndpoint remote);
+	bool removeConnection(TcpEndpoint local, TcpEndpoint remote);
 	void serveSocket(int flags, helix::UniqueLane lane);
 
 private:
-	std::map<TcpEndpoint, smarter::shared_ptr<Tcp4Socket>> binds;
+	struct ConnectionKey {
+		TcpEndpoint local;
+		TcpEndpoint remote;
+
+		friend bool operator==(const ConnectionKey &, const ConnectionKey &) = default;
+	};
+
+	struct ConnectionKeyHash {
+		size_t operator() (const ConnectionKey &key) const;
+	};
+
+	std::unordered_map<ConnectionKey, smarter::shared_ptr<Tcp4Socket>, ConnectionKeyHash> connections;
+	// Bound sockets by local port. Sockets only share an endpoint if all of them set SO_REUSEPORT.
+	std::unordered_map<uint16_t, std::vector<smarter::shared_ptr<Tcp4Socket>>> binds;
 };
@@ -1,14 +1,16 @@
 #include "udp4.hpp"
 
 #include "ip4.hpp"
-#include "checksum.hpp"
+#include "rcvbuf.hpp"
 
 #include <async/basic.hpp>
 #include <async/recurring-event.hpp>
 #include <async/result.hpp>
 #include <async/queue.hpp>
+#include <core/checksum.hpp>
 #include <arch/bit.hpp>
 #include <protocols/fs/server.hpp>
+#include <cstddef>
 #include <cstring>
 #include <iomanip>
 #include <random>
@@ -18,6 +20,9 @@
 #include <netinet/ip.h>
 
 namespace {
+
+constexpr bool debugUdp = false;
+
 struct stl_allocator {
 	void *allocate(size_t size) {
 		return operator new(size);
@@ -81,7 +86,7 @@ struct Udp {
 		if (payload.size() < header.len) {
 			return false;
 		}
-		if (header.chk != 0) {
+		if (header.chk != 0 && !packet->l4ChecksumValid) {
 			PseudoHeader phdr;
 			phdr.src = packet->header.source;
 			phdr.dst = packet->header.destination;
@@ -103,6 +108,9 @@ struct Udp {
 	smarter::shared_ptr<const Ip4Packet> packet;
 
 	std::weak_ptr<nic::Link> link;
+
+	// Drop counter of the socket when the datagram was queued (SO_RXQ_OVFL).
+	uint32_t drops = 0;
 };
 
 Endpoint &Endpoint::operator=(struct sockaddr_in sa) {
@@ -145,7 +153,7 @@ struct Udp4Socket {
 	Udp4Socket(Udp4 *parent) : parent_(parent) {}
 
 	~Udp4Socket() {
-		parent_->unbind(local_);
+		parent_->unbind(this, local_);
 	}
 
 	static auto make_socket(Udp4 *parent) {
@@ -237,6 +245,7 @@ struct Udp4Socket {
 
 		auto element = co_await self->queue_.async_get();
 		auto packet = element->payload();
+		self->rcvbuf_.release(packet.size());
 		auto copy_size = std::min(packet.size(), len);
 		std::memcpy(data, packet.data(), copy_size);
 
@@ -261,6 +270,11 @@ struct Udp4Socket {
 			});
 		}
 
+		if(self->reportDrops_ && element->drops) {
+			ctrl.message(SOL_SOCKET, SO_RXQ_OVFL, sizeof(uint32_t));
+			ctrl.write<uint32_t>(element->drops);
+		}
+
 		co_return RecvData{ctrl.buffer(), copy_size, sizeof(addr), 0};
 	}
 
@@ -288,6 +302,11 @@ struct Udp4Socket {
 			target = self->remote_;
 		}
 
+		// The datagram must fit into a (possibly fragmented) IPv4 packet.
+		if (len > 0xFFFF - sizeof(Udp::Header) - 20) {
+			co_return protocols::fs::Error::messageSize;
+		}
+
 		if (target.port == 0 || target.addr == 0) {
 			std::cout << "netserver: udp needs destination" << std::endl;
 			co_return protocols::fs::Error::destAddrRequired;
@@ -320,7 +339,7 @@ struct Udp4Socket {
 		source.ensureEndian();
 		target.ensureEndian();
 
-		auto ti = co_await ip4().targetByRemote(targetIpNe);
+		auto ti = co_await ip4().targetByRemote(self->routeCache_, targetIpNe);
 		if (!ti) {
 			co_return protocols::fs::Error::netUnreachable;
 		}
@@ -332,21 +351,34 @@ struct Udp4Socket {
 			.len = header.len
 		};
 		chk.update(&psh, sizeof(psh));
-		chk.update(&header, sizeof(header));
-		chk.update(data, len);
-		header.chk = convert_endian<endian::big>(chk.finalize());
 
-		std::cout << "netserver:" << std::endl << std::hex
-			<< std::setw(8) << psh.src << std::endl
-			<< std::setw(8) << psh.dst << std::endl
-			<< std::setw(8) << psh.len << std::endl
+		nic::TransmitOffload offload;
+		offload.flowHash = ip4FlowHash(self->local_.addr, self->local_.port,
+			targetIpNe, convert_endian<endian::big, endian::native>(target.port));
+		if (ti->link->offloads().txChecksum) {
+			// Let the device sum up the header and the payload.
+			header.chk = convert_endian<endian::big>(static_cast<uint16_t>(~chk.finalize()));
+			offload.checksum = true;
+			offload.checksumStart = 0;
+			offload.checksumOffset = offsetof(Udp::Header, chk);
+		} else {
+			chk.update(&header, sizeof(header));
+			chk.update(data, len);
+			header.chk = convert_endian<endian::big>(chk.finalize());
+		}
 
-			<< std::setw(8) << header.src << std::endl
-			<< std::setw(8) << header.dst << std::endl
-			<< std::setw(8) << header.len << std::endl
-			<< std::setw(8) << header.chk << std::endl << std::dec;
+		if(debugUdp)
+			std::cout << "netserver:" << std::endl << std::hex
+				<< std::setw(8) << psh.src << std::endl
+				<< std::setw(8) << psh.dst << std::endl
+				<< std::setw(8) << psh.len << std::endl
 
-		if (header.chk == 0) {
+				<< std::setw(8) << header.src << std::endl
+				<< std::setw(8) << header.dst << std::endl
+				<< std::setw(8) << header.len << std::endl
+				<< std::setw(8) << header.chk << std::endl << std::dec;
+
+		if (header.chk == 0 && !offload.checksum) {
 			header.chk = ~header.chk;
 		}
 
@@ -355,7 +387,7 @@ struct Udp4Socket {
 
 		auto error = co_await ip4().sendFrame(std::move(*ti),
 			buf.data(), buf.size(),
-			static_cast<uint16_t>(IpProto::udp));
+			static_cast<uint16_t>(IpProto::udp), offload);
 		if (error != protocols::fs::Error::none) {
 			co_return error;
 		}
@@ -400,6 +432,25 @@ struct Udp4Socket {
 			int val = *reinterpret_cast<int *>(optbuf.data());
 
 			self->ipPacketInfo_ = (val != 0);
+		} else if(layer == SOL_SOCKET && number == SO_REUSEPORT) {
+			if(optbuf.size() != sizeof(int))
+				co_return Error::illegalArguments;
+
+			int val = *reinterpret_cast<int *>(optbuf.data());
+
+			self->reusePort_ = (val != 0);
+		} else if(layer == SOL_SOCKET && number == SO_RCVBUF) {
+			if(optbuf.size() != sizeof(int))
+				co_return Error::illegalArguments;
+
+			self->rcvbuf_.resize(*reinterpret_cast<int *>(optbuf.data()));
+		} else if(layer == SOL_SOCKET && number == SO_RXQ_OVFL) {
+			if(optbuf.size() != sizeof(int))
+				co_return Error::illegalArguments;
+
+			int val = *reinterpret_cast<int *>(optbuf.data());
+
+			self->reportDrops_ = (val != 0);
 		} else {
 			printf("netserver: unhandled setsockopt layer %d number %d\n", layer, number);
 			co_return protocols::fs::Error::invalidProtocolOption;
@@ -446,9 +497,12 @@ struct Udp4Socket {
 private:
 	friend struct Udp4;
 
+	// Datagrams reference the frames that they were received in.
 	async::queue<Udp, stl_allocator> queue_;
+	ReceiveBuffer rcvbuf_;
 	Endpoint remote_;
 	Endpoint local_;
+	Ip4RouteCache routeCache_;
 	Udp4 *parent_;
 	smarter::weak_ptr<Udp4Socket> holder_;
 
@@ -457,6 +511,8 @@ private:
 	uint64_t _inSeq;
 
 	bool ipPacketInfo_ = false;
+	bool reusePort_ = false;
+	bool reportDrops_ = false;
 };
 
 void Udp4::feedDatagram(smarter::shared_ptr<const Ip4Packet> packet, std::weak_ptr<nic::Link> link) {
@@ -466,37 +522,99 @@ void Udp4::feedDatagram(smarter::shared_ptr<const Ip4Packet> packet, std::weak_p
 		return;
 	}
 
-	std::cout << "received udp datagram to port " << udp.header.dst << std::endl;
+	if(debugUdp)
+		std::cout << "netserver: received udp datagram to port "
+				<< udp.header.dst << std::endl;
+
+	auto i = binds.find(udp.header.dst);
+	if (i == binds.end()) {
+		return;
+	}
 
-	auto i = binds.lower_bound({ 0, udp.header.dst });
-	for (; i != binds.end() && i->first.port == udp.header.dst; i++) {
-		auto ep = i->first;
-		if (ep.addr == udp.packet->header.destination
-			|| ep.addr == INADDR_ANY) {
-			i->second->queue_.emplace(std::move(udp));
-			i->second->_inSeq = ++i->second->_currentSeq;
-			i->second->_statusBell.raise();
+	// Find the best matching socket: sockets that are connected to the source
+	// take precedence over unconnected ones, and sockets that are bound to the
+	// destination address take precedence over wildcard binds.
+	auto destination = udp.packet->header.destination;
+	auto source = udp.packet->header.source;
+	auto score = [&] (const Udp4Socket &socket) {
+		int result = 0;
+		if (socket.local_.addr != INADDR_ANY) {
+			if (socket.local_.addr != destination)
+				return -1;
+			result += 1;
+		}
+		if (socket.remote_.addr == source && socket.remote_.port == udp.header.src)
+			result += 2;
+		return result;
+	};
+
+	int bestScore = -1;
+	size_t numBest = 0;
+	for (auto &socket : i->second) {
+		auto s = score(*socket);
+		if (s > bestScore) {
+			bestScore = s;
+			numBest = 1;
+		} else if (s == bestScore) {
+			numBest++;
+		}
+	}
+	if (bestScore < 0) {
+		return;
+	}
+
+	// Spread datagrams over equally good SO_REUSEPORT sockets by the hash of the 4-tuple.
+	size_t n = 0;
+	if (numBest > 1) {
+		n = ip4FlowHash(destination, udp.header.dst, source, udp.header.src) % numBest;
+	}
+
+	for (auto &socket : i->second) {
+		if (score(*socket) != bestScore || n--) {
+			continue;
+		}
+		if (!socket->rcvbuf_.charge(udp.payload().size())) {
 			break;
 		}
+		udp.drops = socket->rcvbuf_.drops();
+		socket->queue_.emplace(std::move(udp));
+		socket->_inSeq = ++socket->_currentSeq;
+		socket->_statusBell.raise();
+		break;
 	}
 }
 
 bool Udp4::tryBind(smarter::shared_ptr<Udp4Socket> socket, Endpoint addr) {
-	auto i = binds.lower_bound(addr);
-	for (; i != binds.end() && i->first.port == addr.port; i++) {
-		auto ep = i->first;
-		if (ep.addr == INADDR_ANY || addr.addr == INADDR_ANY
-			|| ep.addr == addr.addr) {
-			return false;
+	auto i = binds.find(addr.port);
+	if (i != binds.end()) {
+		for (auto &existing : i->second) {
+			auto ep = existing->local_;
+			if (ep.addr == INADDR_ANY || addr.addr == INADDR_ANY
+				|| ep.addr == addr.addr) {
+				// SO_REUSEPORT sockets may share the exact same endpoint.
+				if (!socket->reusePort_ || !existing->reusePort_ || ep.addr != addr.addr) {
+					return false;
+				}
+			}
 		}
 	}
 	socket->local_ = addr;
-	binds.emplace(addr, std::move(socket));
+	binds[addr.port].push_back(std::move(socket));
 	return true;
 }
 
-bool Udp4::unbind(Endpoint e) {
-	return binds.erase(e) != 0;
+bool Udp4::unbind(Udp4Socket *socket, Endpoint e) {
+	auto i = binds.find(e.port);
+	if (i == binds.end()) {
+		return false;
+	}
+	auto n = std::erase_if(i->second, [&] (auto &bound) {
+		return bound.get() == socket;
+	});
+	if (i->second.empty()) {
+		binds.erase(i);
+	}
+	return n != 0;
 }
 
 void Udp4::serveSocket(helix::UniqueLane lane) {
@@ -2,7 +2,8 @@
 
 #include <helix/ipc.hpp>
 #include <smarter.hpp>
-#include <map>
+#include <unordered_map>
+#include <vector>
 #include <netserver/nic.hpp>
 
 class Ip4Packet;
@@ -21,8 +22,9 @@ struct Udp4Socket;
 struct Udp4 {
 	void feedDatagram(smarter::shared_ptr<const Ip4Packet>, std::weak_ptr<nic::Link> link);
 	bool tryBind(smarter::shared_ptr<Udp4Socket> socket, Endpoint addr);
-	bool unbind(Endpoint remote);
+	bool unbind(Udp4Socket *socket, Endpoint local);
 	void serveSocket(helix::UniqueLane lane);
 private:
-	std::map<Endpoint, smarter::shared_ptr<Udp4Socket>> binds;
+	// Bound sockets by local port. Sockets only share an endpoint if all of them set SO_REUSEPORT.
+	std::unordered_map<uint16_t, std::vector<smarter::shared_ptr<Udp4Socket>>> binds;
 };
@@ -0,0 +1,108 @@
+#include <assert.h>
+#include <iostream>
+#include <linux/rtnetlink.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+
+#include <core/cmdline.hpp>
+#include <frg/cmdline.hpp>
+
+#include "ip/ip4.hpp"
+#include "loopback.hpp"
+
+LoopbackLink::LoopbackLink(unsigned int dropEvery)
+: nic::Link(1500, &dmaPool_), dropEvery_{dropEvery} {
+	raw_ip_ = true;
+	loopback_ = true;
+	l1_up_ = true;
+	configureName("lo");
+}
+
+async::result<size_t> LoopbackLink::receive(arch::dma_buffer_view frame) {
+	while(queue_.empty())
+		co_await queueEvent_.async_wait();
+
+	auto packet = std::move(queue_.front());
+	queue_.pop_front();
+
+	assert(packet.size() <= frame.size());
+	memcpy(frame.data(), packet.data(), packet.size());
+	co_return packet.size();
+}
+
+async::result<void> LoopbackLink::send(const arch::dma_buffer_view frame) {
+	numSent_++;
+	if(dropEvery_ && !(numSent_ % dropEvery_))
+		co_return;
+	if(queue_.size() >= maxQueuedPackets)
+		co_return;
+
+	auto bytes = static_cast<const uint8_t *>(frame.data());
+	queue_.emplace_back(bytes, bytes + frame.size());
+	queueEvent_.raise();
+	co_return;
+}
+
+size_t LoopbackLink::receiveQueueDepth() {
+	return 64;
+}
+
+async::result<void> LoopbackLink::postReceives(std::vector<arch::dma_buffer> buffers, size_t queue) {
+	assert(!queue);
+	for(auto &buffer : buffers)
+		postedBuffers_.push_back(std::move(buffer));
+	co_return;
+}
+
+async::result<std::vector<nic::Link::ReceivedFrame>> LoopbackLink::harvestReceived(size_t queue) {
+	assert(!queue);
+	while(queue_.empty() || postedBuffers_.empty())
+		co_await queueEvent_.async_wait();
+
+	std::vector<ReceivedFrame> frames;
+	while(!queue_.empty() && !postedBuffers_.empty()) {
+		auto packet = std::move(queue_.front());
+		auto buffer = std::move(postedBuffers_.front());
+		queue_.pop_front();
+		postedBuffers_.pop_front();
+
+		assert(packet.size() <= buffer.size());
+		memcpy(buffer.data(), packet.data(), packet.size());
+		frames.push_back({std::move(buffer), packet.size()});
+	}
+	co_return frames;
+}
+
+async::result<std::shared_ptr<LoopbackLink>> setupLoopback() {
+	Cmdline cmdline;
+	auto cmdline_str = co_await cmdline.get();
+
+	frg::string_view drop;
+	frg::array args = {
+		frg::option("netserver.lo_drop", frg::as_string_view(drop)),
+	};
+	frg::parse_arguments({cmdline_str.data(), cmdline_str.length()}, args);
+
+	unsigned int dropEvery = 0;
+	if(drop.size()) {
+		std::string drop_str{drop.data(), drop.size()};
+		dropEvery = strtoul(drop_str.c_str(), nullptr, 10);
+		std::cout << "netserver: loopback drops every " << dropEvery
+			<< "th packet" << std::endl;
+	}
+
+	auto link = std::make_shared<LoopbackLink>(dropEvery);
+
+	constexpr uint32_t localhost = 0x7F000001;
+	ip4().setLink({localhost, 8}, link);
+
+	Ip4Router::Route route{{localhost & 0xFF000000, 8}, link};
+	route.source = localhost;
+	route.scope = RT_SCOPE_HOST;
+	route.protocol = RTPROT_KERNEL;
+	ip4Router().addRoute(std::move(route));
+
+	nic::runDevice(link);
+	co_return link;
+}
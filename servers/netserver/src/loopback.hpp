@@ -0,0 +1,40 @@
+#pragma once
+
+#include <arch/dma_pool.hpp>
+#include <async/recurring-event.hpp>
+#include <async/result.hpp>
+#include <deque>
+#include <memory>
+#include <netserver/nic.hpp>
+#include <vector>
+
+// Software link that feeds every sent IP packet back into the receive path.
+// Like a NIC, it copies packets into posted receive buffers in batches; it also
+// serves as a stand-in device for benchmarking the receive path.
+// For testing, it can drop every n-th packet.
+struct LoopbackLink final : nic::Link {
+	explicit LoopbackLink(unsigned int dropEvery = 0);
+
+	async::result<size_t> receive(arch::dma_buffer_view frame) override;
+	async::result<void> send(const arch::dma_buffer_view frame) override;
+
+	size_t receiveQueueDepth() override;
+	async::result<void> postReceives(std::vector<arch::dma_buffer> buffers, size_t queue) override;
+	async::result<std::vector<ReceivedFrame>> harvestReceived(size_t queue) override;
+
+private:
+	// Packets beyond this limit are dropped, as a full transmit queue would.
+	static constexpr size_t maxQueuedPackets = 512;
+
+	arch::contiguous_pool dmaPool_;
+	std::deque<std::vector<uint8_t>> queue_;
+	std::deque<arch::dma_buffer> postedBuffers_;
+	async::recurring_event queueEvent_;
+
+	unsigned int dropEvery_;
+	uint64_t numSent_ = 0;
+};
+
+// Creates the loopback link (with address 127.0.0.1/8) and starts its receive loop.
+// The kernel command line option netserver.lo_drop=<n> makes it drop every n-th packet.
+async::result<std::shared_ptr<LoopbackLink>> setupLoopback();
@@ -8,6 +8,7 @@
 #include <stdlib.h>
 
 #include <async/result.hpp>
+#include <core/polling.hpp>
 #include <bragi/helpers-std.hpp>
 #include <hel.h>
 #include <hel-syscalls.h>
@@ -21,6 +22,7 @@
 #include "fs.bragi.hpp"
 
 #include "ip/ip4.hpp"
+#include "loopback.hpp"
 #include "netlink/netlink.hpp"
 #include "raw.hpp"
 
@@ -36,6 +38,9 @@
 // Maps mbus IDs to device objects
 std::unordered_map<int64_t, std::shared_ptr<nic::Link>> baseDeviceMap;
 
+// Key of the loopback link in baseDeviceMap; mbus IDs are never negative.
+constexpr int64_t loopbackDeviceId = -1;
+
 std::optional<helix::UniqueDescriptor> posixLane;
 
 const std::string VENDOR_REALTEK = "10ec";
@@ -645,6 +650,11 @@ async::detached advertise() {
 	}(std::move(entity));
 }
 
+async::result<void> createLoopback() {
+	auto link = co_await setupLoopback();
+	baseDeviceMap.insert({loopbackDeviceId, std::move(link)});
+}
+
 static constexpr protocols::svrctl::ControlOperations controlOps = {
 	.bind = bindDevice
 };
@@ -660,6 +670,8 @@ int main() {
 
 //	HEL_CHECK(helSetPriority(kHelThisThread, 3));
 
+	async::detach(configurePolling(helix::Dispatcher::global(), "netserver", 1000));
+	async::detach(createLoopback());
 	async::detach(protocols::svrctl::serveControl(&controlOps));
 	advertise();
 	async::run_forever(helix::currentDispatcher);
@@ -46,7 +46,7 @@ void NetlinkSocket::sendLinkPacket(std::shared_ptr<nic::Link> nic, void *h) {
 
 	b.message<struct ifinfomsg>({
 		.ifi_family = AF_UNSPEC,
-		.ifi_type = ARPHRD_ETHER,
+		.ifi_type = static_cast<unsigned short>(nic->loopback() ? ARPHRD_LOOPBACK : ARPHRD_ETHER),
 		.ifi_index = nic->index(),
 		.ifi_flags = IFF_UP | IFF_RUNNING | nic->iff_flags(),
 	});
@@ -188,7 +188,7 @@ void NetlinkSocket::getRoute(struct nlmsghdr *hdr) {
 
 	// Loop over all ipv4 and ipv6 routes, and return them.
 	// TODO: also return ipv6 routes.
-	auto ipv4_router = ip4Router();
+	auto &ipv4_router = ip4Router();
 
 	for(auto route : ipv4_router.getRoutes()) {
 		sendRoutePacket(hdr, route);
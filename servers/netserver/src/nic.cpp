@@ -1,8 +1,10 @@
+#include <core/checksum.hpp>
 #include <core/id-allocator.hpp>
 #include <format>
 #include <netserver/nic.hpp>
 
 #include <algorithm>
+#include <cstddef>
 #include <cstring>
 #include <arch/bit.hpp>
 #include <frg/formatting.hpp>
@@ -22,6 +24,30 @@ std::unordered_map<std::string, id_allocator<int>> prefixedNames_;
 } /* namespace */
 
 namespace nic {
+RecyclingPool::RecyclingPool(arch::dma_pool *upstream, size_t bufferSize, size_t maxCached)
+: upstream_{upstream}, bufferSize_{bufferSize}, maxCached_{maxCached} {
+	cached_.reserve(maxCached);
+}
+
+void *RecyclingPool::allocate(size_t size, size_t count, size_t align) {
+	if(size * count == bufferSize_ && align <= alignof(std::max_align_t)
+			&& !cached_.empty()) {
+		auto pointer = cached_.back();
+		cached_.pop_back();
+		return pointer;
+	}
+	return upstream_->allocate(size, count, align);
+}
+
+void RecyclingPool::deallocate(void *pointer, size_t size, size_t count, size_t align) {
+	if(size * count == bufferSize_ && align <= alignof(std::max_align_t)
+			&& cached_.size() < maxCached_) {
+		cached_.push_back(pointer);
+		return;
+	}
+	upstream_->deallocate(pointer, size, count, align);
+}
+
 uint8_t &MacAddress::operator[](size_t idx) {
 	return mac_[idx];
 }
@@ -126,6 +152,63 @@ Link::AllocatedBuffer Link::allocateFrame(MacAddress to, EtherType type,
 	return buf;
 }
 
+async::result<void> Link::sendOffloaded(const arch::dma_buffer_view frame,
+		TransmitOffload offload) {
+	assert(!offload.tcpSegmentation);
+
+	if(offload.checksum) {
+		// The checksum field already contains the pseudo header sum.
+		Checksum csum;
+		csum.update(frame.subview(offload.checksumStart));
+		uint16_t sum = csum.finalize();
+
+		auto field = reinterpret_cast<uint8_t *>(
+			frame.subview(offload.checksumStart + offload.checksumOffset, 2).data());
+		field[0] = sum >> 8;
+		field[1] = sum & 0xFF;
+	}
+
+	co_await send(frame);
+}
+
+size_t Link::numReceiveQueues() {
+	return 1;
+}
+
+size_t Link::receiveQueueDepth() {
+	return 1;
+}
+
+async::result<void> Link::postReceives(std::vector<arch::dma_buffer> buffers, size_t queue) {
+	assert(!queue);
+	for(auto &buffer : buffers) {
+		auto posted = std::make_unique<PostedReceive>(std::move(buffer));
+		runReceive_(posted.get());
+		postedReceives_.push_back(std::move(posted));
+	}
+	co_return;
+}
+
+async::detached Link::runReceive_(PostedReceive *posted) {
+	posted->length = co_await receive(posted->buffer);
+	posted->done = true;
+	receiveEvent_.raise();
+}
+
+async::result<std::vector<Link::ReceivedFrame>> Link::harvestReceived(size_t queue) {
+	assert(!queue);
+	while(postedReceives_.empty() || !postedReceives_.front()->done)
+		co_await receiveEvent_.async_wait();
+
+	std::vector<ReceivedFrame> frames;
+	while(!postedReceives_.empty() && postedReceives_.front()->done) {
+		auto &posted = postedReceives_.front();
+		frames.push_back({std::move(posted->buffer), posted->length});
+		postedReceives_.pop_front();
+	}
+	co_return frames;
+}
+
 unsigned int Link::iff_flags() {
 	unsigned int flags = 0;
 
@@ -139,40 +222,87 @@ unsigned int Link::iff_flags() {
 		flags |= IFF_BROADCAST;
 	if(l1_up_)
 		flags |= IFF_LOWER_UP;
+	if(loopback_)
+		flags |= IFF_LOOPBACK;
 
 	return flags;
 }
 
-async::detached runDevice(std::shared_ptr<nic::Link> dev) {
+namespace {
+
+constexpr size_t receiveFrameSize = 1514;
+
+void dispatchFrame(std::shared_ptr<nic::Link> &dev, arch::dma_buffer frameBuffer, size_t len,
+		bool checksumValid) {
 	using namespace arch;
-	while(true) {
-		dma_buffer frameBuffer { dev->dmaPool(), 1514 };
-		auto len = co_await dev->receive(frameBuffer);
-
-		if(!dev->rawIp()) {
-			auto capsule = frameBuffer.subview(14, len - 14);
-			auto data = reinterpret_cast<uint8_t*>(frameBuffer.data());
-			uint16_t ethertype = data[12] << 8 | data[13];
-			nic::MacAddress dstsrc[2];
-			std::memcpy(dstsrc, data, sizeof(dstsrc));
-
-			raw().feedPacket(frameBuffer.subview(0, len));
-
-			switch (ethertype) {
-			case ETHER_TYPE_IP4:
-				ip4().feedPacket(dstsrc[0], dstsrc[1],
-					std::move(frameBuffer), capsule, dev);
-				break;
-			case ETHER_TYPE_ARP:
-				neigh4().feedArp(dstsrc[0], capsule, dev);
-				break;
-			default:
-				break;
-			}
-		} else {
-			dma_buffer_view capsule = frameBuffer;
-			ip4().feedPacket({}, {}, std::move(frameBuffer), capsule, dev);
+	auto owner = std::make_shared<dma_buffer>(std::move(frameBuffer));
+	if(!dev->rawIp()) {
+		auto capsule = owner->subview(14, len - 14);
+		auto data = reinterpret_cast<uint8_t*>(owner->data());
+		uint16_t ethertype = data[12] << 8 | data[13];
+		nic::MacAddress dstsrc[2];
+		std::memcpy(dstsrc, data, sizeof(dstsrc));
+
+		raw().feedPacket(owner, owner->subview(0, len));
+
+		switch (ethertype) {
+		case ETHER_TYPE_IP4:
+			ip4().feedPacket(dstsrc[0], dstsrc[1],
+				std::move(owner), capsule, dev, checksumValid);
+			break;
+		case ETHER_TYPE_ARP:
+			neigh4().feedArp(dstsrc[0], capsule, dev);
+			break;
+		default:
+			break;
 		}
+	} else {
+		dma_buffer_view capsule = owner->subview(0, len);
+		ip4().feedPacket({}, {}, std::move(owner), capsule, dev, checksumValid);
 	}
 }
+
+async::detached runReceiveQueue(std::shared_ptr<nic::Link> dev, size_t queue) {
+	using namespace arch;
+	auto depth = std::max(dev->receiveQueueDepth(), size_t{1});
+
+	// Frame buffers are recycled once the stack drops them (e.g., after
+	// an IP packet was consumed), so that steady-state receive does not
+	// hit the upstream allocator. Keep twice the queue depth cached to
+	// absorb frames that are still queued in sockets.
+	auto pool = std::make_unique<RecyclingPool>(dev->dmaPool(), receiveFrameSize, 2 * depth);
+
+	auto allocateBuffers = [&] (size_t n) {
+		std::vector<dma_buffer> buffers;
+		buffers.reserve(n);
+		for(size_t i = 0; i < n; i++)
+			buffers.emplace_back(pool.get(), receiveFrameSize);
+		return buffers;
+	};
+
+	co_await dev->postReceives(allocateBuffers(depth), queue);
+
+	while(true) {
+		auto frames = co_await dev->harvestReceived(queue);
+
+		// Refill the receive queue before processing the frames such that
+		// the device can continue to receive while we are busy.
+		co_await dev->postReceives(allocateBuffers(frames.size()), queue);
+
+		for(auto &frame : frames)
+			dispatchFrame(dev, std::move(frame.buffer), frame.length, frame.checksumValid);
+	}
+}
+
+} // anonymous namespace
+
+// Multi-queue support only covers negotiating the queues with the device
+// and steering flows to them. The receive loops of all queues run on
+// netserver's dispatcher, i.e., packet processing is not spread over cores:
+// the IP layer and the socket tables are not thread-safe.
+async::detached runDevice(std::shared_ptr<nic::Link> dev) {
+	for(size_t queue = 0; queue < dev->numReceiveQueues(); queue++)
+		runReceiveQueue(dev, queue);
+	co_return;
+}
 } // namespace nic
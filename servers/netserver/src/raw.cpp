@@ -25,7 +25,7 @@ managarm::fs::Errors Raw::serveSocket(helix::UniqueLane lane, int type, int prot
 	return managarm::fs::Errors::SUCCESS;
 }
 
-void Raw::feedPacket(arch::dma_buffer_view frame) {
+void Raw::feedPacket(nic::FrameOwner owner, arch::dma_buffer_view frame) {
 	for(auto s = sockets_.begin(); s != sockets_.end(); s++) {
 		size_t accept_bytes = SIZE_MAX;
 
@@ -37,9 +37,12 @@ void Raw::feedPacket(arch::dma_buffer_view frame) {
 				continue;
 		}
 
-		RawSocket::PacketInfo info{frame.size(), frame.subview(0, std::min(frame.size(), accept_bytes))};
+		auto view = frame.subview(0, std::min(frame.size(), accept_bytes));
+		if(!(*s)->rcvbuf_.charge(view.size()))
+			continue;
 
-		(*s)->queue_.emplace(info);
+		RawSocket::PacketInfo info{frame.size(), owner, view, (*s)->rcvbuf_.drops()};
+		(*s)->queue_.emplace(std::move(info));
 		(*s)->_inSeq = ++(*s)->_currentSeq;
 		(*s)->_statusBell.raise();
 	}
@@ -100,6 +103,7 @@ async::result<protocols::fs::RecvResult> RawSocket::recvmsg(void *obj,
 
 	auto element = co_await self->queue_.async_get();
 	assert(element);
+	self->rcvbuf_.release(element->view.size());
 
 	size_t data_len = std::min(len, element->view.size());
 	memcpy(data, element->view.byte_data(), data_len);
@@ -115,6 +119,11 @@ async::result<protocols::fs::RecvResult> RawSocket::recvmsg(void *obj,
 		});
 	}
 
+	if(self->reportDrops_ && element->drops) {
+		ctrl.message(SOL_SOCKET, SO_RXQ_OVFL, sizeof(uint32_t));
+		ctrl.write<uint32_t>(element->drops);
+	}
+
 	co_return protocols::fs::RecvData{ctrl.buffer(), data_len, 0, 0};
 }
 
@@ -147,6 +156,17 @@ async::result<frg::expected<protocols::fs::Error>> RawSocket::setSocketOption(vo
 	} else if(layer == SOL_PACKET && number == PACKET_AUXDATA) {
 		auto opt = *reinterpret_cast<int *>(optbuf.data());
 		self->packetAuxData_ = (opt != 0);
+	} else if(layer == SOL_SOCKET && number == SO_RCVBUF) {
+		if(optbuf.size() != sizeof(int))
+			co_return protocols::fs::Error::illegalArguments;
+
+		self->rcvbuf_.resize(*reinterpret_cast<int *>(optbuf.data()));
+	} else if(layer == SOL_SOCKET && number == SO_RXQ_OVFL) {
+		if(optbuf.size() != sizeof(int))
+			co_return protocols::fs::Error::illegalArguments;
+
+		auto opt = *reinterpret_cast<int *>(optbuf.data());
+		self->reportDrops_ = (opt != 0);
 	} else {
 		printf("netserver: unhandled setsockopt layer %d number %d\n", layer, number);
 		co_return protocols::fs::Error::invalidProtocolOption;
@@ -8,11 +8,13 @@
 #include <protocols/fs/server.hpp>
 #include <vector>
 
+#include "rcvbuf.hpp"
+
 struct RawSocket;
 
 struct Raw {
 	managarm::fs::Errors serveSocket(helix::UniqueLane lane, int type, int proto, int flags);
-	void feedPacket(arch::dma_buffer_view frame);
+	void feedPacket(nic::FrameOwner owner, arch::dma_buffer_view frame);
 
 private:
 	friend RawSocket;
@@ -60,16 +62,22 @@ private:
 	int proto [[maybe_unused]];
 	bool filterLocked_ = false;
 	bool packetAuxData_ = false;
+	bool reportDrops_ = false;
 	std::optional<std::vector<char>> filter_ = std::nullopt;
 
 	std::shared_ptr<nic::Link> link = {};
 
 	struct PacketInfo {
 		size_t len;
+		// Keeps the frame alive while view is queued.
+		nic::FrameOwner owner;
 		arch::dma_buffer_view view;
+		// Drop counter of the socket when the packet was queued (SO_RXQ_OVFL).
+		uint32_t drops;
 	};
 
 	async::queue<PacketInfo, frg::stl_allocator> queue_;
+	ReceiveBuffer rcvbuf_;
 
 	async::recurring_event _statusBell;
 	uint64_t _currentSeq;
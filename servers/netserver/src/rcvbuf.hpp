@@ -0,0 +1,54 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+
+// Accounts the datagrams that are queued on a socket against its receive
+// buffer size (SO_RCVBUF). Datagrams that arrive while the buffer is full
+// are dropped and counted; see SO_RXQ_OVFL.
+struct ReceiveBuffer {
+	// Defaults and limits follow Linux (net.core.rmem_default and SOCK_MIN_RCVBUF).
+	static constexpr size_t defaultSize = 212992;
+	static constexpr size_t minSize = 2304;
+	static constexpr size_t maxSize = size_t{8} << 20;
+
+	// Charged for each datagram in addition to its length; approximates the
+	// queue element and the unused part of the frame that the datagram pins.
+	static constexpr size_t datagramOverhead = 256;
+
+	// Like Linux, only checks whether the buffer is already full before charging
+	// a datagram, such that a datagram larger than the buffer is still accepted.
+	bool charge(size_t length) {
+		if(used_ >= size_) {
+			drops_++;
+			return false;
+		}
+		used_ += length + datagramOverhead;
+		return true;
+	}
+
+	void release(size_t length) {
+		used_ -= length + datagramOverhead;
+	}
+
+	// Implements setsockopt(SO_RCVBUF). Like Linux, this doubles the value
+	// to leave room for bookkeeping overhead.
+	void resize(int value) {
+		size_ = std::clamp(2 * static_cast<size_t>(std::max(value, 0)), minSize, maxSize);
+	}
+
+	size_t size() const {
+		return size_;
+	}
+
+	// Number of dropped datagrams; wraps around like the Linux counter.
+	uint32_t drops() const {
+		return drops_;
+	}
+
+private:
+	size_t size_ = defaultSize;
+	size_t used_ = 0;
+	uint32_t drops_ = 0;
+};
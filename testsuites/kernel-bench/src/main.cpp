@@ -1,9 +1,26 @@
+#include <arpa/inet.h>
+#include <errno.h>
+#include <fcntl.h>
 #include <math.h>
+#include <netinet/in.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <unistd.h>
 
 #include <async/result.hpp>
 #include <async/algorithm.hpp>
+#include <core/checksum.hpp>
 #include <helix/ipc.hpp>
 
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <random>
+#include <string>
+#include <thread>
 #include <vector>
 
 namespace {
@@ -21,6 +38,13 @@ struct IterationsPerSecondBenchmark {
 		return elapsed.count() > 1'000'000'000;
 	}
 
+	// For repetitions that run out of work before they are done.
+	void announceRate(uint64_t iters) {
+		auto elapsed = duration_cast<std::chrono::nanoseconds>(
+					std::chrono::high_resolution_clock::now() - ref_);
+		announceIterations(iters * 1'000'000'000 / std::max(elapsed.count(), int64_t{1}));
+	}
+
 	void announceIterations(uint64_t iters) {
 		std::cout << "    " << iters << " iterations per second" << std::endl;
 		results_.push_back(iters);
@@ -102,6 +126,108 @@ void doFutexBenchmark() {
 	bench.finalizeStatistics();
 }
 
+void doFutexPingPongBenchmark(unsigned int numPairs) {
+	std::cout << "futex ping-pong (" << numPairs << " pairs of threads)" << std::endl;
+
+	// Each pair of threads passes a token back and forth through its own futex.
+	// Since pairs do not share futexes, throughput should scale with the number of pairs.
+	struct alignas(64) PingPong {
+		std::atomic<int> word{0};
+		std::atomic<bool> done{false};
+	};
+
+	auto waitFor = [] (PingPong &pp, int value) -> bool {
+		while(true) {
+			auto current = pp.word.load(std::memory_order_acquire);
+			if(current == value)
+				return true;
+			if(pp.done.load())
+				return false;
+			HEL_CHECK(helFutexWait(reinterpret_cast<int *>(&pp.word), current, -1));
+		}
+	};
+
+	auto pass = [] (PingPong &pp, int value) {
+		pp.word.store(value, std::memory_order_release);
+		HEL_CHECK(helFutexWake(reinterpret_cast<int *>(&pp.word)));
+	};
+
+	IterationsPerSecondBenchmark bench;
+	for(int k = 0; k < 5; ++k) {
+		std::vector<PingPong> pairs(numPairs);
+		std::atomic<uint64_t> n{0};
+		bench.launchRepetition();
+
+		std::vector<std::thread> threads;
+		for(unsigned int j = 0; j < numPairs; ++j) {
+			threads.emplace_back([&, j] {
+				auto &pp = pairs[j];
+				uint64_t roundTrips = 0;
+				while(!bench.isRepetitionDone()) {
+					pass(pp, 1);
+					waitFor(pp, 0);
+					++roundTrips;
+				}
+				pp.done.store(true);
+				pass(pp, 2);
+				n.fetch_add(roundTrips, std::memory_order_relaxed);
+			});
+			threads.emplace_back([&, j] {
+				auto &pp = pairs[j];
+				while(waitFor(pp, 1))
+					pass(pp, 0);
+			});
+		}
+		for(auto &thread : threads)
+			thread.join();
+		bench.announceIterations(n.load());
+	}
+	bench.finalizeStatistics();
+}
+
+async::result<void> armAndCancelTimers(IterationsPerSecondBenchmark &bench, uint64_t &n) {
+	while(!bench.isRepetitionDone()) {
+		for(int i = 0; i < 100; ++i) {
+			uint64_t tick;
+			HEL_CHECK(helGetClock(&tick));
+
+			// Arm a timer that does not expire during the benchmark and cancel it immediately.
+			helix::AwaitClock await;
+			auto &&submit = helix::submitAwaitClock(&await, tick + 1'000'000'000,
+					helix::Dispatcher::global());
+			HEL_CHECK(helCancelAsync(helix::Dispatcher::global().acquire(), await.asyncId()));
+			co_await submit.async_wait();
+			if(await.error() != kHelErrCancelled)
+				HEL_CHECK(await.error());
+			++n;
+		}
+	}
+}
+
+void doTimerBenchmark(unsigned int numThreads) {
+	std::cout << "timer arm/cancel (" << numThreads << " threads)" << std::endl;
+
+	IterationsPerSecondBenchmark bench;
+	for(int k = 0; k < 5; ++k) {
+		std::atomic<uint64_t> n{0};
+		bench.launchRepetition();
+
+		// Each thread uses its own (thread-local) dispatcher.
+		std::vector<std::thread> threads;
+		for(unsigned int j = 0; j < numThreads; ++j) {
+			threads.emplace_back([&] {
+				uint64_t ops = 0;
+				async::run(armAndCancelTimers(bench, ops), helix::currentDispatcher);
+				n.fetch_add(ops, std::memory_order_relaxed);
+			});
+		}
+		for(auto &thread : threads)
+			thread.join();
+		bench.announceIterations(n.load());
+	}
+	bench.finalizeStatistics();
+}
+
 void doAllocateBenchmark(size_t size) {
 	std::cout << "allocate memory, size = " << (size / (1024 * 1024)) << " MiB" << std::endl;
 
@@ -176,8 +302,9 @@ void doMapPopulatedBenchmark(size_t size) {
 	HEL_CHECK(helCloseDescriptor(kHelThisUniverse, handle));
 }
 
-void doPageFaultBenchmark(size_t size) {
-	std::cout << "page faults (mapping size = " << (size / (1024 * 1024)) << " MiB)" << std::endl;
+void doPageFaultBenchmark(size_t size, uint32_t allocFlags = 0) {
+	std::cout << "page faults (mapping size = " << (size / (1024 * 1024)) << " MiB"
+			<< ((allocFlags & kHelAllocHugePages) ? ", huge pages" : "") << ")" << std::endl;
 
 	IterationsPerSecondBenchmark bench;
 	for(int k = 0; k < 5; ++k) {
@@ -185,7 +312,7 @@ void doPageFaultBenchmark(size_t size) {
 		bench.launchRepetition();
 		while(!bench.isRepetitionDone()) {
 			HelHandle handle;
-			HEL_CHECK(helAllocateMemory(size, 0, nullptr, &handle));
+			HEL_CHECK(helAllocateMemory(size, allocFlags, nullptr, &handle));
 			void *window;
 			HEL_CHECK(helMapMemory(handle, kHelNullHandle, nullptr, 0, size,
 					kHelMapProtRead | kHelMapProtWrite, &window));
@@ -205,6 +332,261 @@ void doPageFaultBenchmark(size_t size) {
 	bench.finalizeStatistics();
 }
 
+void doParallelPageFaultBenchmark(size_t size, unsigned int numThreads) {
+	std::cout << "parallel page faults (mapping size = " << (size / (1024 * 1024)) << " MiB, "
+			<< numThreads << " threads)" << std::endl;
+
+	IterationsPerSecondBenchmark bench;
+	for(int k = 0; k < 5; ++k) {
+		std::atomic<uint64_t> n{0};
+		bench.launchRepetition();
+
+		// Each thread faults in its own mapping such that the threads
+		// only contend on the physical allocator.
+		std::vector<std::thread> threads;
+		for(unsigned int j = 0; j < numThreads; ++j) {
+			threads.emplace_back([&] {
+				uint64_t faults = 0;
+				while(!bench.isRepetitionDone()) {
+					HelHandle handle;
+					HEL_CHECK(helAllocateMemory(size, 0, nullptr, &handle));
+					void *window;
+					HEL_CHECK(helMapMemory(handle, kHelNullHandle, nullptr, 0, size,
+							kHelMapProtRead | kHelMapProtWrite, &window));
+
+					auto p = reinterpret_cast<volatile std::byte *>(window);
+					for(size_t progress = 0; progress < size; progress += 0x1000) {
+						p[progress] = static_cast<std::byte>(0);
+						++faults;
+					}
+
+					HEL_CHECK(helUnmapMemory(kHelNullHandle, window, size));
+					HEL_CHECK(helCloseDescriptor(kHelThisUniverse, handle));
+				}
+				n.fetch_add(faults, std::memory_order_relaxed);
+			});
+		}
+		for(auto &thread : threads)
+			thread.join();
+
+		bench.announceIterations(n.load(std::memory_order_relaxed));
+	}
+	bench.finalizeStatistics();
+}
+
+// Faults in the pages of a file mapping, similar to an fio mmap job. The file is split
+// into ten regions; each repetition touches a different one (starting at firstRegion),
+// so that its pages are not yet in the page cache and every fault is served by the file system.
+void doFileFaultBenchmark(const char *path, int firstRegion, bool random, unsigned int numThreads) {
+	std::cout << (random ? "random" : "sequential") << " file page faults ("
+			<< numThreads << " threads)" << std::endl;
+
+	int fd = open(path, O_RDONLY);
+	if(fd < 0) {
+		std::cout << "    cannot open " << path << std::endl;
+		return;
+	}
+	struct stat st;
+	if(fstat(fd, &st)) {
+		close(fd);
+		return;
+	}
+	size_t size = st.st_size & ~size_t(0xFFF);
+	auto window = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+	if(window == MAP_FAILED) {
+		close(fd);
+		return;
+	}
+
+	size_t regionPages = size / 0x1000 / 10;
+	IterationsPerSecondBenchmark bench;
+	for(int k = 0; k < 5; ++k) {
+		std::vector<size_t> pages(regionPages);
+		for(size_t i = 0; i < regionPages; ++i)
+			pages[i] = (firstRegion + k) * regionPages + i;
+		if(random)
+			std::shuffle(pages.begin(), pages.end(), std::mt19937{});
+
+		std::atomic<uint64_t> n{0};
+		bench.launchRepetition();
+
+		// Each thread faults in a contiguous chunk of the (possibly shuffled) pages.
+		std::vector<std::thread> threads;
+		for(unsigned int j = 0; j < numThreads; ++j) {
+			threads.emplace_back([&, j] {
+				auto p = reinterpret_cast<volatile std::byte *>(window);
+				size_t begin = regionPages * j / numThreads;
+				size_t end = regionPages * (j + 1) / numThreads;
+				uint64_t faults = 0;
+				for(size_t i = begin; i < end && !bench.isRepetitionDone(); ++i) {
+					(void)p[pages[i] * 0x1000];
+					++faults;
+				}
+				n.fetch_add(faults, std::memory_order_relaxed);
+			});
+		}
+		for(auto &thread : threads)
+			thread.join();
+
+		bench.announceRate(n.load(std::memory_order_relaxed));
+	}
+	bench.finalizeStatistics();
+
+	munmap(window, size);
+	close(fd);
+}
+
+// Looks up random entries of a directory with numEntries files.
+// The directory is created on the first run; later runs reuse it.
+void doDirectoryLookupBenchmark(const char *path, unsigned int numEntries) {
+	std::cout << "directory lookups (" << numEntries << " entries)" << std::endl;
+
+	std::string dir = std::string{path} + "/lookup-" + std::to_string(numEntries);
+	if(mkdir(dir.c_str(), 0755) && errno != EEXIST) {
+		std::cout << "    cannot create " << dir << std::endl;
+		return;
+	}
+	std::vector<std::string> names;
+	for(unsigned int i = 0; i < numEntries; ++i) {
+		names.push_back(dir + "/entry-" + std::to_string(i));
+		int fd = open(names.back().c_str(), O_WRONLY | O_CREAT, 0644);
+		if(fd < 0) {
+			std::cout << "    cannot create " << names.back() << std::endl;
+			return;
+		}
+		close(fd);
+	}
+
+	std::mt19937 prng;
+	std::uniform_int_distribution<unsigned int> distrib{0, numEntries - 1};
+	IterationsPerSecondBenchmark bench;
+	for(int k = 0; k < 5; ++k) {
+		uint64_t n = 0;
+		bench.launchRepetition();
+		while(!bench.isRepetitionDone()) {
+			struct stat st;
+			if(stat(names[distrib(prng)].c_str(), &st)) {
+				std::cout << "    stat() failed" << std::endl;
+				return;
+			}
+			++n;
+		}
+		bench.announceIterations(n);
+	}
+	bench.finalizeStatistics();
+}
+
+// The Internet checksum that netserver used before it summed up wide words.
+uint16_t referenceChecksum(const uint8_t *data, size_t size) {
+	uint32_t state = 0;
+	auto add = [&] (uint16_t word) {
+		state += word;
+		while(state >> 16)
+			state = (state >> 16) + (state & 0xFFFF);
+	};
+
+	if(size % 2) {
+		size--;
+		add(data[size] << 8);
+	}
+	for(size_t i = 0; i < size; i += 2)
+		add(data[i] << 8 | data[i + 1]);
+	return ~state;
+}
+
+// Reports the throughput of the Internet checksum from libcore (as used by netserver) in KiB per second.
+void doChecksumBenchmark(size_t size, bool reference) {
+	std::cout << "checksum (KiB per second), size = " << size
+			<< (reference ? " (per-word reference)" : "") << std::endl;
+
+	std::mt19937 prng;
+	std::uniform_int_distribution<unsigned int> distrib{0, 255};
+	// Start at an odd address to include the cost of misaligned loads.
+	std::vector<uint8_t> buffer(size + 1);
+	for(auto &b : buffer)
+		b = distrib(prng);
+	auto data = buffer.data() + 1;
+
+	// Accumulate the results such that the computation is not optimized out.
+	uint16_t sink = 0;
+	IterationsPerSecondBenchmark bench;
+	for(int k = 0; k < 5; ++k) {
+		uint64_t n = 0;
+		bench.launchRepetition();
+		while(!bench.isRepetitionDone()) {
+			for(int i = 0; i < 16; ++i) {
+				if(reference) {
+					sink += referenceChecksum(data, size);
+				}else{
+					Checksum chk;
+					chk.update(data, size);
+					sink += chk.finalize();
+				}
+			}
+			n += 16 * size;
+		}
+		bench.announceIterations(n / 1024);
+	}
+	bench.finalizeStatistics();
+	asm volatile ("" : : "r"(sink));
+}
+
+// Floods a UDP socket on the loopback interface from a second thread.
+// Reports the number of datagrams that arrive per second, i.e., the packet rate
+// of netserver's transmit and receive paths (excluding datagrams that are dropped
+// when the socket's receive buffer is full).
+void doUdpFloodBenchmark(size_t size) {
+	std::cout << "udp flood over loopback (packets per second), size = " << size << std::endl;
+
+	int rxFd = socket(AF_INET, SOCK_DGRAM, 0);
+	int txFd = socket(AF_INET, SOCK_DGRAM, 0);
+	if(rxFd < 0 || txFd < 0) {
+		std::cout << "    cannot create UDP sockets" << std::endl;
+		return;
+	}
+
+	sockaddr_in addr{};
+	addr.sin_family = AF_INET;
+	addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	socklen_t addrLength = sizeof(addr);
+	if(bind(rxFd, reinterpret_cast<sockaddr *>(&addr), sizeof(addr))
+			|| getsockname(rxFd, reinterpret_cast<sockaddr *>(&addr), &addrLength)) {
+		std::cout << "    cannot bind to the loopback interface" << std::endl;
+		close(rxFd);
+		close(txFd);
+		return;
+	}
+
+	std::atomic<bool> done = false;
+	std::thread sender{[&] {
+		std::vector<char> buffer(size);
+		while(!done.load(std::memory_order_relaxed))
+			sendto(txFd, buffer.data(), size, 0,
+					reinterpret_cast<sockaddr *>(&addr), sizeof(addr));
+	}};
+
+	std::vector<char> buffer(size);
+	IterationsPerSecondBenchmark bench;
+	for(int k = 0; k < 5; ++k) {
+		uint64_t n = 0;
+		bench.launchRepetition();
+		while(!bench.isRepetitionDone()) {
+			if(recv(rxFd, buffer.data(), size, 0) < 0) {
+				std::cout << "    recv() failed" << std::endl;
+				break;
+			}
+			++n;
+		}
+		bench.announceIterations(n);
+	}
+	bench.finalizeStatistics();
+
+	done.store(true, std::memory_order_relaxed);
+	sender.join();
+	close(rxFd);
+	close(txFd);
+}
+
 async::result<void> doSendRecvBufferBenchmark(size_t size) {
 	auto [lane1, lane2] = helix::createStream();
 	std::vector<std::byte> sBuf(size);
@@ -247,16 +629,157 @@ async::result<void> doSendRecvBufferBenchmark(size_t size) {
 	bench.finalizeStatistics();
 }
 
+// Unlike doSendRecvBufferBenchmark(), this uses page-aligned buffers (which enables
+// zero-copy transfers in the kernel) and reports the throughput in KiB per second.
+async::result<void> doIpcThroughputBenchmark(size_t size) {
+	auto [lane1, lane2] = helix::createStream();
+	auto sBuf = static_cast<std::byte *>(aligned_alloc(0x1000, size));
+	auto rBuf = static_cast<std::byte *>(aligned_alloc(0x1000, size));
+	assert(sBuf && rBuf);
+	memset(sBuf, 0, size);
+	memset(rBuf, 0, size);
+
+	std::cout << "ipc throughput (KiB per second), page-aligned size = "
+			<< (size / 1024) << " KiB" << std::endl;
+
+	IterationsPerSecondBenchmark bench;
+	for(int k = 0; k < 5; ++k) {
+		uint64_t n = 0;
+		bench.launchRepetition();
+		while(!bench.isRepetitionDone()) {
+			co_await async::when_all(
+				async::transform(
+					helix_ng::exchangeMsgs(lane1, helix_ng::sendBuffer(sBuf, size)
+				), [&] (auto result) {
+					auto [send] = std::move(result);
+					HEL_CHECK(send.error());
+				}),
+				async::transform(
+					helix_ng::exchangeMsgs(lane2, helix_ng::recvBuffer(rBuf, size)
+				), [&] (auto result) {
+					auto [recv] = std::move(result);
+					HEL_CHECK(recv.error());
+					assert(recv.actualLength() == size);
+				})
+			);
+			n += size / 1024;
+		}
+		bench.announceIterations(n);
+	}
+	bench.finalizeStatistics();
+
+	free(sBuf);
+	free(rBuf);
+}
+
+// Models a server that replies to many clients at once.
+// Reports the number of replies per second and the number of syscalls per reply.
+async::result<void> doReplyBenchmark(bool coalesce) {
+	constexpr size_t numClients = 16;
+
+	std::cout << "replies to " << numClients << " clients"
+			<< (coalesce ? " (coalesced)" : "") << std::endl;
+
+	std::vector<helix::UniqueLane> serverLanes;
+	std::vector<helix::UniqueLane> clientLanes;
+	for(size_t i = 0; i < numClients; ++i) {
+		auto [serverLane, clientLane] = helix::createStream();
+		serverLanes.push_back(std::move(serverLane));
+		clientLanes.push_back(std::move(clientLane));
+	}
+
+	char reply[16]{};
+	std::vector<std::array<char, 16>> buffers(numClients);
+
+	size_t pending = 0;
+	async::oneshot_event *roundDone = nullptr;
+	auto complete = [&] {
+		if(!--pending)
+			roundDone->raise();
+	};
+
+	auto sendReply = [&] (size_t i) -> async::result<void> {
+		if(coalesce) {
+			auto [send] = co_await helix_ng::exchangeMsgsCoalesced(serverLanes[i],
+					helix_ng::sendBuffer(reply, sizeof(reply)));
+			HEL_CHECK(send.error());
+		}else{
+			auto [send] = co_await helix_ng::exchangeMsgs(serverLanes[i],
+					helix_ng::sendBuffer(reply, sizeof(reply)));
+			HEL_CHECK(send.error());
+		}
+		complete();
+	};
+
+	auto receiveReply = [&] (size_t i) -> async::result<void> {
+		auto [recv] = co_await helix_ng::exchangeMsgs(clientLanes[i],
+				helix_ng::recvBuffer(buffers[i].data(), buffers[i].size()));
+		HEL_CHECK(recv.error());
+		complete();
+	};
+
+	IterationsPerSecondBenchmark bench;
+	uint64_t numReplies = 0;
+	auto submissionsBefore = helix::Dispatcher::global().numSubmissions();
+	for(int k = 0; k < 5; ++k) {
+		uint64_t n = 0;
+		bench.launchRepetition();
+		while(!bench.isRepetitionDone()) {
+			async::oneshot_event event;
+			pending = 2 * numClients;
+			roundDone = &event;
+			for(size_t i = 0; i < numClients; ++i) {
+				async::detach(receiveReply(i));
+				async::detach(sendReply(i));
+			}
+			co_await event.wait();
+			n += numClients;
+		}
+		bench.announceIterations(n);
+		numReplies += n;
+	}
+	bench.finalizeStatistics();
+
+	// Includes the submissions of the receiving side, which are never coalesced.
+	auto syscallsPerReply = static_cast<double>(helix::Dispatcher::global().numSubmissions()
+			- submissionsBefore) / numReplies;
+	std::cout << "    syscalls per reply (sender + receiver): " << syscallsPerReply << std::endl;
+}
+
 } // anonymous namespace
 
 int main() {
 	doNopBenchmark();
 	doFutexBenchmark();
+	for(unsigned int n : {1, 2, 4})
+		doFutexPingPongBenchmark(n);
+	for(unsigned int n : {1, 2, 4, 8})
+		doTimerBenchmark(n);
 	async::run(doAsyncNopBenchmark(), helix::currentDispatcher);
 	doAllocateBenchmark(1 << 20);
 	doMapBenchmark(1 << 20);
 	doMapPopulatedBenchmark(1 << 20);
 	doPageFaultBenchmark(1 << 20);
+	doPageFaultBenchmark(8 << 20);
+	doPageFaultBenchmark(8 << 20, kHelAllocHugePages);
+	for(unsigned int n : {1, 2, 4, 8})
+		doParallelPageFaultBenchmark(1 << 20, n);
+	// The file benchmarks need a large file that was not accessed since boot.
+	if(auto path = getenv("KERNEL_BENCH_FILE")) {
+		doFileFaultBenchmark(path, 0, false, 1);
+		doFileFaultBenchmark(path, 5, true, 4);
+	}
+	// Directory lookups need a writable directory on the file system under test.
+	if(auto path = getenv("KERNEL_BENCH_DIR")) {
+		for(unsigned int n : {100, 1000, 10000})
+			doDirectoryLookupBenchmark(path, n);
+	}
+	for(size_t size : {64, 1500, 64 * 1024}) {
+		doChecksumBenchmark(size, true);
+		doChecksumBenchmark(size, false);
+	}
+	for(size_t size : {64, 1024, 1472})
+		doUdpFloodBenchmark(size);
 	async::run(doSendRecvBufferBenchmark(1), helix::currentDispatcher);
 	async::run(doSendRecvBufferBenchmark(32), helix::currentDispatcher);
 	async::run(doSendRecvBufferBenchmark(128), helix::currentDispatcher);
@@ -264,4 +787,8 @@ int main() {
 	async::run(doSendRecvBufferBenchmark(16 * 1024), helix::currentDispatcher);
 	async::run(doSendRecvBufferBenchmark(64 * 1024), helix::currentDispatcher);
 	async::run(doSendRecvBufferBenchmark(1024 * 1024), helix::currentDispatcher);
+	for(size_t size : {4 * 1024, 16 * 1024, 64 * 1024, 256 * 1024, 1024 * 1024, 4096 * 1024})
+		async::run(doIpcThroughputBenchmark(size), helix::currentDispatcher);
+	async::run(doReplyBenchmark(false), helix::currentDispatcher);
+	async::run(doReplyBenchmark(true), helix::currentDispatcher);
 }
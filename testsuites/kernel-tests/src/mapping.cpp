@@ -49,3 +49,51 @@ DEFINE_TEST(unmapPartialPreserve, ([] {
 	HEL_CHECK(helUnmapMemory(kHelNullHandle, p, 0x1000));
 	HEL_CHECK(helUnmapMemory(kHelNullHandle, p + 0x2000, 0x1000));
 }))
+
+DEFINE_TEST(unmapPartialHugePage, ([] {
+	constexpr size_t hugeSize = 0x20'0000;
+
+	// Large mappings of huge page backed memory are aligned such that huge pages are used.
+	HelHandle handle;
+	HEL_CHECK(helAllocateMemory(2 * hugeSize, kHelAllocHugePages, nullptr, &handle));
+	void *window;
+	HEL_CHECK(helMapMemory(handle, kHelNullHandle, nullptr, 0, 2 * hugeSize,
+			kHelMapProtRead | kHelMapProtWrite, &window));
+
+	auto p = reinterpret_cast<std::byte *>(window);
+	for(size_t off = 0; off < 2 * hugeSize; off += 0x1000)
+		p[off] = static_cast<std::byte>(off >> 12);
+
+	// The kernel uses a huge page table entry if both the virtual and the physical
+	// address are 2 MiB aligned and the memory is physically contiguous.
+	// Check that this is the case, i.e., that the test actually splits a huge page.
+	assert(!(reinterpret_cast<uintptr_t>(window) & (hugeSize - 1)));
+	uintptr_t physical;
+	HEL_CHECK(helPointerPhysical(p, &physical));
+	assert(!(physical & (hugeSize - 1)));
+	for(size_t off = 0; off < hugeSize; off += 0x1000) {
+		uintptr_t pagePhysical;
+		HEL_CHECK(helPointerPhysical(p + off, &pagePhysical));
+		assert(pagePhysical == physical + off);
+	}
+
+	// Unmap a single page in the middle of the first huge page.
+	HEL_CHECK(helUnmapMemory(kHelNullHandle, p + 0x10'0000, 0x1000));
+
+	// Check that the remaining pages are still mapped to the same memory.
+	for(size_t off = 0; off < 2 * hugeSize; off += 0x1000) {
+		if(off == 0x10'0000)
+			continue;
+		assert(p[off] == static_cast<std::byte>(off >> 12));
+		if(off < hugeSize) {
+			uintptr_t pagePhysical;
+			HEL_CHECK(helPointerPhysical(p + off, &pagePhysical));
+			assert(pagePhysical == physical + off);
+		}
+	}
+
+	// Clean up.
+	HEL_CHECK(helUnmapMemory(kHelNullHandle, p, 0x10'0000));
+	HEL_CHECK(helUnmapMemory(kHelNullHandle, p + 0x10'1000, 2 * hugeSize - 0x10'1000));
+	HEL_CHECK(helCloseDescriptor(kHelThisUniverse, handle));
+}))
@@ -0,0 +1,122 @@
+#include <cassert>
+#include <cstdint>
+#include <random>
+#include <vector>
+
+#include <core/checksum.hpp>
+
+#include "testsuite.hpp"
+
+/*
+ * These tests compare the Internet checksum from libcore (which sums up
+ * wide words, using vector instructions if available) against the
+ * straightforward RFC 1071 algorithm that folds after every 16-bit word.
+ */
+
+namespace {
+
+uint16_t referenceChecksum(const uint8_t *data, size_t size) {
+	uint32_t state = 0;
+	auto add = [&] (uint16_t word) {
+		state += word;
+		while(state >> 16)
+			state = (state >> 16) + (state & 0xFFFF);
+	};
+
+	if(size % 2) {
+		size--;
+		add(data[size] << 8);
+	}
+	for(size_t i = 0; i < size; i += 2)
+		add(data[i] << 8 | data[i + 1]);
+	return ~state;
+}
+
+uint16_t checksum(const uint8_t *data, size_t size) {
+	Checksum chk;
+	chk.update(data, size);
+	return chk.finalize();
+}
+
+} // anonymous namespace
+
+DEFINE_TEST(checksum_random_buffers, ([] {
+	std::mt19937 prng{42};
+	std::uniform_int_distribution<unsigned int> byteDist{0, 255};
+	std::uniform_int_distribution<size_t> sizeDist{0, 4096};
+	std::uniform_int_distribution<size_t> offsetDist{0, 63};
+
+	std::vector<uint8_t> buffer(4096 + 64);
+	for(int i = 0; i < 10000; i++) {
+		for(auto &b : buffer)
+			b = byteDist(prng);
+
+		// Random (often odd) lengths at random (often misaligned) offsets.
+		auto size = sizeDist(prng);
+		auto p = buffer.data() + offsetDist(prng);
+		assert(checksum(p, size) == referenceChecksum(p, size));
+	}
+}))
+
+DEFINE_TEST(checksum_small_sizes, ([] {
+	std::mt19937 prng{1};
+	std::uniform_int_distribution<unsigned int> byteDist{0, 255};
+
+	std::vector<uint8_t> buffer(256);
+	for(auto &b : buffer)
+		b = byteDist(prng);
+
+	for(size_t offset = 0; offset < 64; offset++) {
+		for(size_t size = 0; size <= 128; size++) {
+			auto p = buffer.data() + offset;
+			assert(checksum(p, size) == referenceChecksum(p, size));
+		}
+	}
+}))
+
+DEFINE_TEST(checksum_large_buffers, ([] {
+	std::mt19937 prng{2};
+	std::uniform_int_distribution<unsigned int> byteDist{0, 255};
+
+	for(size_t size : {65535, 65536, 65537, 100'001, 1 << 20, (4 << 20) + 3}) {
+		std::vector<uint8_t> buffer(size + 1);
+		for(auto &b : buffer)
+			b = byteDist(prng);
+		assert(checksum(buffer.data(), size) == referenceChecksum(buffer.data(), size));
+		assert(checksum(buffer.data() + 1, size) == referenceChecksum(buffer.data() + 1, size));
+
+		// All-ones data maximizes the carries (and the values of the vector lanes).
+		std::fill(buffer.begin(), buffer.end(), 0xFF);
+		assert(checksum(buffer.data(), size) == referenceChecksum(buffer.data(), size));
+	}
+}))
+
+DEFINE_TEST(checksum_special_values, ([] {
+	// A sum of zero must yield 0xFFFF, while a sum of 0xFFFF must yield zero.
+	std::vector<uint8_t> zeros(1000, 0);
+	assert(checksum(zeros.data(), zeros.size()) == 0xFFFF);
+	assert(referenceChecksum(zeros.data(), zeros.size()) == 0xFFFF);
+
+	std::vector<uint8_t> ones(1000, 0xFF);
+	assert(checksum(ones.data(), ones.size()) == 0);
+	assert(referenceChecksum(ones.data(), ones.size()) == 0);
+}))
+
+DEFINE_TEST(checksum_incremental, ([] {
+	std::mt19937 prng{3};
+	std::uniform_int_distribution<unsigned int> byteDist{0, 255};
+	std::uniform_int_distribution<size_t> splitDist{0, 1500};
+
+	std::vector<uint8_t> buffer(3000);
+	for(int i = 0; i < 1000; i++) {
+		for(auto &b : buffer)
+			b = byteDist(prng);
+
+		// Splitting the data at even offsets does not change the sum.
+		auto split = splitDist(prng) & ~size_t{1};
+		Checksum chk;
+		chk.update(buffer.data(), split);
+		chk.update(buffer.data() + split, buffer.size() - split);
+		assert(chk.finalize() == referenceChecksum(buffer.data(), buffer.size()));
+	}
+}))
@@ -0,0 +1,79 @@
+#include <arpa/inet.h>
+#include <cassert>
+#include <cstring>
+#include <errno.h>
+#include <netinet/in.h>
+#include <signal.h>
+#include <stdlib.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "testsuite.hpp"
+
+DEFINE_TEST(tcp_connect_duplicate_tuple, ([] {
+	// Nothing listens on the remote endpoint and SYNs to it are not answered,
+	// hence a connect() that gets past the 4-tuple check blocks.
+	sockaddr_in remote;
+	memset(&remote, 0, sizeof(remote));
+	remote.sin_family = AF_INET;
+	remote.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	remote.sin_port = htons(9);
+
+	// Two sockets share a local endpoint through SO_REUSEPORT.
+	int fds[2];
+	sockaddr_in local;
+	memset(&local, 0, sizeof(local));
+	local.sin_family = AF_INET;
+	local.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	for(int i = 0; i < 2; i++) {
+		fds[i] = socket(AF_INET, SOCK_STREAM, 0);
+		assert(fds[i] >= 0);
+		int one = 1;
+		int e = setsockopt(fds[i], SOL_SOCKET, SO_REUSEPORT, &one, sizeof(one));
+		assert(!e);
+		e = bind(fds[i], reinterpret_cast<sockaddr *>(&local), sizeof(local));
+		assert(!e);
+
+		// The second socket binds to the port that the first one got.
+		socklen_t local_length = sizeof(local);
+		e = getsockname(fds[i], reinterpret_cast<sockaddr *>(&local), &local_length);
+		assert(!e);
+		assert(local.sin_port);
+	}
+
+	// Both sockets connect to the remote endpoint concurrently. Whichever comes
+	// second must fail right away; the other one blocks in the handshake.
+	int report[2];
+	int e = pipe(report);
+	assert(!e);
+
+	pid_t pids[2];
+	for(int i = 0; i < 2; i++) {
+		pids[i] = fork();
+		assert(pids[i] >= 0);
+		if(!pids[i]) {
+			int ret = connect(fds[i], reinterpret_cast<sockaddr *>(&remote), sizeof(remote));
+			int error = ret ? errno : 0;
+			auto written = write(report[1], &error, sizeof(error));
+			assert(written == sizeof(error));
+			exit(0);
+		}
+	}
+
+	// Bound the test's runtime in case both connects block.
+	alarm(30);
+	int error;
+	auto chunk = read(report[0], &error, sizeof(error));
+	alarm(0);
+	assert(chunk == sizeof(error));
+	assert(error == EADDRNOTAVAIL);
+
+	for(int i = 0; i < 2; i++) {
+		kill(pids[i], SIGKILL);
+		waitpid(pids[i], nullptr, 0);
+		close(fds[i]);
+	}
+	close(report[0]);
+	close(report[1]);
+}))